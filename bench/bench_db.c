@@ -0,0 +1,707 @@
+/*
+ * bench_db: microbenchmarks for the db.h layer, without HTTP in the way.
+ *
+ * For each scale a fresh database is filled with N students, N/100 courses
+ * (at least 100) and N * --enrollments enrollments, then every public db.h
+ * call is timed: lists with each order_by, deep offset paging, every find,
+ * adds, updates, removes that cascade to enrollments and the remove_all
+ * calls. Each op runs on one thread and then on --threads threads, each with
+ * its own connection (db_thread_open).
+ *
+ *   bench_db --scales 10000,100000,1000000 --threads 8 --out sqlite.json
+ *   CURRICULUM_BACKEND=memory bench_db --out memory.json
+ *
+ * Reads run for --read-ms per op; writes run --write-ops times per thread on
+ * rows the benchmark added itself, so the population stays the same size.
+ * Allocations per op count every malloc/calloc/realloc in the process on
+ * glibc and only SQLite's own allocations elsewhere ("alloc_scope" in the
+ * report says which).
+ *
+ * The database files are created in --dir (default bench_db.tmp), which is
+ * wiped before each scale.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sqlite3.h>
+#include <jansson.h>
+#include "db.h"
+#include "thread.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#define make_dir(p) _mkdir(p)
+#define change_dir(p) _chdir(p)
+#else
+#include <unistd.h>
+#define make_dir(p) mkdir((p), 0755)
+#define change_dir(p) chdir(p)
+#endif
+
+#pragma region Allocation counting
+
+static _Thread_local uint64_t thread_allocs;
+
+#if defined(__GLIBC__)
+
+// Interpose the C allocator so the memory backend and our own code are counted too
+#define ALLOC_SCOPE "process"
+
+extern void *__libc_malloc(size_t n);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t n);
+extern void __libc_free(void *p);
+
+void *malloc(size_t n) { thread_allocs++; return __libc_malloc(n); }
+void *calloc(size_t n, size_t size) { thread_allocs++; return __libc_calloc(n, size); }
+void *realloc(void *p, size_t n) { thread_allocs++; return __libc_realloc(p, n); }
+void free(void *p) { __libc_free(p); }
+
+static bool alloc_hook_install(void) { return true; }
+
+#else
+
+#define ALLOC_SCOPE "sqlite"
+
+static sqlite3_mem_methods default_mem;
+
+static void *counting_malloc(int n) { thread_allocs++; return default_mem.xMalloc(n); }
+static void *counting_realloc(void *p, int n) { thread_allocs++; return default_mem.xRealloc(p, n); }
+
+// Must run before SQLite is initialised, i.e. before the first init_db
+static bool alloc_hook_install(void) {
+    if (sqlite3_config(SQLITE_CONFIG_GETMALLOC, &default_mem) != SQLITE_OK) return false;
+    sqlite3_mem_methods counting = default_mem;
+    counting.xMalloc = counting_malloc;
+    counting.xRealloc = counting_realloc;
+    return sqlite3_config(SQLITE_CONFIG_MALLOC, &counting) == SQLITE_OK;
+}
+
+#endif
+
+#pragma endregion Allocation counting
+
+#pragma region Configuration
+
+#define MAX_SCALES 8
+
+static struct {
+    int scales[MAX_SCALES];
+    int scale_count;
+    int threads;
+    int enrollments;        // per student
+    int write_ops;          // per thread
+    int read_ms;            // time budget per read op
+    int page;
+    const char *dir;
+    const char *out;
+    const char *label;
+    bool keep;
+    uint64_t seed;
+} cfg = {
+    .scales = { 10000, 100000 },
+    .scale_count = 2,
+    .threads = 4,
+    .enrollments = 3,
+    .write_ops = 1000,
+    .read_ms = 500,
+    .page = 20,
+    .dir = "bench_db.tmp",
+    .out = "bench_db.json",
+    .seed = 1,
+};
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: bench_db [options]\n"
+        "  --scales N,N,...    student counts to test (default 10000,100000)\n"
+        "  --threads N         threads for the multi-threaded pass (default 4)\n"
+        "  --enrollments N     enrollments per student (default 3)\n"
+        "  --write-ops N       iterations per thread for each write op (default 1000)\n"
+        "  --read-ms MS        time budget for each read op (default 500)\n"
+        "  --page N            limit used by list ops (default 20)\n"
+        "  --dir DIR           scratch directory for the database (default bench_db.tmp)\n"
+        "  --seed N            RNG seed (default 1)\n"
+        "  --label TEXT        copied into the JSON output\n"
+        "  --out FILE          JSON report (default bench_db.json; '-' for stdout)\n"
+        "  --keep              leave the last database in DIR\n"
+        "The storage backend is chosen with CURRICULUM_BACKEND as for the server.\n");
+}
+
+static bool parse_scales(const char *s) {
+    int n = 0;
+    while (*s) {
+        char *end;
+        long v = strtol(s, &end, 10);
+        if (end == s || v < 1 || n == MAX_SCALES) return false;
+        cfg.scales[n++] = (int)v;
+        if (*end && *end != ',') return false;
+        s = *end ? end + 1 : end;
+    }
+    if (n == 0) return false;
+    cfg.scale_count = n;
+    return true;
+}
+
+static bool parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        bool takes_value = true;
+        if (strcmp(a, "--keep") == 0) { cfg.keep = true; takes_value = false; }
+        else if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0) return false;
+        else if (!v) { fprintf(stderr, "%s needs a value\n", a); return false; }
+        else if (strcmp(a, "--threads") == 0) cfg.threads = atoi(v);
+        else if (strcmp(a, "--enrollments") == 0) cfg.enrollments = atoi(v);
+        else if (strcmp(a, "--write-ops") == 0) cfg.write_ops = atoi(v);
+        else if (strcmp(a, "--read-ms") == 0) cfg.read_ms = atoi(v);
+        else if (strcmp(a, "--page") == 0) cfg.page = atoi(v);
+        else if (strcmp(a, "--dir") == 0) cfg.dir = v;
+        else if (strcmp(a, "--seed") == 0) cfg.seed = strtoull(v, NULL, 10);
+        else if (strcmp(a, "--label") == 0) cfg.label = v;
+        else if (strcmp(a, "--out") == 0) cfg.out = v;
+        else if (strcmp(a, "--scales") == 0) {
+            if (!parse_scales(v)) { fprintf(stderr, "bad --scales '%s'\n", v); return false; }
+        } else {
+            fprintf(stderr, "unknown option %s\n", a);
+            return false;
+        }
+        if (takes_value) i++;
+    }
+    if (cfg.threads < 1 || cfg.enrollments < 0 || cfg.write_ops < 2 || cfg.read_ms < 1 || cfg.page < 1) {
+        fprintf(stderr, "invalid option value\n");
+        return false;
+    }
+    return true;
+}
+
+#pragma endregion Configuration
+
+#pragma region Population
+
+static const char *types[] = { "Core", "Elective", "Lab" };
+static const char *semesters[] = { "Fall", "Spring", "Summer" };
+
+static struct {
+    int students;
+    int courses;
+    int pass;               // bumped per run so added keys never collide
+} pop;
+
+static void course_key(char *buf, size_t n, int i) { snprintf(buf, n, "c%07d", i); }
+static void student_key(char *buf, size_t n, int i) { snprintf(buf, n, "s%08d", i); }
+
+// Distinct courses for one student as long as enrollments <= courses
+static int enrolled_course(int student, int k) {
+    int step = pop.courses / (cfg.enrollments ? cfg.enrollments : 1);
+    if (step < 1) step = 1;
+    return (student + k * step) % pop.courses;
+}
+
+static Course make_course(const char *id, char *name, size_t name_len, int i) {
+    snprintf(name, name_len, "Course %d", i);
+    double credit = (double)(i % 5 + 1);
+    return (Course){
+        .course_id = id,
+        .name = name,
+        .type = types[i % 3],
+        .total_hours = credit * 16,
+        .lecture_hours = credit * 12,
+        .lab_hours = credit * 4,
+        .credit = credit,
+        .semester = semesters[i % 3],
+    };
+}
+
+static Student make_student(const char *id, char *name, size_t name_len, char *email, size_t email_len, int i) {
+    snprintf(name, name_len, "Student %d", i);
+    snprintf(email, email_len, "s%d@example.edu", i);
+    return (Student){ .student_id = id, .name = name, .email = email, .credits = 0 };
+}
+
+// Commit every BATCH rows so the load neither runs one transaction per row nor one huge one
+#define BATCH 10000
+
+static bool batch_step(uint64_t *n) {
+    if (++*n % BATCH) return true;
+    return db_commit() && db_begin();
+}
+
+static bool load_population(void) {
+    char id[32], id2[32], name[64], email[64];
+    uint64_t n = 0;
+    if (!db_begin()) return false;
+    for (int i = 0; i < pop.courses; i++) {
+        course_key(id, sizeof(id), i);
+        Course c = make_course(id, name, sizeof(name), i);
+        if (!db_course_add(&c) || !batch_step(&n)) goto fail;
+    }
+    for (int i = 0; i < pop.students; i++) {
+        student_key(id, sizeof(id), i);
+        Student s = make_student(id, name, sizeof(name), email, sizeof(email), i);
+        if (!db_student_add(&s) || !batch_step(&n)) goto fail;
+    }
+    for (int i = 0; i < pop.students; i++) {
+        student_key(id, sizeof(id), i);
+        for (int k = 0; k < cfg.enrollments && k < pop.courses; k++) {
+            course_key(id2, sizeof(id2), enrolled_course(i, k));
+            Enrollment e = { .course_id = id2, .student_id = id };
+            if (!db_enrollment_add(&e) || !batch_step(&n)) goto fail;
+        }
+    }
+    return db_commit();
+
+fail:
+    db_rollback();
+    return false;
+}
+
+#pragma endregion Population
+
+#pragma region Operations
+
+typedef struct Worker Worker;
+
+typedef enum {
+    RUN_TIMED,              // reads: as many as fit in --read-ms
+    RUN_WRITES,             // share% of --write-ops per thread
+    RUN_ONCE                // remove_all: a single call
+} RunMode;
+
+typedef struct {
+    char name[64];
+    bool (*run)(Worker *w, uint64_t i);
+    const char *arg;        // order_by for list ops
+    bool deep;              // page from the far end instead of a random offset
+    RunMode mode;
+    int share;
+} BenchOp;
+
+struct Worker {
+    int id;
+    const BenchOp *op;
+    uint64_t rng;
+    uint64_t ops;
+    uint64_t errors;
+    uint64_t rows;
+    uint64_t allocs;
+    uint64_t deadline;
+    thread_t thread;
+};
+
+static uint64_t next_rand(Worker *w) {
+    uint64_t x = w->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return w->rng = x;
+}
+
+static int rand_below(Worker *w, int n) { return (int)(next_rand(w) % (uint64_t)n); }
+
+// Keys for rows a worker adds itself: unique per pass, thread and iteration
+static void new_course_key(char *buf, size_t n, const Worker *w, uint64_t i) {
+    snprintf(buf, n, "m%d-%d-%llu", pop.pass, w->id, (unsigned long long)i);
+}
+
+static void new_student_key(char *buf, size_t n, const Worker *w, uint64_t i) {
+    snprintf(buf, n, "n%d-%d-%llu", pop.pass, w->id, (unsigned long long)i);
+}
+
+static void count_course(const Course *c, void *user) { (void)c; (*(uint64_t *)user)++; }
+static void count_student(const Student *s, void *user) { (void)s; (*(uint64_t *)user)++; }
+static void count_enrollment(const Enrollment *e, void *user) { (void)e; (*(uint64_t *)user)++; }
+
+static QueryOptions page_options(Worker *w, int total) {
+    int span = total > cfg.page ? total - cfg.page : 1;
+    return (QueryOptions){
+        .order_by = w->op->arg,
+        .order = SORT_ASC,
+        .limit = cfg.page,
+        .offset = w->op->deep ? span : rand_below(w, span),
+    };
+}
+
+static bool op_course_list(Worker *w, uint64_t i) {
+    QueryOptions opt = page_options(w, pop.courses);
+    return db_course_list(&opt, count_course, &w->rows);
+}
+
+static bool op_student_list(Worker *w, uint64_t i) {
+    QueryOptions opt = page_options(w, pop.students);
+    return db_student_list(&opt, count_student, &w->rows);
+}
+
+static bool op_enrollment_list(Worker *w, uint64_t i) {
+    QueryOptions opt = page_options(w, pop.students * cfg.enrollments);
+    return db_enrollment_list(&opt, count_enrollment, &w->rows);
+}
+
+static bool op_course_find_by_id(Worker *w, uint64_t i) {
+    char id[32];
+    course_key(id, sizeof(id), rand_below(w, pop.courses));
+    return db_course_find_by_id(id, NULL, count_course, &w->rows);
+}
+
+static bool op_course_find_by_name(Worker *w, uint64_t i) {
+    char name[64];
+    snprintf(name, sizeof(name), "Course %d", rand_below(w, pop.courses));
+    return db_course_find_by_name(name, NULL, count_course, &w->rows);
+}
+
+static bool op_course_find_by_type(Worker *w, uint64_t i) {
+    return db_course_find_by_type(types[rand_below(w, 3)], NULL, count_course, &w->rows);
+}
+
+static bool op_course_find_by_semester(Worker *w, uint64_t i) {
+    return db_course_find_by_semester(semesters[rand_below(w, 3)], NULL, count_course, &w->rows);
+}
+
+static bool op_student_find_by_id(Worker *w, uint64_t i) {
+    char id[32];
+    student_key(id, sizeof(id), rand_below(w, pop.students));
+    return db_student_find_by_id(id, NULL, count_student, &w->rows);
+}
+
+static bool op_student_find_by_name(Worker *w, uint64_t i) {
+    char name[64];
+    snprintf(name, sizeof(name), "Student %d", rand_below(w, pop.students));
+    return db_student_find_by_name(name, NULL, count_student, &w->rows);
+}
+
+static bool op_enrollment_find_by_student_id(Worker *w, uint64_t i) {
+    char id[32];
+    student_key(id, sizeof(id), rand_below(w, pop.students));
+    return db_enrollment_find_by_student_id(id, NULL, count_enrollment, &w->rows);
+}
+
+static bool op_enrollment_find_by_course_id(Worker *w, uint64_t i) {
+    char id[32];
+    course_key(id, sizeof(id), rand_below(w, pop.courses));
+    return db_enrollment_find_by_course_id(id, NULL, count_enrollment, &w->rows);
+}
+
+// The write ops run in table order and each works on the rows the previous ones left behind
+
+static bool op_course_add(Worker *w, uint64_t i) {
+    char id[32], name[64];
+    new_course_key(id, sizeof(id), w, i);
+    Course c = make_course(id, name, sizeof(name), (int)i);
+    return db_course_add(&c);
+}
+
+static bool op_student_add(Worker *w, uint64_t i) {
+    char id[32], name[64], email[64];
+    new_student_key(id, sizeof(id), w, i);
+    Student s = make_student(id, name, sizeof(name), email, sizeof(email), (int)i);
+    return db_student_add(&s);
+}
+
+static bool op_course_update(Worker *w, uint64_t i) {
+    char id[32], name[64];
+    new_course_key(id, sizeof(id), w, i);
+    Course c = make_course(id, name, sizeof(name), (int)i + 1);
+    return db_course_update(&c);
+}
+
+static bool op_student_update(Worker *w, uint64_t i) {
+    char id[32], name[64], email[64];
+    new_student_key(id, sizeof(id), w, i);
+    Student s = make_student(id, name, sizeof(name), email, sizeof(email), (int)i + 1);
+    return db_student_update(&s);
+}
+
+// Each added student joins its own added course and one population course
+static bool op_enrollment_add(Worker *w, uint64_t i) {
+    char sid[32], cid[32];
+    new_student_key(sid, sizeof(sid), w, i / 2);
+    if (i % 2) course_key(cid, sizeof(cid), (int)((i / 2) % (uint64_t)pop.courses));
+    else new_course_key(cid, sizeof(cid), w, i / 2);
+    Enrollment e = { .course_id = cid, .student_id = sid };
+    return db_enrollment_add(&e);
+}
+
+static bool op_enrollment_remove(Worker *w, uint64_t i) {
+    char sid[32], cid[32];
+    new_student_key(sid, sizeof(sid), w, i);
+    course_key(cid, sizeof(cid), (int)(i % (uint64_t)pop.courses));
+    return db_enrollment_remove(sid, cid);
+}
+
+// Cascades to the enrollment in the worker's own course
+static bool op_course_remove(Worker *w, uint64_t i) {
+    char id[32];
+    new_course_key(id, sizeof(id), w, i);
+    return db_course_remove(id);
+}
+
+// Half of the students still hold a population enrollment, so half the removes cascade
+static bool op_student_remove(Worker *w, uint64_t i) {
+    char id[32];
+    new_student_key(id, sizeof(id), w, i);
+    return db_student_remove(id);
+}
+
+static bool op_course_remove_all(Worker *w, uint64_t i) { return db_course_remove_all(); }
+static bool op_student_remove_all(Worker *w, uint64_t i) { return db_student_remove_all(); }
+static bool op_enrollment_remove_all(Worker *w, uint64_t i) { return db_enrollment_remove_all(); }
+
+static const char *course_orders[] = { NULL, "course_id", "name", "type", "total_hours", "lecture_hours", "lab_hours", "credit", "semester" };
+static const char *student_orders[] = { NULL, "student_id", "name", "email", "credits" };
+static const char *enrollment_orders[] = { NULL, "student_id", "course_id" };
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+#define MAX_OPS 64
+
+static BenchOp ops[MAX_OPS];
+static int op_count;
+
+static void add_op(const char *name, bool (*run)(Worker *, uint64_t), const char *arg, bool deep, RunMode mode, int share) {
+    BenchOp *op = &ops[op_count++];
+    if (arg) snprintf(op->name, sizeof(op->name), "%s(order_by=%s)%s", name, arg, deep ? "/deep" : "");
+    else snprintf(op->name, sizeof(op->name), "%s%s", name, deep ? "/deep" : "");
+    op->run = run;
+    op->arg = arg;
+    op->deep = deep;
+    op->mode = mode;
+    op->share = share;
+}
+
+static void build_ops(void) {
+    for (size_t i = 0; i < COUNT_OF(course_orders); i++) add_op("course_list", op_course_list, course_orders[i], false, RUN_TIMED, 0);
+    for (size_t i = 0; i < COUNT_OF(student_orders); i++) add_op("student_list", op_student_list, student_orders[i], false, RUN_TIMED, 0);
+    for (size_t i = 0; i < COUNT_OF(enrollment_orders); i++) add_op("enrollment_list", op_enrollment_list, enrollment_orders[i], false, RUN_TIMED, 0);
+    add_op("student_list", op_student_list, NULL, true, RUN_TIMED, 0);
+    add_op("student_list", op_student_list, "name", true, RUN_TIMED, 0);
+    add_op("enrollment_list", op_enrollment_list, NULL, true, RUN_TIMED, 0);
+    add_op("course_find_by_id", op_course_find_by_id, NULL, false, RUN_TIMED, 0);
+    add_op("course_find_by_name", op_course_find_by_name, NULL, false, RUN_TIMED, 0);
+    add_op("course_find_by_type", op_course_find_by_type, NULL, false, RUN_TIMED, 0);
+    add_op("course_find_by_semester", op_course_find_by_semester, NULL, false, RUN_TIMED, 0);
+    add_op("student_find_by_id", op_student_find_by_id, NULL, false, RUN_TIMED, 0);
+    add_op("student_find_by_name", op_student_find_by_name, NULL, false, RUN_TIMED, 0);
+    add_op("enrollment_find_by_student_id", op_enrollment_find_by_student_id, NULL, false, RUN_TIMED, 0);
+    add_op("enrollment_find_by_course_id", op_enrollment_find_by_course_id, NULL, false, RUN_TIMED, 0);
+
+    add_op("course_add", op_course_add, NULL, false, RUN_WRITES, 100);
+    add_op("student_add", op_student_add, NULL, false, RUN_WRITES, 100);
+    add_op("course_update", op_course_update, NULL, false, RUN_WRITES, 100);
+    add_op("student_update", op_student_update, NULL, false, RUN_WRITES, 100);
+    add_op("enrollment_add", op_enrollment_add, NULL, false, RUN_WRITES, 200);
+    add_op("enrollment_remove", op_enrollment_remove, NULL, false, RUN_WRITES, 50);
+    add_op("course_remove", op_course_remove, NULL, false, RUN_WRITES, 100);
+    add_op("student_remove", op_student_remove, NULL, false, RUN_WRITES, 100);
+
+    // Destructive, so these run last and only on the single-threaded pass
+    add_op("enrollment_remove_all", op_enrollment_remove_all, NULL, false, RUN_ONCE, 0);
+    add_op("student_remove_all", op_student_remove_all, NULL, false, RUN_ONCE, 0);
+    add_op("course_remove_all", op_course_remove_all, NULL, false, RUN_ONCE, 0);
+}
+
+#pragma endregion Operations
+
+#pragma region Runner
+
+static uint64_t iterations(const BenchOp *op) {
+    switch (op->mode) {
+        case RUN_WRITES: return (uint64_t)cfg.write_ops * (uint64_t)op->share / 100;
+        case RUN_ONCE: return 1;
+        default: return UINT64_MAX;
+    }
+}
+
+static void worker_main(void *arg) {
+    Worker *w = arg;
+    if (!db_thread_open()) {
+        w->errors++;
+        return;
+    }
+    uint64_t n = iterations(w->op);
+    uint64_t allocs = thread_allocs;
+    for (uint64_t i = 0; i < n; i++) {
+        if (w->op->mode == RUN_TIMED && now_us() >= w->deadline) break;
+        if (!w->op->run(w, i)) w->errors++;
+        w->ops++;
+    }
+    w->allocs = thread_allocs - allocs;
+    db_thread_close();
+}
+
+static json_t *run_op(const BenchOp *op, int threads) {
+    Worker *workers = calloc((size_t)threads, sizeof(*workers));
+    if (!workers) return NULL;
+
+    uint64_t start = now_us();
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        Worker *w = &workers[t];
+        w->id = t;
+        w->op = op;
+        w->rng = (cfg.seed + 1) * 0x9E3779B97F4A7C15ull + (uint64_t)(t + 1) * 0xBF58476D1CE4E5B9ull;
+        w->deadline = start + (uint64_t)cfg.read_ms * 1000;
+    }
+    if (threads == 1) {
+        worker_main(&workers[0]);
+        started = 1;
+    } else {
+        for (; started < threads; started++) {
+            if (!thread_start(&workers[started].thread, worker_main, &workers[started])) {
+                fprintf(stderr, "failed to start thread %d\n", started);
+                break;
+            }
+        }
+        for (int t = 0; t < started; t++) thread_join(workers[t].thread);
+    }
+    double seconds = (double)(now_us() - start) / 1e6;
+
+    uint64_t total = 0, errors = 0, rows = 0, allocs = 0;
+    for (int t = 0; t < started; t++) {
+        total += workers[t].ops;
+        errors += workers[t].errors;
+        rows += workers[t].rows;
+        allocs += workers[t].allocs;
+    }
+    free(workers);
+
+    double per_op = total ? 1.0 / (double)total : 0.0;
+    json_t *o = json_object();
+    json_object_set_new(o, "op", json_string(op->name));
+    json_object_set_new(o, "threads", json_integer(started));
+    json_object_set_new(o, "ops", json_integer((json_int_t)total));
+    json_object_set_new(o, "errors", json_integer((json_int_t)errors));
+    json_object_set_new(o, "seconds", json_real(seconds));
+    json_object_set_new(o, "ops_per_sec", json_real(seconds > 0 ? (double)total / seconds : 0.0));
+    json_object_set_new(o, "us_per_op", json_real(seconds * 1e6 * (double)started * per_op));
+    json_object_set_new(o, "allocs_per_op", json_real((double)allocs * per_op));
+    json_object_set_new(o, "rows_per_op", json_real((double)rows * per_op));
+
+    fprintf(stderr, "  %-48s %2dT %12.0f ops/s %10.1f allocs/op%s\n", op->name, started,
+            seconds > 0 ? (double)total / seconds : 0.0, (double)allocs * per_op,
+            errors ? "  (errors)" : "");
+    return o;
+}
+
+static void run_pass(json_t *results, int threads, bool destructive) {
+    pop.pass++;
+    for (int i = 0; i < op_count; i++) {
+        if ((ops[i].mode == RUN_ONCE) != destructive) continue;
+        json_t *r = run_op(&ops[i], threads);
+        if (r) json_array_append_new(results, r);
+    }
+}
+
+static const char *db_files[] = {
+    DB_FILE, DB_FILE "-wal", DB_FILE "-shm",
+    DB_MEMORY_FILE, DB_MEMORY_FILE ".log", DB_MEMORY_FILE ".tmp",
+};
+
+static void remove_db_files(void) {
+    for (size_t i = 0; i < COUNT_OF(db_files); i++) remove(db_files[i]);
+}
+
+static json_int_t db_bytes(void) {
+    json_int_t total = 0;
+    struct stat st;
+    for (size_t i = 0; i < COUNT_OF(db_files); i++) {
+        if (stat(db_files[i], &st) == 0) total += (json_int_t)st.st_size;
+    }
+    return total;
+}
+
+static json_t *run_scale(int students) {
+    pop.students = students;
+    pop.courses = students / 100 > 100 ? students / 100 : 100;
+
+    remove_db_files();
+    if (!init_db()) return NULL;
+
+    json_t *scale = json_object();
+    json_object_set_new(scale, "students", json_integer(pop.students));
+    json_object_set_new(scale, "courses", json_integer(pop.courses));
+    json_object_set_new(scale, "enrollments", json_integer((json_int_t)pop.students * cfg.enrollments));
+
+    fprintf(stderr, "scale %d: loading %d courses, %d students, %lld enrollments\n", students, pop.courses,
+            pop.students, (long long)pop.students * cfg.enrollments);
+    uint64_t start = now_us();
+    bool loaded = load_population();
+    double load_s = (double)(now_us() - start) / 1e6;
+    if (!loaded) {
+        fprintf(stderr, "load failed\n");
+        json_decref(scale);
+        close_db();
+        return NULL;
+    }
+    json_object_set_new(scale, "load_seconds", json_real(load_s));
+    json_object_set_new(scale, "db_bytes", json_integer(db_bytes()));
+
+    json_t *single = json_array();
+    json_t *multi = json_array();
+    run_pass(single, 1, false);
+    if (cfg.threads > 1) run_pass(multi, cfg.threads, false);
+    run_pass(single, 1, true);
+
+    json_object_set_new(scale, "single", single);
+    json_object_set_new(scale, "multi", multi);
+    close_db();
+    return scale;
+}
+
+#pragma endregion Runner
+
+int main(int argc, char **argv) {
+    if (!parse_args(argc, argv)) {
+        usage();
+        return 2;
+    }
+
+    // Opened before changing into the scratch directory so relative paths mean what the user typed
+    FILE *out = stdout;
+    if (strcmp(cfg.out, "-") != 0 && !(out = fopen(cfg.out, "w"))) {
+        fprintf(stderr, "cannot write %s\n", cfg.out);
+        return 1;
+    }
+
+    if (!alloc_hook_install()) {
+        fprintf(stderr, "cannot install allocation counter\n");
+        return 1;
+    }
+
+    make_dir(cfg.dir);
+    if (change_dir(cfg.dir) != 0) {
+        fprintf(stderr, "cannot enter %s\n", cfg.dir);
+        return 1;
+    }
+
+    build_ops();
+
+    json_t *report = json_object();
+    if (cfg.label) json_object_set_new(report, "label", json_string(cfg.label));
+    json_object_set_new(report, "backend", json_string(env_str("CURRICULUM_BACKEND", "sqlite")));
+    json_object_set_new(report, "sqlite_version", json_string(sqlite3_libversion()));
+    json_object_set_new(report, "threads", json_integer(cfg.threads));
+    json_object_set_new(report, "write_ops", json_integer(cfg.write_ops));
+    json_object_set_new(report, "read_ms", json_integer(cfg.read_ms));
+    json_object_set_new(report, "page", json_integer(cfg.page));
+    json_object_set_new(report, "alloc_scope", json_string(ALLOC_SCOPE));
+
+    int rc = 0;
+    json_t *scales = json_array();
+    for (int i = 0; i < cfg.scale_count; i++) {
+        json_t *s = run_scale(cfg.scales[i]);
+        if (!s) {
+            rc = 1;
+            break;
+        }
+        json_array_append_new(scales, s);
+        if (!cfg.keep || i + 1 < cfg.scale_count) remove_db_files();
+    }
+    json_object_set_new(report, "scales", scales);
+
+    json_dumpf(report, out, JSON_INDENT(2));
+    fputc('\n', out);
+    if (out != stdout) fclose(out);
+    json_decref(report);
+    return rc;
+}
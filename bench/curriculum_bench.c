@@ -0,0 +1,524 @@
+/*
+ * curriculum-bench: HTTP load generator for the curriculum server.
+ *
+ * N threads each hold one keep-alive connection and issue a weighted mix of
+ * list / find / add / enroll requests, either back to back (closed loop) or on
+ * a fixed schedule (open loop, --rate). Latencies go into log-linear
+ * histograms (~1.5% precision, HdrHistogram style); in open-loop mode they are
+ * measured from the scheduled send time so queueing delay is not hidden.
+ * Results are printed as JSON so runs can be diffed across builds.
+ *
+ *   curriculum-bench --threads 8 --duration 30 --mix list=60,find=30,add=5,enroll=5
+ *   curriculum-bench --rate 2000 --duration 60 --out run.json
+ *
+ * Before the run a population of bench-c-N courses and bench-s-N students is
+ * created (--no-setup skips it). Enrollments made during the run are removed
+ * afterwards unless --keep is given.
+ *
+ * --idle N opens N connections that never send a request and holds them for
+ * the whole run, like browsers parked on keep-alive. Comparing a run with and
+ * without them shows what idle clients cost each server front end:
+ *
+ *   curriculum-bench --threads 16 --idle 1000 --label epoll
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <jansson.h>
+#include "thread.h"
+#include "histogram.h"
+#include "http_client.h"
+
+#pragma region Configuration
+
+typedef enum { OP_LIST, OP_FIND, OP_ADD, OP_ENROLL, OP_COUNT } OpKind;
+static const char *op_names[OP_COUNT] = { "list", "find", "add", "enroll" };
+
+static struct {
+    const char *host;
+    const char *port;
+    int threads;
+    double duration_s;
+    double warmup_s;
+    double rate;            // total requests/s; 0 = closed loop
+    double interval_s;      // timeline resolution
+    int mix[OP_COUNT];
+    int courses;
+    int students;
+    int page;               // list page size
+    int idle;               // silent connections held during the run
+    bool setup;
+    bool keep;
+    const char *out;
+    const char *label;
+    uint64_t seed;
+} cfg = {
+    .host = "127.0.0.1",
+    .port = "8080",
+    .threads = 4,
+    .duration_s = 10,
+    .warmup_s = 2,
+    .interval_s = 1,
+    .mix = { 60, 30, 5, 5 },
+    .courses = 100,
+    .students = 1000,
+    .page = 20,
+    .setup = true,
+    .seed = 1,
+};
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: curriculum-bench [options]\n"
+        "  --host H            server host (default 127.0.0.1)\n"
+        "  --port P            server port (default 8080)\n"
+        "  --threads N         client threads, one keep-alive connection each (default 4)\n"
+        "  --duration S        measured seconds (default 10)\n"
+        "  --warmup S          unmeasured seconds before the run (default 2)\n"
+        "  --rate R            open loop at R requests/s in total (default: closed loop)\n"
+        "  --mix list=60,find=30,add=5,enroll=5\n"
+        "  --courses N         bench courses to create and target (default 100)\n"
+        "  --students N        bench students to create and target (default 1000)\n"
+        "  --page N            page size for list requests (default 20)\n"
+        "  --interval S        throughput timeline resolution (default 1)\n"
+        "  --idle N            hold N connections open without requests during the run\n"
+        "  --seed N            RNG seed (default 1)\n"
+        "  --label TEXT        copied into the JSON output\n"
+        "  --out FILE          write JSON to FILE instead of stdout\n"
+        "  --no-setup          do not create the bench population\n"
+        "  --keep              leave enrollments made by the run in place\n");
+}
+
+static bool parse_mix(const char *s) {
+    int mix[OP_COUNT] = { 0 };
+    while (*s) {
+        const char *eq = strchr(s, '=');
+        if (!eq) return false;
+        int op = -1;
+        for (int i = 0; i < OP_COUNT; i++) {
+            if (strlen(op_names[i]) == (size_t)(eq - s) && strncmp(s, op_names[i], eq - s) == 0) op = i;
+        }
+        if (op < 0) return false;
+        char *end;
+        long w = strtol(eq + 1, &end, 10);
+        if (end == eq + 1 || w < 0) return false;
+        mix[op] = (int)w;
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    int total = 0;
+    for (int i = 0; i < OP_COUNT; i++) total += mix[i];
+    if (total == 0) return false;
+    memcpy(cfg.mix, mix, sizeof(mix));
+    return true;
+}
+
+static bool parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        bool takes_value = true;
+        if (strcmp(a, "--no-setup") == 0) { cfg.setup = false; takes_value = false; }
+        else if (strcmp(a, "--keep") == 0) { cfg.keep = true; takes_value = false; }
+        else if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0) return false;
+        else if (!v) { fprintf(stderr, "%s needs a value\n", a); return false; }
+        else if (strcmp(a, "--host") == 0) cfg.host = v;
+        else if (strcmp(a, "--port") == 0) cfg.port = v;
+        else if (strcmp(a, "--threads") == 0) cfg.threads = atoi(v);
+        else if (strcmp(a, "--duration") == 0) cfg.duration_s = atof(v);
+        else if (strcmp(a, "--warmup") == 0) cfg.warmup_s = atof(v);
+        else if (strcmp(a, "--rate") == 0) cfg.rate = atof(v);
+        else if (strcmp(a, "--interval") == 0) cfg.interval_s = atof(v);
+        else if (strcmp(a, "--courses") == 0) cfg.courses = atoi(v);
+        else if (strcmp(a, "--students") == 0) cfg.students = atoi(v);
+        else if (strcmp(a, "--page") == 0) cfg.page = atoi(v);
+        else if (strcmp(a, "--idle") == 0) cfg.idle = atoi(v);
+        else if (strcmp(a, "--seed") == 0) cfg.seed = strtoull(v, NULL, 10);
+        else if (strcmp(a, "--label") == 0) cfg.label = v;
+        else if (strcmp(a, "--out") == 0) cfg.out = v;
+        else if (strcmp(a, "--mix") == 0) {
+            if (!parse_mix(v)) { fprintf(stderr, "bad --mix '%s'\n", v); return false; }
+        } else {
+            fprintf(stderr, "unknown option %s\n", a);
+            return false;
+        }
+        if (takes_value) i++;
+    }
+    if (cfg.threads < 1 || cfg.duration_s <= 0 || cfg.warmup_s < 0 || cfg.rate < 0
+        || cfg.interval_s <= 0 || cfg.courses < 1 || cfg.students < 1 || cfg.page < 1 || cfg.idle < 0) {
+        fprintf(stderr, "invalid option value\n");
+        return false;
+    }
+    return true;
+}
+
+#pragma endregion Configuration
+
+#pragma region Workers
+
+typedef struct {
+    int id;
+    thread_t thread;
+    HttpConn conn;
+    uint64_t rng;
+
+    Histogram *hist;            // one per OpKind
+    uint64_t requests[OP_COUNT];
+    uint64_t errors[OP_COUNT];  // non-2xx or I/O error
+    uint64_t io_errors;
+    uint64_t missed;            // open loop: scheduled sends still pending at the end
+    uint64_t status_class[6];   // index status/100
+    uint64_t *timeline_requests;
+    uint64_t *timeline_errors;
+
+    uint64_t add_seq;
+    uint64_t enroll_seq;        // enrollment pairs used so far from this thread's slice
+} Worker;
+
+static uint64_t run_nonce;
+static uint64_t start_us;       // measurement starts here, after warmup
+static uint64_t end_us;
+static int timeline_slots;
+static int idle_open;           // --idle connections actually established
+
+static uint64_t next_rand(Worker *w) {
+    // xorshift64*
+    w->rng ^= w->rng >> 12;
+    w->rng ^= w->rng << 25;
+    w->rng ^= w->rng >> 27;
+    return w->rng * 2685821657736338717ull;
+}
+
+static OpKind pick_op(Worker *w) {
+    int total = 0;
+    for (int i = 0; i < OP_COUNT; i++) total += cfg.mix[i];
+    int r = (int)(next_rand(w) % (uint64_t)total);
+    for (int i = 0; i < OP_COUNT; i++) {
+        if (r < cfg.mix[i]) return (OpKind)i;
+        r -= cfg.mix[i];
+    }
+    return OP_LIST;
+}
+
+/*
+ * Each thread enrolls students from its own slice (index % threads == id) into
+ * every course in turn, so threads never collide and every pair is new.
+ * Returns false once the slice is used up.
+ */
+static bool enroll_pair(const Worker *w, uint64_t n, int *student, int *course) {
+    uint64_t slot = n / (uint64_t)cfg.courses;
+    uint64_t s = (uint64_t)w->id + slot * (uint64_t)cfg.threads;
+    if (s >= (uint64_t)cfg.students) return false;
+    *student = (int)s;
+    *course = (int)(n % (uint64_t)cfg.courses);
+    return true;
+}
+
+static int run_op(Worker *w, OpKind op) {
+    char path[256];
+    char body[256];
+    switch (op) {
+    case OP_LIST:
+        if (next_rand(w) & 1) {
+            snprintf(path, sizeof(path), "/course?limit=%d&offset=%d", cfg.page, (int)(next_rand(w) % (uint64_t)cfg.courses));
+        } else {
+            snprintf(path, sizeof(path), "/student?limit=%d&offset=%d", cfg.page, (int)(next_rand(w) % (uint64_t)cfg.students));
+        }
+        return http_request(&w->conn, "GET", path, NULL, 0);
+    case OP_FIND:
+        if (next_rand(w) & 1) {
+            snprintf(path, sizeof(path), "/course/find?id=bench-c-%d", (int)(next_rand(w) % (uint64_t)cfg.courses));
+        } else {
+            snprintf(path, sizeof(path), "/student/find?student_id=bench-s-%d", (int)(next_rand(w) % (uint64_t)cfg.students));
+        }
+        return http_request(&w->conn, "GET", path, NULL, 0);
+    case OP_ADD:
+        snprintf(body, sizeof(body),
+                 "{\"student_id\":\"bench-add-%llx-%d-%llu\",\"name\":\"Bench Student\",\"email\":\"bench@example.com\"}",
+                 (unsigned long long)run_nonce, w->id, (unsigned long long)w->add_seq++);
+        return http_request(&w->conn, "POST", "/student", body, strlen(body));
+    case OP_ENROLL: {
+        int student, course;
+        if (!enroll_pair(w, w->enroll_seq, &student, &course)) return run_op(w, OP_FIND);
+        w->enroll_seq++;
+        snprintf(body, sizeof(body), "{\"student_id\":\"bench-s-%d\",\"course_id\":\"bench-c-%d\"}", student, course);
+        return http_request(&w->conn, "POST", "/enrollment", body, strlen(body));
+    }
+    default:
+        return -1;
+    }
+}
+
+static void sleep_until(uint64_t t) {
+    for (;;) {
+        uint64_t now = now_us();
+        if (now >= t) return;
+        uint64_t left = t - now;
+        sleep_ms(left >= 2000 ? (int)(left / 1000) - 1 : 0);
+    }
+}
+
+static void worker_main(void *arg) {
+    Worker *w = arg;
+    double per_thread_rate = cfg.rate / cfg.threads;
+    uint64_t period_us = per_thread_rate > 0 ? (uint64_t)(1e6 / per_thread_rate) : 0;
+    if (cfg.rate > 0 && period_us == 0) period_us = 1;
+    uint64_t begin = start_us - (uint64_t)(cfg.warmup_s * 1e6);
+    // Stagger threads across one period so the aggregate schedule is smooth
+    uint64_t next = begin + period_us * (uint64_t)w->id / (uint64_t)cfg.threads;
+
+    for (;;) {
+        uint64_t intended;
+        if (period_us) {
+            if (next >= end_us) break;
+            // Falling behind must not stretch the run; report the backlog instead
+            uint64_t now = now_us();
+            if (now >= end_us) {
+                if (next >= start_us) w->missed += (end_us - next + period_us - 1) / period_us;
+                break;
+            }
+            sleep_until(next);
+            intended = next;
+            next += period_us;
+        } else {
+            intended = now_us();
+            if (intended >= end_us) break;
+        }
+
+        OpKind op = pick_op(w);
+        int status = run_op(w, op);
+        uint64_t done = now_us();
+        if (intended < start_us) continue;   // warmup
+
+        hist_record(&w->hist[op], done - intended);
+        w->requests[op]++;
+        bool failed = status < 200 || status > 299;
+        if (failed) w->errors[op]++;
+        if (status < 0) w->io_errors++;
+        else if (status / 100 < 6) w->status_class[status / 100]++;
+
+        int slot = (int)((double)(done - start_us) / (cfg.interval_s * 1e6));
+        if (slot < timeline_slots) {
+            w->timeline_requests[slot]++;
+            if (failed) w->timeline_errors[slot]++;
+        }
+    }
+}
+
+// Remove the enrollments this worker made so repeated runs start clean
+static void worker_cleanup(Worker *w) {
+    char path[128];
+    for (uint64_t n = 0; n < w->enroll_seq; n++) {
+        int student, course;
+        if (!enroll_pair(w, n, &student, &course)) break;
+        snprintf(path, sizeof(path), "/enrollment?student_id=bench-s-%d&course_id=bench-c-%d", student, course);
+        http_request(&w->conn, "DELETE", path, NULL, 0);
+    }
+}
+
+static void setup_population(void) {
+    HttpConn c;
+    http_conn_init(&c);
+    char body[256];
+    int failed = 0;
+    for (int i = 0; i < cfg.courses; i++) {
+        snprintf(body, sizeof(body),
+                 "{\"course_id\":\"bench-c-%d\",\"name\":\"Bench Course %d\",\"type\":\"Core\","
+                 "\"total_hours\":48,\"lecture_hours\":32,\"lab_hours\":16,\"credit\":3,\"semester\":\"Fall\"}", i, i);
+        int status = http_request(&c, "POST", "/course", body, strlen(body));
+        if (status < 0) failed++;
+    }
+    for (int i = 0; i < cfg.students; i++) {
+        snprintf(body, sizeof(body), "{\"student_id\":\"bench-s-%d\",\"name\":\"Bench %d\",\"email\":\"bench%d@example.com\"}", i, i, i);
+        int status = http_request(&c, "POST", "/student", body, strlen(body));
+        if (status < 0) failed++;
+    }
+    http_conn_close(&c);
+    // Duplicates from earlier runs are rejected by the server and that is fine
+    if (failed) fprintf(stderr, "setup: %d requests could not be sent\n", failed);
+}
+
+#pragma endregion Workers
+
+static json_t *build_report(Worker *workers) {
+    Histogram *all = calloc(1, sizeof(*all));
+    Histogram *per_op = calloc(OP_COUNT, sizeof(*per_op));
+    uint64_t requests[OP_COUNT] = { 0 }, errors[OP_COUNT] = { 0 }, status_class[6] = { 0 }, io_errors = 0, missed = 0;
+    uint64_t *tl_req = calloc((size_t)timeline_slots, sizeof(*tl_req));
+    uint64_t *tl_err = calloc((size_t)timeline_slots, sizeof(*tl_err));
+    if (!all || !per_op || !tl_req || !tl_err) {
+        free(all); free(per_op); free(tl_req); free(tl_err);
+        return NULL;
+    }
+
+    for (int t = 0; t < cfg.threads; t++) {
+        Worker *w = &workers[t];
+        for (int op = 0; op < OP_COUNT; op++) {
+            hist_merge(&per_op[op], &w->hist[op]);
+            hist_merge(all, &w->hist[op]);
+            requests[op] += w->requests[op];
+            errors[op] += w->errors[op];
+        }
+        for (int i = 0; i < 6; i++) status_class[i] += w->status_class[i];
+        io_errors += w->io_errors;
+        missed += w->missed;
+        for (int i = 0; i < timeline_slots; i++) {
+            tl_req[i] += w->timeline_requests[i];
+            tl_err[i] += w->timeline_errors[i];
+        }
+    }
+
+    uint64_t total = 0, total_errors = 0;
+    for (int op = 0; op < OP_COUNT; op++) {
+        total += requests[op];
+        total_errors += errors[op];
+    }
+
+    json_t *root = json_object();
+    if (cfg.label) json_object_set_new(root, "label", json_string(cfg.label));
+    char target[256];
+    snprintf(target, sizeof(target), "%s:%s", cfg.host, cfg.port);
+    json_object_set_new(root, "target", json_string(target));
+    json_object_set_new(root, "mode", json_string(cfg.rate > 0 ? "open" : "closed"));
+    json_object_set_new(root, "threads", json_integer(cfg.threads));
+    json_object_set_new(root, "idle_connections", json_integer(idle_open));
+    json_object_set_new(root, "duration_s", json_real(cfg.duration_s));
+    json_object_set_new(root, "warmup_s", json_real(cfg.warmup_s));
+    if (cfg.rate > 0) json_object_set_new(root, "target_rate", json_real(cfg.rate));
+
+    json_t *mix = json_object();
+    for (int op = 0; op < OP_COUNT; op++) json_object_set_new(mix, op_names[op], json_integer(cfg.mix[op]));
+    json_object_set_new(root, "mix", mix);
+
+    json_object_set_new(root, "requests", json_integer((json_int_t)total));
+    json_object_set_new(root, "errors", json_integer((json_int_t)total_errors));
+    if (cfg.rate > 0) json_object_set_new(root, "missed", json_integer((json_int_t)missed));
+    json_object_set_new(root, "throughput_rps", json_real((double)total / cfg.duration_s));
+    json_object_set_new(root, "latency_us", hist_json(all));
+
+    json_t *ops = json_object();
+    for (int op = 0; op < OP_COUNT; op++) {
+        if (cfg.mix[op] == 0) continue;
+        json_t *o = json_object();
+        json_object_set_new(o, "requests", json_integer((json_int_t)requests[op]));
+        json_object_set_new(o, "errors", json_integer((json_int_t)errors[op]));
+        json_object_set_new(o, "throughput_rps", json_real((double)requests[op] / cfg.duration_s));
+        json_object_set_new(o, "latency_us", hist_json(&per_op[op]));
+        json_object_set_new(ops, op_names[op], o);
+    }
+    json_object_set_new(root, "ops", ops);
+
+    json_t *status = json_object();
+    const char *class_names[6] = { NULL, "1xx", "2xx", "3xx", "4xx", "5xx" };
+    for (int i = 1; i < 6; i++) json_object_set_new(status, class_names[i], json_integer((json_int_t)status_class[i]));
+    json_object_set_new(status, "io_error", json_integer((json_int_t)io_errors));
+    json_object_set_new(root, "status", status);
+
+    json_t *timeline = json_array();
+    for (int i = 0; i < timeline_slots; i++) {
+        if ((double)i * cfg.interval_s >= cfg.duration_s) break;
+        json_t *p = json_object();
+        json_object_set_new(p, "t", json_real((double)i * cfg.interval_s));
+        json_object_set_new(p, "requests", json_integer((json_int_t)tl_req[i]));
+        json_object_set_new(p, "errors", json_integer((json_int_t)tl_err[i]));
+        json_object_set_new(p, "rps", json_real((double)tl_req[i] / cfg.interval_s));
+        json_array_append_new(timeline, p);
+    }
+    json_object_set_new(root, "timeline", timeline);
+
+    fprintf(stderr, "%llu requests, %llu errors, %.1f req/s, p50 %lluus p99 %lluus p999 %lluus max %lluus\n",
+            (unsigned long long)total, (unsigned long long)total_errors, (double)total / cfg.duration_s,
+            (unsigned long long)hist_percentile(all, 0.5), (unsigned long long)hist_percentile(all, 0.99),
+            (unsigned long long)hist_percentile(all, 0.999), (unsigned long long)all->max);
+
+    free(all); free(per_op); free(tl_req); free(tl_err);
+    return root;
+}
+
+int main(int argc, char **argv) {
+    if (!parse_args(argc, argv)) {
+        usage();
+        return 2;
+    }
+
+    if (!http_client_init(cfg.host, cfg.port)) {
+        fprintf(stderr, "cannot resolve %s:%s\n", cfg.host, cfg.port);
+        return 1;
+    }
+
+    if (cfg.setup) {
+        fprintf(stderr, "setup: %d courses, %d students\n", cfg.courses, cfg.students);
+        setup_population();
+    }
+
+    // After setup, so a thread-per-connection server is not starved before the run
+    HttpConn *idle = cfg.idle ? calloc((size_t)cfg.idle, sizeof(*idle)) : NULL;
+    for (int i = 0; i < cfg.idle && idle; i++) {
+        http_conn_init(&idle[i]);
+        if (!http_conn_connect(&idle[i])) break;
+        idle_open++;
+    }
+    if (cfg.idle) fprintf(stderr, "idle: %d of %d connections open\n", idle_open, cfg.idle);
+
+    timeline_slots = (int)(cfg.duration_s / cfg.interval_s) + 2;
+    Worker *workers = calloc((size_t)cfg.threads, sizeof(*workers));
+    if (!workers) return 1;
+    run_nonce = now_us() ^ ((uint64_t)cfg.seed << 32);
+    for (int t = 0; t < cfg.threads; t++) {
+        Worker *w = &workers[t];
+        w->id = t;
+        http_conn_init(&w->conn);
+        w->rng = (cfg.seed + 1) * 0x9E3779B97F4A7C15ull + (uint64_t)t * 0xBF58476D1CE4E5B9ull;
+        if (w->rng == 0) w->rng = 1;
+        w->hist = calloc(OP_COUNT, sizeof(*w->hist));
+        w->timeline_requests = calloc((size_t)timeline_slots, sizeof(uint64_t));
+        w->timeline_errors = calloc((size_t)timeline_slots, sizeof(uint64_t));
+        if (!w->hist || !w->timeline_requests || !w->timeline_errors) return 1;
+    }
+
+    fprintf(stderr, "running: %d threads, %s, %gs warmup + %gs\n", cfg.threads,
+            cfg.rate > 0 ? "open loop" : "closed loop", cfg.warmup_s, cfg.duration_s);
+    start_us = now_us() + (uint64_t)(cfg.warmup_s * 1e6);
+    end_us = start_us + (uint64_t)(cfg.duration_s * 1e6);
+    int started = 0;
+    for (; started < cfg.threads; started++) {
+        if (!thread_start(&workers[started].thread, worker_main, &workers[started])) {
+            fprintf(stderr, "failed to start thread %d\n", started);
+            break;
+        }
+    }
+    for (int t = 0; t < started; t++) thread_join(workers[t].thread);
+
+    json_t *report = build_report(workers);
+
+    if (!cfg.keep) {
+        for (int t = 0; t < cfg.threads; t++) worker_cleanup(&workers[t]);
+    }
+
+    int rc = 0;
+    if (!report) {
+        rc = 1;
+    } else if (cfg.out) {
+        if (json_dump_file(report, cfg.out, JSON_INDENT(2)) != 0) {
+            fprintf(stderr, "cannot write %s\n", cfg.out);
+            rc = 1;
+        }
+    } else {
+        json_dumpf(report, stdout, JSON_INDENT(2));
+        fputc('\n', stdout);
+    }
+    json_decref(report);
+
+    for (int t = 0; t < cfg.threads; t++) {
+        http_conn_close(&workers[t].conn);
+        free(workers[t].hist);
+        free(workers[t].timeline_requests);
+        free(workers[t].timeline_errors);
+    }
+    free(workers);
+    for (int i = 0; i < idle_open; i++) http_conn_close(&idle[i]);
+    free(idle);
+    http_client_cleanup();
+    return rc;
+}
@@ -0,0 +1,471 @@
+/*
+ * curriculum-replay: re-drives a traffic capture (CURRICULUM_CAPTURE, see
+ * src/capture.h) against a curriculum server.
+ *
+ *   curriculum-replay --log traffic.ndjson                  original timing
+ *   curriculum-replay --log traffic.ndjson --speed 10       10x faster
+ *   curriculum-replay --log traffic.ndjson --speed 0 --concurrency 32   flat out
+ *
+ * Records are replayed in arrival order. --concurrency keep-alive connections
+ * take them in that order; with a schedule (--speed > 0) each waits for its
+ * record's arrival time, and the lag between that time and the actual send is
+ * reported, as is latency. With --concurrency 1 the server sees exactly the
+ * captured order. Requests carry the captured Content-Type and Accept headers
+ * and body (base64-decoded when the capture had to encode it), so MessagePack
+ * traffic replays as MessagePack. Every response status is compared with the captured one, so
+ * a replay against a database restored to the capture's starting point should
+ * report no mismatches.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <jansson.h>
+#include "thread.h"
+#include "histogram.h"
+#include "http_client.h"
+
+#pragma region Configuration
+
+#define MAX_SKIP 16
+
+static struct {
+    const char *log;
+    const char *host;
+    const char *port;
+    double speed;               // 0 = as fast as possible
+    int concurrency;
+    long limit;                 // replay at most this many records; 0 = all
+    const char *skip[MAX_SKIP]; // URI prefixes left out of the replay
+    int skip_count;
+    const char *out;
+    const char *label;
+} cfg = {
+    .host = "127.0.0.1",
+    .port = "8080",
+    .speed = 1,
+    .concurrency = 8,
+};
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: curriculum-replay --log FILE [options]\n"
+        "  --log FILE          NDJSON capture written via CURRICULUM_CAPTURE\n"
+        "  --host H            server host (default 127.0.0.1)\n"
+        "  --port P            server port (default 8080)\n"
+        "  --speed X           replay at X times the captured pace; 0 = flat out (default 1)\n"
+        "  --concurrency N     connections replaying in parallel (default 8)\n"
+        "  --limit N           replay only the first N records\n"
+        "  --skip PREFIX       leave out URIs starting with PREFIX (repeatable)\n"
+        "  --label TEXT        copied into the JSON output\n"
+        "  --out FILE          write JSON to FILE instead of stdout\n");
+}
+
+static bool parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0) return false;
+        if (!v) { fprintf(stderr, "%s needs a value\n", a); return false; }
+        if (strcmp(a, "--log") == 0) cfg.log = v;
+        else if (strcmp(a, "--host") == 0) cfg.host = v;
+        else if (strcmp(a, "--port") == 0) cfg.port = v;
+        else if (strcmp(a, "--speed") == 0) cfg.speed = atof(v);
+        else if (strcmp(a, "--concurrency") == 0) cfg.concurrency = atoi(v);
+        else if (strcmp(a, "--limit") == 0) cfg.limit = atol(v);
+        else if (strcmp(a, "--label") == 0) cfg.label = v;
+        else if (strcmp(a, "--out") == 0) cfg.out = v;
+        else if (strcmp(a, "--skip") == 0) {
+            if (cfg.skip_count == MAX_SKIP) { fprintf(stderr, "too many --skip\n"); return false; }
+            cfg.skip[cfg.skip_count++] = v;
+        } else {
+            fprintf(stderr, "unknown option %s\n", a);
+            return false;
+        }
+        i++;
+    }
+    if (!cfg.log || cfg.speed < 0 || cfg.concurrency < 1 || cfg.limit < 0) {
+        fprintf(stderr, cfg.log ? "invalid option value\n" : "--log is required\n");
+        return false;
+    }
+    return true;
+}
+
+#pragma endregion Configuration
+
+#pragma region Capture log
+
+typedef struct {
+    uint64_t t_us;          // arrival, relative to the first record
+    char *method;
+    char *path;             // URI plus query string, ready for the request line
+    char *content_type;     // NULL when the request sent none
+    char *accept;
+    char *body;
+    size_t body_len;
+    int status;             // captured response status
+    size_t seq;             // position in the file, keeps the sort stable
+} Record;
+
+static Record *records;
+static size_t record_count;
+static size_t skipped;
+
+static bool skip_uri(const char *uri) {
+    for (int i = 0; i < cfg.skip_count; i++) {
+        if (strncmp(uri, cfg.skip[i], strlen(cfg.skip[i])) == 0) return true;
+    }
+    return false;
+}
+
+// The capture stores the decoded path, so re-escape what cannot go on a request line
+static char *build_path(const char *uri, const char *query) {
+    size_t n = strlen(uri), q = strlen(query);
+    char *out = malloc(n * 3 + q + 2);
+    if (!out) return NULL;
+    char *d = out;
+    for (const unsigned char *p = (const unsigned char *)uri; *p; p++) {
+        if (*p <= 0x20 || *p >= 0x7f || *p == '%' || *p == '?' || *p == '#') {
+            d += sprintf(d, "%%%02X", *p);
+        } else {
+            *d++ = (char)*p;
+        }
+    }
+    if (q) {
+        *d++ = '?';
+        memcpy(d, query, q);
+        d += q;
+    }
+    *d = '\0';
+    return out;
+}
+
+static char *dup_str(const char *s) {
+    size_t n = strlen(s) + 1;
+    char *d = malloc(n);
+    if (d) memcpy(d, s, n);
+    return d;
+}
+
+static int base64_value(char ch) {
+    if (ch >= 'A' && ch <= 'Z') return ch - 'A';
+    if (ch >= 'a' && ch <= 'z') return ch - 'a' + 26;
+    if (ch >= '0' && ch <= '9') return ch - '0' + 52;
+    if (ch == '+') return 62;
+    if (ch == '/') return 63;
+    return -1;
+}
+
+// Decodes a capture's body_base64; false when it is not base64
+static bool base64_decode(const char *s, size_t len, char **out, size_t *out_len) {
+    while (len && s[len - 1] == '=') len--;
+    if (len % 4 == 1) return false;
+    char *d = malloc(len / 4 * 3 + 3);
+    if (!d) return false;
+    size_t n = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < len; i++) {
+        int v = base64_value(s[i]);
+        if (v < 0) { free(d); return false; }
+        acc = (acc << 6) | (uint32_t)v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            d[n++] = (char)((acc >> bits) & 0xff);
+        }
+    }
+    *out = d;
+    *out_len = n;
+    return true;
+}
+
+// One line without its terminator, grown as needed; NULL at end of file
+static char *read_line(FILE *f, char **buf, size_t *cap) {
+    size_t len = 0;
+    for (;;) {
+        if (*cap - len < 2) {
+            size_t grown_cap = *cap ? *cap * 2 : 4096;
+            char *grown = realloc(*buf, grown_cap);
+            if (!grown) return NULL;
+            *buf = grown;
+            *cap = grown_cap;
+        }
+        if (!fgets(*buf + len, (int)(*cap - len), f)) break;
+        len += strlen(*buf + len);
+        if (len && (*buf)[len - 1] == '\n') break;
+    }
+    if (len == 0) return NULL;
+    while (len && ((*buf)[len - 1] == '\n' || (*buf)[len - 1] == '\r')) (*buf)[--len] = '\0';
+    return *buf;
+}
+
+static int compare_records(const void *a, const void *b) {
+    const Record *x = a, *y = b;
+    if (x->t_us != y->t_us) return x->t_us < y->t_us ? -1 : 1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static bool load_log(void) {
+    FILE *f = fopen(cfg.log, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", cfg.log);
+        return false;
+    }
+
+    size_t cap = 0, line_no = 0, line_cap = 0;
+    uint64_t shift = 0, latest = 0;
+    char *line = NULL;
+    bool ok = true;
+    while (ok && read_line(f, &line, &line_cap)) {
+        line_no++;
+        if (!*line) continue;
+        json_error_t err;
+        json_t *rec = json_loads(line, 0, &err);
+        if (!rec) {
+            fprintf(stderr, "%s:%zu: %s\n", cfg.log, line_no, err.text);
+            ok = false;
+            break;
+        }
+        // Each server start writes a marker and restarts the clock; continue after the previous session
+        if (json_object_get(rec, "session_start")) {
+            shift = record_count ? latest + 1 : 0;
+            json_decref(rec);
+            continue;
+        }
+
+        const char *method = json_string_value(json_object_get(rec, "method"));
+        const char *uri = json_string_value(json_object_get(rec, "uri"));
+        const char *query = json_string_value(json_object_get(rec, "query"));
+        const char *content_type = json_string_value(json_object_get(rec, "content_type"));
+        const char *accept = json_string_value(json_object_get(rec, "accept"));
+        json_t *body = json_object_get(rec, "body");
+        json_t *body_base64 = json_object_get(rec, "body_base64");
+        json_t *t = json_object_get(rec, "t_us");
+        if (!method || !uri || !json_is_integer(t)) {
+            fprintf(stderr, "%s:%zu: not a capture record\n", cfg.log, line_no);
+            json_decref(rec);
+            ok = false;
+            break;
+        }
+        uint64_t at = (uint64_t)json_integer_value(t) + shift;
+        if (at > latest) latest = at;
+
+        if (skip_uri(uri) || (cfg.limit && (long)record_count == cfg.limit)) {
+            skipped++;
+            json_decref(rec);
+            continue;
+        }
+        if (record_count == cap) {
+            cap = cap ? cap * 2 : 1024;
+            Record *grown = realloc(records, cap * sizeof(*records));
+            if (!grown) { json_decref(rec); ok = false; break; }
+            records = grown;
+        }
+        Record *r = &records[record_count];
+        r->t_us = at;
+        r->method = dup_str(method);
+        r->path = build_path(uri, query ? query : "");
+        r->content_type = content_type ? dup_str(content_type) : NULL;
+        r->accept = accept ? dup_str(accept) : NULL;
+        r->body = NULL;
+        r->body_len = 0;
+        if (json_is_string(body) && json_string_length(body)) {
+            r->body_len = json_string_length(body);
+            r->body = malloc(r->body_len);
+            if (r->body) memcpy(r->body, json_string_value(body), r->body_len);
+        } else if (json_is_string(body_base64) &&
+                   !base64_decode(json_string_value(body_base64), json_string_length(body_base64), &r->body, &r->body_len)) {
+            fprintf(stderr, "%s:%zu: body_base64 is not base64\n", cfg.log, line_no);
+            ok = false;
+        }
+        r->status = (int)json_integer_value(json_object_get(rec, "status"));
+        r->seq = record_count;
+        json_decref(rec);
+        record_count++;
+        if (!r->method || !r->path || (r->body_len && !r->body) ||
+            (content_type && !r->content_type) || (accept && !r->accept)) ok = false;
+    }
+    free(line);
+    fclose(f);
+    if (!ok) return false;
+
+    // Lines are written when requests finish, so put them back in arrival order
+    qsort(records, record_count, sizeof(*records), compare_records);
+    uint64_t first = record_count ? records[0].t_us : 0;
+    for (size_t i = 0; i < record_count; i++) records[i].t_us -= first;
+    return true;
+}
+
+#pragma endregion Capture log
+
+#pragma region Replay
+
+typedef struct {
+    thread_t thread;
+    HttpConn conn;
+    Histogram latency;
+    Histogram lag;
+    uint64_t requests;
+    uint64_t io_errors;
+    uint64_t mismatches;
+    uint64_t status_class[6];
+} Worker;
+
+static mutex_t next_lock;
+static size_t next_record;
+static uint64_t start_us;
+
+static const Record *claim(void) {
+    mutex_lock(&next_lock);
+    const Record *r = next_record < record_count ? &records[next_record++] : NULL;
+    mutex_unlock(&next_lock);
+    return r;
+}
+
+static void sleep_until(uint64_t t) {
+    for (;;) {
+        uint64_t now = now_us();
+        if (now >= t) return;
+        uint64_t left = t - now;
+        sleep_ms(left >= 2000 ? (int)(left / 1000) - 1 : 0);
+    }
+}
+
+static void worker_main(void *arg) {
+    Worker *w = arg;
+    const Record *r;
+    while ((r = claim()) != NULL) {
+        uint64_t scheduled = now_us();
+        if (cfg.speed > 0) {
+            scheduled = start_us + (uint64_t)((double)r->t_us / cfg.speed);
+            sleep_until(scheduled);
+        }
+        uint64_t sent = now_us();
+        int status = http_request_typed(&w->conn, r->method, r->path, r->content_type, r->accept, r->body, r->body_len);
+        uint64_t done = now_us();
+
+        w->requests++;
+        hist_record(&w->latency, done - sent);
+        if (cfg.speed > 0) hist_record(&w->lag, sent - scheduled);
+        if (status < 0) {
+            w->io_errors++;
+            continue;
+        }
+        if (status / 100 >= 1 && status / 100 <= 5) w->status_class[status / 100]++;
+        if (r->status && status != r->status) w->mismatches++;
+    }
+}
+
+static json_t *build_report(Worker *workers, double seconds) {
+    Histogram *latency = calloc(1, sizeof(*latency));
+    Histogram *lag = calloc(1, sizeof(*lag));
+    if (!latency || !lag) { free(latency); free(lag); return NULL; }
+
+    uint64_t requests = 0, io_errors = 0, mismatches = 0, status_class[6] = { 0 };
+    for (int t = 0; t < cfg.concurrency; t++) {
+        Worker *w = &workers[t];
+        hist_merge(latency, &w->latency);
+        hist_merge(lag, &w->lag);
+        requests += w->requests;
+        io_errors += w->io_errors;
+        mismatches += w->mismatches;
+        for (int i = 0; i < 6; i++) status_class[i] += w->status_class[i];
+    }
+
+    char target[300];
+    snprintf(target, sizeof(target), "%s:%s", cfg.host, cfg.port);
+    json_t *root = json_object();
+    if (cfg.label) json_object_set_new(root, "label", json_string(cfg.label));
+    json_object_set_new(root, "target", json_string(target));
+    json_object_set_new(root, "log", json_string(cfg.log));
+    json_object_set_new(root, "mode", json_string(cfg.speed == 0 ? "flat" : cfg.speed == 1 ? "original" : "scaled"));
+    json_object_set_new(root, "speed", json_real(cfg.speed));
+    json_object_set_new(root, "concurrency", json_integer(cfg.concurrency));
+    json_object_set_new(root, "records", json_integer((json_int_t)record_count));
+    json_object_set_new(root, "skipped", json_integer((json_int_t)skipped));
+    json_object_set_new(root, "captured_span_s", json_real(record_count ? (double)records[record_count - 1].t_us / 1e6 : 0.0));
+    json_object_set_new(root, "duration_s", json_real(seconds));
+    json_object_set_new(root, "requests", json_integer((json_int_t)requests));
+    json_object_set_new(root, "throughput_rps", json_real(seconds > 0 ? (double)requests / seconds : 0.0));
+    json_object_set_new(root, "status_mismatches", json_integer((json_int_t)mismatches));
+    json_object_set_new(root, "latency_us", hist_json(latency));
+    if (cfg.speed > 0) json_object_set_new(root, "lag_us", hist_json(lag));
+
+    json_t *status = json_object();
+    static const char *class_names[] = { "", "1xx", "2xx", "3xx", "4xx", "5xx" };
+    for (int i = 1; i < 6; i++) json_object_set_new(status, class_names[i], json_integer((json_int_t)status_class[i]));
+    json_object_set_new(status, "io_error", json_integer((json_int_t)io_errors));
+    json_object_set_new(root, "status", status);
+
+    fprintf(stderr, "replayed %llu requests in %.2fs (%.0f req/s), %llu status mismatches, %llu I/O errors, p50 %lluus p99 %lluus\n",
+            (unsigned long long)requests, seconds, seconds > 0 ? (double)requests / seconds : 0.0,
+            (unsigned long long)mismatches, (unsigned long long)io_errors,
+            (unsigned long long)hist_percentile(latency, 0.5), (unsigned long long)hist_percentile(latency, 0.99));
+    free(latency);
+    free(lag);
+    return root;
+}
+
+#pragma endregion Replay
+
+int main(int argc, char **argv) {
+    if (!parse_args(argc, argv)) {
+        usage();
+        return 2;
+    }
+    if (!load_log()) return 1;
+    fprintf(stderr, "loaded %zu records (%zu skipped) from %s\n", record_count, skipped, cfg.log);
+
+    if (!http_client_init(cfg.host, cfg.port)) {
+        fprintf(stderr, "cannot resolve %s:%s\n", cfg.host, cfg.port);
+        return 1;
+    }
+
+    Worker *workers = calloc((size_t)cfg.concurrency, sizeof(*workers));
+    if (!workers) return 1;
+    for (int t = 0; t < cfg.concurrency; t++) http_conn_init(&workers[t].conn);
+    mutex_init(&next_lock);
+
+    // Give the threads a moment to start so the first records are not reported late
+    start_us = now_us() + 10000;
+    int started = 0;
+    for (; started < cfg.concurrency; started++) {
+        if (!thread_start(&workers[started].thread, worker_main, &workers[started])) {
+            fprintf(stderr, "failed to start thread %d\n", started);
+            break;
+        }
+    }
+    for (int t = 0; t < started; t++) thread_join(workers[t].thread);
+    uint64_t end = now_us();
+    double seconds = end > start_us ? (double)(end - start_us) / 1e6 : 0.0;
+
+    json_t *report = build_report(workers, seconds);
+    int rc = 0;
+    if (!report) {
+        rc = 1;
+    } else if (cfg.out) {
+        if (json_dump_file(report, cfg.out, JSON_INDENT(2)) != 0) {
+            fprintf(stderr, "cannot write %s\n", cfg.out);
+            rc = 1;
+        }
+    } else {
+        json_dumpf(report, stdout, JSON_INDENT(2));
+        fputc('\n', stdout);
+    }
+    json_decref(report);
+
+    for (int t = 0; t < cfg.concurrency; t++) http_conn_close(&workers[t].conn);
+    free(workers);
+    mutex_destroy(&next_lock);
+    for (size_t i = 0; i < record_count; i++) {
+        free(records[i].method);
+        free(records[i].path);
+        free(records[i].content_type);
+        free(records[i].accept);
+        free(records[i].body);
+    }
+    free(records);
+    http_client_cleanup();
+    return rc;
+}
@@ -0,0 +1,66 @@
+#include "histogram.h"
+
+static int msb64(uint64_t v) {
+    int n = 0;
+    while (v >>= 1) n++;
+    return n;
+}
+
+static int hist_index(uint64_t v) {
+    if (v < (1u << SUB_BITS)) return (int)v;
+    int shift = msb64(v) - (SUB_BITS - 1);
+    return shift * 64 + (int)(v >> shift);
+}
+
+// Highest value that maps to the bucket, so percentiles never under-report
+static uint64_t hist_value(int index) {
+    if (index < (1 << SUB_BITS)) return (uint64_t)index;
+    int shift = index / 64 - 1;
+    uint64_t sub = (uint64_t)(index % 64 + 64);
+    return ((sub + 1) << shift) - 1;
+}
+
+void hist_record(Histogram *h, uint64_t v) {
+    h->counts[hist_index(v)]++;
+    if (h->total == 0 || v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+    h->total++;
+    h->sum += (double)v;
+}
+
+void hist_merge(Histogram *dst, const Histogram *src) {
+    if (src->total == 0) return;
+    for (int i = 0; i < HIST_BUCKETS; i++) dst->counts[i] += src->counts[i];
+    if (dst->total == 0 || src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+    dst->total += src->total;
+    dst->sum += src->sum;
+}
+
+uint64_t hist_percentile(const Histogram *h, double q) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)(q * (double)h->total + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t v = hist_value(i);
+            return v > h->max ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+json_t *hist_json(const Histogram *h) {
+    json_t *o = json_object();
+    json_object_set_new(o, "count", json_integer((json_int_t)h->total));
+    json_object_set_new(o, "min", json_integer((json_int_t)h->min));
+    json_object_set_new(o, "mean", json_real(h->total ? h->sum / (double)h->total : 0.0));
+    json_object_set_new(o, "p50", json_integer((json_int_t)hist_percentile(h, 0.50)));
+    json_object_set_new(o, "p90", json_integer((json_int_t)hist_percentile(h, 0.90)));
+    json_object_set_new(o, "p99", json_integer((json_int_t)hist_percentile(h, 0.99)));
+    json_object_set_new(o, "p999", json_integer((json_int_t)hist_percentile(h, 0.999)));
+    json_object_set_new(o, "max", json_integer((json_int_t)h->max));
+    return o;
+}
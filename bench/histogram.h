@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include <jansson.h>
+
+/*
+ * Log-linear latency histogram (~1.5% precision, HdrHistogram style) shared by
+ * the bench tools. Zero-initialise before use; not thread-safe, so keep one per
+ * thread and merge at the end.
+ */
+
+// Values below 2^SUB_BITS are exact; above that each power of two gets 64 buckets
+#define SUB_BITS 7
+#define HIST_BUCKETS ((64 - SUB_BITS + 1) * 64 + 64)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+} Histogram;
+
+void hist_record(Histogram *h, uint64_t v);
+void hist_merge(Histogram *dst, const Histogram *src);
+uint64_t hist_percentile(const Histogram *h, double q);
+// {count, min, mean, p50, p90, p99, p999, max}
+json_t *hist_json(const Histogram *h);
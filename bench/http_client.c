@@ -0,0 +1,243 @@
+#include "http_client.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef _WIN32
+#define close_socket closesocket
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#define close_socket close
+#endif
+
+static struct addrinfo *server_addr;
+static char host_header[300];
+
+bool http_client_init(const char *host, const char *port) {
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#endif
+    snprintf(host_header, sizeof(host_header), "%s:%s", host, port);
+    struct addrinfo hints = { 0 };
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    return getaddrinfo(host, port, &hints, &server_addr) == 0;
+}
+
+void http_client_cleanup(void) {
+    if (server_addr) freeaddrinfo(server_addr);
+    server_addr = NULL;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+void http_conn_init(HttpConn *c) {
+    c->fd = INVALID_SOCKET;
+    c->len = c->pos = 0;
+}
+
+void http_conn_close(HttpConn *c) {
+    if (c->fd != INVALID_SOCKET) close_socket(c->fd);
+    c->fd = INVALID_SOCKET;
+    c->len = c->pos = 0;
+}
+
+bool http_conn_connect(HttpConn *c) {
+    http_conn_close(c);
+    for (struct addrinfo *ai = server_addr; ai; ai = ai->ai_next) {
+        socket_t fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd == INVALID_SOCKET) continue;
+        if (connect(fd, ai->ai_addr, (int)ai->ai_addrlen) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof(one));
+            c->fd = fd;
+            return true;
+        }
+        close_socket(fd);
+    }
+    return false;
+}
+
+// An idle connection the server has closed reads as EOF straight away
+static bool conn_closed_by_server(HttpConn *c) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(c->fd, &readable);
+    struct timeval now = { 0, 0 };
+    if (select((int)c->fd + 1, &readable, NULL, NULL, &now) <= 0) return false;
+    char b;
+    return recv(c->fd, &b, 1, MSG_PEEK) <= 0;
+}
+
+static bool send_all(HttpConn *c, const char *p, size_t n) {
+    while (n > 0) {
+        int w = send(c->fd, p, (int)n, 0);
+        if (w <= 0) return false;
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+static bool fill(HttpConn *c) {
+    if (c->pos > 0) {
+        memmove(c->buf, c->buf + c->pos, c->len - c->pos);
+        c->len -= c->pos;
+        c->pos = 0;
+    }
+    if (c->len == sizeof(c->buf)) return false;
+    int r = recv(c->fd, c->buf + c->len, (int)(sizeof(c->buf) - c->len), 0);
+    if (r <= 0) return false;
+    c->len += (size_t)r;
+    return true;
+}
+
+// Next CRLF-terminated line, NUL-terminated in place
+static char *read_line(HttpConn *c) {
+    for (;;) {
+        char *start = c->buf + c->pos;
+        char *nl = memchr(start, '\n', c->len - c->pos);
+        if (nl) {
+            *nl = '\0';
+            if (nl > start && nl[-1] == '\r') nl[-1] = '\0';
+            c->pos = (size_t)(nl - c->buf) + 1;
+            return start;
+        }
+        if (!fill(c)) return NULL;
+    }
+}
+
+static bool skip_bytes(HttpConn *c, uint64_t n) {
+    while (n > 0) {
+        if (c->pos == c->len && !fill(c)) return false;
+        size_t take = c->len - c->pos;
+        if (take > n) take = (size_t)n;
+        c->pos += take;
+        n -= take;
+    }
+    return true;
+}
+
+static bool header_is(const char *line, const char *name, const char **value) {
+    size_t n = strlen(name);
+    for (size_t i = 0; i < n; i++) {
+        if (tolower((unsigned char)line[i]) != name[i]) return false;
+    }
+    if (line[n] != ':') return false;
+    const char *v = line + n + 1;
+    while (*v == ' ' || *v == '\t') v++;
+    *value = v;
+    return true;
+}
+
+// How far an exchange got before it failed
+typedef enum {
+    EXCHANGE_UNSENT,        // the request did not make it into the socket
+    EXCHANGE_SENT,          // sent, but not a byte of response came back
+    EXCHANGE_ANSWERED
+} ExchangeProgress;
+
+// Sends one request and consumes the response; returns the status or -1 on I/O error
+static int http_exchange(HttpConn *c, const char *req, size_t req_len, ExchangeProgress *progress) {
+    *progress = EXCHANGE_UNSENT;
+    if (!send_all(c, req, req_len)) return -1;
+    *progress = EXCHANGE_SENT;
+
+    char *line = read_line(c);
+    if (line || c->len > 0) *progress = EXCHANGE_ANSWERED;
+    if (!line || strncmp(line, "HTTP/1.", 7) != 0) return -1;
+    int status = atoi(line + 9);
+
+    int64_t content_length = -1;
+    bool chunked = false, close_after = false;
+    while ((line = read_line(c)) != NULL && *line) {
+        const char *v;
+        if (header_is(line, "content-length", &v)) content_length = strtoll(v, NULL, 10);
+        else if (header_is(line, "transfer-encoding", &v)) chunked = strstr(v, "chunked") != NULL;
+        else if (header_is(line, "connection", &v)) close_after = strncmp(v, "close", 5) == 0;
+    }
+    if (!line) return -1;
+
+    if (chunked) {
+        for (;;) {
+            char *size_line = read_line(c);
+            if (!size_line) return -1;
+            uint64_t size = strtoull(size_line, NULL, 16);
+            if (size == 0) {
+                while ((line = read_line(c)) != NULL && *line) {}
+                if (!line) return -1;
+                break;
+            }
+            if (!skip_bytes(c, size) || !read_line(c)) return -1;
+        }
+    } else if (content_length >= 0) {
+        if (!skip_bytes(c, (uint64_t)content_length)) return -1;
+    } else {
+        // No framing: the body runs to EOF
+        c->pos = c->len;
+        while (fill(c)) c->pos = c->len;
+        close_after = true;
+    }
+
+    if (close_after) http_conn_close(c);
+    return status;
+}
+
+int http_request(HttpConn *c, const char *method, const char *path, const char *body, size_t body_len) {
+    return http_request_typed(c, method, path, NULL, NULL, body, body_len);
+}
+
+int http_request_typed(HttpConn *c, const char *method, const char *path, const char *content_type,
+                       const char *accept, const char *body, size_t body_len) {
+    char small[4096];
+    const char *accept_name = accept ? "Accept: " : "", *accept_end = accept ? "\r\n" : "";
+    if (!content_type) content_type = "application/json";
+    if (!accept) accept = "";
+    int head = snprintf(NULL, 0,
+        "%s %s HTTP/1.1\r\n"
+        "Host: %s\r\n"
+        "Content-Type: %s\r\n"
+        "%s%s%s"
+        "Content-Length: %zu\r\n"
+        "\r\n",
+        method, path, host_header, content_type, accept_name, accept, accept_end, body_len);
+    if (head < 0) return -1;
+    size_t n = (size_t)head + body_len;
+    char *req = n < sizeof(small) ? small : malloc(n + 1);
+    if (!req) return -1;
+    snprintf(req, (size_t)head + 1,
+        "%s %s HTTP/1.1\r\n"
+        "Host: %s\r\n"
+        "Content-Type: %s\r\n"
+        "%s%s%s"
+        "Content-Length: %zu\r\n"
+        "\r\n",
+        method, path, host_header, content_type, accept_name, accept, accept_end, body_len);
+    if (body_len) memcpy(req + head, body, body_len);
+
+    // A kept-alive connection the server closed while idle is replaced up front. One it
+    // closes while the request goes out is retried once on a fresh connection; a write
+    // that was sent but got no answer is not, as it may still have been applied.
+    int status = -1;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (c->fd != INVALID_SOCKET && conn_closed_by_server(c)) http_conn_close(c);
+        bool reused = c->fd != INVALID_SOCKET;
+        if (!reused && !http_conn_connect(c)) break;
+        ExchangeProgress progress;
+        status = http_exchange(c, req, n, &progress);
+        if (status >= 0) break;
+        http_conn_close(c);
+        bool unanswered = progress == EXCHANGE_UNSENT || (progress == EXCHANGE_SENT && strcmp(method, "GET") == 0);
+        if (!reused || !unanswered) break;
+    }
+    if (req != small) free(req);
+    return status;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#else
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#endif
+
+/*
+ * Minimal HTTP/1.1 keep-alive client shared by the bench tools. Responses are
+ * read (Content-Length, chunked or close-delimited) and discarded; only the
+ * status is returned. One HttpConn per thread.
+ */
+
+typedef struct {
+    socket_t fd;
+    char buf[16384];
+    size_t len;
+    size_t pos;
+} HttpConn;
+
+// Resolves host:port once for every connection (and starts Winsock)
+bool http_client_init(const char *host, const char *port);
+void http_client_cleanup(void);
+
+void http_conn_init(HttpConn *c);
+void http_conn_close(HttpConn *c);
+
+// Opens the connection without sending anything (used to hold idle connections)
+bool http_conn_connect(HttpConn *c);
+
+// Sends one request and consumes the response; returns the status or -1 on I/O error.
+// path may include a query string; body may be NULL.
+int http_request(HttpConn *c, const char *method, const char *path, const char *body, size_t body_len);
+// As http_request with the given Content-Type (NULL: application/json) and Accept (NULL: none)
+int http_request_typed(HttpConn *c, const char *method, const char *path, const char *content_type,
+                       const char *accept, const char *body, size_t body_len);
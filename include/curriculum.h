@@ -0,0 +1,154 @@
+#pragma once
+/*
+ * libcurriculum: the server's storage layer as an embeddable C library.
+ *
+ * Batch jobs open the same database the server uses and read or write it
+ * in-process, without going through HTTP:
+ *
+ *   CurDb *db;
+ *   if (cur_open(NULL, "curriculum.db", &db) != CUR_OK) ...
+ *   CurCursor *it;
+ *   CurStudent s;
+ *   cur_student_query(db, NULL, &it);
+ *   while (cur_student_next(it, &s) == CUR_ROW) ...
+ *   cur_cursor_close(it);
+ *   cur_close(db);
+ *
+ * Handles are independent (each has its own connection) and thread-safe:
+ * calls on one handle are serialized, and a thread inside cur_begin/cur_commit
+ * owns the handle until the transaction ends. Threads that should read in
+ * parallel open a handle each. An SQLite database may be shared with a
+ * running server; a memory-backend store must not be (it has a single writer).
+ *
+ * Strings passed in are copied as needed; strings handed out (rows from
+ * visitors and cursors) are only valid until the next row or call.
+ */
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32) && defined(CURRICULUM_SHARED)
+#  ifdef CURRICULUM_BUILDING
+#    define CURRICULUM_API __declspec(dllexport)
+#  else
+#    define CURRICULUM_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__)
+#  define CURRICULUM_API __attribute__((visibility("default")))
+#else
+#  define CURRICULUM_API
+#endif
+
+// Bumped on incompatible changes to anything in this header
+#define CURRICULUM_API_VERSION 1
+
+typedef enum {
+    CUR_OK = 0,
+    CUR_ERROR = 1,          // storage failure; details go to the log
+    CUR_INVALID = 2,        // missing required field, bad query option or misuse
+    CUR_NOT_FOUND = 3,      // the row to change, or an enrollment's student/course, does not exist
+    CUR_EXISTS = 4,         // the ID (or enrollment) is already taken
+    CUR_NOMEM = 5,
+    CUR_ROW = 100,          // a cursor produced a row
+    CUR_DONE = 101          // a cursor is exhausted
+} CurStatus;
+
+typedef struct CurDb CurDb;
+typedef struct CurCursor CurCursor;
+
+typedef struct {
+    const char *course_id;   // required
+    const char *name;
+    const char *type;
+    double total_hours;
+    double lecture_hours;
+    double lab_hours;
+    double credit;           // required
+    const char *semester;
+} CurCourse;
+
+typedef struct {
+    const char *student_id;  // required
+    const char *name;        // required
+    const char *email;
+    double credits;          // kept equal to the sum of enrolled course credits
+} CurStudent;
+
+typedef struct {
+    const char *student_id;
+    const char *course_id;
+} CurEnrollment;
+
+typedef enum {
+    CUR_ALL,                 // no filter
+    CUR_BY_COURSE_ID,        // exact match
+    CUR_BY_STUDENT_ID,       // exact match
+    CUR_BY_NAME,             // LIKE pattern
+    CUR_BY_TYPE,             // LIKE pattern, courses only
+    CUR_BY_SEMESTER          // LIKE pattern, courses only
+} CurField;
+
+// A NULL query means CUR_ALL in the default order with no limit
+typedef struct {
+    CurField field;
+    const char *value;       // required unless field is CUR_ALL
+    const char *order_by;    // a column of the entity, NULL = default order
+    bool descending;
+    int limit;               // <= 0 = no limit
+    int offset;              // >= 0
+} CurQuery;
+
+typedef void (*CurCourseVisitor)(const CurCourse *, void *user);
+typedef void (*CurStudentVisitor)(const CurStudent *, void *user);
+typedef void (*CurEnrollmentVisitor)(const CurEnrollment *, void *user);
+
+CURRICULUM_API int cur_api_version(void);
+CURRICULUM_API const char *cur_strerror(CurStatus status);
+
+// backend: "sqlite" (default when NULL) or "memory"; the database is created if missing
+CURRICULUM_API CurStatus cur_open(const char *backend, const char *path, CurDb **out);
+// Close every cursor of the handle first
+CURRICULUM_API void cur_close(CurDb *db);
+
+// One transaction per handle at a time; other threads wait until it ends
+CURRICULUM_API CurStatus cur_begin(CurDb *db);
+CURRICULUM_API CurStatus cur_commit(CurDb *db);
+CURRICULUM_API CurStatus cur_rollback(CurDb *db);
+
+CURRICULUM_API CurStatus cur_course_add(CurDb *db, const CurCourse *course);
+CURRICULUM_API CurStatus cur_course_update(CurDb *db, const CurCourse *course);
+// Also drops the course's enrollments
+CURRICULUM_API CurStatus cur_course_remove(CurDb *db, const char *course_id);
+CURRICULUM_API CurStatus cur_course_remove_all(CurDb *db);
+
+CURRICULUM_API CurStatus cur_student_add(CurDb *db, const CurStudent *student);
+CURRICULUM_API CurStatus cur_student_update(CurDb *db, const CurStudent *student);
+CURRICULUM_API CurStatus cur_student_remove(CurDb *db, const char *student_id);
+CURRICULUM_API CurStatus cur_student_remove_all(CurDb *db);
+
+// Enrolling adds the course's credit to the student, removing takes it back
+CURRICULUM_API CurStatus cur_enrollment_add(CurDb *db, const CurEnrollment *enrollment);
+CURRICULUM_API CurStatus cur_enrollment_remove(CurDb *db, const char *student_id, const char *course_id);
+CURRICULUM_API CurStatus cur_enrollment_remove_all(CurDb *db);
+
+// Push-style reads: the visitor runs for every row before the call returns
+CURRICULUM_API CurStatus cur_course_visit(CurDb *db, const CurQuery *query, CurCourseVisitor visitor, void *user);
+CURRICULUM_API CurStatus cur_student_visit(CurDb *db, const CurQuery *query, CurStudentVisitor visitor, void *user);
+CURRICULUM_API CurStatus cur_enrollment_visit(CurDb *db, const CurQuery *query, CurEnrollmentVisitor visitor, void *user);
+
+// Pull-style reads: *_next returns CUR_ROW with the row filled in, CUR_DONE at
+// the end, or an error. SQLite streams rows from the open statement; the
+// memory backend collects the result when the cursor is opened.
+CURRICULUM_API CurStatus cur_course_query(CurDb *db, const CurQuery *query, CurCursor **out);
+CURRICULUM_API CurStatus cur_student_query(CurDb *db, const CurQuery *query, CurCursor **out);
+CURRICULUM_API CurStatus cur_enrollment_query(CurDb *db, const CurQuery *query, CurCursor **out);
+CURRICULUM_API CurStatus cur_course_next(CurCursor *cursor, CurCourse *row);
+CURRICULUM_API CurStatus cur_student_next(CurCursor *cursor, CurStudent *row);
+CURRICULUM_API CurStatus cur_enrollment_next(CurCursor *cursor, CurEnrollment *row);
+CURRICULUM_API void cur_cursor_close(CurCursor *cursor);
+
+#ifdef __cplusplus
+}
+#endif
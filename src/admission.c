@@ -0,0 +1,215 @@
+#include "admission.h"
+#include "thread.h"
+#include "trace.h"
+#include <string.h>
+
+#define WAIT_BUCKETS 32             // bucket i > 0 counts waits in [2^(i-1), 2^i) microseconds
+
+typedef struct Waiter {
+    struct Waiter *next;
+    bool admitted;
+} Waiter;
+
+typedef struct {
+    cond_t wake;
+    Waiter *head, *tail;            // FIFO of requests waiting for a slot
+    AdmitStats stats;
+    uint64_t wait_hist[WAIT_BUCKETS];
+} AdmitQueue;
+
+static struct {
+    mutex_t lock;
+    bool running;
+    int wait_ms;
+    int retry_after;
+    AdmitQueue q[ADMIT_CLASSES];
+} ad;
+
+static const char *class_names[ADMIT_CLASSES] = { "read", "write", "bulk" };
+static const char *limit_vars[ADMIT_CLASSES] = { "CURRICULUM_ADMIT_READ", "CURRICULUM_ADMIT_WRITE", "CURRICULUM_ADMIT_BULK" };
+static const char *queue_vars[ADMIT_CLASSES] = { "CURRICULUM_ADMIT_READ_QUEUE", "CURRICULUM_ADMIT_WRITE_QUEUE", "CURRICULUM_ADMIT_BULK_QUEUE" };
+static const long limit_defaults[ADMIT_CLASSES] = { 0, 0, 1 };
+static const long queue_defaults[ADMIT_CLASSES] = { 64, 64, 0 };
+
+bool admission_start(void) {
+    mutex_init(&ad.lock);
+    ad.wait_ms = (int)env_long("CURRICULUM_ADMIT_WAIT_MS", 1000);
+    ad.retry_after = (int)env_long("CURRICULUM_RETRY_AFTER_S", 1);
+    if (ad.wait_ms < 0) ad.wait_ms = 0;
+    if (ad.retry_after < 1) ad.retry_after = 1;
+
+    char buf[256];
+    int len = snprintf(buf, sizeof(buf), "Admission control:");
+    for (int i = 0; i < ADMIT_CLASSES; i++) {
+        AdmitQueue *q = &ad.q[i];
+        memset(q, 0, sizeof(*q));
+        cond_init(&q->wake);
+        long limit = env_long(limit_vars[i], limit_defaults[i]);
+        long queue = env_long(queue_vars[i], queue_defaults[i]);
+        q->stats.limit = limit > 0 ? (int)limit : 0;
+        q->stats.queue_limit = queue > 0 ? (int)queue : 0;
+        if (q->stats.limit)
+            len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %s %d+%d", class_names[i], q->stats.limit, q->stats.queue_limit);
+        else
+            len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %s unlimited", class_names[i]);
+    }
+    ad.running = true;
+    log_message(buf, LOG_INFO);
+    return true;
+}
+
+void admission_stop(void) {
+    if (!ad.running) return;
+    mutex_lock(&ad.lock);
+    ad.running = false;
+    mutex_unlock(&ad.lock);
+    for (int i = 0; i < ADMIT_CLASSES; i++) cond_destroy(&ad.q[i].wake);
+    mutex_destroy(&ad.lock);
+}
+
+AdmitClass admission_classify(const struct mg_request_info *ri) {
+    const char *method = ri->request_method;
+    const char *uri = ri->local_uri;
+    if (strcmp(method, "OPTIONS") == 0 || strcmp(uri, "/ping") == 0 || strcmp(uri, "/metrics") == 0
+        || strncmp(uri, "/debug/", 7) == 0)
+        return ADMIT_EXEMPT;
+    if (strncmp(uri, "/export/", 8) == 0) return ADMIT_BULK;
+    if (strcmp(method, "GET") == 0) return ADMIT_READ;
+    size_t n = strlen(uri);
+    if (n >= 4 && strcmp(uri + n - 4, "/all") == 0) return ADMIT_BULK;
+    return ADMIT_WRITE;
+}
+
+// Caller holds ad.lock
+static void record_wait(AdmitQueue *q, uint64_t us) {
+    int bucket = 0;
+    while (bucket < WAIT_BUCKETS - 1 && us >= (1ull << bucket)) bucket++;
+    q->wait_hist[bucket]++;
+    q->stats.admitted++;
+    q->stats.wait_total_us += us;
+    if (us > q->stats.wait_max_us) q->stats.wait_max_us = us;
+}
+
+static bool slot_free(const AdmitQueue *q) {
+    return !q->stats.limit || q->stats.active < q->stats.limit;
+}
+
+bool admission_enter(AdmitClass cls) {
+    if (cls == ADMIT_EXEMPT || !ad.running) return true;
+    AdmitQueue *q = &ad.q[cls];
+    mutex_lock(&ad.lock);
+    // Waiters go first, so a newcomer cannot overtake the queue
+    if (slot_free(q) && !q->head) {
+        q->stats.active++;
+        record_wait(q, 0);
+        mutex_unlock(&ad.lock);
+        return true;
+    }
+    if (q->stats.queued >= q->stats.queue_limit) {
+        q->stats.shed_full++;
+        mutex_unlock(&ad.lock);
+        return false;
+    }
+
+    Waiter w = { NULL, false };
+    if (q->tail) q->tail->next = &w;
+    else q->head = &w;
+    q->tail = &w;
+    q->stats.queued++;
+
+    TraceSpan span;
+    bool traced = trace_span_begin(&span);
+    uint64_t start = now_us();
+    uint64_t deadline = start + (uint64_t)ad.wait_ms * 1000;
+    for (;;) {
+        uint64_t now = now_us();
+        if (w.admitted || now >= deadline) break;
+        cond_timedwait(&q->wake, &ad.lock, (int)((deadline - now + 999) / 1000));
+    }
+    if (w.admitted) {
+        q->stats.queued_total++;
+        record_wait(q, now_us() - start);
+    } else {
+        // Timed out: unlink ourselves; admission_leave only hands slots to queued waiters
+        Waiter *prev = NULL;
+        for (Waiter *it = q->head; it != &w; it = it->next) prev = it;
+        if (prev) prev->next = w.next;
+        else q->head = w.next;
+        if (q->tail == &w) q->tail = prev;
+        q->stats.queued--;
+        q->stats.shed_timeout++;
+    }
+    mutex_unlock(&ad.lock);
+    if (traced) trace_span_end(&span, "admission.wait", class_names[cls]);
+    return w.admitted;
+}
+
+void admission_leave(AdmitClass cls) {
+    if (cls == ADMIT_EXEMPT || !ad.running) return;
+    AdmitQueue *q = &ad.q[cls];
+    mutex_lock(&ad.lock);
+    q->stats.active--;
+    // Hand the slot straight to the oldest waiter
+    if (q->head && slot_free(q)) {
+        Waiter *w = q->head;
+        q->head = w->next;
+        if (!q->head) q->tail = NULL;
+        w->admitted = true;
+        q->stats.queued--;
+        q->stats.active++;
+        cond_broadcast(&q->wake);
+    }
+    mutex_unlock(&ad.lock);
+}
+
+int admission_retry_after(void) {
+    return ad.retry_after;
+}
+
+static uint64_t percentile(const AdmitQueue *q, double p) {
+    uint64_t total = 0;
+    for (int i = 0; i < WAIT_BUCKETS; i++) total += q->wait_hist[i];
+    if (!total) return 0;
+    uint64_t rank = (uint64_t)(p * (double)total);
+    uint64_t seen = 0;
+    for (int i = 0; i < WAIT_BUCKETS; i++) {
+        seen += q->wait_hist[i];
+        if (seen > rank) return i ? 1ull << i : 0;
+    }
+    return q->stats.wait_max_us;
+}
+
+void admission_get_stats(AdmitClass cls, AdmitStats *out) {
+    memset(out, 0, sizeof(*out));
+    if (cls >= ADMIT_CLASSES || !ad.running) return;
+    mutex_lock(&ad.lock);
+    *out = ad.q[cls].stats;
+    out->wait_p50_us = percentile(&ad.q[cls], 0.50);
+    out->wait_p99_us = percentile(&ad.q[cls], 0.99);
+    mutex_unlock(&ad.lock);
+}
+
+json_t *admission_stats_json(void) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "retry_after_s", json_integer(ad.retry_after));
+    json_object_set_new(obj, "wait_ms", json_integer(ad.wait_ms));
+    for (int i = 0; i < ADMIT_CLASSES; i++) {
+        AdmitStats s;
+        admission_get_stats((AdmitClass)i, &s);
+        json_t *c = json_object();
+        json_object_set_new(c, "limit", json_integer(s.limit));
+        json_object_set_new(c, "queue_limit", json_integer(s.queue_limit));
+        json_object_set_new(c, "active", json_integer(s.active));
+        json_object_set_new(c, "queued", json_integer(s.queued));
+        json_object_set_new(c, "admitted", json_integer((json_int_t)s.admitted));
+        json_object_set_new(c, "admitted_after_wait", json_integer((json_int_t)s.queued_total));
+        json_object_set_new(c, "shed_queue_full", json_integer((json_int_t)s.shed_full));
+        json_object_set_new(c, "shed_timeout", json_integer((json_int_t)s.shed_timeout));
+        json_object_set_new(c, "wait_avg_us", json_integer(s.admitted ? (json_int_t)(s.wait_total_us / s.admitted) : 0));
+        json_object_set_new(c, "wait_p50_us", json_integer((json_int_t)s.wait_p50_us));
+        json_object_set_new(c, "wait_p99_us", json_integer((json_int_t)s.wait_p99_us));
+        json_object_set_new(c, "wait_max_us", json_integer((json_int_t)s.wait_max_us));
+        json_object_set_new(obj, class_names[i], c);
+    }
+    return obj;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "utils.h"
+#include <stdint.h>
+
+/*
+ * Admission control. Every request is put into a class before its handler
+ * runs; each class has its own concurrency limit and a bounded FIFO of
+ * requests waiting for a slot. A request that finds the queue full, or waits
+ * longer than CURRICULUM_ADMIT_WAIT_MS, is answered with 503 and Retry-After
+ * at once instead of piling up behind the SQLite lock. Keeping bulk work in
+ * its own class means a remove_all or a full export cannot take the slots
+ * (and threads) that cheap reads need.
+ *
+ *   read    GET requests
+ *   write   POST / PUT / DELETE of single rows
+ *   bulk    DELETE .../all and GET /export/...
+ *
+ * OPTIONS, /ping, /metrics and /debug/... are never queued or shed.
+ *
+ * CURRICULUM_ADMIT_READ         concurrent reads (default 0 = unlimited)
+ * CURRICULUM_ADMIT_WRITE        concurrent writes (default 0 = unlimited)
+ * CURRICULUM_ADMIT_BULK         concurrent bulk requests (default 1)
+ * CURRICULUM_ADMIT_READ_QUEUE   reads that may wait for a slot (default 64)
+ * CURRICULUM_ADMIT_WRITE_QUEUE  writes that may wait for a slot (default 64)
+ * CURRICULUM_ADMIT_BULK_QUEUE   bulk requests that may wait for a slot (default 0)
+ * CURRICULUM_ADMIT_WAIT_MS      longest wait for a slot (default 1000)
+ * CURRICULUM_RETRY_AFTER_S      Retry-After sent with 503 (default 1)
+ */
+
+typedef enum {
+    ADMIT_READ,
+    ADMIT_WRITE,
+    ADMIT_BULK,
+    ADMIT_CLASSES,
+    ADMIT_EXEMPT = ADMIT_CLASSES
+} AdmitClass;
+
+typedef struct {
+    int limit;                      // 0 = unlimited
+    int queue_limit;
+    int active;
+    int queued;
+    uint64_t admitted;
+    uint64_t queued_total;          // admitted after waiting
+    uint64_t shed_full;             // rejected because the queue was full
+    uint64_t shed_timeout;          // rejected after waiting CURRICULUM_ADMIT_WAIT_MS
+    uint64_t wait_total_us;
+    uint64_t wait_max_us;
+    uint64_t wait_p50_us;           // upper bound of the histogram bucket
+    uint64_t wait_p99_us;
+} AdmitStats;
+
+bool admission_start(void);
+void admission_stop(void);
+
+AdmitClass admission_classify(const struct mg_request_info *ri);
+
+// false means the request must be shed; on true admission_leave must follow
+bool admission_enter(AdmitClass cls);
+void admission_leave(AdmitClass cls);
+int admission_retry_after(void);
+
+void admission_get_stats(AdmitClass cls, AdmitStats *out);
+json_t *admission_stats_json(void);
@@ -0,0 +1,368 @@
+#include "backup.h"
+#include "db.h"
+#include "thread.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+#ifdef CURRICULUM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Requests and results, private to this process unless backup_share placed them in
+// shared memory, so any server process answers POST and GET /backup
+typedef struct {
+    mutex_t lock;
+    bool requested;
+    bool busy;                      // a backup is being written
+    long owner;                     // process whose thread takes the requests, 0 = none
+
+    uint64_t backups;
+    uint64_t failures;
+    uint64_t total_bytes;
+    uint64_t total_duration_us;
+    char last_file[300];            // of the first shard
+    char last_started[32];
+    bool last_ok;
+    int last_files;
+    int last_pages;
+    int last_steps;
+    int last_restarts;
+    int64_t last_bytes;             // database size copied
+    int64_t last_output_bytes;      // written, after compression
+    uint64_t last_duration_us;
+} BackupState;
+
+static BackupState own_state;
+
+static struct {
+    mutex_t lock;                   // taken before state->lock, never after
+    cond_t wake;
+    thread_t thread;
+    bool started;
+    bool running;                   // this process runs the backup thread
+    bool stopping;
+    BackupState *state;
+
+    const char *dir;
+    int interval_s;
+    int step_pages;
+    int pause_ms;
+    int compress;                   // gzip level, 0 = off
+    uint64_t next_at_us;            // next scheduled backup
+} bk = { .state = &own_state };
+
+// How often the thread looks for requests made by other processes, which cannot wake it
+#define BACKUP_POLL_MS 200
+
+static int64_t file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (int64_t)st.st_size : -1;
+}
+
+static bool make_dir(const char *dir) {
+#ifdef _WIN32
+    int rc = _mkdir(dir);
+#else
+    int rc = mkdir(dir, 0755);
+#endif
+    return rc == 0 || errno == EEXIST;
+}
+
+static bool finish_file(const char *tmp, const char *path) {
+#ifdef _WIN32
+    remove(path);
+#endif
+    if (rename(tmp, path) == 0) return true;
+    remove(tmp);
+    return false;
+}
+
+#ifdef CURRICULUM_HAVE_ZLIB
+static bool gzip_file(const char *from, const char *to, int level) {
+    FILE *in = fopen(from, "rb");
+    if (!in) return false;
+    char mode[8];
+    snprintf(mode, sizeof(mode), "wb%d", level);
+    gzFile out = gzopen(to, mode);
+    bool ok = out != NULL;
+    char buf[65536];
+    size_t n;
+    while (ok && (n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        ok = gzwrite(out, buf, (unsigned)n) == (int)n;
+    }
+    ok = !ferror(in) && ok;
+    fclose(in);
+    if (out && gzclose(out) != Z_OK) ok = false;
+    if (!ok) remove(to);
+    return ok;
+}
+#endif
+
+// Copies one database file to dir/<stem>-<stamp><ext>[.gz]; sizes and stats are added up
+static bool backup_file(const char *src, const char *stamp, char *out, size_t outlen, DbCopyStats *st, int64_t *bytes, int64_t *written) {
+    const char *base = strrchr(src, '/');
+    base = base ? base + 1 : src;
+    const char *ext = strrchr(base, '.');
+    int stem = ext ? (int)(ext - base) : (int)strlen(base);
+    snprintf(out, outlen, "%s/%.*s-%s%s%s", bk.dir, stem, base, stamp, ext ? ext : "", bk.compress ? ".gz" : "");
+
+    // Per-process temporary names, so two servers sharing the directory never write one file
+    char copy[340];
+    snprintf(copy, sizeof(copy), "%.*s.%ld.tmp", (int)(strlen(out) - (bk.compress ? 3 : 0)), out, process_id());
+    DbCopyStats one;
+    if (!db_copy_file(src, copy, bk.step_pages, bk.pause_ms, &one)) {
+        remove(copy);
+        return false;
+    }
+    st->pages += one.pages;
+    st->steps += one.steps;
+    st->restarts += one.restarts;
+    *bytes += file_size(copy);
+
+    bool ok;
+#ifdef CURRICULUM_HAVE_ZLIB
+    if (bk.compress) {
+        char gz[340];
+        snprintf(gz, sizeof(gz), "%s.%ld.tmp", out, process_id());
+        ok = gzip_file(copy, gz, bk.compress);
+        remove(copy);
+        ok = ok && finish_file(gz, out);
+    } else
+#endif
+    {
+        ok = finish_file(copy, out);
+    }
+    if (ok) *written += file_size(out);
+    return ok;
+}
+
+static void run_backup(void) {
+    char stamp[32], started[32];
+    time_t now = time(NULL);
+    struct tm tm;
+#ifdef _WIN32
+    localtime_s(&tm, &now);
+#else
+    localtime_r(&now, &tm);
+#endif
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+    strftime(started, sizeof(started), "%Y-%m-%d %H:%M:%S", &tm);
+
+    uint64_t start = now_us();
+    DbCopyStats st = { 0 };
+    int64_t bytes = 0, written = 0;
+    char first[300] = "";
+    int files = db_shard_count();
+    bool ok = make_dir(bk.dir);
+    if (!ok) log_message("backup: cannot create CURRICULUM_BACKUP_DIR", LOG_ERROR);
+    for (int i = 0; ok && i < files; i++) {
+        char src[256], out[300];
+        db_shard_file(i, src, sizeof(src));
+        ok = backup_file(src, stamp, out, sizeof(out), &st, &bytes, &written);
+        if (i == 0) snprintf(first, sizeof(first), "%s", out);
+    }
+    uint64_t elapsed = now_us() - start;
+
+    BackupState *s = bk.state;
+    mutex_lock(&s->lock);
+    snprintf(s->last_file, sizeof(s->last_file), "%s", first);
+    snprintf(s->last_started, sizeof(s->last_started), "%s", started);
+    s->last_ok = ok;
+    s->last_files = files;
+    s->last_pages = st.pages;
+    s->last_steps = st.steps;
+    s->last_restarts = st.restarts;
+    s->last_bytes = bytes;
+    s->last_output_bytes = written;
+    s->last_duration_us = elapsed;
+    if (ok) {
+        s->backups++;
+        s->total_bytes += (uint64_t)bytes;
+        s->total_duration_us += elapsed;
+    } else {
+        s->failures++;
+    }
+    mutex_unlock(&s->lock);
+
+    char buf[512];
+    if (ok) {
+        snprintf(buf, sizeof(buf), "Backup %s written: %d file(s), %lld bytes (%lld on disk) in %llums",
+                 first, files, (long long)bytes, (long long)written, (unsigned long long)(elapsed / 1000));
+        log_message(buf, LOG_INFO);
+    } else {
+        snprintf(buf, sizeof(buf), "Backup %s failed", first);
+        log_message(buf, LOG_ERROR);
+    }
+}
+
+// Takes the request flag, or the schedule's turn, and marks the state busy
+static bool take_turn(uint64_t now) {
+    BackupState *s = bk.state;
+    mutex_lock(&s->lock);
+    bool due = s->requested || (bk.interval_s > 0 && now >= bk.next_at_us);
+    if (due) {
+        s->requested = false;
+        s->busy = true;
+    }
+    mutex_unlock(&s->lock);
+    return due;
+}
+
+static void backup_loop(void *arg) {
+    (void)arg;
+    bool shared = bk.state != &own_state;
+    mutex_lock(&bk.lock);
+    while (!bk.stopping) {
+        uint64_t now = now_us();
+        if (!take_turn(now)) {
+            int wait_ms = bk.interval_s > 0 ? (int)((bk.next_at_us - now + 999) / 1000) : -1;
+            if (shared && (wait_ms < 0 || wait_ms > BACKUP_POLL_MS)) wait_ms = BACKUP_POLL_MS;
+            if (wait_ms >= 0) {
+                cond_timedwait(&bk.wake, &bk.lock, wait_ms);
+            } else {
+                cond_wait(&bk.wake, &bk.lock);
+            }
+            continue;
+        }
+        if (bk.interval_s > 0) bk.next_at_us = now + (uint64_t)bk.interval_s * 1000000;
+        mutex_unlock(&bk.lock);
+        run_backup();
+        mutex_lock(&bk.state->lock);
+        bk.state->busy = false;
+        mutex_unlock(&bk.state->lock);
+        mutex_lock(&bk.lock);
+    }
+    mutex_unlock(&bk.lock);
+}
+
+bool backup_start(void) {
+    mutex_init(&bk.lock);
+    cond_init(&bk.wake);
+    bk.dir = env_str("CURRICULUM_BACKUP_DIR", "backups");
+    bk.interval_s = (int)env_long("CURRICULUM_BACKUP_INTERVAL_S", 0);
+    bk.step_pages = (int)env_long("CURRICULUM_BACKUP_STEP_PAGES", 256);
+    bk.pause_ms = (int)env_long("CURRICULUM_BACKUP_PAUSE_MS", 5);
+    bk.compress = (int)env_long("CURRICULUM_BACKUP_COMPRESS", 0);
+    if (bk.interval_s < 0) bk.interval_s = 0;
+    if (bk.compress < 0) bk.compress = 0;
+    if (bk.compress > 9) bk.compress = 9;
+#ifndef CURRICULUM_HAVE_ZLIB
+    if (bk.compress) {
+        log_message("CURRICULUM_BACKUP_COMPRESS ignored: built without zlib", LOG_WARN);
+        bk.compress = 0;
+    }
+#endif
+    bk.stopping = false;
+    bk.next_at_us = now_us() + (uint64_t)bk.interval_s * 1000000;
+    if (bk.state == &own_state) {
+        memset(&own_state, 0, sizeof(own_state));
+        mutex_init(&own_state.lock);
+    }
+
+    if (strncmp(db_backend_name(), "sqlite", 6) != 0) {
+        log_message("Backups disabled: the storage backend is not sqlite", LOG_INFO);
+        return true;
+    }
+    bk.started = true;
+
+    if (!env_long("CURRICULUM_BACKUPS", 1)) {
+        log_message("Backup thread off: another process writes the backups", LOG_INFO);
+        return true;
+    }
+
+    // A previous owner that died mid-backup leaves busy set
+    mutex_lock(&bk.state->lock);
+    bk.state->busy = false;
+    bk.state->owner = process_id();
+    mutex_unlock(&bk.state->lock);
+
+    if (!thread_start(&bk.thread, backup_loop, NULL)) return false;
+    bk.running = true;
+
+    char buf[256];
+    if (bk.interval_s > 0) {
+        snprintf(buf, sizeof(buf), "Backups to %s every %ds (step=%d pages, pause=%dms, gzip=%d)",
+                 bk.dir, bk.interval_s, bk.step_pages, bk.pause_ms, bk.compress);
+    } else {
+        snprintf(buf, sizeof(buf), "Backups to %s on POST /backup (step=%d pages, pause=%dms, gzip=%d)",
+                 bk.dir, bk.step_pages, bk.pause_ms, bk.compress);
+    }
+    log_message(buf, LOG_INFO);
+    return true;
+}
+
+void backup_stop(void) {
+    bk.started = false;
+    if (!bk.running) return;
+    mutex_lock(&bk.lock);
+    bk.stopping = true;
+    cond_broadcast(&bk.wake);
+    mutex_unlock(&bk.lock);
+    thread_join(bk.thread);
+    bk.running = false;
+    mutex_lock(&bk.state->lock);
+    if (bk.state->owner == process_id()) bk.state->owner = 0;
+    mutex_unlock(&bk.state->lock);
+}
+
+size_t backup_shared_size(void) {
+    return sizeof(BackupState);
+}
+
+bool backup_share(void *shared) {
+    BackupState *state = shared;
+    memset(state, 0, sizeof(*state));
+    if (!mutex_init_shared(&state->lock)) return false;
+    bk.state = state;
+    return true;
+}
+
+BackupRequest backup_request(void) {
+    if (!bk.started) return BACKUP_UNAVAILABLE;
+    mutex_lock(&bk.lock);
+    BackupState *s = bk.state;
+    mutex_lock(&s->lock);
+    BackupRequest r = !s->owner ? BACKUP_UNAVAILABLE : s->requested || s->busy ? BACKUP_BUSY : BACKUP_STARTED;
+    if (r == BACKUP_STARTED) s->requested = true;
+    mutex_unlock(&s->lock);
+    if (r == BACKUP_STARTED) cond_broadcast(&bk.wake);
+    mutex_unlock(&bk.lock);
+    return r;
+}
+
+json_t *backup_stats_json(void) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "enabled", json_boolean(bk.started));
+    if (!bk.started) return obj;
+    BackupState *s = bk.state;
+    mutex_lock(&s->lock);
+    json_object_set_new(obj, "running", json_boolean(s->requested || s->busy));
+    json_object_set_new(obj, "dir", json_string(bk.dir));
+    json_object_set_new(obj, "interval_s", json_integer(bk.interval_s));
+    json_object_set_new(obj, "gzip", json_integer(bk.compress));
+    json_object_set_new(obj, "backups", json_integer((json_int_t)s->backups));
+    json_object_set_new(obj, "failures", json_integer((json_int_t)s->failures));
+    json_object_set_new(obj, "total_bytes", json_integer((json_int_t)s->total_bytes));
+    json_object_set_new(obj, "avg_duration_ms", json_integer(s->backups ? (json_int_t)(s->total_duration_us / s->backups / 1000) : 0));
+    if (s->last_started[0]) {
+        json_t *last = json_object();
+        json_object_set_new(last, "ok", json_boolean(s->last_ok));
+        json_object_set_new(last, "file", json_string(s->last_file));
+        json_object_set_new(last, "files", json_integer(s->last_files));
+        json_object_set_new(last, "started", json_string(s->last_started));
+        json_object_set_new(last, "duration_ms", json_integer((json_int_t)(s->last_duration_us / 1000)));
+        json_object_set_new(last, "pages", json_integer(s->last_pages));
+        json_object_set_new(last, "steps", json_integer(s->last_steps));
+        json_object_set_new(last, "restarts", json_integer(s->last_restarts));
+        json_object_set_new(last, "bytes", json_integer(s->last_bytes));
+        json_object_set_new(last, "output_bytes", json_integer(s->last_output_bytes));
+        double secs = s->last_duration_us / 1e6;
+        json_object_set_new(last, "mb_per_s", json_real(secs > 0 ? s->last_bytes / 1048576.0 / secs : 0));
+        json_object_set_new(obj, "last", last);
+    }
+    mutex_unlock(&s->lock);
+    return obj;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "utils.h"
+
+/*
+ * Online backups of the sqlite database while the server keeps serving.
+ * POST /backup starts one (202, or 409 while one is running), GET /backup
+ * and /metrics report on it, and CURRICULUM_BACKUP_INTERVAL_S runs them on a
+ * schedule as well. A backup thread copies the database with db_copy_file:
+ * CURRICULUM_BACKUP_STEP_PAGES pages per step, sleeping between steps so it
+ * leaves disk and CPU to requests. It only reads the database, so neither
+ * readers nor the writer wait on it; a commit in the middle starts the copy
+ * over (see db_copy_file).
+ *
+ * Each database file (every shard) becomes
+ * CURRICULUM_BACKUP_DIR/<name>-YYYYMMDD-HHMMSS.db, gzipped to .db.gz when
+ * CURRICULUM_BACKUP_COMPRESS is set and the server was built with zlib. Files
+ * are written under a .tmp name and renamed when complete, so a file with the
+ * final name is always a whole backup. Old backups are never deleted, and
+ * shutdown waits for a backup that is running.
+ *
+ * Under the supervisor (see supervisor.h) only the first process runs the
+ * backup thread; the request flag and the results live in shared memory, so
+ * POST /backup on any process is taken by it (within BACKUP_POLL_MS) and
+ * answers 409 while any backup is queued or running.
+ *
+ * CURRICULUM_BACKUP_DIR          output directory, created if needed (default backups)
+ * CURRICULUM_BACKUP_INTERVAL_S   seconds between scheduled backups (default 0: on request only)
+ * CURRICULUM_BACKUP_STEP_PAGES   pages per copy step (default 256)
+ * CURRICULUM_BACKUP_PAUSE_MS     pause between copy steps (default 5)
+ * CURRICULUM_BACKUP_COMPRESS     gzip level 1-9 (default 0: uncompressed)
+ * CURRICULUM_BACKUPS             0 runs no backup thread here, leaving backups to another
+ *                                process sharing the state (default 1)
+ */
+
+typedef enum {
+    BACKUP_STARTED,
+    BACKUP_BUSY,                    // one is already queued or running
+    BACKUP_UNAVAILABLE              // not the sqlite backend, or no process runs backups
+} BackupRequest;
+
+bool backup_start(void);
+void backup_stop(void);
+// Moves the request flag and results into shared memory of backup_shared_size()
+// bytes; call before forking the server processes and before backup_start
+size_t backup_shared_size(void);
+bool backup_share(void *shared);
+BackupRequest backup_request(void);
+json_t *backup_stats_json(void);
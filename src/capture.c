@@ -0,0 +1,157 @@
+#include "capture.h"
+#include "frontend.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FLUSH_INTERVAL_US 1000000
+
+static struct {
+    mutex_t lock;
+    FILE *fp;
+    uint64_t start_us;
+    uint64_t last_flush_us;
+    CaptureStats stats;
+} cap;
+
+// One request in flight per civetweb worker thread
+static _Thread_local struct {
+    json_t *record;
+    uint64_t start_us;
+} current;
+
+bool capture_start(void) {
+    const char *path = env_str("CURRICULUM_CAPTURE", NULL);
+    if (!path) return true;
+
+    mutex_init(&cap.lock);
+    cap.fp = fopen(path, "ab");
+    if (!cap.fp) {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "capture: cannot open %s", path);
+        log_message(buf, LOG_ERROR);
+        mutex_destroy(&cap.lock);
+        return false;
+    }
+    cap.start_us = cap.last_flush_us = now_us();
+    cap.stats.enabled = true;
+    fprintf(cap.fp, "{\"session_start\":%lld}\n", (long long)time(NULL));
+
+    char buf[256];
+    snprintf(buf, sizeof(buf), "Capturing traffic to %s", path);
+    log_message(buf, LOG_INFO);
+    return true;
+}
+
+void capture_stop(void) {
+    if (!cap.fp) return;
+    mutex_lock(&cap.lock);
+    fclose(cap.fp);
+    cap.fp = NULL;
+    cap.stats.enabled = false;
+    mutex_unlock(&cap.lock);
+    mutex_destroy(&cap.lock);
+}
+
+void capture_request_begin(struct mg_connection *conn) {
+    if (!cap.stats.enabled) return;
+    const struct mg_request_info *ri = http_request_info(conn);
+    const char *content_type = http_header(conn, "Content-Type");
+    const char *accept = http_header(conn, "Accept");
+    current.start_us = now_us();
+    json_t *rec = json_object();
+    json_object_set_new(rec, "t_us", json_integer((json_int_t)(current.start_us - cap.start_us)));
+    json_object_set_new(rec, "method", json_string(ri->request_method));
+    json_object_set_new(rec, "uri", json_string(ri->local_uri));
+    json_object_set_new(rec, "query", json_string(ri->query_string ? ri->query_string : ""));
+    if (content_type) json_object_set_new(rec, "content_type", json_string(content_type));
+    if (accept) json_object_set_new(rec, "accept", json_string(accept));
+    current.record = rec;
+}
+
+static json_t *base64_string(const unsigned char *data, size_t len) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char *out = malloc((len + 2) / 3 * 4 + 1);
+    if (!out) return NULL;
+    char *d = out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        *d++ = alphabet[v >> 18];
+        *d++ = alphabet[(v >> 12) & 63];
+        *d++ = i + 1 < len ? alphabet[(v >> 6) & 63] : '=';
+        *d++ = i + 2 < len ? alphabet[v & 63] : '=';
+    }
+    json_t *s = json_stringn(out, (size_t)(d - out));
+    free(out);
+    return s;
+}
+
+void capture_request_body(const char *data, size_t len) {
+    if (!current.record || !data) return;
+    // A NUL would come back as \u0000, which the replay's parser refuses
+    json_t *body = memchr(data, '\0', len) ? NULL : json_stringn(data, len);
+    if (body) {
+        json_object_set_new(current.record, "body", body);
+        return;
+    }
+    json_t *encoded = base64_string((const unsigned char *)data, len);
+    if (!encoded) return;
+    json_object_set_new(current.record, "body_base64", encoded);
+    mutex_lock(&cap.lock);
+    cap.stats.binary_bodies++;
+    mutex_unlock(&cap.lock);
+}
+
+void capture_request_end(int status) {
+    json_t *rec = current.record;
+    if (!rec) return;
+    current.record = NULL;
+
+    uint64_t end = now_us();
+    json_object_set_new(rec, "status", json_integer(status));
+    json_object_set_new(rec, "dur_us", json_integer((json_int_t)(end - current.start_us)));
+    char *line = json_dumps(rec, JSON_COMPACT);
+    json_decref(rec);
+    if (!line) return;
+
+    size_t len = strlen(line);
+    mutex_lock(&cap.lock);
+    if (cap.fp) {
+        if (fwrite(line, 1, len, cap.fp) == len && fputc('\n', cap.fp) != EOF) {
+            cap.stats.records++;
+            cap.stats.bytes += len + 1;
+        } else {
+            cap.stats.write_errors++;
+        }
+        if (end - cap.last_flush_us >= FLUSH_INTERVAL_US) {
+            fflush(cap.fp);
+            cap.last_flush_us = end;
+        }
+    }
+    mutex_unlock(&cap.lock);
+    free(line);
+}
+
+void capture_get_stats(CaptureStats *out) {
+    if (!cap.stats.enabled) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    mutex_lock(&cap.lock);
+    *out = cap.stats;
+    mutex_unlock(&cap.lock);
+}
+
+json_t *capture_stats_json(void) {
+    CaptureStats s;
+    capture_get_stats(&s);
+    json_t *obj = json_object();
+    json_object_set_new(obj, "enabled", json_boolean(s.enabled));
+    json_object_set_new(obj, "records", json_integer((json_int_t)s.records));
+    json_object_set_new(obj, "bytes", json_integer((json_int_t)s.bytes));
+    json_object_set_new(obj, "binary_bodies", json_integer((json_int_t)s.binary_bodies));
+    json_object_set_new(obj, "write_errors", json_integer((json_int_t)s.write_errors));
+    return obj;
+}
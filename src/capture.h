@@ -0,0 +1,40 @@
+#pragma once
+#include "utils.h"
+#include <stdint.h>
+
+/*
+ * Traffic capture for replay. With CURRICULUM_CAPTURE=<path> every request
+ * that reaches request_handler is appended to <path> as one NDJSON line:
+ *
+ *   {"t_us":1520,"method":"POST","uri":"/course","query":"","content_type":"application/json","body":"{...}","status":200,"dur_us":310}
+ *
+ * t_us is the arrival time in microseconds since capture started and dur_us
+ * the time spent in the handler. content_type and accept copy the request's
+ * headers when it sent them, so MessagePack traffic replays as MessagePack.
+ * The body is only present when the handler read one; a body that is not
+ * valid UTF-8 text (a MessagePack body, say) is stored base64-encoded as
+ * "body_base64" instead. t_us restarts from zero with every server start, so
+ * each start first writes a {"session_start":<unix time>} line. Lines are
+ * buffered and flushed at least once a second and on shutdown.
+ * bench/curriculum-replay re-drives a capture file.
+ */
+
+typedef struct {
+    bool enabled;
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t binary_bodies;     // stored as body_base64
+    uint64_t write_errors;
+} CaptureStats;
+
+// No-op unless CURRICULUM_CAPTURE is set; must run before the server accepts requests
+bool capture_start(void);
+void capture_stop(void);
+
+// Called on the request thread: begin/end bracket the handler, body is fed by read_body
+void capture_request_begin(struct mg_connection *conn);
+void capture_request_body(const char *data, size_t len);
+void capture_request_end(int status);
+
+void capture_get_stats(CaptureStats *out);
+json_t *capture_stats_json(void);
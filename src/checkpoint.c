@@ -0,0 +1,188 @@
+#include "checkpoint.h"
+#include "db.h"
+#include "thread.h"
+#include <string.h>
+#include <sys/stat.h>
+
+static struct {
+    mutex_t lock;
+    cond_t wake;
+    thread_t thread;
+    bool running;
+    bool stopping;
+
+    DbCheckpointMode mode;
+    int interval_ms;
+    int busy_ms;
+    int64_t low_bytes;
+    int64_t high_bytes;
+
+    CheckpointStats stats;
+} cp;
+
+// All shards together: one checkpoint covers every WAL
+static int64_t wal_size(void) {
+    int64_t total = 0;
+    for (int i = 0; i < db_shard_count(); i++) {
+        char path[256];
+        struct stat st;
+        db_shard_file(i, path, sizeof(path));
+        strcat(path, "-wal");
+        if (stat(path, &st) == 0) total += (int64_t)st.st_size;
+    }
+    return total;
+}
+
+static DbCheckpointMode parse_mode(const char *s) {
+    if (strcmp(s, "passive") == 0) return DB_CHECKPOINT_PASSIVE;
+    if (strcmp(s, "restart") == 0) return DB_CHECKPOINT_RESTART;
+    if (strcmp(s, "truncate") == 0) return DB_CHECKPOINT_TRUNCATE;
+    log_message("Unknown CURRICULUM_CHECKPOINT_MODE, using truncate", LOG_WARN);
+    return DB_CHECKPOINT_TRUNCATE;
+}
+
+static const char *mode_name(DbCheckpointMode mode) {
+    switch (mode) {
+        case DB_CHECKPOINT_PASSIVE: return "passive";
+        case DB_CHECKPOINT_FULL: return "full";
+        case DB_CHECKPOINT_RESTART: return "restart";
+        case DB_CHECKPOINT_TRUNCATE: return "truncate";
+    }
+    return "";
+}
+
+static bool run_checkpoint(DbCheckpointMode mode) {
+    int frames = 0, done = 0;
+    uint64_t start = now_us();
+    bool ok = db_checkpoint(mode, &frames, &done);
+    uint64_t elapsed = now_us() - start;
+    // A passive checkpoint "succeeds" even when readers pinned part of the WAL
+    bool complete = ok && frames >= 0 && done >= frames;
+
+    mutex_lock(&cp.lock);
+    cp.stats.checkpoints++;
+    if (mode != DB_CHECKPOINT_PASSIVE) cp.stats.escalations++;
+    if (!complete) cp.stats.incomplete++;
+    cp.stats.last_duration_us = elapsed;
+    cp.stats.total_duration_us += elapsed;
+    if (elapsed > cp.stats.max_duration_us) cp.stats.max_duration_us = elapsed;
+    cp.stats.last_wal_frames = frames;
+    cp.stats.last_checkpointed_frames = done;
+    mutex_unlock(&cp.lock);
+
+    if (!complete && mode != DB_CHECKPOINT_PASSIVE) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "checkpoint: %s incomplete (%d/%d frames), database busy",
+                 mode_name(mode), done, frames);
+        log_message(buf, LOG_WARN);
+    }
+    return complete;
+}
+
+static void checkpoint_loop(void *arg) {
+    (void)arg;
+    if (!db_thread_open()) {
+        log_message("checkpoint: failed to open connection", LOG_ERROR);
+        return;
+    }
+    // Escalated checkpoints take the write lock; give up quickly rather than stall writers
+    db_busy_timeout(cp.busy_ms);
+
+    mutex_lock(&cp.lock);
+    while (!cp.stopping) {
+        cond_timedwait(&cp.wake, &cp.lock, cp.interval_ms);
+        if (cp.stopping) break;
+        mutex_unlock(&cp.lock);
+
+        int64_t size = wal_size();
+        if (size >= cp.low_bytes) {
+            // Backfill without locks first, so an escalation has less left to copy.
+            // Past the high watermark escalate even if PASSIVE stopped short: a steady
+            // stream of readers would otherwise let the WAL grow without bound, and
+            // busy_ms bounds how long the escalation waits for them.
+            run_checkpoint(DB_CHECKPOINT_PASSIVE);
+            if (size >= cp.high_bytes && cp.mode != DB_CHECKPOINT_PASSIVE) {
+                run_checkpoint(cp.mode);
+            }
+        }
+
+        int64_t after = wal_size();
+        mutex_lock(&cp.lock);
+        cp.stats.wal_bytes = after;
+        if (size > cp.stats.wal_bytes_max) cp.stats.wal_bytes_max = size;
+    }
+    mutex_unlock(&cp.lock);
+
+    // Leave a small WAL behind on shutdown
+    run_checkpoint(DB_CHECKPOINT_PASSIVE);
+    db_thread_close();
+}
+
+bool checkpoint_start(void) {
+    mutex_init(&cp.lock);
+    cond_init(&cp.wake);
+    memset(&cp.stats, 0, sizeof(cp.stats));
+    cp.mode = parse_mode(env_str("CURRICULUM_CHECKPOINT_MODE", "truncate"));
+    cp.interval_ms = (int)env_long("CURRICULUM_CHECKPOINT_INTERVAL_MS", 1000);
+    cp.busy_ms = (int)env_long("CURRICULUM_CHECKPOINT_BUSY_MS", 20);
+    cp.low_bytes = (int64_t)env_long("CURRICULUM_WAL_LOW_KB", 4096) * 1024;
+    cp.high_bytes = (int64_t)env_long("CURRICULUM_WAL_HIGH_KB", 65536) * 1024;
+    if (cp.interval_ms < 10) cp.interval_ms = 10;
+    if (cp.high_bytes < cp.low_bytes) cp.high_bytes = cp.low_bytes;
+    cp.stopping = false;
+
+    if (!db_has_wal()) {
+        log_message("Checkpointer disabled: storage backend has no WAL", LOG_INFO);
+        return true;
+    }
+
+    db_disable_autocheckpoint();
+
+    if (!env_long("CURRICULUM_CHECKPOINTER", 1)) {
+        log_message("Checkpointer off: another process checkpoints the WAL", LOG_INFO);
+        return true;
+    }
+
+    if (!thread_start(&cp.thread, checkpoint_loop, NULL)) return false;
+    cp.running = true;
+
+    char buf[160];
+    snprintf(buf, sizeof(buf), "Checkpointer started (mode=%s, low=%lldKB, high=%lldKB, every %dms)",
+             mode_name(cp.mode), (long long)(cp.low_bytes / 1024), (long long)(cp.high_bytes / 1024), cp.interval_ms);
+    log_message(buf, LOG_INFO);
+    return true;
+}
+
+void checkpoint_stop(void) {
+    if (!cp.running) return;
+    mutex_lock(&cp.lock);
+    cp.stopping = true;
+    cond_broadcast(&cp.wake);
+    mutex_unlock(&cp.lock);
+    thread_join(cp.thread);
+    cp.running = false;
+}
+
+void checkpoint_get_stats(CheckpointStats *out) {
+    mutex_lock(&cp.lock);
+    *out = cp.stats;
+    mutex_unlock(&cp.lock);
+}
+
+json_t *checkpoint_stats_json(void) {
+    CheckpointStats s;
+    checkpoint_get_stats(&s);
+    json_t *obj = json_object();
+    json_object_set_new(obj, "mode", json_string(mode_name(cp.mode)));
+    json_object_set_new(obj, "wal_bytes", json_integer(s.wal_bytes));
+    json_object_set_new(obj, "wal_bytes_max", json_integer(s.wal_bytes_max));
+    json_object_set_new(obj, "checkpoints", json_integer((json_int_t)s.checkpoints));
+    json_object_set_new(obj, "escalations", json_integer((json_int_t)s.escalations));
+    json_object_set_new(obj, "incomplete", json_integer((json_int_t)s.incomplete));
+    json_object_set_new(obj, "last_duration_us", json_integer((json_int_t)s.last_duration_us));
+    json_object_set_new(obj, "max_duration_us", json_integer((json_int_t)s.max_duration_us));
+    json_object_set_new(obj, "avg_duration_us", json_integer(s.checkpoints ? (json_int_t)(s.total_duration_us / s.checkpoints) : 0));
+    json_object_set_new(obj, "last_wal_frames", json_integer(s.last_wal_frames));
+    json_object_set_new(obj, "last_checkpointed_frames", json_integer(s.last_checkpointed_frames));
+    return obj;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "utils.h"
+#include <stdint.h>
+
+/*
+ * Background WAL checkpointer. SQLite's auto-checkpoint is disabled on every
+ * connection so no request commit ever runs a checkpoint; instead a thread
+ * with its own connection polls the WAL size:
+ *
+ *   size >= low watermark   PASSIVE checkpoint (never waits on readers/writers)
+ *   size >= high watermark  after the PASSIVE pass, escalate to
+ *                           CURRICULUM_CHECKPOINT_MODE (passive|restart|truncate)
+ *                           so the WAL can be reset/shrunk, even when readers kept
+ *                           PASSIVE from finishing
+ *
+ * CURRICULUM_CHECKPOINT_MODE         escalation mode (default truncate)
+ * CURRICULUM_CHECKPOINT_INTERVAL_MS  poll interval (default 1000)
+ * CURRICULUM_WAL_LOW_KB              low watermark (default 4096)
+ * CURRICULUM_WAL_HIGH_KB             high watermark (default 65536)
+ * CURRICULUM_CHECKPOINT_BUSY_MS      how long an escalated checkpoint may wait (default 20)
+ * CURRICULUM_CHECKPOINTER            0 runs no thread here, leaving the WAL to another
+ *                                    process on the same database (default 1)
+ */
+
+typedef struct {
+    int64_t wal_bytes;              // WAL file size at the last poll
+    int64_t wal_bytes_max;          // largest WAL size observed
+    uint64_t checkpoints;           // checkpoints attempted
+    uint64_t escalations;           // RESTART/TRUNCATE attempts
+    uint64_t incomplete;            // checkpoints cut short by active readers/writers
+    uint64_t last_duration_us;
+    uint64_t max_duration_us;
+    uint64_t total_duration_us;
+    int last_wal_frames;
+    int last_checkpointed_frames;
+} CheckpointStats;
+
+bool checkpoint_start(void);
+void checkpoint_stop(void);
+void checkpoint_get_stats(CheckpointStats *out);
+json_t *checkpoint_stats_json(void);
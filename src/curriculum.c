@@ -0,0 +1,580 @@
+#include "curriculum.h"
+#include "db_backend.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * libcurriculum on top of the backend ops table. Each handle owns a DbStore,
+ * so it talks to the backends directly rather than through db.c's global
+ * store; change notifications are a server concern and are not raised here.
+ * The backends report failures as a bare false, so statuses are worked out
+ * by validating arguments up front and probing for the rows involved.
+ */
+
+struct CurDb {
+    DbStore *store;
+    mutex_t lock;
+};
+
+// The handle whose transaction the calling thread is running
+static _Thread_local CurDb *txn_db;
+
+static void enter(CurDb *db) { if (txn_db != db) mutex_lock(&db->lock); }
+static void leave(CurDb *db) { if (txn_db != db) mutex_unlock(&db->lock); }
+
+static bool empty(const char *s) { return !s || !*s; }
+
+int cur_api_version(void) {
+    return CURRICULUM_API_VERSION;
+}
+
+const char *cur_strerror(CurStatus status) {
+    switch (status) {
+        case CUR_OK: return "ok";
+        case CUR_ERROR: return "storage error";
+        case CUR_INVALID: return "invalid argument";
+        case CUR_NOT_FOUND: return "not found";
+        case CUR_EXISTS: return "already exists";
+        case CUR_NOMEM: return "out of memory";
+        case CUR_ROW: return "row available";
+        case CUR_DONE: return "no more rows";
+    }
+    return "unknown status";
+}
+
+#pragma region Handles and transactions
+
+CurStatus cur_open(const char *backend, const char *path, CurDb **out) {
+    if (!out || empty(path)) return CUR_INVALID;
+    *out = NULL;
+
+    DbStore *store;
+    if (!backend || strcmp(backend, "sqlite") == 0) store = db_sqlite_open(path);
+    else if (strcmp(backend, "memory") == 0) store = db_memory_open(path);
+    else return CUR_INVALID;
+    if (!store) return CUR_ERROR;
+
+    CurDb *db = malloc(sizeof(*db));
+    if (!db) {
+        store->ops->close(store);
+        return CUR_NOMEM;
+    }
+    db->store = store;
+    mutex_init(&db->lock);
+    *out = db;
+    return CUR_OK;
+}
+
+void cur_close(CurDb *db) {
+    if (!db) return;
+    if (txn_db == db) {
+        cur_rollback(db);
+    }
+    db->store->ops->close(db->store);
+    mutex_destroy(&db->lock);
+    free(db);
+}
+
+CurStatus cur_begin(CurDb *db) {
+    if (!db || txn_db) return CUR_INVALID;
+    mutex_lock(&db->lock);
+    if (db->store->ops->begin && !db->store->ops->begin(db->store)) {
+        mutex_unlock(&db->lock);
+        return CUR_ERROR;
+    }
+    txn_db = db;
+    return CUR_OK;
+}
+
+static CurStatus end_transaction(CurDb *db, bool commit) {
+    if (!db || txn_db != db) return CUR_INVALID;
+    const DbStoreOps *ops = db->store->ops;
+    bool ok;
+    if (commit) {
+        ok = !ops->commit || ops->commit(db->store);
+        // Never hand the handle back with the transaction still open
+        if (!ok && ops->rollback) ops->rollback(db->store);
+    } else {
+        ok = !ops->rollback || ops->rollback(db->store);
+    }
+    txn_db = NULL;
+    mutex_unlock(&db->lock);
+    return ok ? CUR_OK : CUR_ERROR;
+}
+
+CurStatus cur_commit(CurDb *db) {
+    return end_transaction(db, true);
+}
+
+CurStatus cur_rollback(CurDb *db) {
+    return end_transaction(db, false);
+}
+
+#pragma endregion Handles and transactions
+
+#pragma region Probes
+
+static void count_course(const Course *c, void *user) { (void)c; (*(int *)user)++; }
+static void count_student(const Student *s, void *user) { (void)s; (*(int *)user)++; }
+
+static bool course_exists(CurDb *db, const char *course_id) {
+    int n = 0;
+    db->store->ops->course_find(db->store, DB_FIND_COURSE_ID, course_id, &(QueryOptions){ .limit = 1 }, count_course, &n);
+    return n > 0;
+}
+
+static bool student_exists(CurDb *db, const char *student_id) {
+    int n = 0;
+    db->store->ops->student_find(db->store, DB_FIND_STUDENT_ID, student_id, &(QueryOptions){ .limit = 1 }, count_student, &n);
+    return n > 0;
+}
+
+typedef struct {
+    const char *course_id;
+    bool found;
+} EnrolledProbe;
+
+static void match_enrollment(const Enrollment *e, void *user) {
+    EnrolledProbe *p = user;
+    if (e->course_id && strcmp(e->course_id, p->course_id) == 0) p->found = true;
+}
+
+static bool enrolled(CurDb *db, const char *student_id, const char *course_id) {
+    EnrolledProbe p = { course_id, false };
+    db->store->ops->enrollment_find(db->store, DB_FIND_STUDENT_ID, student_id, NULL, match_enrollment, &p);
+    return p.found;
+}
+
+#pragma endregion Probes
+
+#pragma region Writes
+
+static Course to_course(const CurCourse *c) {
+    return (Course){ c->course_id, c->name, c->type, c->total_hours, c->lecture_hours, c->lab_hours, c->credit, c->semester };
+}
+
+static Student to_student(const CurStudent *s) {
+    return (Student){ s->student_id, s->name, s->email, s->credits };
+}
+
+CurStatus cur_course_add(CurDb *db, const CurCourse *course) {
+    if (!db || !course || empty(course->course_id)) return CUR_INVALID;
+    Course c = to_course(course);
+    enter(db);
+    CurStatus st = db->store->ops->course_add(db->store, &c) ? CUR_OK
+                 : course_exists(db, c.course_id) ? CUR_EXISTS : CUR_ERROR;
+    leave(db);
+    return st;
+}
+
+CurStatus cur_course_update(CurDb *db, const CurCourse *course) {
+    if (!db || !course || empty(course->course_id)) return CUR_INVALID;
+    Course c = to_course(course);
+    enter(db);
+    CurStatus st = !course_exists(db, c.course_id) ? CUR_NOT_FOUND
+                 : db->store->ops->course_update(db->store, &c) ? CUR_OK : CUR_ERROR;
+    leave(db);
+    return st;
+}
+
+CurStatus cur_course_remove(CurDb *db, const char *course_id) {
+    if (!db || empty(course_id)) return CUR_INVALID;
+    enter(db);
+    CurStatus st = !course_exists(db, course_id) ? CUR_NOT_FOUND
+                 : db->store->ops->course_remove(db->store, course_id) ? CUR_OK : CUR_ERROR;
+    leave(db);
+    return st;
+}
+
+CurStatus cur_course_remove_all(CurDb *db) {
+    if (!db) return CUR_INVALID;
+    enter(db);
+    bool ok = db->store->ops->course_remove_all(db->store);
+    leave(db);
+    return ok ? CUR_OK : CUR_ERROR;
+}
+
+CurStatus cur_student_add(CurDb *db, const CurStudent *student) {
+    if (!db || !student || empty(student->student_id) || empty(student->name) || student->credits < 0) return CUR_INVALID;
+    Student s = to_student(student);
+    enter(db);
+    CurStatus st = db->store->ops->student_add(db->store, &s) ? CUR_OK
+                 : student_exists(db, s.student_id) ? CUR_EXISTS : CUR_ERROR;
+    leave(db);
+    return st;
+}
+
+CurStatus cur_student_update(CurDb *db, const CurStudent *student) {
+    if (!db || !student || empty(student->student_id) || empty(student->name) || student->credits < 0) return CUR_INVALID;
+    Student s = to_student(student);
+    enter(db);
+    CurStatus st = !student_exists(db, s.student_id) ? CUR_NOT_FOUND
+                 : db->store->ops->student_update(db->store, &s) ? CUR_OK : CUR_ERROR;
+    leave(db);
+    return st;
+}
+
+CurStatus cur_student_remove(CurDb *db, const char *student_id) {
+    if (!db || empty(student_id)) return CUR_INVALID;
+    enter(db);
+    CurStatus st = !student_exists(db, student_id) ? CUR_NOT_FOUND
+                 : db->store->ops->student_remove(db->store, student_id) ? CUR_OK : CUR_ERROR;
+    leave(db);
+    return st;
+}
+
+CurStatus cur_student_remove_all(CurDb *db) {
+    if (!db) return CUR_INVALID;
+    enter(db);
+    bool ok = db->store->ops->student_remove_all(db->store);
+    leave(db);
+    return ok ? CUR_OK : CUR_ERROR;
+}
+
+CurStatus cur_enrollment_add(CurDb *db, const CurEnrollment *enrollment) {
+    if (!db || !enrollment || empty(enrollment->student_id) || empty(enrollment->course_id)) return CUR_INVALID;
+    Enrollment e = { enrollment->course_id, enrollment->student_id };
+    enter(db);
+    CurStatus st = CUR_OK;
+    if (!db->store->ops->enrollment_add(db->store, &e)) {
+        st = !student_exists(db, e.student_id) || !course_exists(db, e.course_id) ? CUR_NOT_FOUND
+           : enrolled(db, e.student_id, e.course_id) ? CUR_EXISTS : CUR_ERROR;
+    }
+    leave(db);
+    return st;
+}
+
+CurStatus cur_enrollment_remove(CurDb *db, const char *student_id, const char *course_id) {
+    if (!db || empty(student_id) || empty(course_id)) return CUR_INVALID;
+    enter(db);
+    CurStatus st = !enrolled(db, student_id, course_id) ? CUR_NOT_FOUND
+                 : db->store->ops->enrollment_remove(db->store, student_id, course_id) ? CUR_OK : CUR_ERROR;
+    leave(db);
+    return st;
+}
+
+CurStatus cur_enrollment_remove_all(CurDb *db) {
+    if (!db) return CUR_INVALID;
+    enter(db);
+    bool ok = db->store->ops->enrollment_remove_all(db->store);
+    leave(db);
+    return ok ? CUR_OK : CUR_ERROR;
+}
+
+#pragma endregion Writes
+
+#pragma region Reads
+
+typedef struct {
+    QueryOptions opt;
+    DbFindField field;
+    const char *value;      // NULL lists everything
+} ReadSpec;
+
+static CurStatus to_spec(DbEntity entity, const CurQuery *q, ReadSpec *spec) {
+    memset(spec, 0, sizeof(*spec));
+    if (!q) return CUR_OK;
+    if (q->offset < 0) return CUR_INVALID;
+    if (q->order_by && !db_valid_order(entity, q->order_by)) return CUR_INVALID;
+    spec->opt = (QueryOptions){ q->order_by, q->descending ? SORT_DESC : SORT_ASC, q->limit, q->offset };
+    if (q->field == CUR_ALL) return CUR_OK;
+    if (!q->value) return CUR_INVALID;
+    spec->value = q->value;
+
+    switch (q->field) {
+        case CUR_BY_COURSE_ID:
+            if (entity == DB_ENTITY_STUDENT) return CUR_INVALID;
+            spec->field = DB_FIND_COURSE_ID;
+            return CUR_OK;
+        case CUR_BY_STUDENT_ID:
+            if (entity == DB_ENTITY_COURSE) return CUR_INVALID;
+            spec->field = DB_FIND_STUDENT_ID;
+            return CUR_OK;
+        case CUR_BY_NAME:
+            if (entity == DB_ENTITY_ENROLLMENT) return CUR_INVALID;
+            spec->field = DB_FIND_NAME;
+            return CUR_OK;
+        case CUR_BY_TYPE:
+        case CUR_BY_SEMESTER:
+            if (entity != DB_ENTITY_COURSE) return CUR_INVALID;
+            spec->field = q->field == CUR_BY_TYPE ? DB_FIND_TYPE : DB_FIND_SEMESTER;
+            return CUR_OK;
+        default:
+            return CUR_INVALID;
+    }
+}
+
+// One visitor per entity; only the one matching the read is used
+typedef struct {
+    CourseVisitor course;
+    StudentVisitor student;
+    EnrollmentVisitor enrollment;
+} Visitors;
+
+// Runs the entity's list op, or its find op when the spec has a value
+static bool store_visit(DbStore *store, DbEntity entity, const ReadSpec *spec, const Visitors *v, void *user) {
+    const DbStoreOps *ops = store->ops;
+    switch (entity) {
+        case DB_ENTITY_COURSE:
+            return spec->value ? ops->course_find(store, spec->field, spec->value, &spec->opt, v->course, user)
+                               : ops->course_list(store, &spec->opt, v->course, user);
+        case DB_ENTITY_STUDENT:
+            return spec->value ? ops->student_find(store, spec->field, spec->value, &spec->opt, v->student, user)
+                               : ops->student_list(store, &spec->opt, v->student, user);
+        case DB_ENTITY_ENROLLMENT:
+            return spec->value ? ops->enrollment_find(store, spec->field, spec->value, &spec->opt, v->enrollment, user)
+                               : ops->enrollment_list(store, &spec->opt, v->enrollment, user);
+    }
+    return false;
+}
+
+typedef struct {
+    CurCourseVisitor course;
+    CurStudentVisitor student;
+    CurEnrollmentVisitor enrollment;
+    void *user;
+} PublicVisitors;
+
+static void visit_course(const Course *c, void *user) {
+    PublicVisitors *p = user;
+    CurCourse row = { c->course_id, c->name, c->type, c->total_hours, c->lecture_hours, c->lab_hours, c->credit, c->semester };
+    p->course(&row, p->user);
+}
+
+static void visit_student(const Student *s, void *user) {
+    PublicVisitors *p = user;
+    CurStudent row = { s->student_id, s->name, s->email, s->credits };
+    p->student(&row, p->user);
+}
+
+static void visit_enrollment(const Enrollment *e, void *user) {
+    PublicVisitors *p = user;
+    CurEnrollment row = { e->student_id, e->course_id };
+    p->enrollment(&row, p->user);
+}
+
+static CurStatus visit(CurDb *db, DbEntity entity, const CurQuery *query, PublicVisitors *p) {
+    if (!db) return CUR_INVALID;
+    ReadSpec spec;
+    CurStatus st = to_spec(entity, query, &spec);
+    if (st != CUR_OK) return st;
+    static const Visitors adapters = { visit_course, visit_student, visit_enrollment };
+    enter(db);
+    bool ok = store_visit(db->store, entity, &spec, &adapters, p);
+    leave(db);
+    return ok ? CUR_OK : CUR_ERROR;
+}
+
+CurStatus cur_course_visit(CurDb *db, const CurQuery *query, CurCourseVisitor visitor, void *user) {
+    if (!visitor) return CUR_INVALID;
+    return visit(db, DB_ENTITY_COURSE, query, &(PublicVisitors){ .course = visitor, .user = user });
+}
+
+CurStatus cur_student_visit(CurDb *db, const CurQuery *query, CurStudentVisitor visitor, void *user) {
+    if (!visitor) return CUR_INVALID;
+    return visit(db, DB_ENTITY_STUDENT, query, &(PublicVisitors){ .student = visitor, .user = user });
+}
+
+CurStatus cur_enrollment_visit(CurDb *db, const CurQuery *query, CurEnrollmentVisitor visitor, void *user) {
+    if (!visitor) return CUR_INVALID;
+    return visit(db, DB_ENTITY_ENROLLMENT, query, &(PublicVisitors){ .enrollment = visitor, .user = user });
+}
+
+#pragma endregion Reads
+
+#pragma region Cursors
+
+/*
+ * Backends with cursor ops stream rows from an open statement. For the rest
+ * (the memory backend, whose rows are in RAM anyway) the result is collected
+ * when the cursor opens: rows go into an array, their strings into an arena.
+ */
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    size_t cap;
+    char data[];
+} ArenaBlock;
+
+struct CurCursor {
+    CurDb *db;
+    DbEntity entity;
+    DbCursor *stream;
+
+    // Collected rows
+    void *rows;
+    size_t row_size;
+    size_t count;
+    size_t cap;
+    size_t next;
+    ArenaBlock *arena;
+    bool nomem;
+};
+
+static const char *arena_dup(CurCursor *cur, const char *s) {
+    if (!s) return NULL;
+    size_t n = strlen(s) + 1;
+    ArenaBlock *b = cur->arena;
+    if (!b || b->cap - b->used < n) {
+        size_t cap = n > ARENA_BLOCK_SIZE ? n : ARENA_BLOCK_SIZE;
+        b = malloc(sizeof(*b) + cap);
+        if (!b) {
+            cur->nomem = true;
+            return NULL;
+        }
+        b->next = cur->arena;
+        b->used = 0;
+        b->cap = cap;
+        cur->arena = b;
+    }
+    char *out = memcpy(b->data + b->used, s, n);
+    b->used += n;
+    return out;
+}
+
+static void *push_row(CurCursor *cur) {
+    if (cur->nomem) return NULL;
+    if (cur->count == cur->cap) {
+        size_t cap = cur->cap ? cur->cap * 2 : 256;
+        void *rows = realloc(cur->rows, cap * cur->row_size);
+        if (!rows) {
+            cur->nomem = true;
+            return NULL;
+        }
+        cur->rows = rows;
+        cur->cap = cap;
+    }
+    return (char *)cur->rows + cur->count++ * cur->row_size;
+}
+
+static void collect_course(const Course *c, void *user) {
+    CurCursor *cur = user;
+    Course *row = push_row(cur);
+    if (!row) return;
+    *row = *c;
+    row->course_id = arena_dup(cur, c->course_id);
+    row->name = arena_dup(cur, c->name);
+    row->type = arena_dup(cur, c->type);
+    row->semester = arena_dup(cur, c->semester);
+}
+
+static void collect_student(const Student *s, void *user) {
+    CurCursor *cur = user;
+    Student *row = push_row(cur);
+    if (!row) return;
+    *row = *s;
+    row->student_id = arena_dup(cur, s->student_id);
+    row->name = arena_dup(cur, s->name);
+    row->email = arena_dup(cur, s->email);
+}
+
+static void collect_enrollment(const Enrollment *e, void *user) {
+    CurCursor *cur = user;
+    Enrollment *row = push_row(cur);
+    if (!row) return;
+    row->student_id = arena_dup(cur, e->student_id);
+    row->course_id = arena_dup(cur, e->course_id);
+}
+
+static CurStatus open_cursor(CurDb *db, DbEntity entity, const CurQuery *query, CurCursor **out) {
+    if (!db || !out) return CUR_INVALID;
+    *out = NULL;
+    ReadSpec spec;
+    CurStatus st = to_spec(entity, query, &spec);
+    if (st != CUR_OK) return st;
+
+    CurCursor *cur = calloc(1, sizeof(*cur));
+    if (!cur) return CUR_NOMEM;
+    cur->db = db;
+    cur->entity = entity;
+    cur->row_size = entity == DB_ENTITY_COURSE ? sizeof(Course)
+                  : entity == DB_ENTITY_STUDENT ? sizeof(Student)
+                  : sizeof(Enrollment);
+
+    const DbStoreOps *ops = db->store->ops;
+    enter(db);
+    if (ops->cursor_open) {
+        cur->stream = ops->cursor_open(db->store, entity, spec.field, spec.value, &spec.opt);
+        st = cur->stream ? CUR_OK : CUR_ERROR;
+    } else {
+        static const Visitors collectors = { collect_course, collect_student, collect_enrollment };
+        st = !store_visit(db->store, entity, &spec, &collectors, cur) ? CUR_ERROR : cur->nomem ? CUR_NOMEM : CUR_OK;
+    }
+    leave(db);
+
+    if (st != CUR_OK) {
+        cur_cursor_close(cur);
+        return st;
+    }
+    *out = cur;
+    return CUR_OK;
+}
+
+CurStatus cur_course_query(CurDb *db, const CurQuery *query, CurCursor **out) {
+    return open_cursor(db, DB_ENTITY_COURSE, query, out);
+}
+
+CurStatus cur_student_query(CurDb *db, const CurQuery *query, CurCursor **out) {
+    return open_cursor(db, DB_ENTITY_STUDENT, query, out);
+}
+
+CurStatus cur_enrollment_query(CurDb *db, const CurQuery *query, CurCursor **out) {
+    return open_cursor(db, DB_ENTITY_ENROLLMENT, query, out);
+}
+
+// Fills *row (a Course, Student or Enrollment) with the next row
+static CurStatus next_row(CurCursor *cur, DbEntity entity, void *row) {
+    if (!cur || cur->entity != entity) return CUR_INVALID;
+    if (!cur->stream) {
+        if (cur->next == cur->count) return CUR_DONE;
+        memcpy(row, (char *)cur->rows + cur->next++ * cur->row_size, cur->row_size);
+        return CUR_ROW;
+    }
+    enter(cur->db);
+    int rc = cur->db->store->ops->cursor_next(cur->stream, row);
+    leave(cur->db);
+    return rc > 0 ? CUR_ROW : rc == 0 ? CUR_DONE : CUR_ERROR;
+}
+
+CurStatus cur_course_next(CurCursor *cursor, CurCourse *row) {
+    Course c;
+    CurStatus st = next_row(cursor, DB_ENTITY_COURSE, &c);
+    if (st == CUR_ROW) *row = (CurCourse){ c.course_id, c.name, c.type, c.total_hours, c.lecture_hours, c.lab_hours, c.credit, c.semester };
+    return st;
+}
+
+CurStatus cur_student_next(CurCursor *cursor, CurStudent *row) {
+    Student s;
+    CurStatus st = next_row(cursor, DB_ENTITY_STUDENT, &s);
+    if (st == CUR_ROW) *row = (CurStudent){ s.student_id, s.name, s.email, s.credits };
+    return st;
+}
+
+CurStatus cur_enrollment_next(CurCursor *cursor, CurEnrollment *row) {
+    Enrollment e;
+    CurStatus st = next_row(cursor, DB_ENTITY_ENROLLMENT, &e);
+    if (st == CUR_ROW) *row = (CurEnrollment){ e.student_id, e.course_id };
+    return st;
+}
+
+void cur_cursor_close(CurCursor *cursor) {
+    if (!cursor) return;
+    if (cursor->stream) {
+        enter(cursor->db);
+        cursor->db->store->ops->cursor_close(cursor->stream);
+        leave(cursor->db);
+    }
+    while (cursor->arena) {
+        ArenaBlock *next = cursor->arena->next;
+        free(cursor->arena);
+        cursor->arena = next;
+    }
+    free(cursor->rows);
+    free(cursor);
+}
+
+#pragma endregion Cursors
@@ -1,364 +1,323 @@
-#include "db.h"
+#include "db_backend.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Active storage engine, chosen by init_db
+static DbStore *store = NULL;
+
+#define DB_MAX_LISTENERS 8
+
+static struct {
+    DbChangeListener fn;
+    void *user;
+} listeners[DB_MAX_LISTENERS];
+static int listener_count = 0;
+
+bool db_add_change_listener(DbChangeListener listener, void *user) {
+    if (!listener || listener_count >= DB_MAX_LISTENERS) return false;
+    listeners[listener_count].fn = listener;
+    listeners[listener_count].user = user;
+    listener_count++;
+    return true;
+}
 
-sqlite3 *db;
+static uint64_t own_versions[DB_ENTITY_ENROLLMENT + 1];
+static volatile uint64_t *versions = own_versions;
 
-static bool valid_course_order(const char *col) {
-    if (!col) return false;
-    const char *allowed[] = { "course_id", "name", "type", "total_hours", "lecture_hours", "lab_hours", "credit", "semester" };
-    for (size_t i = 0; i < sizeof(allowed)/sizeof(allowed[0]); ++i) {
-        if (strcmp(col, allowed[i]) == 0) return true;
-    }
-    return false;
+void db_share_data_versions(uint64_t *shared) {
+    versions = shared ? shared : own_versions;
 }
 
-static bool valid_student_order(const char *col) {
-    if (!col) return false;
-    const char *allowed[] = { "student_id", "name", "email", "credits" };
-    for (size_t i = 0; i < sizeof(allowed)/sizeof(allowed[0]); ++i) {
-        if (strcmp(col, allowed[i]) == 0) return true;
-    }
-    return false;
+uint64_t db_data_version(DbEntity entity) {
+    return atomic_load_u64(&versions[entity]);
 }
 
-static bool valid_enrollment_order(const char *col) {
-    if (!col) return false;
-    const char *allowed[] = { "student_id", "course_id" };
-    for (size_t i = 0; i < sizeof(allowed)/sizeof(allowed[0]); ++i) {
-        if (strcmp(col, allowed[i]) == 0) return true;
-    }
-    return false;
+void db_data_replaced(void) {
+    for (int e = DB_ENTITY_COURSE; e <= DB_ENTITY_ENROLLMENT; e++) atomic_inc_u64(&versions[e]);
 }
 
-bool init_db(void) {
-    log_message("Initializing database...", LOG_INFO);
-    int rc = sqlite3_open(DB_FILE, &db);
-    if (rc != SQLITE_OK) {
-        log_message(sqlite3_errmsg(db), LOG_WARN);
-        sqlite3_close(db);
-
-        remove(DB_FILE);
-        rc = sqlite3_open(DB_FILE, &db);
-        if (rc != SQLITE_OK) {
-            log_message("Failed to create new database file", LOG_ERROR);
-            return false;
-        }
+static void bump_versions(DbEntity entity) {
+    atomic_inc_u64(&versions[entity]);
+    if (entity == DB_ENTITY_COURSE) {
+        atomic_inc_u64(&versions[DB_ENTITY_STUDENT]);
+        atomic_inc_u64(&versions[DB_ENTITY_ENROLLMENT]);
+    } else if (entity == DB_ENTITY_STUDENT) {
+        atomic_inc_u64(&versions[DB_ENTITY_ENROLLMENT]);
+    } else {
+        atomic_inc_u64(&versions[DB_ENTITY_STUDENT]);
     }
+}
 
-    sqlite3_exec(db, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
-    sqlite3_busy_timeout(db, 5000);
-
-    const char *course =
-        "CREATE TABLE IF NOT EXISTS course ("
-        "course_id TEXT PRIMARY KEY,"
-        "name TEXT,"
-        "type TEXT,"
-        "total_hours REAL,"
-        "lecture_hours REAL,"
-        "lab_hours REAL,"
-        "credit REAL NOT NULL,"
-        "semester TEXT"
-        ");";
-
-    const char *student =
-        "CREATE TABLE IF NOT EXISTS student ("
-        "student_id TEXT PRIMARY KEY,"
-        "name TEXT NOT NULL,"
-        "email TEXT,"
-        "credits REAL NOT NULL DEFAULT 0.0 CHECK(credits >= 0.0)"
-        ");";
-
-    const char *enrollment =
-        "CREATE TABLE IF NOT EXISTS enrollment ("
-        "student_id TEXT NOT NULL,"
-        "course_id TEXT NOT NULL,"
-        "PRIMARY KEY (student_id, course_id),"
-        "FOREIGN KEY (student_id) REFERENCES student(student_id),"
-        "FOREIGN KEY (course_id) REFERENCES course(course_id)"
-        ");";
-
-    const char* tables[] = { course, student, enrollment };
-
-    for (int i = 0; i < (int)(sizeof(tables) / sizeof(tables[0])); i++) {
-        char *errmsg = NULL;
-        if (sqlite3_exec(db, tables[i], NULL, NULL, &errmsg) != SQLITE_OK) {
-            log_message("Failed to create table", LOG_ERROR);
-            if (errmsg) {
-                log_message(errmsg, LOG_ERROR);
-                sqlite3_free(errmsg);
-            }
-            return false;
-        }
+// Runs once the change is committed, so versions never move ahead of visible data
+static void dispatch_change(const DbChange *change) {
+    bump_versions(change->entity);
+    for (int i = 0; i < listener_count; i++) {
+        listeners[i].fn(change, listeners[i].user);
     }
-    
-
-    return true;
 }
 
-void close_db(void) {
-    log_message("Closing database...", LOG_INFO);
-    sqlite3_close(db);
+// Inside a transaction, changes are held back until COMMIT so listeners never see rolled-back writes
+typedef struct {
+    DbChange change;
+    char *key;
+    char *key2;
+} PendingChange;
+
+static _Thread_local struct {
+    PendingChange *items;
+    int count;
+    int cap;
+    int mark;           // count at the last savepoint
+    bool active;
+} pending;
+
+static char *dup_str(const char *s) {
+    if (!s) return NULL;
+    size_t n = strlen(s) + 1;
+    char *d = malloc(n);
+    if (d) memcpy(d, s, n);
+    return d;
 }
 
-static bool db_exec(const char *sql, DbValue *values, int value_count) {
-    sqlite3_stmt *stmt;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
-        char buf[256];
-        snprintf(buf, sizeof(buf), "db_exec: prepare failed: %s", sqlite3_errmsg(db));
-        log_message(buf, LOG_ERROR);
-        return false;
+static void pending_truncate(int count) {
+    for (int i = count; i < pending.count; i++) {
+        free(pending.items[i].key);
+        free(pending.items[i].key2);
     }
+    pending.count = count;
+    if (pending.mark > count) pending.mark = count;
+}
 
-    for (int i = 0; i < value_count; i++) {
-        int idx = i + 1;
-        switch (values[i].type) {
-        case DB_NULL:
-            sqlite3_bind_null(stmt, idx);
-            break;
-        case DB_TEXT:
-            sqlite3_bind_text(stmt, idx, values[i].text, -1, SQLITE_TRANSIENT);
-            break;
-        case DB_REAL:
-            sqlite3_bind_double(stmt, idx, values[i].d);
-            break;
-        case DB_INT:
-            sqlite3_bind_int(stmt, idx, values[i].i);
-            break;
-        }
+static void notify_change(DbEntity entity, DbChangeOp op, const char *key, const char *key2) {
+    DbChange change = { entity, op, key, key2 };
+    if (!pending.active) {
+        dispatch_change(&change);
+        return;
     }
 
-    int step = sqlite3_step(stmt);
-    bool ok = step == SQLITE_DONE;
-    if (!ok) {
-        char buf[256];
-        snprintf(buf, sizeof(buf), "db_exec: step failed: %s", sqlite3_errmsg(db));
-        log_message(buf, LOG_ERROR);
-    }
-    sqlite3_finalize(stmt);
-    return ok;
-}
-
-static bool db_query(const char *base_sql, const QueryOptions *opt, DbValue *values, int value_count, sqlite3_stmt **stmt, const char *entity_type) {
-    char query[1024];
-    int n = snprintf(query, sizeof(query), "%s", base_sql);
-    
-    // Add ORDER BY clause if specified and valid
-    if (opt && opt->order_by) {
-        bool valid = false;
-        if (entity_type) {
-            if (strcmp(entity_type, "course") == 0) {
-                valid = valid_course_order(opt->order_by);
-            } else if (strcmp(entity_type, "student") == 0) {
-                valid = valid_student_order(opt->order_by);
-            } else if (strcmp(entity_type, "enrollment") == 0) {
-                valid = valid_enrollment_order(opt->order_by);
-            }
-        }
-        if (valid) {
-            n += snprintf(query + n, sizeof(query) - n, " ORDER BY %s %s", opt->order_by, opt->order == SORT_DESC ? "DESC" : "ASC");
-        }
-    }
-    
-    // Add LIMIT and OFFSET clauses (OFFSET requires LIMIT in SQLite)
-    int param_idx = value_count + 1;
-    if (opt && opt->limit > 0) {
-        n += snprintf(query + n, sizeof(query) - n, " LIMIT ?");
-        if (opt->offset > 0) {
-            n += snprintf(query + n, sizeof(query) - n, " OFFSET ?");
-        }
-    } else if (opt && opt->offset > 0) {
-        // If only offset is specified, use a very large limit
-        // SQLite requires LIMIT when using OFFSET
-        n += snprintf(query + n, sizeof(query) - n, " LIMIT -1 OFFSET ?");
+    if (pending.count == pending.cap) {
+        int cap = pending.cap ? pending.cap * 2 : 64;
+        PendingChange *items = realloc(pending.items, cap * sizeof(*items));
+        if (!items) return;
+        pending.items = items;
+        pending.cap = cap;
     }
+    PendingChange *p = &pending.items[pending.count++];
+    p->key = dup_str(key);
+    p->key2 = dup_str(key2);
+    p->change = (DbChange){ entity, op, p->key, p->key2 };
+}
 
-    if (sqlite3_prepare_v2(db, query, -1, stmt, NULL) != SQLITE_OK)
-    {
-        char buf[256];
-        snprintf(buf, sizeof(buf), "db_query: prepare failed: %s", sqlite3_errmsg(db));
-        log_message(buf, LOG_ERROR);
-        return false;
-    }
+bool db_valid_order(DbEntity entity, const char *col) {
+    static const char *course_cols[] = { "course_id", "name", "type", "total_hours", "lecture_hours", "lab_hours", "credit", "semester", NULL };
+    static const char *student_cols[] = { "student_id", "name", "email", "credits", NULL };
+    static const char *enrollment_cols[] = { "student_id", "course_id", NULL };
 
-    // Bind WHERE clause parameters
-    for (int i = 0; i < value_count; i++) {
-        int idx = i + 1;
-        switch (values[i].type) {
-        case DB_NULL:
-            sqlite3_bind_null(*stmt, idx);
-            break;
-        case DB_TEXT:
-            sqlite3_bind_text(*stmt, idx, values[i].text, -1, SQLITE_TRANSIENT);
-            break;
-        case DB_REAL:
-            sqlite3_bind_double(*stmt, idx, values[i].d);
-            break;
-        case DB_INT:
-            sqlite3_bind_int(*stmt, idx, values[i].i);
-            break;
-        }
+    if (!col) return false;
+    const char **allowed = entity == DB_ENTITY_COURSE ? course_cols
+                         : entity == DB_ENTITY_STUDENT ? student_cols
+                         : enrollment_cols;
+    for (size_t i = 0; allowed[i]; ++i) {
+        if (strcmp(col, allowed[i]) == 0) return true;
     }
+    return false;
+}
 
-    // Bind pagination parameters
-    if (opt && opt->limit > 0) {
-        sqlite3_bind_int(*stmt, param_idx++, opt->limit);
-        if (opt->offset > 0) {
-            sqlite3_bind_int(*stmt, param_idx++, opt->offset);
-        }
-    } else if (opt && opt->offset > 0) {
-        // Only offset specified, already added LIMIT -1 in query
-        sqlite3_bind_int(*stmt, param_idx++, opt->offset);
-    }
+static int shard_count = 1;
 
-    return true;
+int db_shard_count(void) {
+    return shard_count;
 }
 
-#pragma region Course
+// FNV-1a, so a student lands on the same shard in every process and every run
+int db_shard_of(const char *student_id) {
+    if (shard_count == 1 || !student_id) return 0;
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)student_id; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return (int)(h % (uint32_t)shard_count);
+}
 
-static bool db_visit_course(CourseVisitor visitor, void *user, sqlite3_stmt *stmt) {
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Course c = {
-            .course_id = (const char *)sqlite3_column_text(stmt, 0),
-            .name      = (const char *)sqlite3_column_text(stmt, 1),
-            .type      = (const char *)sqlite3_column_text(stmt, 2),
-            .total_hours = sqlite3_column_double(stmt, 3),
-            .lecture_hours = sqlite3_column_double(stmt, 4),
-            .lab_hours = sqlite3_column_double(stmt, 5),
-            .credit    = sqlite3_column_double(stmt, 6),
-            .semester  = (const char *)sqlite3_column_text(stmt, 7),
-        };
-        visitor(&c, user);
+void db_shard_file(int shard, char *path, size_t len) {
+    if (shard_count == 1) {
+        snprintf(path, len, "%s", DB_FILE);
+        return;
     }
+    // curriculum.db -> curriculum-shard0.db
+    const char *ext = strrchr(DB_FILE, '.');
+    int stem = ext ? (int)(ext - DB_FILE) : (int)strlen(DB_FILE);
+    snprintf(path, len, "%.*s-shard%d%s", stem, DB_FILE, shard, ext ? ext : "");
+}
 
-    return true;
+bool init_db(void) {
+    const char *backend = env_str("CURRICULUM_BACKEND", "sqlite");
+    shard_count = 1;
+    if (strcmp(backend, "memory") == 0) {
+        store = db_memory_open(env_str("CURRICULUM_MEMORY_PATH", DB_MEMORY_FILE));
+    } else {
+        if (strcmp(backend, "sqlite") != 0) {
+            char buf[128];
+            snprintf(buf, sizeof(buf), "Unknown CURRICULUM_BACKEND '%s', using sqlite", backend);
+            log_message(buf, LOG_WARN);
+        }
+        long shards = env_long("CURRICULUM_SHARDS", 1);
+        if (shards > DB_SHARDS_MAX) {
+            char buf[128];
+            snprintf(buf, sizeof(buf), "CURRICULUM_SHARDS=%ld is more than %d, using %d", shards, DB_SHARDS_MAX, DB_SHARDS_MAX);
+            log_message(buf, LOG_WARN);
+            shards = DB_SHARDS_MAX;
+        }
+        shard_count = shards > 1 ? (int)shards : 1;
+        store = shard_count > 1 ? db_shard_open(shard_count) : db_sqlite_open(DB_FILE);
+    }
+    return store != NULL;
 }
 
-bool db_course_add(const Course *c) {
-    const char *sql =
-        "INSERT INTO course VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
+void close_db(void) {
+    if (!store) return;
+    store->ops->close(store);
+    store = NULL;
+}
 
-    DbValue v[] = {
-        { DB_TEXT, .text = c->course_id },
-        { c->name ? DB_TEXT : DB_NULL, .text = c->name },
-        { c->type ? DB_TEXT : DB_NULL, .text = c->type },
-        { DB_REAL, .d = c->total_hours },
-        { DB_REAL, .d = c->lecture_hours },
-        { DB_REAL, .d = c->lab_hours },
-        { DB_REAL, .d = c->credit },
-        { c->semester ? DB_TEXT : DB_NULL, .text = c->semester }
-    };
+const char *db_backend_name(void) {
+    return store ? store->ops->name : NULL;
+}
 
-    return db_exec(sql, v, 8);
+bool db_has_wal(void) {
+    return store && store->ops->checkpoint;
 }
 
-bool db_course_update(const Course *c) {
-    const char *sql =
-        "UPDATE course SET name = ?, type = ?, total_hours = ?, lecture_hours = ?, "
-        "lab_hours = ?, credit = ?, semester = ? WHERE course_id = ?;";
+static _Thread_local int thread_opens;
 
-    DbValue v[] = {
-        { c->name ? DB_TEXT : DB_NULL, .text = c->name },
-        { c->type ? DB_TEXT : DB_NULL, .text = c->type },
-        { DB_REAL, .d = c->total_hours },
-        { DB_REAL, .d = c->lecture_hours },
-        { DB_REAL, .d = c->lab_hours },
-        { DB_REAL, .d = c->credit },
-        { c->semester ? DB_TEXT : DB_NULL, .text = c->semester },
-        { DB_TEXT, .text = c->course_id }
-    };
+bool db_thread_open(void) {
+    if (thread_opens == 0 && store->ops->thread_open && !store->ops->thread_open(store)) return false;
+    thread_opens++;
+    return true;
+}
 
-    return db_exec(sql, v, 8);
+void db_thread_close(void) {
+    if (thread_opens > 1) {
+        thread_opens--;
+        return;
+    }
+    thread_opens = 0;
+    if (store->ops->thread_close) store->ops->thread_close(store);
+    pending_truncate(0);
+    free(pending.items);
+    pending.items = NULL;
+    pending.cap = 0;
 }
 
-bool db_course_remove(const char *course_id) {
-    // First remove all enrollments for this course
-    const char *sql_enrollments = "DELETE FROM enrollment WHERE course_id = ?;";
-    DbValue v_enroll[] = { { DB_TEXT, .text = course_id } };
-    if (!db_exec(sql_enrollments, v_enroll, 1)) return false;
+void db_disable_autocheckpoint(void) {
+    if (store->ops->disable_autocheckpoint) store->ops->disable_autocheckpoint(store);
+}
 
-    // Then remove the course
-    const char *sql = "DELETE FROM course WHERE course_id = ?;";
-    DbValue v[] = { { DB_TEXT, .text = course_id } };
+void db_busy_timeout(int ms) {
+    if (store->ops->busy_timeout) store->ops->busy_timeout(store, ms);
+}
 
-    return db_exec(sql, v, 1);
+bool db_checkpoint(DbCheckpointMode mode, int *wal_frames, int *checkpointed_frames) {
+    if (!store->ops->checkpoint) {
+        if (wal_frames) *wal_frames = 0;
+        if (checkpointed_frames) *checkpointed_frames = 0;
+        return true;
+    }
+    return store->ops->checkpoint(store, mode, wal_frames, checkpointed_frames);
 }
 
-bool db_course_list(const QueryOptions *opt, CourseVisitor visitor, void *user) {
-    sqlite3_stmt *stmt;
-    char sql[256] =
-        "SELECT course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester "
-        "FROM course";
-    
-    if(!db_query(sql, opt, NULL, 0, &stmt, "course")) return false;
-    if(!db_visit_course(visitor, user, stmt)) return false;
-
-    sqlite3_finalize(stmt);
+bool db_begin(void) {
+    if (store->ops->begin && !store->ops->begin(store)) return false;
+    pending_truncate(0);
+    pending.mark = 0;
+    pending.active = true;
     return true;
 }
 
-bool db_course_find_by_id(const char *course_id, const QueryOptions *opt,  CourseVisitor visitor, void *user) {
-    sqlite3_stmt *stmt;
-    
-    char sql[256] =
-        "SELECT course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester "
-        "FROM course WHERE course_id = ?";
+bool db_commit(void) {
+    if (store->ops->commit && !store->ops->commit(store)) return false;
+    pending.active = false;
+    for (int i = 0; i < pending.count; i++) {
+        dispatch_change(&pending.items[i].change);
+    }
+    pending_truncate(0);
+    return true;
+}
 
-    if (!db_query(sql, opt, (DbValue[]){{ DB_TEXT, .text = course_id }}, 1, &stmt, "course")) return false;
-    if (!db_visit_course(visitor, user, stmt)) return false;
+bool db_rollback(void) {
+    pending.active = false;
+    pending_truncate(0);
+    return !store->ops->rollback || store->ops->rollback(store);
+}
 
-    sqlite3_finalize(stmt);
+bool db_savepoint(void) {
+    if (store->ops->savepoint && !store->ops->savepoint(store)) return false;
+    pending.mark = pending.count;
     return true;
 }
 
-bool db_course_find_by_name(const char *name, const QueryOptions *opt, CourseVisitor visitor, void *user) {
-    sqlite3_stmt *stmt;
-
-    char sql[256] =
-        "SELECT course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester "
-        "FROM course WHERE name LIKE ?";
+bool db_release_savepoint(void) {
+    return !store->ops->release_savepoint || store->ops->release_savepoint(store);
+}
 
-    if (!db_query(sql, opt, (DbValue[]){{ DB_TEXT, .text = name }}, 1, &stmt, "course")) return false;
-    if (!db_visit_course(visitor, user, stmt)) return false;
+bool db_rollback_savepoint(void) {
+    pending_truncate(pending.mark);
+    return !store->ops->rollback_savepoint || store->ops->rollback_savepoint(store);
+}
 
-    sqlite3_finalize(stmt);
-    return true;
+bool db_read_begin(void) {
+    return !store->ops->read_begin || store->ops->read_begin(store);
 }
 
-bool db_course_find_by_type(const char *type, const QueryOptions *opt, CourseVisitor visitor, void *user) {
-    sqlite3_stmt *stmt;
+bool db_read_end(void) {
+    return !store->ops->read_end || store->ops->read_end(store);
+}
 
-    char sql[256] =
-        "SELECT course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester "
-        "FROM course WHERE type LIKE ?";
+#pragma region Course
 
-    if (!db_query(sql, opt, (DbValue[]){{ DB_TEXT, .text = type }}, 1, &stmt, "course")) return false;
-    if (!db_visit_course(visitor, user, stmt)) return false;
+bool db_course_add(const Course *c) {
+    if (!store->ops->course_add(store, c)) return false;
+    notify_change(DB_ENTITY_COURSE, DB_CHANGE_ADD, c->course_id, NULL);
+    return true;
+}
 
-    sqlite3_finalize(stmt);
+bool db_course_update(const Course *c) {
+    if (!store->ops->course_update(store, c)) return false;
+    notify_change(DB_ENTITY_COURSE, DB_CHANGE_UPDATE, c->course_id, NULL);
     return true;
 }
 
-bool db_course_find_by_semester(const char *semester, const QueryOptions *opt, CourseVisitor visitor, void *user) {
-    sqlite3_stmt *stmt;
+bool db_course_remove(const char *course_id) {
+    if (!store->ops->course_remove(store, course_id)) return false;
+    notify_change(DB_ENTITY_COURSE, DB_CHANGE_REMOVE, course_id, NULL);
+    return true;
+}
 
-    char sql[256] =
-        "SELECT course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester "
-        "FROM course WHERE semester LIKE ?";
+bool db_course_list(const QueryOptions *opt, CourseVisitor visitor, void *user) {
+    return store->ops->course_list(store, opt, visitor, user);
+}
 
-    if (!db_query(sql, opt, (DbValue[]){{ DB_TEXT, .text = semester }}, 1, &stmt, "course")) return false;
-    if (!db_visit_course(visitor, user, stmt)) return false;
+bool db_course_find_by_id(const char *course_id, const QueryOptions *opt,  CourseVisitor visitor, void *user) {
+    return store->ops->course_find(store, DB_FIND_COURSE_ID, course_id, opt, visitor, user);
+}
 
-    sqlite3_finalize(stmt);
-    return true;
-}  
+bool db_course_find_by_name(const char *name, const QueryOptions *opt, CourseVisitor visitor, void *user) {
+    return store->ops->course_find(store, DB_FIND_NAME, name, opt, visitor, user);
+}
 
-bool db_course_remove_all(void) {
-    // Remove all enrollments first to maintain consistency
-    const char *sql_del_enr = "DELETE FROM enrollment;";
-    if (!db_exec(sql_del_enr, NULL, 0)) return false;
+bool db_course_find_by_type(const char *type, const QueryOptions *opt, CourseVisitor visitor, void *user) {
+    return store->ops->course_find(store, DB_FIND_TYPE, type, opt, visitor, user);
+}
 
-    const char *sql_del = "DELETE FROM course;";
-    if (!db_exec(sql_del, NULL, 0)) return false;
+bool db_course_find_by_semester(const char *semester, const QueryOptions *opt, CourseVisitor visitor, void *user) {
+    return store->ops->course_find(store, DB_FIND_SEMESTER, semester, opt, visitor, user);
+}
 
+bool db_course_remove_all(void) {
+    if (!store->ops->course_remove_all(store)) return false;
+    notify_change(DB_ENTITY_COURSE, DB_CHANGE_REMOVE_ALL, NULL, NULL);
     return true;
 }
 
@@ -366,242 +325,84 @@ bool db_course_remove_all(void) {
 
 #pragma region Enrollment
 
-static bool db_visit_enrollment(EnrollmentVisitor visitor, void *user, sqlite3_stmt *stmt) {
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Enrollment e = {
-            .student_id = (const char *)sqlite3_column_text(stmt, 0),
-            .course_id  = (const char *)sqlite3_column_text(stmt, 1),
-        };
-        visitor(&e, user);
-    }
-
-    return true;
-}
-
 bool db_enrollment_add(const Enrollment *e) {
-    // First verify both student and course exist
-    sqlite3_stmt *stmt;
-    const char *check_student = "SELECT student_id FROM student WHERE student_id = ?;";
-    if (sqlite3_prepare_v2(db, check_student, -1, &stmt, NULL) != SQLITE_OK) return false;
-    sqlite3_bind_text(stmt, 1, e->student_id, -1, SQLITE_TRANSIENT);
-    int student_exists = sqlite3_step(stmt) == SQLITE_ROW;
-    sqlite3_finalize(stmt);
-    if (!student_exists) return false;
-
-    const char *check_course = "SELECT credit FROM course WHERE course_id = ?;";
-    if (sqlite3_prepare_v2(db, check_course, -1, &stmt, NULL) != SQLITE_OK) return false;
-    sqlite3_bind_text(stmt, 1, e->course_id, -1, SQLITE_TRANSIENT);
-    int course_exists = sqlite3_step(stmt) == SQLITE_ROW;
-    double course_credit = 0.0;
-    if (course_exists) {
-        course_credit = sqlite3_column_double(stmt, 0);
-    }
-    sqlite3_finalize(stmt);
-    if (!course_exists) return false;
-
-    // Add enrollment
-    const char *sql = "INSERT INTO enrollment VALUES (?, ?);";
-    DbValue v[] = {
-        { DB_TEXT, .text = e->student_id },
-        { DB_TEXT, .text = e->course_id }
-    };
-    if (!db_exec(sql, v, 2)) return false;
-
-    // Update student credits
-    const char *update_credits = "UPDATE student SET credits = credits + ? WHERE student_id = ?;";
-    DbValue v_credits[] = {
-        { DB_REAL, .d = course_credit },
-        { DB_TEXT, .text = e->student_id }
-    };
-    return db_exec(update_credits, v_credits, 2);
+    if (!store->ops->enrollment_add(store, e)) return false;
+    notify_change(DB_ENTITY_ENROLLMENT, DB_CHANGE_ADD, e->student_id, e->course_id);
+    return true;
 }
 
 bool db_enrollment_remove(const char *student_id, const char *course_id) {
-    // Get course credit before removing
-    sqlite3_stmt *stmt;
-    const char *get_credit = "SELECT credit FROM course WHERE course_id = ?;";
-    if (sqlite3_prepare_v2(db, get_credit, -1, &stmt, NULL) != SQLITE_OK) return false;
-    sqlite3_bind_text(stmt, 1, course_id, -1, SQLITE_TRANSIENT);
-    double course_credit = 0.0;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        course_credit = sqlite3_column_double(stmt, 0);
-    }
-    sqlite3_finalize(stmt);
-
-    // Remove enrollment
-    const char *sql = "DELETE FROM enrollment WHERE student_id = ? AND course_id = ?;";
-    DbValue v[] = {
-        { DB_TEXT, .text = student_id },
-        { DB_TEXT, .text = course_id }
-    };
-    if (!db_exec(sql, v, 2)) return false;
-
-    // Update student credits
-    const char *update_credits = "UPDATE student SET credits = credits - ? WHERE student_id = ?;";
-    DbValue v_credits[] = {
-        { DB_REAL, .d = course_credit },
-        { DB_TEXT, .text = student_id }
-    };
-    return db_exec(update_credits, v_credits, 2);
+    if (!store->ops->enrollment_remove(store, student_id, course_id)) return false;
+    notify_change(DB_ENTITY_ENROLLMENT, DB_CHANGE_REMOVE, student_id, course_id);
+    return true;
 }
 
 bool db_enrollment_remove_all(void) {
-    const char *sql_del = "DELETE FROM enrollment;";
-    if (!db_exec(sql_del, NULL, 0)) return false;
-
-    const char *sql_reset = "UPDATE student SET credits = 0.0;";
-    if (!db_exec(sql_reset, NULL, 0)) return false;
-
+    if (!store->ops->enrollment_remove_all(store)) return false;
+    notify_change(DB_ENTITY_ENROLLMENT, DB_CHANGE_REMOVE_ALL, NULL, NULL);
     return true;
 }
 
 bool db_enrollment_list(const QueryOptions *opt, EnrollmentVisitor visitor, void *user) {
-    sqlite3_stmt *stmt;
-
-    char sql[256] =
-        "SELECT student_id, course_id "
-        "FROM enrollment";
-
-    if (!db_query(sql, opt, NULL, 0, &stmt, "enrollment")) return false;
-    if (!db_visit_enrollment(visitor, user, stmt)) return false;
-
-    sqlite3_finalize(stmt);
-    return true;
+    return store->ops->enrollment_list(store, opt, visitor, user);
 }
 
 bool db_enrollment_find_by_student_id(const char *student_id, const QueryOptions *opt, EnrollmentVisitor visitor, void *user) {
-    sqlite3_stmt *stmt;
-
-    char sql[256] =
-        "SELECT student_id, course_id "
-        "FROM enrollment WHERE student_id = ?";
-
-    if (!db_query(sql, opt, (DbValue[]){{ DB_TEXT, .text = student_id }}, 1, &stmt, "enrollment")) return false;
-    if (!db_visit_enrollment(visitor, user, stmt)) return false;
-
-    sqlite3_finalize(stmt);
-    return true;
+    return store->ops->enrollment_find(store, DB_FIND_STUDENT_ID, student_id, opt, visitor, user);
 }
 
 bool db_enrollment_find_by_course_id(const char *course_id, const QueryOptions *opt, EnrollmentVisitor visitor, void *user) {
-    sqlite3_stmt *stmt;
-
-    char sql[256] =
-        "SELECT student_id, course_id "
-        "FROM enrollment WHERE course_id = ?";
-
-    if (!db_query(sql, opt, (DbValue[]){{ DB_TEXT, .text = course_id }}, 1, &stmt, "enrollment")) return false;
-    if (!db_visit_enrollment(visitor, user, stmt)) return false;
-
-    sqlite3_finalize(stmt);
-    return true;
+    return store->ops->enrollment_find(store, DB_FIND_COURSE_ID, course_id, opt, visitor, user);
 }
 
 #pragma endregion Enrollment
 
 #pragma region Student
 
-static bool db_visit_student(StudentVisitor visitor, void *user, sqlite3_stmt *stmt) {
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        Student s = {
-            .student_id = (const char *)sqlite3_column_text(stmt, 0),
-            .name       = (const char *)sqlite3_column_text(stmt, 1),
-            .email      = (const char *)sqlite3_column_text(stmt, 2),
-            .credits    = sqlite3_column_double(stmt, 3),
-        };
-        visitor(&s, user);
-    }
-
-    return true;
-}
-
 bool db_student_add(const Student *s) {
-    const char *sql =
-        "INSERT INTO student VALUES (?, ?, ?, 0.0);";
-    DbValue v[] = {
-        { DB_TEXT, .text = s->student_id },
-        { DB_TEXT, .text = s->name },
-        { s->email ? DB_TEXT : DB_NULL, .text = s->email }
-    };
-    return db_exec(sql, v, 3);
+    if (!store->ops->student_add(store, s)) return false;
+    notify_change(DB_ENTITY_STUDENT, DB_CHANGE_ADD, s->student_id, NULL);
+    return true;
 }
 
 bool db_student_update(const Student *s) {
-    const char *sql =
-        "UPDATE student SET name = ?, email = ?, credits = ? WHERE student_id = ?;";
-    DbValue v[] = {
-        { DB_TEXT, .text = s->name },
-        { s->email ? DB_TEXT : DB_NULL, .text = s->email },
-        { DB_REAL, .d = s->credits },
-        { DB_TEXT, .text = s->student_id }
-    };
-    return db_exec(sql, v, 4);
+    if (!store->ops->student_update(store, s)) return false;
+    notify_change(DB_ENTITY_STUDENT, DB_CHANGE_UPDATE, s->student_id, NULL);
+    return true;
 }
 
 bool db_student_remove(const char *student_id) {
-    // First remove all enrollments for this student
-    const char *sql_enrollments = "DELETE FROM enrollment WHERE student_id = ?;";
-    DbValue v_enroll[] = { { DB_TEXT, .text = student_id } };
-    if (!db_exec(sql_enrollments, v_enroll, 1)) return false;
-
-    // Then remove the student
-    const char *sql = "DELETE FROM student WHERE student_id = ?;";
-    DbValue v[] = { { DB_TEXT, .text = student_id } };
-    return db_exec(sql, v, 1);
+    if (!store->ops->student_remove(store, student_id)) return false;
+    notify_change(DB_ENTITY_STUDENT, DB_CHANGE_REMOVE, student_id, NULL);
+    return true;
 }
 
 bool db_student_remove_all(void) {
-    // Remove all enrollments first
-    const char *sql_del_enr = "DELETE FROM enrollment;";
-    if (!db_exec(sql_del_enr, NULL, 0)) return false;
-
-    // Then remove all students
-    const char *sql_del = "DELETE FROM student;";
-    if (!db_exec(sql_del, NULL, 0)) return false;
-
+    if (!store->ops->student_remove_all(store)) return false;
+    notify_change(DB_ENTITY_STUDENT, DB_CHANGE_REMOVE_ALL, NULL, NULL);
     return true;
 }
 
 bool db_student_list(const QueryOptions *opt, StudentVisitor visitor, void *user) {
-    sqlite3_stmt *stmt;
-
-    char sql[256] =
-        "SELECT student_id, name, email, credits "
-        "FROM student";
-
-    if (!db_query(sql, opt, NULL, 0, &stmt, "student")) return false;
-    if (!db_visit_student(visitor, user, stmt)) return false;
-
-    sqlite3_finalize(stmt);
-    return true;
+    return store->ops->student_list(store, opt, visitor, user);
 }
 
 bool db_student_find_by_id(const char *student_id, const QueryOptions *opt, StudentVisitor visitor, void *user) {
-    sqlite3_stmt *stmt;
-
-    char sql[256] =
-        "SELECT student_id, name, email, credits "
-        "FROM student WHERE student_id = ?";
-
-    if (!db_query(sql, opt, (DbValue[]){{ DB_TEXT, .text = student_id }}, 1, &stmt, "student")) return false;
-    if (!db_visit_student(visitor, user, stmt)) return false;
-
-    sqlite3_finalize(stmt);
-    return true;
+    return store->ops->student_find(store, DB_FIND_STUDENT_ID, student_id, opt, visitor, user);
 }
 
 bool db_student_find_by_name(const char *name, const QueryOptions *opt, StudentVisitor visitor, void *user) {
-    sqlite3_stmt *stmt;
-
-    char sql[256] =
-        "SELECT student_id, name, email, credits "
-        "FROM student WHERE name LIKE ?";
+    return store->ops->student_find(store, DB_FIND_NAME, name, opt, visitor, user);
+}
 
-    if (!db_query(sql, opt, (DbValue[]){{ DB_TEXT, .text = name }}, 1, &stmt, "student")) return false;
-    if (!db_visit_student(visitor, user, stmt)) return false;
+#pragma endregion Student
 
-    sqlite3_finalize(stmt);
+bool db_remove_batch(DbEntity entity, int limit, int *removed) {
+    *removed = 0;
+    if (!store->ops->remove_batch) return true;
+    // Courses only go once no enrollment is left anywhere (with shards, in any file)
+    if (entity == DB_ENTITY_COURSE && !store->ops->remove_batch(store, entity, DB_ENTITY_ENROLLMENT, limit, removed)) return false;
+    if (!*removed && !store->ops->remove_batch(store, entity, entity, limit, removed)) return false;
+    if (*removed) notify_change(entity, DB_CHANGE_REMOVE_BATCH, NULL, NULL);
     return true;
 }
-
-#pragma endregion Student
\ No newline at end of file
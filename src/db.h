@@ -1,7 +1,9 @@
 #pragma once
 #include "utils.h"
+#include <stdint.h>
 
 #define DB_FILE "curriculum.db"
+#define DB_MEMORY_FILE "curriculum.mem"
 
 typedef enum {
     DB_NULL,
@@ -33,8 +35,144 @@ typedef struct {
 } QueryOptions;
 
 
+// CURRICULUM_BACKEND selects the storage engine: sqlite (default) or memory.
+// The memory engine keeps everything in RAM and persists to an append log plus
+// periodic snapshots at CURRICULUM_MEMORY_PATH (default DB_MEMORY_FILE).
 bool init_db(void);
 void close_db(void);
+const char *db_backend_name(void);
+
+
+
+// Change notifications //
+
+typedef enum {
+    DB_ENTITY_COURSE,
+    DB_ENTITY_STUDENT,
+    DB_ENTITY_ENROLLMENT
+} DbEntity;
+
+typedef enum {
+    DB_CHANGE_ADD,
+    DB_CHANGE_UPDATE,
+    DB_CHANGE_REMOVE,
+    DB_CHANGE_REMOVE_ALL,
+    DB_CHANGE_REMOVE_BATCH      // some rows of the entity, from db_remove_batch
+} DbChangeOp;
+
+typedef struct {
+    DbEntity entity;
+    DbChangeOp op;
+    const char *key;         // course_id / student_id, NULL for REMOVE_ALL and REMOVE_BATCH
+    const char *key2;        // enrollments only: course_id (key is student_id)
+} DbChange;
+
+typedef void (*DbChangeListener)(const DbChange *, void *);
+
+// Listeners are called on the writing thread after a successful write and must not block.
+bool db_add_change_listener(DbChangeListener listener, void *user);
+
+// Bumped after every committed change to entity, including changes that cascade into it
+// (enrollment writes recompute student credits, course and student removals drop
+// enrollments). A reader that sees the same version before and after a query knows no
+// write committed in between; results computed at an older version are stale.
+uint64_t db_data_version(DbEntity entity);
+
+// Keeps the versions in shared (e.g. mmap'd) memory of DB_ENTITY_ENROLLMENT + 1 counters,
+// so processes serving one database see each other's commits; NULL goes back to
+// process-local counters. Call before init_db, and never reset the shared counters.
+void db_share_data_versions(uint64_t *shared);
+
+// The database file was replaced underneath the store (see db_copy_file): moves every
+// version, since any row may have changed. Listeners are not called.
+void db_data_replaced(void);
+
+
+
+// Connections and transactions //
+
+// Give the calling thread a private connection; all db_* calls on that thread use it.
+// Calls nest: each successful db_thread_open needs its db_thread_close, and only the
+// last one closes the connection (an export on a request thread keeps its reads').
+bool db_thread_open(void);
+void db_thread_close(void);
+
+// Inside db_begin/db_commit, change notifications are delivered on commit.
+bool db_begin(void);
+bool db_commit(void);
+bool db_rollback(void);
+
+// A single non-nested savepoint, used to isolate one mutation inside a batch
+bool db_savepoint(void);
+bool db_release_savepoint(void);
+bool db_rollback_savepoint(void);
+
+// A read snapshot: every read on this thread until db_read_end sees the same committed
+// state. SQLite needs db_thread_open first so the shared connection is never pinned;
+// the memory backend holds its read lock, so writers wait until db_read_end.
+bool db_read_begin(void);
+bool db_read_end(void);
+
+
+
+// WAL checkpoints //
+
+typedef enum {
+    DB_CHECKPOINT_PASSIVE,
+    DB_CHECKPOINT_FULL,
+    DB_CHECKPOINT_RESTART,
+    DB_CHECKPOINT_TRUNCATE
+} DbCheckpointMode;
+
+// False when the active backend has no WAL to checkpoint
+bool db_has_wal(void);
+// Stop SQLite from checkpointing on commit; call before other threads open connections.
+void db_disable_autocheckpoint(void);
+void db_busy_timeout(int ms);
+// Returns false if the checkpoint could not complete (e.g. SQLITE_BUSY). Frame counts may be NULL.
+bool db_checkpoint(DbCheckpointMode mode, int *wal_frames, int *checkpointed_frames);
+
+
+
+// Shards //
+
+// With CURRICULUM_SHARDS=K (2..DB_SHARDS_MAX) the sqlite backend hash-partitions students
+// and their enrollments by student_id across K database files and copies every course
+// into each of them. K is fixed once data exists: rows are never moved between shards.
+#define DB_SHARDS_MAX 16
+
+// 1 when not sharded; known after init_db
+int db_shard_count(void);
+// The shard that holds student_id and its enrollments
+int db_shard_of(const char *student_id);
+// Database file of a shard; DB_FILE when not sharded
+void db_shard_file(int shard, char *path, size_t len);
+
+
+
+// Online copies //
+
+// File-to-file copies of sqlite databases with sqlite3_backup, whatever the active
+// backend. pages_per_step pages are copied per step with pause_ms between steps, so the
+// source is only read-locked briefly; a write to it from another connection starts the
+// copy over, and after a few restarts the rest is copied in one step. The destination
+// is created if needed and replaced in one transaction, so its readers see either the
+// old or the new database.
+typedef struct {
+    int pages;               // pages in the copy
+    int steps;
+    int restarts;            // passes started over because the source changed
+} DbCopyStats;
+
+bool db_copy_file(const char *from, const char *to, int pages_per_step, int pause_ms, DbCopyStats *stats);
+
+// Notices commits to another database file by any connection, in any process
+typedef struct DbFileWatch DbFileWatch;
+
+DbFileWatch *db_watch_open(const char *path);
+// *version differs from the previous call's whenever something was committed in between
+bool db_watch_version(DbFileWatch *w, int64_t *version);
+void db_watch_close(DbFileWatch *w);
 
 
 
@@ -103,3 +241,10 @@ bool db_student_remove_all(void);
 
 // Delete all courses/enrollments/students
 bool db_course_remove_all(void);
+
+// One step of a remove_all done in chunks, ending where the matching remove_all would:
+// up to limit enrollments and then limit courses; up to limit students with their
+// enrollments; or the enrollments of up to limit students, resetting their credits.
+// *removed is 0 once nothing is left, or always when the backend only removes
+// everything at once.
+bool db_remove_batch(DbEntity entity, int limit, int *removed);
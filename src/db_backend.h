@@ -0,0 +1,90 @@
+#pragma once
+#include "db.h"
+
+/*
+ * Storage backend interface. db.c routes the public db_* API through the
+ * active store's ops table; change notifications, transactions bookkeeping
+ * and option validation stay in db.c so every backend behaves the same.
+ */
+
+typedef struct DbStore DbStore;
+typedef struct DbCursor DbCursor;
+
+typedef enum {
+    DB_FIND_COURSE_ID,
+    DB_FIND_STUDENT_ID,
+    DB_FIND_NAME,
+    DB_FIND_TYPE,
+    DB_FIND_SEMESTER
+} DbFindField;
+
+typedef struct {
+    const char *name;
+    void (*close)(DbStore *self);
+
+    // Optional, NULL when the backend has nothing to do
+    bool (*thread_open)(DbStore *self);
+    void (*thread_close)(DbStore *self);
+    bool (*begin)(DbStore *self);
+    bool (*commit)(DbStore *self);
+    bool (*rollback)(DbStore *self);
+    bool (*savepoint)(DbStore *self);
+    bool (*release_savepoint)(DbStore *self);
+    bool (*rollback_savepoint)(DbStore *self);
+    bool (*read_begin)(DbStore *self);
+    bool (*read_end)(DbStore *self);
+    bool (*checkpoint)(DbStore *self, DbCheckpointMode mode, int *wal_frames, int *checkpointed_frames);
+    void (*disable_autocheckpoint)(DbStore *self);
+    void (*busy_timeout)(DbStore *self, int ms);
+
+    // Pull-style reads over the same queries as *_list (value == NULL) and *_find.
+    // next returns 1 with *row filled in (a Course, Student or Enrollment by entity,
+    // valid until the next call), 0 at the end and -1 on error.
+    DbCursor *(*cursor_open)(DbStore *self, DbEntity entity, DbFindField field, const char *value, const QueryOptions *opt);
+    int (*cursor_next)(DbCursor *cur, void *row);
+    void (*cursor_close)(DbCursor *cur);
+
+    bool (*course_add)(DbStore *self, const Course *c);
+    bool (*course_update)(DbStore *self, const Course *c);
+    bool (*course_remove)(DbStore *self, const char *course_id);
+    bool (*course_remove_all)(DbStore *self);
+    bool (*course_list)(DbStore *self, const QueryOptions *opt, CourseVisitor visitor, void *user);
+    // field: DB_FIND_COURSE_ID (exact) or DB_FIND_NAME / TYPE / SEMESTER (LIKE)
+    bool (*course_find)(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, CourseVisitor visitor, void *user);
+
+    bool (*enrollment_add)(DbStore *self, const Enrollment *e);
+    bool (*enrollment_remove)(DbStore *self, const char *student_id, const char *course_id);
+    bool (*enrollment_remove_all)(DbStore *self);
+    bool (*enrollment_list)(DbStore *self, const QueryOptions *opt, EnrollmentVisitor visitor, void *user);
+    // field: DB_FIND_STUDENT_ID or DB_FIND_COURSE_ID
+    bool (*enrollment_find)(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, EnrollmentVisitor visitor, void *user);
+
+    bool (*student_add)(DbStore *self, const Student *s);
+    bool (*student_update)(DbStore *self, const Student *s);
+    bool (*student_remove)(DbStore *self, const char *student_id);
+    bool (*student_remove_all)(DbStore *self);
+    bool (*student_list)(DbStore *self, const QueryOptions *opt, StudentVisitor visitor, void *user);
+    // field: DB_FIND_STUDENT_ID (exact) or DB_FIND_NAME (LIKE)
+    bool (*student_find)(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, StudentVisitor visitor, void *user);
+
+    // Optional, see db_remove_batch; without it jobs fall back to *_remove_all.
+    // table is the entity itself, or DB_ENTITY_ENROLLMENT for the first phase of a
+    // course step, which removes only enrollments.
+    bool (*remove_batch)(DbStore *self, DbEntity entity, DbEntity table, int limit, int *removed);
+} DbStoreOps;
+
+struct DbStore {
+    const DbStoreOps *ops;
+};
+
+DbStore *db_sqlite_open(const char *path);
+// The sqlite schema's secondary indexes. Bulk loaders drop them before inserting
+// and create them once at the end instead of updating them row by row.
+extern const char *const db_sqlite_drop_indexes_sql;
+extern const char *const db_sqlite_create_indexes_sql;
+DbStore *db_memory_open(const char *path);
+// K sqlite stores at db_shard_file(0..K-1)
+DbStore *db_shard_open(int shards);
+
+// Shared by backends: is col an allowed order_by column for the entity?
+bool db_valid_order(DbEntity entity, const char *col);
@@ -0,0 +1,1310 @@
+#include "db_backend.h"
+#include "thread.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/*
+ * In-memory storage engine.
+ *
+ * Courses and students live in heap records indexed two ways: an open-addressed
+ * hash by ID for point lookups and an ID-ordered pointer array for listing.
+ * Listing by any other column uses a sorted view built on first use and cached
+ * until the table changes. Enrollments are not stored as rows; each student
+ * keeps its courses and each course its students (both ordered by ID), which
+ * doubles as the inverted index for find_by_course_id/find_by_student_id.
+ *
+ * Persistence: every successful write is appended to <path>.log, and a full
+ * snapshot is written to <path> every CURRICULUM_SNAPSHOT_INTERVAL_S seconds
+ * (default 60, 0 = only on open/close), after which the log starts over. Both
+ * files carry a generation number so a log that was already folded into the
+ * snapshot is never replayed twice. Records are in host byte order.
+ *
+ * CURRICULUM_MEMORY_FSYNC=1 fsyncs the log on every commit (default: flush only).
+ *
+ * Mutations are validated before anything is changed, so a failed mutation
+ * leaves nothing to undo and savepoint rollback is a no-op. A transaction holds
+ * the write lock from db_begin to db_commit so readers never see half a batch.
+ */
+
+#define MEM_MAX_COLUMNS 8
+#define SNAPSHOT_MAGIC "CURSNAP1"
+#define LOG_MAGIC "CURLOG01"
+#define NULL_STR_LEN 0xFFFFFFFFu
+
+typedef enum {
+    MEM_OP_COURSE_ADD = 1,
+    MEM_OP_COURSE_UPDATE,
+    MEM_OP_COURSE_REMOVE,
+    MEM_OP_COURSE_REMOVE_ALL,
+    MEM_OP_STUDENT_ADD,
+    MEM_OP_STUDENT_UPDATE,
+    MEM_OP_STUDENT_REMOVE,
+    MEM_OP_STUDENT_REMOVE_ALL,
+    MEM_OP_ENROLLMENT_ADD,
+    MEM_OP_ENROLLMENT_REMOVE,
+    MEM_OP_ENROLLMENT_REMOVE_ALL,
+    MEM_OP_ENROLLMENT_LINK      // snapshot only: enrollment without the credit update
+} MemOp;
+
+#pragma region Containers
+
+typedef struct {
+    void **items;
+    size_t count;
+    size_t cap;
+} PtrVec;
+
+// Every record type starts with its ID so containers can key any of them
+static const char *rec_id(const void *rec) {
+    return *(char *const *)rec;
+}
+
+static bool vec_reserve(PtrVec *v, size_t need) {
+    if (need <= v->cap) return true;
+    size_t cap = v->cap ? v->cap : 4;
+    while (cap < need) cap *= 2;
+    void **items = realloc(v->items, cap * sizeof(*items));
+    if (!items) return false;
+    v->items = items;
+    v->cap = cap;
+    return true;
+}
+
+static size_t vec_lower_bound(const PtrVec *v, const char *id) {
+    size_t lo = 0, hi = v->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(rec_id(v->items[mid]), id) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static bool vec_insert_sorted(PtrVec *v, void *rec) {
+    if (!vec_reserve(v, v->count + 1)) return false;
+    size_t at = vec_lower_bound(v, rec_id(rec));
+    memmove(&v->items[at + 1], &v->items[at], (v->count - at) * sizeof(*v->items));
+    v->items[at] = rec;
+    v->count++;
+    return true;
+}
+
+static bool vec_remove_sorted(PtrVec *v, const char *id) {
+    size_t at = vec_lower_bound(v, id);
+    if (at == v->count || strcmp(rec_id(v->items[at]), id) != 0) return false;
+    memmove(&v->items[at], &v->items[at + 1], (v->count - at - 1) * sizeof(*v->items));
+    v->count--;
+    return true;
+}
+
+static bool vec_contains(const PtrVec *v, const char *id) {
+    size_t at = vec_lower_bound(v, id);
+    return at < v->count && strcmp(rec_id(v->items[at]), id) == 0;
+}
+
+static void vec_free(PtrVec *v) {
+    free(v->items);
+    v->items = NULL;
+    v->count = v->cap = 0;
+}
+
+typedef struct {
+    const char *key;        // points at the record's own ID, or tombstone
+    void *rec;
+} HashSlot;
+
+typedef struct {
+    HashSlot *slots;
+    size_t cap;             // power of two
+    size_t used;            // live + tombstones
+    size_t live;
+} HashIndex;
+
+static const char tombstone[1];
+
+static uint64_t hash_str(const char *s) {
+    uint64_t h = 1469598103934665603ull;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+static HashSlot *hash_slot(const HashIndex *h, const char *key) {
+    if (!h->cap) return NULL;
+    size_t mask = h->cap - 1;
+    for (size_t i = hash_str(key) & mask;; i = (i + 1) & mask) {
+        HashSlot *slot = &h->slots[i];
+        if (!slot->key) return NULL;
+        if (slot->key != tombstone && strcmp(slot->key, key) == 0) return slot;
+    }
+}
+
+static void *hash_get(const HashIndex *h, const char *key) {
+    HashSlot *slot = hash_slot(h, key);
+    return slot ? slot->rec : NULL;
+}
+
+static bool hash_rehash(HashIndex *h, size_t cap) {
+    HashSlot *slots = calloc(cap, sizeof(*slots));
+    if (!slots) return false;
+    size_t used = 0;
+    for (size_t i = 0; i < h->cap; i++) {
+        HashSlot *old = &h->slots[i];
+        if (!old->key || old->key == tombstone) continue;
+        size_t j = hash_str(old->key) & (cap - 1);
+        while (slots[j].key) j = (j + 1) & (cap - 1);
+        slots[j] = *old;
+        used++;
+    }
+    free(h->slots);
+    h->slots = slots;
+    h->cap = cap;
+    h->used = h->live = used;
+    return true;
+}
+
+// key must stay valid as long as the entry exists (it is the record's ID)
+static bool hash_put(HashIndex *h, const char *key, void *rec) {
+    if ((h->used + 1) * 4 >= h->cap * 3) {
+        // Sized by the live entries, so add/remove churn only clears tombstones
+        size_t cap = 64;
+        while (cap < (h->live + 1) * 2) cap *= 2;
+        if (!hash_rehash(h, cap)) return false;
+    }
+    size_t mask = h->cap - 1;
+    for (size_t i = hash_str(key) & mask;; i = (i + 1) & mask) {
+        HashSlot *slot = &h->slots[i];
+        if (!slot->key || slot->key == tombstone) {
+            if (!slot->key) h->used++;
+            h->live++;
+            slot->key = key;
+            slot->rec = rec;
+            return true;
+        }
+    }
+}
+
+static void hash_del(HashIndex *h, const char *key) {
+    HashSlot *slot = hash_slot(h, key);
+    if (!slot) return;
+    h->live--;
+    slot->key = tombstone;
+    slot->rec = NULL;
+}
+
+static void hash_free(HashIndex *h) {
+    free(h->slots);
+    h->slots = NULL;
+    h->cap = h->used = h->live = 0;
+}
+
+#pragma endregion Containers
+
+#pragma region Tables
+
+typedef struct {
+    char *course_id;
+    char *name;
+    char *type;
+    char *semester;
+    double total_hours;
+    double lecture_hours;
+    double lab_hours;
+    double credit;
+    PtrVec students;        // enrolled MemStudent*, ordered by student_id
+} MemCourse;
+
+typedef struct {
+    char *student_id;
+    char *name;
+    char *email;
+    double credits;
+    PtrVec courses;         // enrolled MemCourse*, ordered by course_id
+} MemStudent;
+
+typedef struct {
+    const char *name;
+    bool text;
+    size_t offset;
+} MemColumn;
+
+static const MemColumn course_columns[] = {
+    { "course_id", true, offsetof(MemCourse, course_id) },
+    { "name", true, offsetof(MemCourse, name) },
+    { "type", true, offsetof(MemCourse, type) },
+    { "total_hours", false, offsetof(MemCourse, total_hours) },
+    { "lecture_hours", false, offsetof(MemCourse, lecture_hours) },
+    { "lab_hours", false, offsetof(MemCourse, lab_hours) },
+    { "credit", false, offsetof(MemCourse, credit) },
+    { "semester", true, offsetof(MemCourse, semester) },
+    { NULL, false, 0 }
+};
+
+static const MemColumn student_columns[] = {
+    { "student_id", true, offsetof(MemStudent, student_id) },
+    { "name", true, offsetof(MemStudent, name) },
+    { "email", true, offsetof(MemStudent, email) },
+    { "credits", false, offsetof(MemStudent, credits) },
+    { NULL, false, 0 }
+};
+
+typedef struct {
+    uint64_t generation;    // table generation the view was built for
+    void **items;
+    size_t count;
+} MemView;
+
+typedef struct {
+    const MemColumn *columns;
+    HashIndex index;
+    PtrVec rows;            // ordered by ID
+    uint64_t generation;    // bumped on every change; invalidates views
+    MemView views[MEM_MAX_COLUMNS];
+    mutex_t view_lock;      // readers share the table lock but build views one at a time
+} MemTable;
+
+static void table_init(MemTable *t, const MemColumn *columns) {
+    memset(t, 0, sizeof(*t));
+    t->columns = columns;
+    t->generation = 1;
+    mutex_init(&t->view_lock);
+}
+
+static void *table_get(const MemTable *t, const char *id) {
+    return id ? hash_get(&t->index, id) : NULL;
+}
+
+static bool table_insert(MemTable *t, void *rec) {
+    if (!vec_reserve(&t->rows, t->rows.count + 1)) return false;
+    if (!hash_put(&t->index, rec_id(rec), rec)) return false;
+    vec_insert_sorted(&t->rows, rec);
+    t->generation++;
+    return true;
+}
+
+static void table_unlink(MemTable *t, const char *id) {
+    vec_remove_sorted(&t->rows, id);
+    hash_del(&t->index, id);
+    t->generation++;
+}
+
+static void table_reset(MemTable *t) {
+    hash_free(&t->index);
+    t->rows.count = 0;
+    t->generation++;
+}
+
+static void table_free(MemTable *t) {
+    hash_free(&t->index);
+    vec_free(&t->rows);
+    for (int i = 0; i < MEM_MAX_COLUMNS; i++) free(t->views[i].items);
+    mutex_destroy(&t->view_lock);
+}
+
+static int column_index(const MemTable *t, const char *name) {
+    if (!name) return 0;
+    for (int i = 0; t->columns[i].name; i++) {
+        if (strcmp(t->columns[i].name, name) == 0) return i;
+    }
+    return 0;
+}
+
+static _Thread_local const MemColumn *sort_column;
+
+// NULLs sort first like SQLite; ties fall back to the ID so pages are stable
+static int compare_by_column(const void *pa, const void *pb) {
+    const char *a = *(const char *const *)pa;
+    const char *b = *(const char *const *)pb;
+    const MemColumn *col = sort_column;
+    int c = 0;
+    if (col->text) {
+        const char *x = *(const char *const *)(a + col->offset);
+        const char *y = *(const char *const *)(b + col->offset);
+        if (!x || !y) c = (x != NULL) - (y != NULL);
+        else c = strcmp(x, y);
+    } else {
+        double x = *(const double *)(a + col->offset);
+        double y = *(const double *)(b + col->offset);
+        c = (x > y) - (x < y);
+    }
+    return c ? c : strcmp(rec_id(a), rec_id(b));
+}
+
+// Rows ordered by the given column; caller holds the store lock for reading
+static const PtrVec *table_view(MemTable *t, int col, PtrVec *out) {
+    if (col == 0) return &t->rows;
+
+    mutex_lock(&t->view_lock);
+    MemView *view = &t->views[col];
+    if (view->generation != t->generation) {
+        void **items = realloc(view->items, (t->rows.count ? t->rows.count : 1) * sizeof(*items));
+        if (!items) {
+            mutex_unlock(&t->view_lock);
+            return &t->rows;
+        }
+        memcpy(items, t->rows.items, t->rows.count * sizeof(*items));
+        sort_column = &t->columns[col];
+        qsort(items, t->rows.count, sizeof(*items), compare_by_column);
+        view->items = items;
+        view->count = t->rows.count;
+        view->generation = t->generation;
+    }
+    out->items = view->items;
+    out->count = view->count;
+    out->cap = view->count;
+    mutex_unlock(&t->view_lock);
+    return out;
+}
+
+#pragma endregion Tables
+
+typedef struct {
+    DbStore base;
+    rwlock_t lock;
+    MemTable courses;
+    MemTable students;
+
+    char *path;             // snapshot
+    char *log_path;
+    char *tmp_path;
+    FILE *log;
+    uint64_t generation;    // snapshot/log generation
+    uint64_t log_bytes;     // bytes appended since the last snapshot
+    bool fsync_log;
+
+    thread_t snapshot_thread;
+    mutex_t snapshot_lock;
+    cond_t snapshot_wake;
+    int snapshot_interval_s;
+    bool snapshot_running;
+    bool stopping;
+} MemStore;
+
+// The store whose write lock the calling thread holds for a transaction
+static _Thread_local MemStore *txn_owner;
+// The store whose read lock the calling thread holds for a read snapshot
+static _Thread_local MemStore *read_owner;
+
+static void read_begin(MemStore *s) { if (txn_owner != s && read_owner != s) rwlock_rdlock(&s->lock); }
+static void read_end(MemStore *s) { if (txn_owner != s && read_owner != s) rwlock_rdunlock(&s->lock); }
+
+static void sync_log(MemStore *s) {
+    if (!s->log) return;
+    if (fflush(s->log) != 0) {
+        log_message("memory store: failed to flush append log", LOG_ERROR);
+        return;
+    }
+    if (!s->fsync_log) return;
+#ifdef _WIN32
+    _commit(_fileno(s->log));
+#else
+    fsync(fileno(s->log));
+#endif
+}
+
+static void write_begin(MemStore *s) { if (txn_owner != s) rwlock_wrlock(&s->lock); }
+static void write_end(MemStore *s) {
+    if (txn_owner == s) return;
+    sync_log(s);
+    rwlock_wrunlock(&s->lock);
+}
+
+static char *dup_str(const char *str) {
+    if (!str) return NULL;
+    size_t n = strlen(str) + 1;
+    char *d = malloc(n);
+    if (d) memcpy(d, str, n);
+    return d;
+}
+
+// Replace *dst with a copy of src; false (and *dst untouched) if out of memory
+static bool set_str(char **dst, const char *src) {
+    char *copy = dup_str(src);
+    if (src && !copy) return false;
+    free(*dst);
+    *dst = copy;
+    return true;
+}
+
+// SQLite LIKE: case-insensitive for ASCII, % matches any run, _ one character
+static bool like_match(const char *pattern, const char *text) {
+    const char *star_p = NULL, *star_t = NULL;
+    while (*text) {
+        if (*pattern == '%') {
+            star_p = ++pattern;
+            star_t = text;
+        } else if (*pattern && (*pattern == '_' || tolower((unsigned char)*pattern) == tolower((unsigned char)*text))) {
+            pattern++;
+            text++;
+        } else if (star_p) {
+            pattern = star_p;
+            text = ++star_t;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '%') pattern++;
+    return *pattern == '\0';
+}
+
+static void to_course(const MemCourse *m, Course *c) {
+    *c = (Course){
+        .course_id = m->course_id,
+        .name = m->name,
+        .type = m->type,
+        .total_hours = m->total_hours,
+        .lecture_hours = m->lecture_hours,
+        .lab_hours = m->lab_hours,
+        .credit = m->credit,
+        .semester = m->semester,
+    };
+}
+
+static void to_student(const MemStudent *m, Student *st) {
+    *st = (Student){
+        .student_id = m->student_id,
+        .name = m->name,
+        .email = m->email,
+        .credits = m->credits,
+    };
+}
+
+static void free_course(MemCourse *c) {
+    free(c->course_id);
+    free(c->name);
+    free(c->type);
+    free(c->semester);
+    vec_free(&c->students);
+    free(c);
+}
+
+static void free_student(MemStudent *st) {
+    free(st->student_id);
+    free(st->name);
+    free(st->email);
+    vec_free(&st->courses);
+    free(st);
+}
+
+#pragma region Append log
+
+static bool put_bytes(MemStore *s, FILE *f, const void *p, size_t n) {
+    if (fwrite(p, 1, n, f) != n) return false;
+    if (f == s->log) s->log_bytes += n;
+    return true;
+}
+
+static bool put_u8(MemStore *s, FILE *f, uint8_t v) { return put_bytes(s, f, &v, 1); }
+static bool put_f64(MemStore *s, FILE *f, double v) { return put_bytes(s, f, &v, sizeof(v)); }
+
+static bool put_str(MemStore *s, FILE *f, const char *str) {
+    uint32_t len = str ? (uint32_t)strlen(str) : NULL_STR_LEN;
+    if (!put_bytes(s, f, &len, sizeof(len))) return false;
+    return !str || put_bytes(s, f, str, len);
+}
+
+static bool get_bytes(FILE *f, void *p, size_t n) { return fread(p, 1, n, f) == n; }
+static bool get_f64(FILE *f, double *v) { return get_bytes(f, v, sizeof(*v)); }
+
+static bool get_str(FILE *f, char **out) {
+    uint32_t len;
+    *out = NULL;
+    if (!get_bytes(f, &len, sizeof(len))) return false;
+    if (len == NULL_STR_LEN) return true;
+    char *str = malloc((size_t)len + 1);
+    if (!str) return false;
+    if (!get_bytes(f, str, len)) { free(str); return false; }
+    str[len] = '\0';
+    *out = str;
+    return true;
+}
+
+static bool put_course(MemStore *s, FILE *f, MemOp op, const Course *c) {
+    return put_u8(s, f, (uint8_t)op)
+        && put_str(s, f, c->course_id) && put_str(s, f, c->name) && put_str(s, f, c->type)
+        && put_f64(s, f, c->total_hours) && put_f64(s, f, c->lecture_hours)
+        && put_f64(s, f, c->lab_hours) && put_f64(s, f, c->credit)
+        && put_str(s, f, c->semester);
+}
+
+static bool put_student(MemStore *s, FILE *f, MemOp op, const Student *st) {
+    return put_u8(s, f, (uint8_t)op)
+        && put_str(s, f, st->student_id) && put_str(s, f, st->name) && put_str(s, f, st->email)
+        && put_f64(s, f, st->credits);
+}
+
+// b == NULL for records that carry a single ID
+static bool put_ids(MemStore *s, FILE *f, MemOp op, const char *a, const char *b) {
+    return put_u8(s, f, (uint8_t)op) && put_str(s, f, a) && (!b || put_str(s, f, b));
+}
+
+static void log_write_failed(void) {
+    log_message("memory store: failed to append to log", LOG_ERROR);
+}
+
+static void log_course(MemStore *s, MemOp op, const Course *c) {
+    if (s->log && !put_course(s, s->log, op, c)) log_write_failed();
+}
+
+static void log_student(MemStore *s, MemOp op, const Student *st) {
+    if (s->log && !put_student(s, s->log, op, st)) log_write_failed();
+}
+
+static void log_ids(MemStore *s, MemOp op, const char *a, const char *b) {
+    if (s->log && !put_ids(s, s->log, op, a, b)) log_write_failed();
+}
+
+static void log_op(MemStore *s, MemOp op) {
+    if (s->log && !put_u8(s, s->log, (uint8_t)op)) log_write_failed();
+}
+
+static bool write_header(MemStore *s, FILE *f, const char *magic, uint64_t generation) {
+    return put_bytes(s, f, magic, 8) && put_bytes(s, f, &generation, sizeof(generation));
+}
+
+static bool read_header(FILE *f, const char *magic, uint64_t *generation) {
+    char buf[8];
+    return get_bytes(f, buf, sizeof(buf)) && memcmp(buf, magic, sizeof(buf)) == 0
+        && get_bytes(f, generation, sizeof(*generation));
+}
+
+#pragma endregion Append log
+
+#pragma region Mutations
+
+// Apply functions change memory only; callers hold the write lock and log on success
+
+static bool apply_course_add(MemStore *s, const Course *c) {
+    if (!c->course_id || table_get(&s->courses, c->course_id)) return false;
+    MemCourse *m = calloc(1, sizeof(*m));
+    if (!m) return false;
+    m->course_id = dup_str(c->course_id);
+    m->total_hours = c->total_hours;
+    m->lecture_hours = c->lecture_hours;
+    m->lab_hours = c->lab_hours;
+    m->credit = c->credit;
+    if (!m->course_id || !set_str(&m->name, c->name) || !set_str(&m->type, c->type)
+        || !set_str(&m->semester, c->semester) || !table_insert(&s->courses, m)) {
+        free_course(m);
+        return false;
+    }
+    return true;
+}
+
+static bool apply_course_update(MemStore *s, const Course *c) {
+    MemCourse *m = table_get(&s->courses, c->course_id);
+    if (!m) return true;    // UPDATE of a missing row is not an error
+    char *name = dup_str(c->name), *type = dup_str(c->type), *semester = dup_str(c->semester);
+    if ((c->name && !name) || (c->type && !type) || (c->semester && !semester)) {
+        free(name); free(type); free(semester);
+        return false;
+    }
+    free(m->name); m->name = name;
+    free(m->type); m->type = type;
+    free(m->semester); m->semester = semester;
+    m->total_hours = c->total_hours;
+    m->lecture_hours = c->lecture_hours;
+    m->lab_hours = c->lab_hours;
+    m->credit = c->credit;
+    s->courses.generation++;
+    return true;
+}
+
+static bool apply_course_remove(MemStore *s, const char *course_id) {
+    MemCourse *m = table_get(&s->courses, course_id);
+    if (!m) return true;
+    // Like the SQLite schema, dropping a course's enrollments leaves credits alone
+    for (size_t i = 0; i < m->students.count; i++) {
+        MemStudent *st = m->students.items[i];
+        vec_remove_sorted(&st->courses, m->course_id);
+    }
+    table_unlink(&s->courses, m->course_id);
+    free_course(m);
+    return true;
+}
+
+static bool apply_course_remove_all(MemStore *s) {
+    for (size_t i = 0; i < s->students.rows.count; i++) {
+        MemStudent *st = s->students.rows.items[i];
+        st->courses.count = 0;
+    }
+    for (size_t i = 0; i < s->courses.rows.count; i++) free_course(s->courses.rows.items[i]);
+    table_reset(&s->courses);
+    return true;
+}
+
+static bool apply_student_add(MemStore *s, const Student *st) {
+    // NOT NULL name and CHECK(credits >= 0.0) from the SQLite schema
+    if (!st->student_id || !st->name || st->credits < 0.0) return false;
+    if (table_get(&s->students, st->student_id)) return false;
+    MemStudent *m = calloc(1, sizeof(*m));
+    if (!m) return false;
+    m->student_id = dup_str(st->student_id);
+    m->credits = st->credits;
+    if (!m->student_id || !set_str(&m->name, st->name) || !set_str(&m->email, st->email)
+        || !table_insert(&s->students, m)) {
+        free_student(m);
+        return false;
+    }
+    return true;
+}
+
+static bool apply_student_update(MemStore *s, const Student *st) {
+    if (!st->name || st->credits < 0.0) return false;
+    MemStudent *m = table_get(&s->students, st->student_id);
+    if (!m) return true;
+    char *name = dup_str(st->name), *email = dup_str(st->email);
+    if (!name || (st->email && !email)) {
+        free(name); free(email);
+        return false;
+    }
+    free(m->name); m->name = name;
+    free(m->email); m->email = email;
+    m->credits = st->credits;
+    s->students.generation++;
+    return true;
+}
+
+static bool apply_student_remove(MemStore *s, const char *student_id) {
+    MemStudent *m = table_get(&s->students, student_id);
+    if (!m) return true;
+    for (size_t i = 0; i < m->courses.count; i++) {
+        MemCourse *c = m->courses.items[i];
+        vec_remove_sorted(&c->students, m->student_id);
+    }
+    table_unlink(&s->students, m->student_id);
+    free_student(m);
+    return true;
+}
+
+static bool apply_student_remove_all(MemStore *s) {
+    for (size_t i = 0; i < s->courses.rows.count; i++) {
+        MemCourse *c = s->courses.rows.items[i];
+        c->students.count = 0;
+    }
+    for (size_t i = 0; i < s->students.rows.count; i++) free_student(s->students.rows.items[i]);
+    table_reset(&s->students);
+    return true;
+}
+
+// with_credit is false when restoring a snapshot, whose student credits are already final
+static bool apply_enrollment_link(MemStore *s, const char *student_id, const char *course_id, bool with_credit) {
+    MemStudent *st = table_get(&s->students, student_id);
+    MemCourse *c = table_get(&s->courses, course_id);
+    if (!st || !c || vec_contains(&st->courses, c->course_id)) return false;
+    double credits = with_credit ? st->credits + c->credit : st->credits;
+    if (credits < 0.0) return false;
+    if (!vec_reserve(&st->courses, st->courses.count + 1) || !vec_reserve(&c->students, c->students.count + 1)) return false;
+    vec_insert_sorted(&st->courses, c);
+    vec_insert_sorted(&c->students, st);
+    if (credits != st->credits) {
+        st->credits = credits;
+        s->students.generation++;
+    }
+    return true;
+}
+
+static bool apply_enrollment_remove(MemStore *s, const char *student_id, const char *course_id) {
+    MemStudent *st = table_get(&s->students, student_id);
+    MemCourse *c = table_get(&s->courses, course_id);
+    if (!st || !c || !vec_contains(&st->courses, c->course_id)) return true;
+    if (st->credits - c->credit < 0.0) return false;
+    vec_remove_sorted(&st->courses, c->course_id);
+    vec_remove_sorted(&c->students, st->student_id);
+    st->credits -= c->credit;
+    s->students.generation++;
+    return true;
+}
+
+static bool apply_enrollment_remove_all(MemStore *s) {
+    for (size_t i = 0; i < s->courses.rows.count; i++) {
+        MemCourse *c = s->courses.rows.items[i];
+        c->students.count = 0;
+    }
+    for (size_t i = 0; i < s->students.rows.count; i++) {
+        MemStudent *st = s->students.rows.items[i];
+        st->courses.count = 0;
+        st->credits = 0.0;
+    }
+    s->students.generation++;
+    return true;
+}
+
+#pragma endregion Mutations
+
+#pragma region Snapshots
+
+static bool replay(MemStore *s, FILE *f, long *records) {
+    *records = 0;
+    for (;;) {
+        uint8_t op;
+        if (!get_bytes(f, &op, 1)) return true;
+
+        bool ok = true;
+        switch ((MemOp)op) {
+        case MEM_OP_COURSE_ADD:
+        case MEM_OP_COURSE_UPDATE: {
+            char *id = NULL, *name = NULL, *type = NULL, *semester = NULL;
+            Course c = { 0 };
+            ok = get_str(f, &id) && get_str(f, &name) && get_str(f, &type)
+              && get_f64(f, &c.total_hours) && get_f64(f, &c.lecture_hours)
+              && get_f64(f, &c.lab_hours) && get_f64(f, &c.credit) && get_str(f, &semester);
+            if (ok) {
+                c.course_id = id; c.name = name; c.type = type; c.semester = semester;
+                if (op == MEM_OP_COURSE_ADD) apply_course_add(s, &c);
+                else apply_course_update(s, &c);
+            }
+            free(id); free(name); free(type); free(semester);
+            break;
+        }
+        case MEM_OP_STUDENT_ADD:
+        case MEM_OP_STUDENT_UPDATE: {
+            char *id = NULL, *name = NULL, *email = NULL;
+            Student st = { 0 };
+            ok = get_str(f, &id) && get_str(f, &name) && get_str(f, &email) && get_f64(f, &st.credits);
+            if (ok) {
+                st.student_id = id; st.name = name; st.email = email;
+                if (op == MEM_OP_STUDENT_ADD) apply_student_add(s, &st);
+                else apply_student_update(s, &st);
+            }
+            free(id); free(name); free(email);
+            break;
+        }
+        case MEM_OP_COURSE_REMOVE:
+        case MEM_OP_STUDENT_REMOVE: {
+            char *id = NULL;
+            ok = get_str(f, &id) && id;
+            if (ok && op == MEM_OP_COURSE_REMOVE) apply_course_remove(s, id);
+            else if (ok) apply_student_remove(s, id);
+            free(id);
+            break;
+        }
+        case MEM_OP_ENROLLMENT_ADD:
+        case MEM_OP_ENROLLMENT_REMOVE:
+        case MEM_OP_ENROLLMENT_LINK: {
+            char *student_id = NULL, *course_id = NULL;
+            ok = get_str(f, &student_id) && get_str(f, &course_id) && student_id && course_id;
+            if (ok && op == MEM_OP_ENROLLMENT_REMOVE) apply_enrollment_remove(s, student_id, course_id);
+            else if (ok) apply_enrollment_link(s, student_id, course_id, op == MEM_OP_ENROLLMENT_ADD);
+            free(student_id); free(course_id);
+            break;
+        }
+        case MEM_OP_COURSE_REMOVE_ALL: apply_course_remove_all(s); break;
+        case MEM_OP_STUDENT_REMOVE_ALL: apply_student_remove_all(s); break;
+        case MEM_OP_ENROLLMENT_REMOVE_ALL: apply_enrollment_remove_all(s); break;
+        default: ok = false; break;
+        }
+
+        // A torn record at the tail is what a crash mid-append looks like
+        if (!ok) return false;
+        (*records)++;
+    }
+}
+
+static bool load(MemStore *s) {
+    uint64_t generation = 0;
+    long records;
+
+    FILE *f = fopen(s->path, "rb");
+    if (f) {
+        if (!read_header(f, SNAPSHOT_MAGIC, &generation)) {
+            fclose(f);
+            log_message("memory store: snapshot header is invalid", LOG_ERROR);
+            return false;
+        }
+        if (!replay(s, f, &records)) {
+            fclose(f);
+            log_message("memory store: snapshot is truncated or corrupt", LOG_ERROR);
+            return false;
+        }
+        fclose(f);
+    }
+    s->generation = generation;
+
+    f = fopen(s->log_path, "rb");
+    if (!f) return true;
+    uint64_t log_generation;
+    if (read_header(f, LOG_MAGIC, &log_generation) && log_generation == generation) {
+        char buf[128];
+        bool complete = replay(s, f, &records);
+        snprintf(buf, sizeof(buf), "memory store: replayed %ld log records%s", records,
+                 complete ? "" : " (ignored torn tail)");
+        log_message(buf, complete ? LOG_INFO : LOG_WARN);
+    }
+    fclose(f);
+    return true;
+}
+
+// Caller holds the lock (read is enough: writers are the only other log users)
+static bool snapshot(MemStore *s) {
+    uint64_t generation = s->generation + 1;
+    FILE *f = fopen(s->tmp_path, "wb");
+    if (!f) {
+        log_message("memory store: cannot create snapshot file", LOG_ERROR);
+        return false;
+    }
+
+    bool ok = write_header(s, f, SNAPSHOT_MAGIC, generation);
+    for (size_t i = 0; ok && i < s->courses.rows.count; i++) {
+        Course c;
+        to_course(s->courses.rows.items[i], &c);
+        ok = put_course(s, f, MEM_OP_COURSE_ADD, &c);
+    }
+    for (size_t i = 0; ok && i < s->students.rows.count; i++) {
+        Student st;
+        to_student(s->students.rows.items[i], &st);
+        ok = put_student(s, f, MEM_OP_STUDENT_ADD, &st);
+    }
+    for (size_t i = 0; ok && i < s->students.rows.count; i++) {
+        MemStudent *st = s->students.rows.items[i];
+        for (size_t j = 0; ok && j < st->courses.count; j++) {
+            ok = put_ids(s, f, MEM_OP_ENROLLMENT_LINK, st->student_id, rec_id(st->courses.items[j]));
+        }
+    }
+    ok = fflush(f) == 0 && ok;
+#ifdef _WIN32
+    if (ok) _commit(_fileno(f));
+#else
+    if (ok) fsync(fileno(f));
+#endif
+    ok = fclose(f) == 0 && ok;
+#ifdef _WIN32
+    if (ok) remove(s->path);
+#endif
+    if (!ok || rename(s->tmp_path, s->path) != 0) {
+        remove(s->tmp_path);
+        log_message("memory store: failed to write snapshot", LOG_ERROR);
+        return false;
+    }
+
+    // The old log is now folded into the snapshot; start a new one
+    if (s->log) fclose(s->log);
+    s->log = fopen(s->log_path, "wb");
+    s->generation = generation;
+    if (!s->log || !write_header(s, s->log, LOG_MAGIC, generation)) {
+        log_message("memory store: cannot open append log", LOG_ERROR);
+        return false;
+    }
+    s->log_bytes = 0;
+    sync_log(s);
+    return true;
+}
+
+static void snapshot_loop(void *arg) {
+    MemStore *s = arg;
+    mutex_lock(&s->snapshot_lock);
+    while (!s->stopping) {
+        cond_timedwait(&s->snapshot_wake, &s->snapshot_lock, s->snapshot_interval_s * 1000);
+        if (s->stopping) break;
+        mutex_unlock(&s->snapshot_lock);
+
+        rwlock_rdlock(&s->lock);
+        if (s->log_bytes > 0) snapshot(s);
+        rwlock_rdunlock(&s->lock);
+
+        mutex_lock(&s->snapshot_lock);
+    }
+    mutex_unlock(&s->snapshot_lock);
+}
+
+#pragma endregion Snapshots
+
+#pragma region Store ops
+
+static void memory_close(DbStore *self) {
+    MemStore *s = (MemStore *)self;
+    log_message("Closing database...", LOG_INFO);
+
+    if (s->snapshot_running) {
+        mutex_lock(&s->snapshot_lock);
+        s->stopping = true;
+        cond_broadcast(&s->snapshot_wake);
+        mutex_unlock(&s->snapshot_lock);
+        thread_join(s->snapshot_thread);
+    }
+
+    rwlock_wrlock(&s->lock);
+    if (s->log_bytes > 0) snapshot(s);
+    if (s->log) fclose(s->log);
+    apply_course_remove_all(s);
+    apply_student_remove_all(s);
+    rwlock_wrunlock(&s->lock);
+
+    table_free(&s->courses);
+    table_free(&s->students);
+    rwlock_destroy(&s->lock);
+    mutex_destroy(&s->snapshot_lock);
+    cond_destroy(&s->snapshot_wake);
+    free(s->path);
+    free(s->log_path);
+    free(s->tmp_path);
+    free(s);
+}
+
+static bool memory_begin(DbStore *self) {
+    MemStore *s = (MemStore *)self;
+    if (txn_owner == s) return false;
+    rwlock_wrlock(&s->lock);
+    txn_owner = s;
+    return true;
+}
+
+static bool memory_commit(DbStore *self) {
+    MemStore *s = (MemStore *)self;
+    if (txn_owner != s) return false;
+    txn_owner = NULL;
+    sync_log(s);
+    rwlock_wrunlock(&s->lock);
+    return true;
+}
+
+// Failed mutations never change anything, so there is nothing to undo here
+static bool memory_rollback(DbStore *self) {
+    return memory_commit(self);
+}
+
+static bool memory_read_begin(DbStore *self) {
+    MemStore *s = (MemStore *)self;
+    if (txn_owner == s || read_owner == s) return false;
+    rwlock_rdlock(&s->lock);
+    read_owner = s;
+    return true;
+}
+
+static bool memory_read_end(DbStore *self) {
+    MemStore *s = (MemStore *)self;
+    if (read_owner != s) return false;
+    read_owner = NULL;
+    rwlock_rdunlock(&s->lock);
+    return true;
+}
+
+static bool memory_course_add(DbStore *self, const Course *c) {
+    MemStore *s = (MemStore *)self;
+    write_begin(s);
+    bool ok = apply_course_add(s, c);
+    if (ok) log_course(s, MEM_OP_COURSE_ADD, c);
+    write_end(s);
+    return ok;
+}
+
+static bool memory_course_update(DbStore *self, const Course *c) {
+    MemStore *s = (MemStore *)self;
+    write_begin(s);
+    bool ok = apply_course_update(s, c);
+    if (ok) log_course(s, MEM_OP_COURSE_UPDATE, c);
+    write_end(s);
+    return ok;
+}
+
+static bool memory_course_remove(DbStore *self, const char *course_id) {
+    MemStore *s = (MemStore *)self;
+    write_begin(s);
+    bool ok = apply_course_remove(s, course_id);
+    if (ok) log_ids(s, MEM_OP_COURSE_REMOVE, course_id, NULL);
+    write_end(s);
+    return ok;
+}
+
+static bool memory_course_remove_all(DbStore *self) {
+    MemStore *s = (MemStore *)self;
+    write_begin(s);
+    bool ok = apply_course_remove_all(s);
+    if (ok) log_op(s, MEM_OP_COURSE_REMOVE_ALL);
+    write_end(s);
+    return ok;
+}
+
+static bool page_visible(const QueryOptions *opt, size_t *skipped, size_t *emitted) {
+    if (opt && opt->limit > 0 && *emitted >= (size_t)opt->limit) return false;
+    if (opt && opt->offset > 0 && *skipped < (size_t)opt->offset) {
+        (*skipped)++;
+        return false;
+    }
+    (*emitted)++;
+    return true;
+}
+
+static bool page_full(const QueryOptions *opt, size_t emitted) {
+    return opt && opt->limit > 0 && emitted >= (size_t)opt->limit;
+}
+
+static bool memory_course_list(DbStore *self, const QueryOptions *opt, CourseVisitor visitor, void *user) {
+    return self->ops->course_find(self, DB_FIND_NAME, NULL, opt, visitor, user);
+}
+
+static bool memory_course_find(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, CourseVisitor visitor, void *user) {
+    MemStore *s = (MemStore *)self;
+    size_t skipped = 0, emitted = 0;
+    read_begin(s);
+
+    if (field == DB_FIND_COURSE_ID) {
+        MemCourse *m = table_get(&s->courses, value);
+        if (m && page_visible(opt, &skipped, &emitted)) {
+            Course c;
+            to_course(m, &c);
+            visitor(&c, user);
+        }
+        read_end(s);
+        return true;
+    }
+
+    // value == NULL lists everything
+    size_t offset = field == DB_FIND_TYPE ? offsetof(MemCourse, type)
+                  : field == DB_FIND_SEMESTER ? offsetof(MemCourse, semester)
+                  : offsetof(MemCourse, name);
+    bool valid = opt && opt->order_by && db_valid_order(DB_ENTITY_COURSE, opt->order_by);
+    bool desc = valid && opt->order == SORT_DESC;
+    PtrVec scratch;
+    const PtrVec *rows = table_view(&s->courses, valid ? column_index(&s->courses, opt->order_by) : 0, &scratch);
+
+    for (size_t i = 0; i < rows->count && !page_full(opt, emitted); i++) {
+        MemCourse *m = rows->items[desc ? rows->count - 1 - i : i];
+        if (value) {
+            const char *col = *(char **)((char *)m + offset);
+            if (!col || !like_match(value, col)) continue;
+        }
+        if (!page_visible(opt, &skipped, &emitted)) continue;
+        Course c;
+        to_course(m, &c);
+        visitor(&c, user);
+    }
+    read_end(s);
+    return true;
+}
+
+static bool memory_enrollment_add(DbStore *self, const Enrollment *e) {
+    MemStore *s = (MemStore *)self;
+    write_begin(s);
+    bool ok = apply_enrollment_link(s, e->student_id, e->course_id, true);
+    if (ok) log_ids(s, MEM_OP_ENROLLMENT_ADD, e->student_id, e->course_id);
+    write_end(s);
+    return ok;
+}
+
+static bool memory_enrollment_remove(DbStore *self, const char *student_id, const char *course_id) {
+    MemStore *s = (MemStore *)self;
+    write_begin(s);
+    bool ok = apply_enrollment_remove(s, student_id, course_id);
+    if (ok) log_ids(s, MEM_OP_ENROLLMENT_REMOVE, student_id, course_id);
+    write_end(s);
+    return ok;
+}
+
+static bool memory_enrollment_remove_all(DbStore *self) {
+    MemStore *s = (MemStore *)self;
+    write_begin(s);
+    bool ok = apply_enrollment_remove_all(s);
+    if (ok) log_op(s, MEM_OP_ENROLLMENT_REMOVE_ALL);
+    write_end(s);
+    return ok;
+}
+
+// Visit one side of the inverted index; owners/others are MemStudent/MemCourse in either role
+static void visit_links(const PtrVec *owners, bool by_course, bool desc, const QueryOptions *opt,
+                        size_t *skipped, size_t *emitted, EnrollmentVisitor visitor, void *user) {
+    for (size_t i = 0; i < owners->count && !page_full(opt, *emitted); i++) {
+        void *owner = owners->items[desc ? owners->count - 1 - i : i];
+        const PtrVec *links = by_course ? &((MemCourse *)owner)->students : &((MemStudent *)owner)->courses;
+        for (size_t j = 0; j < links->count && !page_full(opt, *emitted); j++) {
+            void *other = links->items[desc ? links->count - 1 - j : j];
+            if (!page_visible(opt, skipped, emitted)) continue;
+            Enrollment e = {
+                .course_id = rec_id(by_course ? owner : other),
+                .student_id = rec_id(by_course ? other : owner),
+            };
+            visitor(&e, user);
+        }
+    }
+}
+
+static bool memory_enrollment_list(DbStore *self, const QueryOptions *opt, EnrollmentVisitor visitor, void *user) {
+    MemStore *s = (MemStore *)self;
+    size_t skipped = 0, emitted = 0;
+    bool valid = opt && opt->order_by && db_valid_order(DB_ENTITY_ENROLLMENT, opt->order_by);
+    bool by_course = valid && strcmp(opt->order_by, "course_id") == 0;
+    bool desc = valid && opt->order == SORT_DESC;
+
+    read_begin(s);
+    visit_links(by_course ? &s->courses.rows : &s->students.rows, by_course, desc, opt, &skipped, &emitted, visitor, user);
+    read_end(s);
+    return true;
+}
+
+static bool memory_enrollment_find(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, EnrollmentVisitor visitor, void *user) {
+    MemStore *s = (MemStore *)self;
+    size_t skipped = 0, emitted = 0;
+    bool by_course = field == DB_FIND_COURSE_ID;
+    if (!by_course && field != DB_FIND_STUDENT_ID) return false;
+    bool desc = opt && opt->order_by && db_valid_order(DB_ENTITY_ENROLLMENT, opt->order_by) && opt->order == SORT_DESC;
+
+    read_begin(s);
+    void *owner = table_get(by_course ? &s->courses : &s->students, value);
+    if (owner) {
+        PtrVec one = { &owner, 1, 1 };
+        visit_links(&one, by_course, desc, opt, &skipped, &emitted, visitor, user);
+    }
+    read_end(s);
+    return true;
+}
+
+static bool memory_student_add(DbStore *self, const Student *st) {
+    MemStore *s = (MemStore *)self;
+    write_begin(s);
+    bool ok = apply_student_add(s, st);
+    if (ok) log_student(s, MEM_OP_STUDENT_ADD, st);
+    write_end(s);
+    return ok;
+}
+
+static bool memory_student_update(DbStore *self, const Student *st) {
+    MemStore *s = (MemStore *)self;
+    write_begin(s);
+    bool ok = apply_student_update(s, st);
+    if (ok) log_student(s, MEM_OP_STUDENT_UPDATE, st);
+    write_end(s);
+    return ok;
+}
+
+static bool memory_student_remove(DbStore *self, const char *student_id) {
+    MemStore *s = (MemStore *)self;
+    write_begin(s);
+    bool ok = apply_student_remove(s, student_id);
+    if (ok) log_ids(s, MEM_OP_STUDENT_REMOVE, student_id, NULL);
+    write_end(s);
+    return ok;
+}
+
+static bool memory_student_remove_all(DbStore *self) {
+    MemStore *s = (MemStore *)self;
+    write_begin(s);
+    bool ok = apply_student_remove_all(s);
+    if (ok) log_op(s, MEM_OP_STUDENT_REMOVE_ALL);
+    write_end(s);
+    return ok;
+}
+
+static bool memory_student_list(DbStore *self, const QueryOptions *opt, StudentVisitor visitor, void *user) {
+    return self->ops->student_find(self, DB_FIND_NAME, NULL, opt, visitor, user);
+}
+
+static bool memory_student_find(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, StudentVisitor visitor, void *user) {
+    MemStore *s = (MemStore *)self;
+    size_t skipped = 0, emitted = 0;
+    read_begin(s);
+
+    if (field == DB_FIND_STUDENT_ID) {
+        MemStudent *m = table_get(&s->students, value);
+        if (m && page_visible(opt, &skipped, &emitted)) {
+            Student st;
+            to_student(m, &st);
+            visitor(&st, user);
+        }
+        read_end(s);
+        return true;
+    }
+
+    // value == NULL lists everything
+    bool valid = opt && opt->order_by && db_valid_order(DB_ENTITY_STUDENT, opt->order_by);
+    bool desc = valid && opt->order == SORT_DESC;
+    PtrVec scratch;
+    const PtrVec *rows = table_view(&s->students, valid ? column_index(&s->students, opt->order_by) : 0, &scratch);
+
+    for (size_t i = 0; i < rows->count && !page_full(opt, emitted); i++) {
+        MemStudent *m = rows->items[desc ? rows->count - 1 - i : i];
+        if (value && !like_match(value, m->name)) continue;
+        if (!page_visible(opt, &skipped, &emitted)) continue;
+        Student st;
+        to_student(m, &st);
+        visitor(&st, user);
+    }
+    read_end(s);
+    return true;
+}
+
+#pragma endregion Store ops
+
+static const DbStoreOps memory_ops = {
+    .name = "memory",
+    .close = memory_close,
+    .begin = memory_begin,
+    .commit = memory_commit,
+    .rollback = memory_rollback,
+    .read_begin = memory_read_begin,
+    .read_end = memory_read_end,
+
+    .course_add = memory_course_add,
+    .course_update = memory_course_update,
+    .course_remove = memory_course_remove,
+    .course_remove_all = memory_course_remove_all,
+    .course_list = memory_course_list,
+    .course_find = memory_course_find,
+
+    .enrollment_add = memory_enrollment_add,
+    .enrollment_remove = memory_enrollment_remove,
+    .enrollment_remove_all = memory_enrollment_remove_all,
+    .enrollment_list = memory_enrollment_list,
+    .enrollment_find = memory_enrollment_find,
+
+    .student_add = memory_student_add,
+    .student_update = memory_student_update,
+    .student_remove = memory_student_remove,
+    .student_remove_all = memory_student_remove_all,
+    .student_list = memory_student_list,
+    .student_find = memory_student_find,
+};
+
+static char *path_with_suffix(const char *path, const char *suffix) {
+    size_t n = strlen(path), m = strlen(suffix);
+    char *out = malloc(n + m + 1);
+    if (!out) return NULL;
+    memcpy(out, path, n);
+    memcpy(out + n, suffix, m + 1);
+    return out;
+}
+
+DbStore *db_memory_open(const char *path) {
+    log_message("Initializing in-memory database...", LOG_INFO);
+
+    MemStore *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->base.ops = &memory_ops;
+    rwlock_init(&s->lock);
+    mutex_init(&s->snapshot_lock);
+    cond_init(&s->snapshot_wake);
+    table_init(&s->courses, course_columns);
+    table_init(&s->students, student_columns);
+    s->fsync_log = env_long("CURRICULUM_MEMORY_FSYNC", 0) != 0;
+    s->snapshot_interval_s = (int)env_long("CURRICULUM_SNAPSHOT_INTERVAL_S", 60);
+    s->path = path_with_suffix(path, "");
+    s->log_path = path_with_suffix(path, ".log");
+    s->tmp_path = path_with_suffix(path, ".tmp");
+
+    // Fold whatever the last run left in the log into a fresh snapshot
+    bool ok = s->path && s->log_path && s->tmp_path && load(s) && snapshot(s);
+    if (ok && s->snapshot_interval_s > 0) {
+        s->snapshot_running = thread_start(&s->snapshot_thread, snapshot_loop, s);
+        ok = s->snapshot_running;
+    }
+    if (!ok) {
+        log_message("Failed to open in-memory database", LOG_ERROR);
+        memory_close(&s->base);
+        return NULL;
+    }
+
+    char buf[160];
+    snprintf(buf, sizeof(buf), "In-memory database ready (%zu courses, %zu students, snapshot every %ds)",
+             s->courses.rows.count, s->students.rows.count, s->snapshot_interval_s);
+    log_message(buf, LOG_INFO);
+    return &s->base;
+}
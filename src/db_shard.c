@@ -0,0 +1,610 @@
+#include "db_backend.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Sharded storage engine: K sqlite stores, one database file each.
+ *
+ * Students and their enrollments live in the shard db_shard_of(student_id)
+ * picks, so a per-student write touches one file and the writer of each shard
+ * (see writer.h) commits independently. Courses are written to every shard:
+ * enrollments check their course and credits are recomputed inside one file,
+ * and course reads are served by shard 0. Writes that span shards (course
+ * writes, remove_all, remove_batch) lock the shards in index order, so two of
+ * them never wait on each other crosswise.
+ *
+ * A transaction or savepoint starts on a shard only when the first write
+ * reaches it, so a writer batch for one shard never locks the others. Commit
+ * is atomic per shard, not across shards: a failure in the middle of a course
+ * write's commit may leave the shards that already committed ahead.
+ *
+ * Reads keyed by student go to one shard. Other student and enrollment reads
+ * open a cursor on every shard: with an order_by, each shard sorts and stops
+ * at offset + limit rows and a k-way merge takes the smallest head in turn;
+ * without one, the shards are read one after another. Either way the merge
+ * applies offset and limit to the combined rows. Rows that tie on order_by
+ * come lower shard first, so their order (like the order of unsorted reads)
+ * can differ from that of a single file.
+ */
+
+typedef struct {
+    DbStore base;
+    int count;
+    DbStore *shards[DB_SHARDS_MAX];
+} ShardStore;
+
+#define SHARD_BIT(i) (1u << (i))
+
+// Transaction state of the calling thread; bits are shards that joined it
+static _Thread_local struct {
+    bool in_txn;
+    bool in_savepoint;
+    unsigned began;
+    unsigned saved;
+    unsigned reading;
+} tx;
+
+static DbStore *shard(ShardStore *s, int i) {
+    return s->shards[i];
+}
+
+// Joins shard i to the calling thread's open transaction and savepoint before a write
+static bool touch(ShardStore *s, int i) {
+    DbStore *c = shard(s, i);
+    if (tx.in_txn && !(tx.began & SHARD_BIT(i))) {
+        if (!c->ops->begin(c)) return false;
+        tx.began |= SHARD_BIT(i);
+    }
+    if (tx.in_savepoint && !(tx.saved & SHARD_BIT(i))) {
+        if (!c->ops->savepoint(c)) return false;
+        tx.saved |= SHARD_BIT(i);
+    }
+    return true;
+}
+
+#pragma region Connections and transactions
+
+static void shard_close(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) shard(s, i)->ops->close(shard(s, i));
+    free(s);
+}
+
+static void shard_thread_close(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) shard(s, i)->ops->thread_close(shard(s, i));
+}
+
+static bool shard_thread_open(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) {
+        if (!shard(s, i)->ops->thread_open(shard(s, i))) {
+            shard_thread_close(self);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool shard_begin(DbStore *self) {
+    (void)self;
+    tx.in_txn = true;
+    tx.began = 0;
+    return true;
+}
+
+static bool shard_rollback(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    bool ok = true;
+    for (int i = 0; i < s->count; i++) {
+        if (tx.began & SHARD_BIT(i)) ok = shard(s, i)->ops->rollback(shard(s, i)) && ok;
+    }
+    tx.in_txn = tx.in_savepoint = false;
+    tx.began = tx.saved = 0;
+    return ok;
+}
+
+// A shard that committed is dropped from the set, so a rollback after a failure leaves it alone
+static bool shard_commit(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) {
+        if (!(tx.began & SHARD_BIT(i))) continue;
+        if (!shard(s, i)->ops->commit(shard(s, i))) return false;
+        tx.began &= ~SHARD_BIT(i);
+    }
+    tx.in_txn = false;
+    return true;
+}
+
+static bool shard_savepoint(DbStore *self) {
+    (void)self;
+    tx.in_savepoint = true;
+    tx.saved = 0;
+    return true;
+}
+
+static bool shard_release_savepoint(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    bool ok = true;
+    for (int i = 0; i < s->count; i++) {
+        if (tx.saved & SHARD_BIT(i)) ok = shard(s, i)->ops->release_savepoint(shard(s, i)) && ok;
+    }
+    tx.in_savepoint = false;
+    tx.saved = 0;
+    return ok;
+}
+
+static bool shard_rollback_savepoint(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    bool ok = true;
+    for (int i = 0; i < s->count; i++) {
+        if (tx.saved & SHARD_BIT(i)) ok = shard(s, i)->ops->rollback_savepoint(shard(s, i)) && ok;
+    }
+    tx.in_savepoint = false;
+    tx.saved = 0;
+    return ok;
+}
+
+static bool shard_read_end(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    bool ok = true;
+    for (int i = 0; i < s->count; i++) {
+        if (tx.reading & SHARD_BIT(i)) ok = shard(s, i)->ops->read_end(shard(s, i)) && ok;
+    }
+    tx.reading = 0;
+    return ok;
+}
+
+// Snapshots are taken one shard after another, so they are consistent per shard only
+static bool shard_read_begin(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    tx.reading = 0;
+    for (int i = 0; i < s->count; i++) {
+        if (!shard(s, i)->ops->read_begin(shard(s, i))) {
+            shard_read_end(self);
+            return false;
+        }
+        tx.reading |= SHARD_BIT(i);
+    }
+    return true;
+}
+
+static bool shard_checkpoint(DbStore *self, DbCheckpointMode mode, int *wal_frames, int *checkpointed_frames) {
+    ShardStore *s = (ShardStore *)self;
+    bool ok = true;
+    int log_total = 0, ckpt_total = 0;
+    for (int i = 0; i < s->count; i++) {
+        int log = 0, ckpt = 0;
+        ok = shard(s, i)->ops->checkpoint(shard(s, i), mode, &log, &ckpt) && ok;
+        if (log > 0) log_total += log;
+        if (ckpt > 0) ckpt_total += ckpt;
+    }
+    if (wal_frames) *wal_frames = log_total;
+    if (checkpointed_frames) *checkpointed_frames = ckpt_total;
+    return ok;
+}
+
+static void shard_disable_autocheckpoint(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) shard(s, i)->ops->disable_autocheckpoint(shard(s, i));
+}
+
+static void shard_busy_timeout(DbStore *self, int ms) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) shard(s, i)->ops->busy_timeout(shard(s, i), ms);
+}
+
+#pragma endregion Connections and transactions
+
+#pragma region Merged reads
+
+typedef union {
+    Course course;
+    Student student;
+    Enrollment enrollment;
+} AnyRow;
+
+struct DbCursor {
+    DbEntity entity;
+    const char *order_by;           // NULL: shards in turn
+    bool desc;
+    int offset;                     // applied here, not by the shards
+    int limit;
+    int skipped;
+    int emitted;
+    int count;
+    int current;                    // shards in turn: the one being read
+    struct {
+        DbStore *store;
+        DbCursor *cur;
+        AnyRow row;
+        int state;                  // 1 row held, 0 exhausted, -1 to be fetched
+    } parts[DB_SHARDS_MAX];
+};
+
+typedef struct {
+    bool text;
+    const char *s;
+    double d;
+} SortKey;
+
+static SortKey sort_key(DbEntity entity, const AnyRow *row, const char *col) {
+    SortKey k = { true, NULL, 0.0 };
+    if (entity == DB_ENTITY_COURSE) {
+        const Course *c = &row->course;
+        if (strcmp(col, "course_id") == 0) k.s = c->course_id;
+        else if (strcmp(col, "name") == 0) k.s = c->name;
+        else if (strcmp(col, "type") == 0) k.s = c->type;
+        else if (strcmp(col, "semester") == 0) k.s = c->semester;
+        else {
+            k.text = false;
+            k.d = strcmp(col, "total_hours") == 0 ? c->total_hours
+                : strcmp(col, "lecture_hours") == 0 ? c->lecture_hours
+                : strcmp(col, "lab_hours") == 0 ? c->lab_hours
+                : c->credit;
+        }
+    } else if (entity == DB_ENTITY_STUDENT) {
+        const Student *st = &row->student;
+        if (strcmp(col, "student_id") == 0) k.s = st->student_id;
+        else if (strcmp(col, "name") == 0) k.s = st->name;
+        else if (strcmp(col, "email") == 0) k.s = st->email;
+        else {
+            k.text = false;
+            k.d = st->credits;
+        }
+    } else {
+        k.s = strcmp(col, "course_id") == 0 ? row->enrollment.course_id : row->enrollment.student_id;
+    }
+    return k;
+}
+
+// SQLite's order: NULL first, then text by bytes (the BINARY collation)
+static int compare_rows(const DbCursor *cur, const AnyRow *a, const AnyRow *b) {
+    SortKey ka = sort_key(cur->entity, a, cur->order_by);
+    SortKey kb = sort_key(cur->entity, b, cur->order_by);
+    int c;
+    if (ka.text) {
+        c = !ka.s ? (kb.s ? -1 : 0) : !kb.s ? 1 : strcmp(ka.s, kb.s);
+    } else {
+        c = ka.d < kb.d ? -1 : ka.d > kb.d;
+    }
+    return cur->desc ? -c : c;
+}
+
+static void shard_cursor_close(DbCursor *cur) {
+    if (!cur) return;
+    for (int i = 0; i < cur->count; i++) {
+        if (cur->parts[i].cur) cur->parts[i].store->ops->cursor_close(cur->parts[i].cur);
+    }
+    free(cur);
+}
+
+// Reads keyed by student, and every course read, need one shard
+static int single_shard(DbEntity entity, DbFindField field, const char *value) {
+    if (entity == DB_ENTITY_COURSE) return 0;
+    if (value && field == DB_FIND_STUDENT_ID) return db_shard_of(value);
+    return -1;
+}
+
+static DbCursor *shard_cursor_open(DbStore *self, DbEntity entity, DbFindField field, const char *value, const QueryOptions *opt) {
+    ShardStore *s = (ShardStore *)self;
+    DbCursor *cur = calloc(1, sizeof(*cur));
+    if (!cur) return NULL;
+    cur->entity = entity;
+
+    int only = single_shard(entity, field, value);
+    if (only >= 0) {
+        cur->count = 1;
+        cur->parts[0].store = shard(s, only);
+        cur->parts[0].cur = shard(s, only)->ops->cursor_open(shard(s, only), entity, field, value, opt);
+        cur->parts[0].state = -1;
+        if (!cur->parts[0].cur) {
+            shard_cursor_close(cur);
+            return NULL;
+        }
+        return cur;
+    }
+
+    // Each shard returns at most the rows that could make it into the merged page
+    QueryOptions part = { 0 };
+    if (opt) {
+        cur->offset = opt->offset > 0 ? opt->offset : 0;
+        cur->limit = opt->limit > 0 ? opt->limit : 0;
+        if (opt->order_by && db_valid_order(entity, opt->order_by)) {
+            cur->order_by = opt->order_by;
+            cur->desc = opt->order == SORT_DESC;
+            part.order_by = opt->order_by;
+            part.order = opt->order;
+            part.limit = cur->limit ? cur->offset + cur->limit : 0;
+        }
+    }
+    cur->count = s->count;
+    for (int i = 0; i < s->count; i++) {
+        cur->parts[i].store = shard(s, i);
+        cur->parts[i].cur = shard(s, i)->ops->cursor_open(shard(s, i), entity, field, value, &part);
+        cur->parts[i].state = -1;
+        if (!cur->parts[i].cur) {
+            shard_cursor_close(cur);
+            return NULL;
+        }
+    }
+    return cur;
+}
+
+// Index of the part holding the next row, -1 at the end, -2 on error
+static int next_part(DbCursor *cur) {
+    if (!cur->order_by) {
+        for (; cur->current < cur->count; cur->current++) {
+            int i = cur->current;
+            if (cur->parts[i].state == -1) {
+                cur->parts[i].state = cur->parts[i].store->ops->cursor_next(cur->parts[i].cur, &cur->parts[i].row);
+            }
+            if (cur->parts[i].state < 0) return -2;
+            if (cur->parts[i].state == 1) return i;
+        }
+        return -1;
+    }
+
+    int best = -1;
+    for (int i = 0; i < cur->count; i++) {
+        if (cur->parts[i].state == -1) {
+            cur->parts[i].state = cur->parts[i].store->ops->cursor_next(cur->parts[i].cur, &cur->parts[i].row);
+            if (cur->parts[i].state < 0) return -2;
+        }
+        if (cur->parts[i].state != 1) continue;
+        // Ties go to the lower shard, so pages do not overlap
+        if (best < 0 || compare_rows(cur, &cur->parts[i].row, &cur->parts[best].row) < 0) best = i;
+    }
+    return best;
+}
+
+// The row stays valid until the next call: its shard is only advanced then
+static int shard_cursor_next(DbCursor *cur, void *row) {
+    for (;;) {
+        if (cur->limit && cur->emitted >= cur->limit) return 0;
+        int i = next_part(cur);
+        if (i == -2) return -1;
+        if (i < 0) return 0;
+        cur->parts[i].state = -1;
+        if (cur->skipped < cur->offset) {
+            cur->skipped++;
+            continue;
+        }
+        size_t size = cur->entity == DB_ENTITY_COURSE ? sizeof(Course)
+                    : cur->entity == DB_ENTITY_STUDENT ? sizeof(Student)
+                    : sizeof(Enrollment);
+        memcpy(row, &cur->parts[i].row, size);
+        cur->emitted++;
+        return 1;
+    }
+}
+
+// visitor is the Course/Student/EnrollmentVisitor of the entity
+static bool visit_rows(DbStore *self, DbEntity entity, DbFindField field, const char *value, const QueryOptions *opt, void (*visitor)(void), void *user) {
+    DbCursor *cur = shard_cursor_open(self, entity, field, value, opt);
+    if (!cur) return false;
+    AnyRow row;
+    int rc;
+    while ((rc = shard_cursor_next(cur, &row)) == 1) {
+        switch (entity) {
+            case DB_ENTITY_COURSE: ((CourseVisitor)visitor)(&row.course, user); break;
+            case DB_ENTITY_STUDENT: ((StudentVisitor)visitor)(&row.student, user); break;
+            case DB_ENTITY_ENROLLMENT: ((EnrollmentVisitor)visitor)(&row.enrollment, user); break;
+        }
+    }
+    shard_cursor_close(cur);
+    return rc == 0;
+}
+
+#pragma endregion Merged reads
+
+#pragma region Course
+
+// Courses are the same in every shard: writes go to all of them, reads to shard 0
+
+static bool shard_course_add(DbStore *self, const Course *c) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) {
+        if (!touch(s, i) || !shard(s, i)->ops->course_add(shard(s, i), c)) return false;
+    }
+    return true;
+}
+
+static bool shard_course_update(DbStore *self, const Course *c) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) {
+        if (!touch(s, i) || !shard(s, i)->ops->course_update(shard(s, i), c)) return false;
+    }
+    return true;
+}
+
+static bool shard_course_remove(DbStore *self, const char *course_id) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) {
+        if (!touch(s, i) || !shard(s, i)->ops->course_remove(shard(s, i), course_id)) return false;
+    }
+    return true;
+}
+
+static bool shard_course_remove_all(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) {
+        if (!touch(s, i) || !shard(s, i)->ops->course_remove_all(shard(s, i))) return false;
+    }
+    return true;
+}
+
+static bool shard_course_list(DbStore *self, const QueryOptions *opt, CourseVisitor visitor, void *user) {
+    DbStore *first = shard((ShardStore *)self, 0);
+    return first->ops->course_list(first, opt, visitor, user);
+}
+
+static bool shard_course_find(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, CourseVisitor visitor, void *user) {
+    DbStore *first = shard((ShardStore *)self, 0);
+    return first->ops->course_find(first, field, value, opt, visitor, user);
+}
+
+#pragma endregion Course
+
+#pragma region Enrollment
+
+static bool shard_enrollment_add(DbStore *self, const Enrollment *e) {
+    ShardStore *s = (ShardStore *)self;
+    int i = db_shard_of(e->student_id);
+    return touch(s, i) && shard(s, i)->ops->enrollment_add(shard(s, i), e);
+}
+
+static bool shard_enrollment_remove(DbStore *self, const char *student_id, const char *course_id) {
+    ShardStore *s = (ShardStore *)self;
+    int i = db_shard_of(student_id);
+    return touch(s, i) && shard(s, i)->ops->enrollment_remove(shard(s, i), student_id, course_id);
+}
+
+static bool shard_enrollment_remove_all(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) {
+        if (!touch(s, i) || !shard(s, i)->ops->enrollment_remove_all(shard(s, i))) return false;
+    }
+    return true;
+}
+
+static bool shard_enrollment_list(DbStore *self, const QueryOptions *opt, EnrollmentVisitor visitor, void *user) {
+    return visit_rows(self, DB_ENTITY_ENROLLMENT, DB_FIND_STUDENT_ID, NULL, opt, (void (*)(void))visitor, user);
+}
+
+static bool shard_enrollment_find(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, EnrollmentVisitor visitor, void *user) {
+    ShardStore *s = (ShardStore *)self;
+    if (field == DB_FIND_STUDENT_ID) {
+        DbStore *one = shard(s, db_shard_of(value));
+        return one->ops->enrollment_find(one, field, value, opt, visitor, user);
+    }
+    return visit_rows(self, DB_ENTITY_ENROLLMENT, field, value, opt, (void (*)(void))visitor, user);
+}
+
+#pragma endregion Enrollment
+
+#pragma region Student
+
+static bool shard_student_add(DbStore *self, const Student *st) {
+    ShardStore *s = (ShardStore *)self;
+    int i = db_shard_of(st->student_id);
+    return touch(s, i) && shard(s, i)->ops->student_add(shard(s, i), st);
+}
+
+static bool shard_student_update(DbStore *self, const Student *st) {
+    ShardStore *s = (ShardStore *)self;
+    int i = db_shard_of(st->student_id);
+    return touch(s, i) && shard(s, i)->ops->student_update(shard(s, i), st);
+}
+
+static bool shard_student_remove(DbStore *self, const char *student_id) {
+    ShardStore *s = (ShardStore *)self;
+    int i = db_shard_of(student_id);
+    return touch(s, i) && shard(s, i)->ops->student_remove(shard(s, i), student_id);
+}
+
+static bool shard_student_remove_all(DbStore *self) {
+    ShardStore *s = (ShardStore *)self;
+    for (int i = 0; i < s->count; i++) {
+        if (!touch(s, i) || !shard(s, i)->ops->student_remove_all(shard(s, i))) return false;
+    }
+    return true;
+}
+
+static bool shard_student_list(DbStore *self, const QueryOptions *opt, StudentVisitor visitor, void *user) {
+    return visit_rows(self, DB_ENTITY_STUDENT, DB_FIND_STUDENT_ID, NULL, opt, (void (*)(void))visitor, user);
+}
+
+static bool shard_student_find(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, StudentVisitor visitor, void *user) {
+    ShardStore *s = (ShardStore *)self;
+    if (field == DB_FIND_STUDENT_ID) {
+        DbStore *one = shard(s, db_shard_of(value));
+        return one->ops->student_find(one, field, value, opt, visitor, user);
+    }
+    return visit_rows(self, DB_ENTITY_STUDENT, field, value, opt, (void (*)(void))visitor, user);
+}
+
+#pragma endregion Student
+
+// Every shard takes a step of its own. Every shard holds the same courses, so a course
+// row removed from each of them counts once; students and enrollments add up.
+static bool shard_remove_batch(DbStore *self, DbEntity entity, DbEntity table, int limit, int *removed) {
+    ShardStore *s = (ShardStore *)self;
+    *removed = 0;
+    for (int i = 0; i < s->count; i++) {
+        int n = 0;
+        if (!touch(s, i) || !shard(s, i)->ops->remove_batch(shard(s, i), entity, table, limit, &n)) return false;
+        if (table == DB_ENTITY_COURSE) {
+            if (n > *removed) *removed = n;
+        } else {
+            *removed += n;
+        }
+    }
+    return true;
+}
+
+static const DbStoreOps shard_ops = {
+    .name = "sqlite-sharded",
+    .close = shard_close,
+
+    .thread_open = shard_thread_open,
+    .thread_close = shard_thread_close,
+    .begin = shard_begin,
+    .commit = shard_commit,
+    .rollback = shard_rollback,
+    .savepoint = shard_savepoint,
+    .release_savepoint = shard_release_savepoint,
+    .rollback_savepoint = shard_rollback_savepoint,
+    .read_begin = shard_read_begin,
+    .read_end = shard_read_end,
+    .checkpoint = shard_checkpoint,
+    .disable_autocheckpoint = shard_disable_autocheckpoint,
+    .busy_timeout = shard_busy_timeout,
+
+    .cursor_open = shard_cursor_open,
+    .cursor_next = shard_cursor_next,
+    .cursor_close = shard_cursor_close,
+
+    .course_add = shard_course_add,
+    .course_update = shard_course_update,
+    .course_remove = shard_course_remove,
+    .course_remove_all = shard_course_remove_all,
+    .course_list = shard_course_list,
+    .course_find = shard_course_find,
+
+    .enrollment_add = shard_enrollment_add,
+    .enrollment_remove = shard_enrollment_remove,
+    .enrollment_remove_all = shard_enrollment_remove_all,
+    .enrollment_list = shard_enrollment_list,
+    .enrollment_find = shard_enrollment_find,
+
+    .student_add = shard_student_add,
+    .student_update = shard_student_update,
+    .student_remove = shard_student_remove,
+    .student_remove_all = shard_student_remove_all,
+    .student_list = shard_student_list,
+    .student_find = shard_student_find,
+
+    .remove_batch = shard_remove_batch,
+};
+
+DbStore *db_shard_open(int shards) {
+    ShardStore *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->base.ops = &shard_ops;
+    for (int i = 0; i < shards; i++) {
+        char path[256];
+        db_shard_file(i, path, sizeof(path));
+        s->shards[i] = db_sqlite_open(path);
+        if (!s->shards[i]) {
+            shard_close(&s->base);
+            return NULL;
+        }
+        s->count++;
+    }
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "Students and enrollments split across %d database files", shards);
+    log_message(buf, LOG_INFO);
+    return &s->base;
+}
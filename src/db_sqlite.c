@@ -0,0 +1,1023 @@
+#include "db_backend.h"
+#include "slowlog.h"
+#include "trace.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    DbStore base;
+    sqlite3 *db;
+    char *path;
+    bool autocheckpoint;
+} SqliteStore;
+
+// Threads that need their own connection (e.g. the group-commit writer) set this,
+// one entry per store so a thread can hold a connection to every shard
+static _Thread_local struct {
+    SqliteStore *owner;
+    sqlite3 *db;
+} thread_conns[DB_SHARDS_MAX];
+static _Thread_local int thread_conn_count;
+
+static int thread_conn_index(SqliteStore *s) {
+    for (int i = 0; i < thread_conn_count; i++) {
+        if (thread_conns[i].owner == s) return i;
+    }
+    return -1;
+}
+
+static sqlite3 *conn(SqliteStore *s) {
+    int i = thread_conn_index(s);
+    return i >= 0 ? thread_conns[i].db : s->db;
+}
+
+static bool db_exec(SqliteStore *s, const char *sql, DbValue *values, int value_count) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(conn(s), sql, -1, &stmt, NULL) != SQLITE_OK) {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "db_exec: prepare failed: %s", sqlite3_errmsg(conn(s)));
+        log_message(buf, LOG_ERROR);
+        return false;
+    }
+
+    for (int i = 0; i < value_count; i++) {
+        int idx = i + 1;
+        switch (values[i].type) {
+        case DB_NULL:
+            sqlite3_bind_null(stmt, idx);
+            break;
+        case DB_TEXT:
+            sqlite3_bind_text(stmt, idx, values[i].text, -1, SQLITE_TRANSIENT);
+            break;
+        case DB_REAL:
+            sqlite3_bind_double(stmt, idx, values[i].d);
+            break;
+        case DB_INT:
+            sqlite3_bind_int(stmt, idx, values[i].i);
+            break;
+        }
+    }
+
+    int step = sqlite3_step(stmt);
+    bool ok = step == SQLITE_DONE;
+    if (!ok) {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "db_exec: step failed: %s", sqlite3_errmsg(conn(s)));
+        log_message(buf, LOG_ERROR);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+static bool db_query(SqliteStore *s, const char *base_sql, const QueryOptions *opt, DbValue *values, int value_count, sqlite3_stmt **stmt, DbEntity entity) {
+    char query[1024];
+    int n = snprintf(query, sizeof(query), "%s", base_sql);
+
+    // Add ORDER BY clause if specified and valid
+    if (opt && opt->order_by && db_valid_order(entity, opt->order_by)) {
+        n += snprintf(query + n, sizeof(query) - n, " ORDER BY %s %s", opt->order_by, opt->order == SORT_DESC ? "DESC" : "ASC");
+    }
+
+    // Add LIMIT and OFFSET clauses (OFFSET requires LIMIT in SQLite)
+    int param_idx = value_count + 1;
+    if (opt && opt->limit > 0) {
+        n += snprintf(query + n, sizeof(query) - n, " LIMIT ?");
+        if (opt->offset > 0) {
+            n += snprintf(query + n, sizeof(query) - n, " OFFSET ?");
+        }
+    } else if (opt && opt->offset > 0) {
+        // If only offset is specified, use a very large limit
+        // SQLite requires LIMIT when using OFFSET
+        n += snprintf(query + n, sizeof(query) - n, " LIMIT -1 OFFSET ?");
+    }
+
+    if (sqlite3_prepare_v2(conn(s), query, -1, stmt, NULL) != SQLITE_OK)
+    {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "db_query: prepare failed: %s", sqlite3_errmsg(conn(s)));
+        log_message(buf, LOG_ERROR);
+        return false;
+    }
+
+    // Bind WHERE clause parameters
+    for (int i = 0; i < value_count; i++) {
+        int idx = i + 1;
+        switch (values[i].type) {
+        case DB_NULL:
+            sqlite3_bind_null(*stmt, idx);
+            break;
+        case DB_TEXT:
+            sqlite3_bind_text(*stmt, idx, values[i].text, -1, SQLITE_TRANSIENT);
+            break;
+        case DB_REAL:
+            sqlite3_bind_double(*stmt, idx, values[i].d);
+            break;
+        case DB_INT:
+            sqlite3_bind_int(*stmt, idx, values[i].i);
+            break;
+        }
+    }
+
+    // Bind pagination parameters
+    if (opt && opt->limit > 0) {
+        sqlite3_bind_int(*stmt, param_idx++, opt->limit);
+        if (opt->offset > 0) {
+            sqlite3_bind_int(*stmt, param_idx++, opt->offset);
+        }
+    } else if (opt && opt->offset > 0) {
+        // Only offset specified, already added LIMIT -1 in query
+        sqlite3_bind_int(*stmt, param_idx++, opt->offset);
+    }
+
+    return true;
+}
+
+#pragma region Statement hooks
+
+// A thread steps one statement at a time, except for cursors held open while
+// others run; rows of such interleaved statements are not counted
+static _Thread_local struct {
+    sqlite3_stmt *stmt;
+    uint64_t rows;
+} row_count;
+
+static int statement_hook(unsigned type, void *ctx, void *p, void *x) {
+    (void)ctx;
+    sqlite3_stmt *stmt = p;
+    if (type == SQLITE_TRACE_ROW) {
+        if (row_count.stmt != stmt) {
+            row_count.stmt = stmt;
+            row_count.rows = 0;
+        }
+        row_count.rows++;
+        return 0;
+    }
+
+    // SQLITE_TRACE_PROFILE: the statement finished, x is its run time in ns
+    uint64_t ns = *(sqlite3_uint64 *)x;
+    uint64_t rows = row_count.stmt == stmt ? row_count.rows : 0;
+    row_count.stmt = NULL;
+    row_count.rows = 0;
+    slowlog_statement(stmt, ns, rows);
+    trace_statement(sqlite3_sql(stmt), ns);
+    return 0;
+}
+
+// Only pays for the hook (and per-row callbacks) when someone listens
+static void attach_hooks(sqlite3 *db) {
+    unsigned mask = 0;
+    if (slowlog_enabled()) mask |= SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW;
+    if (trace_enabled()) mask |= SQLITE_TRACE_PROFILE;
+    if (mask) sqlite3_trace_v2(db, mask, statement_hook, NULL);
+}
+
+#pragma endregion Statement hooks
+
+#pragma region Connections
+
+static bool open_connection(const char *path, sqlite3 **out) {
+    if (sqlite3_open(path, out) != SQLITE_OK) {
+        log_message(sqlite3_errmsg(*out), LOG_ERROR);
+        sqlite3_close(*out);
+        *out = NULL;
+        return false;
+    }
+    sqlite3_exec(*out, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
+    sqlite3_busy_timeout(*out, 5000);
+    attach_hooks(*out);
+    return true;
+}
+
+static void sqlite_close(DbStore *self) {
+    SqliteStore *s = (SqliteStore *)self;
+    log_message("Closing database...", LOG_INFO);
+    sqlite3_close(s->db);
+    free(s->path);
+    free(s);
+}
+
+static bool sqlite_thread_open(DbStore *self) {
+    SqliteStore *s = (SqliteStore *)self;
+    if (thread_conn_index(s) >= 0) return true;
+    if (thread_conn_count == DB_SHARDS_MAX) return false;
+    sqlite3 *db;
+    if (!open_connection(s->path, &db)) return false;
+    if (!s->autocheckpoint) sqlite3_wal_autocheckpoint(db, 0);
+    thread_conns[thread_conn_count].owner = s;
+    thread_conns[thread_conn_count].db = db;
+    thread_conn_count++;
+    return true;
+}
+
+static void sqlite_thread_close(DbStore *self) {
+    int i = thread_conn_index((SqliteStore *)self);
+    if (i < 0) return;
+    sqlite3_close(thread_conns[i].db);
+    thread_conns[i] = thread_conns[--thread_conn_count];
+}
+
+static bool sqlite_begin(DbStore *self) { return db_exec((SqliteStore *)self, "BEGIN IMMEDIATE;", NULL, 0); }
+static bool sqlite_commit(DbStore *self) { return db_exec((SqliteStore *)self, "COMMIT;", NULL, 0); }
+static bool sqlite_rollback(DbStore *self) { return db_exec((SqliteStore *)self, "ROLLBACK;", NULL, 0); }
+static bool sqlite_savepoint(DbStore *self) { return db_exec((SqliteStore *)self, "SAVEPOINT mutation;", NULL, 0); }
+static bool sqlite_release_savepoint(DbStore *self) { return db_exec((SqliteStore *)self, "RELEASE mutation;", NULL, 0); }
+
+static bool sqlite_rollback_savepoint(DbStore *self) {
+    SqliteStore *s = (SqliteStore *)self;
+    return db_exec(s, "ROLLBACK TO mutation;", NULL, 0) && db_exec(s, "RELEASE mutation;", NULL, 0);
+}
+
+// Only on a private connection: a transaction on the shared one would pin every request to it
+static bool sqlite_read_begin(DbStore *self) {
+    int i = thread_conn_index((SqliteStore *)self);
+    if (i < 0) return false;
+    sqlite3 *db = thread_conns[i].db;
+    // BEGIN is deferred and the first read fixes the snapshot, so take it now
+    if (sqlite3_exec(db, "BEGIN; SELECT 1 FROM sqlite_master LIMIT 1;", NULL, NULL, NULL) == SQLITE_OK) return true;
+    log_message("db_read_begin: cannot start a read transaction", LOG_ERROR);
+    sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+    return false;
+}
+
+static bool sqlite_read_end(DbStore *self) { return db_exec((SqliteStore *)self, "COMMIT;", NULL, 0); }
+
+static void sqlite_disable_autocheckpoint(DbStore *self) {
+    SqliteStore *s = (SqliteStore *)self;
+    s->autocheckpoint = false;
+    sqlite3_wal_autocheckpoint(s->db, 0);
+}
+
+static void sqlite_busy_timeout(DbStore *self, int ms) {
+    sqlite3_busy_timeout(conn((SqliteStore *)self), ms);
+}
+
+static bool sqlite_checkpoint(DbStore *self, DbCheckpointMode mode, int *wal_frames, int *checkpointed_frames) {
+    SqliteStore *s = (SqliteStore *)self;
+    int m = SQLITE_CHECKPOINT_PASSIVE;
+    switch (mode) {
+        case DB_CHECKPOINT_PASSIVE: m = SQLITE_CHECKPOINT_PASSIVE; break;
+        case DB_CHECKPOINT_FULL: m = SQLITE_CHECKPOINT_FULL; break;
+        case DB_CHECKPOINT_RESTART: m = SQLITE_CHECKPOINT_RESTART; break;
+        case DB_CHECKPOINT_TRUNCATE: m = SQLITE_CHECKPOINT_TRUNCATE; break;
+    }
+    int log = -1, ckpt = -1;
+    int rc = sqlite3_wal_checkpoint_v2(conn(s), NULL, m, &log, &ckpt);
+    if (wal_frames) *wal_frames = log;
+    if (checkpointed_frames) *checkpointed_frames = ckpt;
+    if (rc != SQLITE_OK && rc != SQLITE_BUSY) {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "db_checkpoint: %s", sqlite3_errmsg(conn(s)));
+        log_message(buf, LOG_WARN);
+    }
+    return rc == SQLITE_OK;
+}
+
+#pragma endregion Connections
+
+#pragma region Course
+
+static void row_course(sqlite3_stmt *stmt, Course *c) {
+    *c = (Course){
+        .course_id = (const char *)sqlite3_column_text(stmt, 0),
+        .name      = (const char *)sqlite3_column_text(stmt, 1),
+        .type      = (const char *)sqlite3_column_text(stmt, 2),
+        .total_hours = sqlite3_column_double(stmt, 3),
+        .lecture_hours = sqlite3_column_double(stmt, 4),
+        .lab_hours = sqlite3_column_double(stmt, 5),
+        .credit    = sqlite3_column_double(stmt, 6),
+        .semester  = (const char *)sqlite3_column_text(stmt, 7),
+    };
+}
+
+static bool db_visit_course(CourseVisitor visitor, void *user, sqlite3_stmt *stmt) {
+    Course c;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        row_course(stmt, &c);
+        visitor(&c, user);
+    }
+
+    return true;
+}
+
+// value == NULL selects every course; shared by the visitor and cursor reads
+static bool course_select(SqliteStore *s, DbFindField field, const char *value, const QueryOptions *opt, sqlite3_stmt **stmt) {
+    if (!value) {
+        return db_query(s,
+            "SELECT course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester "
+            "FROM course", opt, NULL, 0, stmt, DB_ENTITY_COURSE);
+    }
+
+    const char *where;
+    switch (field) {
+        case DB_FIND_COURSE_ID: where = "course_id = ?"; break;
+        case DB_FIND_NAME: where = "name LIKE ?"; break;
+        case DB_FIND_TYPE: where = "type LIKE ?"; break;
+        case DB_FIND_SEMESTER: where = "semester LIKE ?"; break;
+        default: return false;
+    }
+
+    char sql[256];
+    snprintf(sql, sizeof(sql),
+        "SELECT course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester "
+        "FROM course WHERE %s", where);
+    return db_query(s, sql, opt, (DbValue[]){{ DB_TEXT, .text = value }}, 1, stmt, DB_ENTITY_COURSE);
+}
+
+static bool sqlite_course_add(DbStore *self, const Course *c) {
+    const char *sql =
+        "INSERT INTO course (course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
+
+    DbValue v[] = {
+        { DB_TEXT, .text = c->course_id },
+        { c->name ? DB_TEXT : DB_NULL, .text = c->name },
+        { c->type ? DB_TEXT : DB_NULL, .text = c->type },
+        { DB_REAL, .d = c->total_hours },
+        { DB_REAL, .d = c->lecture_hours },
+        { DB_REAL, .d = c->lab_hours },
+        { DB_REAL, .d = c->credit },
+        { c->semester ? DB_TEXT : DB_NULL, .text = c->semester }
+    };
+
+    return db_exec((SqliteStore *)self, sql, v, 8);
+}
+
+static bool sqlite_course_update(DbStore *self, const Course *c) {
+    const char *sql =
+        "UPDATE course SET name = ?, type = ?, total_hours = ?, lecture_hours = ?, "
+        "lab_hours = ?, credit = ?, semester = ? WHERE course_id = ?;";
+
+    DbValue v[] = {
+        { c->name ? DB_TEXT : DB_NULL, .text = c->name },
+        { c->type ? DB_TEXT : DB_NULL, .text = c->type },
+        { DB_REAL, .d = c->total_hours },
+        { DB_REAL, .d = c->lecture_hours },
+        { DB_REAL, .d = c->lab_hours },
+        { DB_REAL, .d = c->credit },
+        { c->semester ? DB_TEXT : DB_NULL, .text = c->semester },
+        { DB_TEXT, .text = c->course_id }
+    };
+
+    return db_exec((SqliteStore *)self, sql, v, 8);
+}
+
+static bool sqlite_course_remove(DbStore *self, const char *course_id) {
+    SqliteStore *s = (SqliteStore *)self;
+
+    // First remove all enrollments for this course
+    const char *sql_enrollments = "DELETE FROM enrollment WHERE course = (SELECT id FROM course WHERE course_id = ?);";
+    DbValue v_enroll[] = { { DB_TEXT, .text = course_id } };
+    if (!db_exec(s, sql_enrollments, v_enroll, 1)) return false;
+
+    // Then remove the course
+    const char *sql = "DELETE FROM course WHERE course_id = ?;";
+    DbValue v[] = { { DB_TEXT, .text = course_id } };
+
+    return db_exec(s, sql, v, 1);
+}
+
+static bool sqlite_course_remove_all(DbStore *self) {
+    SqliteStore *s = (SqliteStore *)self;
+
+    // Remove all enrollments first to maintain consistency
+    const char *sql_del_enr = "DELETE FROM enrollment;";
+    if (!db_exec(s, sql_del_enr, NULL, 0)) return false;
+
+    const char *sql_del = "DELETE FROM course;";
+    return db_exec(s, sql_del, NULL, 0);
+}
+
+static bool sqlite_course_list(DbStore *self, const QueryOptions *opt, CourseVisitor visitor, void *user) {
+    sqlite3_stmt *stmt;
+    if(!course_select((SqliteStore *)self, DB_FIND_COURSE_ID, NULL, opt, &stmt)) return false;
+    if(!db_visit_course(visitor, user, stmt)) return false;
+
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+static bool sqlite_course_find(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, CourseVisitor visitor, void *user) {
+    sqlite3_stmt *stmt;
+    if (!value) return true;    // NULL matches nothing, as binding it did
+    if (!course_select((SqliteStore *)self, field, value, opt, &stmt)) return false;
+    if (!db_visit_course(visitor, user, stmt)) return false;
+
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+#pragma endregion Course
+
+#pragma region Enrollment
+
+// Enrollments store surrogate keys; join back to the external IDs for output
+#define ENROLLMENT_JOIN \
+    "FROM enrollment " \
+    "JOIN student ON student.id = enrollment.student " \
+    "JOIN course ON course.id = enrollment.course"
+
+static void row_enrollment(sqlite3_stmt *stmt, Enrollment *e) {
+    *e = (Enrollment){
+        .student_id = (const char *)sqlite3_column_text(stmt, 0),
+        .course_id  = (const char *)sqlite3_column_text(stmt, 1),
+    };
+}
+
+static bool db_visit_enrollment(EnrollmentVisitor visitor, void *user, sqlite3_stmt *stmt) {
+    Enrollment e;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        row_enrollment(stmt, &e);
+        visitor(&e, user);
+    }
+
+    return true;
+}
+
+// value == NULL selects every enrollment
+static bool enrollment_select(SqliteStore *s, DbFindField field, const char *value, const QueryOptions *opt, sqlite3_stmt **stmt) {
+    if (!value) return db_query(s, "SELECT student.student_id, course.course_id " ENROLLMENT_JOIN, opt, NULL, 0, stmt, DB_ENTITY_ENROLLMENT);
+
+    const char *sql;
+    switch (field) {
+        case DB_FIND_STUDENT_ID: sql = "SELECT student.student_id, course.course_id " ENROLLMENT_JOIN " WHERE student.student_id = ?"; break;
+        case DB_FIND_COURSE_ID: sql = "SELECT student.student_id, course.course_id " ENROLLMENT_JOIN " WHERE course.course_id = ?"; break;
+        default: return false;
+    }
+    return db_query(s, sql, opt, (DbValue[]){{ DB_TEXT, .text = value }}, 1, stmt, DB_ENTITY_ENROLLMENT);
+}
+
+static bool sqlite_enrollment_add(DbStore *self, const Enrollment *e) {
+    SqliteStore *s = (SqliteStore *)self;
+
+    // Resolving both surrogate keys in the INSERT doubles as the existence check
+    const char *sql =
+        "INSERT INTO enrollment (student, course) "
+        "SELECT student.id, course.id FROM student, course "
+        "WHERE student.student_id = ? AND course.course_id = ?;";
+    DbValue v[] = {
+        { DB_TEXT, .text = e->student_id },
+        { DB_TEXT, .text = e->course_id }
+    };
+    if (!db_exec(s, sql, v, 2)) return false;
+    if (sqlite3_changes(conn(s)) == 0) return false;
+
+    // Update student credits
+    const char *update_credits =
+        "UPDATE student SET credits = credits + (SELECT credit FROM course WHERE course_id = ?) "
+        "WHERE student_id = ?;";
+    DbValue v_credits[] = {
+        { DB_TEXT, .text = e->course_id },
+        { DB_TEXT, .text = e->student_id }
+    };
+    return db_exec(s, update_credits, v_credits, 2);
+}
+
+static bool sqlite_enrollment_remove(DbStore *self, const char *student_id, const char *course_id) {
+    SqliteStore *s = (SqliteStore *)self;
+
+    // Remove enrollment
+    const char *sql =
+        "DELETE FROM enrollment "
+        "WHERE student = (SELECT id FROM student WHERE student_id = ?) "
+        "AND course = (SELECT id FROM course WHERE course_id = ?);";
+    DbValue v[] = {
+        { DB_TEXT, .text = student_id },
+        { DB_TEXT, .text = course_id }
+    };
+    if (!db_exec(s, sql, v, 2)) return false;
+
+    // Nothing was enrolled, so there are no credits to give back
+    if (sqlite3_changes(conn(s)) == 0) return true;
+
+    // Update student credits
+    const char *update_credits =
+        "UPDATE student SET credits = credits - (SELECT credit FROM course WHERE course_id = ?) "
+        "WHERE student_id = ?;";
+    DbValue v_credits[] = {
+        { DB_TEXT, .text = course_id },
+        { DB_TEXT, .text = student_id }
+    };
+    return db_exec(s, update_credits, v_credits, 2);
+}
+
+static bool sqlite_enrollment_remove_all(DbStore *self) {
+    SqliteStore *s = (SqliteStore *)self;
+
+    const char *sql_del = "DELETE FROM enrollment;";
+    if (!db_exec(s, sql_del, NULL, 0)) return false;
+
+    const char *sql_reset = "UPDATE student SET credits = 0.0;";
+    return db_exec(s, sql_reset, NULL, 0);
+}
+
+static bool sqlite_enrollment_list(DbStore *self, const QueryOptions *opt, EnrollmentVisitor visitor, void *user) {
+    sqlite3_stmt *stmt;
+    if (!enrollment_select((SqliteStore *)self, DB_FIND_STUDENT_ID, NULL, opt, &stmt)) return false;
+    if (!db_visit_enrollment(visitor, user, stmt)) return false;
+
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+static bool sqlite_enrollment_find(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, EnrollmentVisitor visitor, void *user) {
+    sqlite3_stmt *stmt;
+    if (!value) return true;    // NULL matches nothing, as binding it did
+    if (!enrollment_select((SqliteStore *)self, field, value, opt, &stmt)) return false;
+    if (!db_visit_enrollment(visitor, user, stmt)) return false;
+
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+#pragma endregion Enrollment
+
+#pragma region Student
+
+static void row_student(sqlite3_stmt *stmt, Student *s) {
+    *s = (Student){
+        .student_id = (const char *)sqlite3_column_text(stmt, 0),
+        .name       = (const char *)sqlite3_column_text(stmt, 1),
+        .email      = (const char *)sqlite3_column_text(stmt, 2),
+        .credits    = sqlite3_column_double(stmt, 3),
+    };
+}
+
+static bool db_visit_student(StudentVisitor visitor, void *user, sqlite3_stmt *stmt) {
+    Student s;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        row_student(stmt, &s);
+        visitor(&s, user);
+    }
+
+    return true;
+}
+
+// value == NULL selects every student
+static bool student_select(SqliteStore *s, DbFindField field, const char *value, const QueryOptions *opt, sqlite3_stmt **stmt) {
+    if (!value) return db_query(s, "SELECT student_id, name, email, credits FROM student", opt, NULL, 0, stmt, DB_ENTITY_STUDENT);
+
+    const char *sql;
+    switch (field) {
+        case DB_FIND_STUDENT_ID: sql = "SELECT student_id, name, email, credits FROM student WHERE student_id = ?"; break;
+        case DB_FIND_NAME: sql = "SELECT student_id, name, email, credits FROM student WHERE name LIKE ?"; break;
+        default: return false;
+    }
+    return db_query(s, sql, opt, (DbValue[]){{ DB_TEXT, .text = value }}, 1, stmt, DB_ENTITY_STUDENT);
+}
+
+static bool sqlite_student_add(DbStore *self, const Student *s) {
+    const char *sql =
+        "INSERT INTO student (student_id, name, email, credits) VALUES (?, ?, ?, ?);";
+    DbValue v[] = {
+        { DB_TEXT, .text = s->student_id },
+        { DB_TEXT, .text = s->name },
+        { s->email ? DB_TEXT : DB_NULL, .text = s->email },
+        { DB_REAL, .d = s->credits }
+    };
+    return db_exec((SqliteStore *)self, sql, v, 4);
+}
+
+static bool sqlite_student_update(DbStore *self, const Student *s) {
+    const char *sql =
+        "UPDATE student SET name = ?, email = ?, credits = ? WHERE student_id = ?;";
+    DbValue v[] = {
+        { DB_TEXT, .text = s->name },
+        { s->email ? DB_TEXT : DB_NULL, .text = s->email },
+        { DB_REAL, .d = s->credits },
+        { DB_TEXT, .text = s->student_id }
+    };
+    return db_exec((SqliteStore *)self, sql, v, 4);
+}
+
+static bool sqlite_student_remove(DbStore *self, const char *student_id) {
+    SqliteStore *s = (SqliteStore *)self;
+
+    // First remove all enrollments for this student
+    const char *sql_enrollments = "DELETE FROM enrollment WHERE student = (SELECT id FROM student WHERE student_id = ?);";
+    DbValue v_enroll[] = { { DB_TEXT, .text = student_id } };
+    if (!db_exec(s, sql_enrollments, v_enroll, 1)) return false;
+
+    // Then remove the student
+    const char *sql = "DELETE FROM student WHERE student_id = ?;";
+    DbValue v[] = { { DB_TEXT, .text = student_id } };
+    return db_exec(s, sql, v, 1);
+}
+
+static bool sqlite_student_remove_all(DbStore *self) {
+    SqliteStore *s = (SqliteStore *)self;
+
+    // Remove all enrollments first
+    const char *sql_del_enr = "DELETE FROM enrollment;";
+    if (!db_exec(s, sql_del_enr, NULL, 0)) return false;
+
+    // Then remove all students
+    const char *sql_del = "DELETE FROM student;";
+    return db_exec(s, sql_del, NULL, 0);
+}
+
+static bool sqlite_student_list(DbStore *self, const QueryOptions *opt, StudentVisitor visitor, void *user) {
+    sqlite3_stmt *stmt;
+    if (!student_select((SqliteStore *)self, DB_FIND_STUDENT_ID, NULL, opt, &stmt)) return false;
+    if (!db_visit_student(visitor, user, stmt)) return false;
+
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+static bool sqlite_student_find(DbStore *self, DbFindField field, const char *value, const QueryOptions *opt, StudentVisitor visitor, void *user) {
+    sqlite3_stmt *stmt;
+    if (!value) return true;    // NULL matches nothing, as binding it did
+    if (!student_select((SqliteStore *)self, field, value, opt, &stmt)) return false;
+    if (!db_visit_student(visitor, user, stmt)) return false;
+
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+#pragma endregion Student
+
+// Each step deletes the lowest ids first, so the subquery picks the same rows in
+// both statements of the transaction
+static bool sqlite_remove_batch(DbStore *self, DbEntity entity, DbEntity table, int limit, int *removed) {
+    SqliteStore *s = (SqliteStore *)self;
+    DbValue v[] = { { DB_INT, .i = limit } };
+    const char *first, *second;
+    switch (entity) {
+        case DB_ENTITY_COURSE:
+            // A course has hundreds of enrollments, so those go first, limit rows at a
+            // time; removing a course leaves credits alone either way
+            if (table == DB_ENTITY_ENROLLMENT) {
+                if (!db_exec(s, "DELETE FROM enrollment WHERE (student, course) IN "
+                                "(SELECT student, course FROM enrollment LIMIT ?);", v, 1)) return false;
+                *removed = sqlite3_changes(conn(s));
+                return true;
+            }
+            if (!db_exec(s, "DELETE FROM course WHERE id IN (SELECT id FROM course ORDER BY id LIMIT ?);", v, 1)) return false;
+            *removed = sqlite3_changes(conn(s));
+            return true;
+        case DB_ENTITY_STUDENT:
+            first = "DELETE FROM enrollment WHERE student IN (SELECT id FROM student ORDER BY id LIMIT ?);";
+            second = "DELETE FROM student WHERE id IN (SELECT id FROM student ORDER BY id LIMIT ?);";
+            break;
+        default:
+            // A student at a time, so credits never disagree with the enrollments left
+            first = "UPDATE student SET credits = 0.0 WHERE id IN "
+                    "(SELECT DISTINCT student FROM enrollment ORDER BY student LIMIT ?);";
+            second = "DELETE FROM enrollment WHERE student IN "
+                     "(SELECT DISTINCT student FROM enrollment ORDER BY student LIMIT ?);";
+            break;
+    }
+    if (!db_exec(s, first, v, 1) || !db_exec(s, second, v, 1)) return false;
+    *removed = sqlite3_changes(conn(s));
+    return true;
+}
+
+#pragma region Cursors
+
+struct DbCursor {
+    sqlite3_stmt *stmt;
+    DbEntity entity;
+};
+
+static DbCursor *sqlite_cursor_open(DbStore *self, DbEntity entity, DbFindField field, const char *value, const QueryOptions *opt) {
+    SqliteStore *s = (SqliteStore *)self;
+    sqlite3_stmt *stmt;
+    bool ok = entity == DB_ENTITY_COURSE ? course_select(s, field, value, opt, &stmt)
+            : entity == DB_ENTITY_STUDENT ? student_select(s, field, value, opt, &stmt)
+            : enrollment_select(s, field, value, opt, &stmt);
+    if (!ok) return NULL;
+
+    DbCursor *cur = malloc(sizeof(*cur));
+    if (!cur) {
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+    cur->stmt = stmt;
+    cur->entity = entity;
+    return cur;
+}
+
+static int sqlite_cursor_next(DbCursor *cur, void *row) {
+    int rc = sqlite3_step(cur->stmt);
+    if (rc == SQLITE_DONE) return 0;
+    if (rc != SQLITE_ROW) {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "cursor: step failed: %s", sqlite3_errmsg(sqlite3_db_handle(cur->stmt)));
+        log_message(buf, LOG_ERROR);
+        return -1;
+    }
+    switch (cur->entity) {
+        case DB_ENTITY_COURSE: row_course(cur->stmt, row); break;
+        case DB_ENTITY_STUDENT: row_student(cur->stmt, row); break;
+        case DB_ENTITY_ENROLLMENT: row_enrollment(cur->stmt, row); break;
+    }
+    return 1;
+}
+
+static void sqlite_cursor_close(DbCursor *cur) {
+    if (!cur) return;
+    sqlite3_finalize(cur->stmt);
+    free(cur);
+}
+
+#pragma endregion Cursors
+
+#pragma region Schema
+
+/*
+ * Schema version 2 keys students and courses by INTEGER surrogate keys (the
+ * rowid) and keeps the external TEXT IDs behind UNIQUE indexes. Enrollment is
+ * a WITHOUT ROWID table of two integers clustered on (student, course) with a
+ * covering index for the other direction. Translation between external and
+ * surrogate keys happens entirely in the SQL below, so db.h is unchanged.
+ */
+#define DB_SCHEMA_VERSION 2
+
+#define SECONDARY_INDEXES_SQL \
+    "CREATE INDEX IF NOT EXISTS enrollment_by_course ON enrollment(course, student);"
+
+const char *const db_sqlite_create_indexes_sql = SECONDARY_INDEXES_SQL;
+const char *const db_sqlite_drop_indexes_sql = "DROP INDEX IF EXISTS enrollment_by_course;";
+
+static const char *schema_sql =
+    "CREATE TABLE IF NOT EXISTS course ("
+    "id INTEGER PRIMARY KEY,"
+    "course_id TEXT NOT NULL UNIQUE,"
+    "name TEXT,"
+    "type TEXT,"
+    "total_hours REAL,"
+    "lecture_hours REAL,"
+    "lab_hours REAL,"
+    "credit REAL NOT NULL,"
+    "semester TEXT"
+    ");"
+    "CREATE TABLE IF NOT EXISTS student ("
+    "id INTEGER PRIMARY KEY,"
+    "student_id TEXT NOT NULL UNIQUE,"
+    "name TEXT NOT NULL,"
+    "email TEXT,"
+    "credits REAL NOT NULL DEFAULT 0.0 CHECK(credits >= 0.0)"
+    ");"
+    "CREATE TABLE IF NOT EXISTS enrollment ("
+    "student INTEGER NOT NULL REFERENCES student(id),"
+    "course INTEGER NOT NULL REFERENCES course(id),"
+    "PRIMARY KEY (student, course)"
+    ") WITHOUT ROWID;"
+    SECONDARY_INDEXES_SQL;
+
+// Version 1 tables used the TEXT IDs as keys everywhere
+static const char *migrate_v1_sql =
+    "ALTER TABLE enrollment RENAME TO enrollment_v1;"
+    "ALTER TABLE student RENAME TO student_v1;"
+    "ALTER TABLE course RENAME TO course_v1;"
+    "%s"
+    "INSERT INTO course (course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester) "
+    "SELECT course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester FROM course_v1 "
+    "WHERE course_id IS NOT NULL;"
+    "INSERT INTO student (student_id, name, email, credits) "
+    "SELECT student_id, name, email, credits FROM student_v1 WHERE student_id IS NOT NULL;"
+    "INSERT OR IGNORE INTO enrollment (student, course) "
+    "SELECT student.id, course.id FROM enrollment_v1 "
+    "JOIN student ON student.student_id = enrollment_v1.student_id "
+    "JOIN course ON course.course_id = enrollment_v1.course_id;"
+    "DROP TABLE enrollment_v1;"
+    "DROP TABLE student_v1;"
+    "DROP TABLE course_v1;";
+
+static bool exec_script(sqlite3 *db, const char *sql) {
+    char *errmsg = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &errmsg) == SQLITE_OK) return true;
+    log_message("Failed to create tables", LOG_ERROR);
+    if (errmsg) {
+        log_message(errmsg, LOG_ERROR);
+        sqlite3_free(errmsg);
+    }
+    return false;
+}
+
+static int schema_version(sqlite3 *db) {
+    sqlite3_stmt *stmt;
+    int version = 0;
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, NULL) != SQLITE_OK) return -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) version = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    if (version != 0) return version;
+
+    // Databases created before versioning have tables but user_version 0
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'enrollment';", -1, &stmt, NULL) != SQLITE_OK) return -1;
+    bool legacy = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return legacy ? 1 : 0;
+}
+
+static bool create_schema(sqlite3 *db) {
+    int version = schema_version(db);
+    if (version < 0) return false;
+    if (version > DB_SCHEMA_VERSION) {
+        log_message("Database was created by a newer version", LOG_ERROR);
+        return false;
+    }
+    if (version == DB_SCHEMA_VERSION) return exec_script(db, schema_sql);
+
+    if (!exec_script(db, "BEGIN IMMEDIATE;")) return false;
+    bool ok;
+    if (version == 1) {
+        log_message("Migrating database to integer surrogate keys...", LOG_INFO);
+        size_t n = strlen(migrate_v1_sql) + strlen(schema_sql);
+        char *sql = malloc(n);
+        ok = sql != NULL;
+        if (ok) {
+            snprintf(sql, n, migrate_v1_sql, schema_sql);
+            ok = exec_script(db, sql);
+            free(sql);
+        }
+    } else {
+        ok = exec_script(db, schema_sql);
+    }
+
+    char pragma[64];
+    snprintf(pragma, sizeof(pragma), "PRAGMA user_version = %d;", DB_SCHEMA_VERSION);
+    ok = ok && exec_script(db, pragma);
+    exec_script(db, ok ? "COMMIT;" : "ROLLBACK;");
+    return ok;
+}
+
+#pragma endregion Schema
+
+static const DbStoreOps sqlite_ops = {
+    .name = "sqlite",
+    .close = sqlite_close,
+    .thread_open = sqlite_thread_open,
+    .thread_close = sqlite_thread_close,
+    .begin = sqlite_begin,
+    .commit = sqlite_commit,
+    .rollback = sqlite_rollback,
+    .savepoint = sqlite_savepoint,
+    .release_savepoint = sqlite_release_savepoint,
+    .rollback_savepoint = sqlite_rollback_savepoint,
+    .read_begin = sqlite_read_begin,
+    .read_end = sqlite_read_end,
+    .checkpoint = sqlite_checkpoint,
+    .disable_autocheckpoint = sqlite_disable_autocheckpoint,
+    .busy_timeout = sqlite_busy_timeout,
+    .cursor_open = sqlite_cursor_open,
+    .cursor_next = sqlite_cursor_next,
+    .cursor_close = sqlite_cursor_close,
+
+    .course_add = sqlite_course_add,
+    .course_update = sqlite_course_update,
+    .course_remove = sqlite_course_remove,
+    .course_remove_all = sqlite_course_remove_all,
+    .course_list = sqlite_course_list,
+    .course_find = sqlite_course_find,
+
+    .enrollment_add = sqlite_enrollment_add,
+    .enrollment_remove = sqlite_enrollment_remove,
+    .enrollment_remove_all = sqlite_enrollment_remove_all,
+    .enrollment_list = sqlite_enrollment_list,
+    .enrollment_find = sqlite_enrollment_find,
+
+    .student_add = sqlite_student_add,
+    .student_update = sqlite_student_update,
+    .student_remove = sqlite_student_remove,
+    .student_remove_all = sqlite_student_remove_all,
+    .student_list = sqlite_student_list,
+    .student_find = sqlite_student_find,
+
+    .remove_batch = sqlite_remove_batch,
+};
+
+DbStore *db_sqlite_open(const char *path) {
+    log_message("Initializing database...", LOG_INFO);
+
+    SqliteStore *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->base.ops = &sqlite_ops;
+    s->autocheckpoint = true;
+    s->path = malloc(strlen(path) + 1);
+    if (!s->path) { free(s); return NULL; }
+    strcpy(s->path, path);
+
+    int rc = sqlite3_open(path, &s->db);
+    if (rc != SQLITE_OK) {
+        log_message(sqlite3_errmsg(s->db), LOG_WARN);
+        sqlite3_close(s->db);
+
+        remove(path);
+        rc = sqlite3_open(path, &s->db);
+        if (rc != SQLITE_OK) {
+            log_message("Failed to create new database file", LOG_ERROR);
+            free(s->path);
+            free(s);
+            return NULL;
+        }
+    }
+
+    sqlite3_exec(s->db, "PRAGMA journal_mode=WAL;", NULL, NULL, NULL);
+    sqlite3_busy_timeout(s->db, 5000);
+    attach_hooks(s->db);
+
+    if (!create_schema(s->db)) {
+        sqlite_close(&s->base);
+        return NULL;
+    }
+
+    return &s->base;
+}
+
+#pragma region Online copies
+
+// Source changes tolerated before the rest of a copy is taken in one step
+#define COPY_MAX_RESTARTS 3
+
+static void copy_error(const char *what, sqlite3 *db) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "db_copy_file: %s: %s", what, sqlite3_errmsg(db));
+    log_message(buf, LOG_ERROR);
+}
+
+static bool run_backup(sqlite3 *src, sqlite3 *dst, int pages_per_step, int pause_ms, DbCopyStats *st) {
+    sqlite3_backup *b = sqlite3_backup_init(dst, "main", src, "main");
+    if (!b) {
+        copy_error("cannot start backup", dst);
+        return false;
+    }
+    if (pages_per_step < 1) pages_per_step = -1;
+    int remaining = -1;
+    int rc;
+    for (;;) {
+        rc = sqlite3_backup_step(b, st->restarts >= COPY_MAX_RESTARTS ? -1 : pages_per_step);
+        st->steps++;
+        if (rc == SQLITE_DONE) break;
+        if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) break;
+        // The step after a commit to the source starts again from page 1
+        int left = sqlite3_backup_remaining(b);
+        if (remaining >= 0 && left > remaining) st->restarts++;
+        remaining = left;
+        if (pause_ms > 0) sleep_ms(pause_ms);
+    }
+    st->pages = sqlite3_backup_pagecount(b);
+    sqlite3_backup_finish(b);
+    if (rc != SQLITE_DONE) copy_error("backup step failed", dst);
+    return rc == SQLITE_DONE;
+}
+
+bool db_copy_file(const char *from, const char *to, int pages_per_step, int pause_ms, DbCopyStats *stats) {
+    DbCopyStats st = { 0 };
+    sqlite3 *src = NULL, *dst = NULL;
+    bool ok = false;
+
+    if (sqlite3_open_v2(from, &src, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        copy_error("cannot open source", src);
+    } else if (sqlite3_open_v2(to, &dst, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK) {
+        copy_error("cannot open destination", dst);
+    } else {
+        sqlite3_busy_timeout(src, 5000);
+        sqlite3_busy_timeout(dst, 5000);
+        // A destination in use by this server is checkpointed by its checkpointer
+        sqlite3_exec(dst, "PRAGMA wal_autocheckpoint=0;", NULL, NULL, NULL);
+        ok = run_backup(src, dst, pages_per_step, pause_ms, &st);
+    }
+    sqlite3_close(src);
+    sqlite3_close(dst);
+    if (stats) *stats = st;
+    return ok;
+}
+
+struct DbFileWatch {
+    sqlite3 *db;
+    sqlite3_stmt *stmt;
+};
+
+DbFileWatch *db_watch_open(const char *path) {
+    DbFileWatch *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    if (sqlite3_open_v2(path, &w->db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(w->db, "PRAGMA data_version;", -1, &w->stmt, NULL) != SQLITE_OK) {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "db_watch_open: %s: %s", path, sqlite3_errmsg(w->db));
+        log_message(buf, LOG_ERROR);
+        db_watch_close(w);
+        return NULL;
+    }
+    sqlite3_busy_timeout(w->db, 1000);
+    return w;
+}
+
+// data_version only moves for commits by other connections, and this one never writes
+bool db_watch_version(DbFileWatch *w, int64_t *version) {
+    bool ok = sqlite3_step(w->stmt) == SQLITE_ROW;
+    if (ok) *version = sqlite3_column_int64(w->stmt, 0);
+    sqlite3_reset(w->stmt);
+    return ok;
+}
+
+void db_watch_close(DbFileWatch *w) {
+    if (!w) return;
+    sqlite3_finalize(w->stmt);
+    sqlite3_close(w->db);
+    free(w);
+}
+
+#pragma endregion Online copies
@@ -0,0 +1,259 @@
+#include "events.h"
+#include "db.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Writers append notifications to a shared ring and never wait for subscribers.
+ * Each subscriber has its own sender thread forwarding the ring, so a client that
+ * stops reading only stalls its own socket. A subscriber that falls a full ring
+ * behind, or whose write blocks for longer than EVENTS_SLOW_WRITE_MS, is
+ * disconnected and has to reload.
+ */
+
+#define EVENTS_RING_SIZE 1024
+#define EVENTS_MAX_SUBSCRIBERS 64
+#define EVENTS_MAX_BATCH 64
+#define EVENTS_SLOW_WRITE_MS 1000
+
+typedef struct {
+    struct mg_connection *conn;
+    uint64_t next;      // sequence number of the next notification to deliver
+    bool active;
+    bool closing;       // ws_close is waiting for the sender to exit
+    bool dropped;
+    bool has_sender;    // sender is running or not joined yet
+    thread_t sender;
+} Subscriber;
+
+static char *ring[EVENTS_RING_SIZE];
+static uint64_t head = 0;   // sequence number of the next notification to publish
+static Subscriber subscribers[EVENTS_MAX_SUBSCRIBERS];
+static int subscriber_count = 0;
+
+static mutex_t lock;
+static cond_t wake;         // broadcast on publish / close / stop
+static bool running = false;
+
+static const char *entity_name(DbEntity e) {
+    switch (e) {
+        case DB_ENTITY_COURSE: return "course";
+        case DB_ENTITY_STUDENT: return "student";
+        case DB_ENTITY_ENROLLMENT: return "enrollment";
+    }
+    return "";
+}
+
+static const char *op_name(DbChangeOp op) {
+    switch (op) {
+        case DB_CHANGE_ADD: return "add";
+        case DB_CHANGE_UPDATE: return "update";
+        case DB_CHANGE_REMOVE: return "remove";
+        case DB_CHANGE_REMOVE_ALL: return "remove_all";
+        case DB_CHANGE_REMOVE_BATCH: return "remove_batch";
+    }
+    return "";
+}
+
+static void on_db_change(const DbChange *c, void *user) {
+    (void)user;
+
+    mutex_lock(&lock);
+    bool wanted = running && subscriber_count > 0;
+    mutex_unlock(&lock);
+    if (!wanted) return;
+
+    json_t *obj = json_object();
+    json_object_set_new(obj, "entity", json_string(entity_name(c->entity)));
+    json_object_set_new(obj, "op", json_string(op_name(c->op)));
+    if (c->key) {
+        json_object_set_new(obj, c->entity == DB_ENTITY_COURSE ? "course_id" : "student_id", json_string(c->key));
+    }
+    if (c->key2) {
+        json_object_set_new(obj, "course_id", json_string(c->key2));
+    }
+    char *msg = json_dumps(obj, JSON_COMPACT);
+    json_decref(obj);
+    if (!msg) return;
+
+    mutex_lock(&lock);
+    free(ring[head % EVENTS_RING_SIZE]);
+    ring[head % EVENTS_RING_SIZE] = msg;
+    head++;
+    cond_broadcast(&wake);
+    mutex_unlock(&lock);
+}
+
+/* Build "[a,b,...]" from the ring starting at s->next. Called with the lock held. */
+static char *build_batch(Subscriber *s, size_t *len_out) {
+    uint64_t end = head;
+    if (end - s->next > EVENTS_MAX_BATCH) end = s->next + EVENTS_MAX_BATCH;
+
+    size_t len = 2;
+    for (uint64_t i = s->next; i < end; i++) len += strlen(ring[i % EVENTS_RING_SIZE]) + 1;
+
+    char *buf = malloc(len + 1);
+    if (!buf) return NULL;
+    size_t n = 0;
+    buf[n++] = '[';
+    for (uint64_t i = s->next; i < end; i++) {
+        const char *msg = ring[i % EVENTS_RING_SIZE];
+        size_t m = strlen(msg);
+        if (i != s->next) buf[n++] = ',';
+        memcpy(buf + n, msg, m);
+        n += m;
+    }
+    buf[n++] = ']';
+    buf[n] = '\0';
+
+    s->next = end;
+    *len_out = n;
+    return buf;
+}
+
+static void drop_subscriber(struct mg_connection *conn) {
+    log_message("events: dropping slow subscriber", LOG_WARN);
+    const char code[2] = { (char)0x03, (char)0xF5 };   // 1013 Try Again Later
+    mg_websocket_write(conn, MG_WEBSOCKET_OPCODE_CONNECTION_CLOSE, code, sizeof(code));
+}
+
+static void sender_loop(void *arg) {
+    Subscriber *s = arg;
+    struct mg_connection *conn = s->conn;
+    mutex_lock(&lock);
+    while (running && !s->closing && !s->dropped) {
+        if (s->next == head) {
+            cond_wait(&wake, &lock);
+            continue;
+        }
+        if (head - s->next > EVENTS_RING_SIZE) {
+            // Fell behind the ring: drop it instead of holding back publishers
+            s->dropped = true;
+            mutex_unlock(&lock);
+            drop_subscriber(conn);
+            mutex_lock(&lock);
+            break;
+        }
+        size_t len = 0;
+        char *buf = build_batch(s, &len);
+        mutex_unlock(&lock);
+        uint64_t started = now_us();
+        bool failed = !buf || mg_websocket_write(conn, MG_WEBSOCKET_OPCODE_TEXT, buf, len) <= 0;
+        // A write this slow means the client's window is full; the next one would block too
+        bool slow = !failed && now_us() - started > (uint64_t)EVENTS_SLOW_WRITE_MS * 1000;
+        free(buf);
+        if (slow) drop_subscriber(conn);
+        mutex_lock(&lock);
+        if (failed || slow) s->dropped = true;
+    }
+    mutex_unlock(&lock);
+}
+
+static int ws_connect(const struct mg_connection *conn, void *cbdata) {
+    (void)conn; (void)cbdata;
+    mutex_lock(&lock);
+    bool full = subscriber_count >= EVENTS_MAX_SUBSCRIBERS;
+    mutex_unlock(&lock);
+    if (full) log_message("events: subscriber limit reached", LOG_WARN);
+    return full ? 1 : 0;    // non-zero rejects the upgrade
+}
+
+static void ws_ready(struct mg_connection *conn, void *cbdata) {
+    (void)cbdata;
+    bool added = false;
+    mutex_lock(&lock);
+    for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS && !added; i++) {
+        Subscriber *s = &subscribers[i];
+        if (s->active) continue;
+        s->conn = conn;
+        s->next = head;
+        s->closing = false;
+        s->dropped = false;
+        s->has_sender = thread_start(&s->sender, sender_loop, s);
+        if (!s->has_sender) break;
+        s->active = true;
+        subscriber_count++;
+        added = true;
+    }
+    mutex_unlock(&lock);
+    if (added) {
+        log_message("events: subscriber connected", LOG_INFO);
+        return;
+    }
+
+    // The table filled up after ws_connect let this one through, or no sender could
+    // be started; tell the client to retry
+    log_message("events: cannot add subscriber", LOG_WARN);
+    const char code[2] = { (char)0x03, (char)0xF5 };   // 1013 Try Again Later
+    mg_websocket_write(conn, MG_WEBSOCKET_OPCODE_CONNECTION_CLOSE, code, sizeof(code));
+}
+
+static int ws_data(struct mg_connection *conn, int bits, char *data, size_t len, void *cbdata) {
+    (void)conn; (void)data; (void)len; (void)cbdata;
+    // The feed is one-way; only watch for the client closing
+    return (bits & 0x0F) == MG_WEBSOCKET_OPCODE_CONNECTION_CLOSE ? 0 : 1;
+}
+
+static void ws_close(const struct mg_connection *conn, void *cbdata) {
+    (void)cbdata;
+    mutex_lock(&lock);
+    for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++) {
+        Subscriber *s = &subscribers[i];
+        if (!s->active || s->conn != conn) continue;
+        // The sender may be writing to conn; it must be gone before civetweb frees it
+        s->closing = true;
+        cond_broadcast(&wake);
+        if (s->has_sender) {
+            s->has_sender = false;
+            mutex_unlock(&lock);
+            thread_join(s->sender);
+            mutex_lock(&lock);
+        }
+        s->active = false;
+        s->conn = NULL;
+        subscriber_count--;
+        break;
+    }
+    mutex_unlock(&lock);
+    log_message("events: subscriber disconnected", LOG_INFO);
+}
+
+bool events_start(struct mg_context *ctx) {
+    static bool registered = false;
+
+    mutex_init(&lock);
+    cond_init(&wake);
+    running = true;
+
+    if (!registered) {
+        if (!db_add_change_listener(on_db_change, NULL)) return false;
+        registered = true;
+    }
+
+    mg_set_websocket_handler(ctx, "/events", ws_connect, ws_ready, ws_data, ws_close, NULL);
+    return true;
+}
+
+void events_stop(void) {
+    mutex_lock(&lock);
+    if (!running) { mutex_unlock(&lock); return; }
+    running = false;
+    cond_broadcast(&wake);
+    // Subscribers stay in the table until civetweb reports their close
+    thread_t senders[EVENTS_MAX_SUBSCRIBERS];
+    int nsenders = 0;
+    for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++) {
+        Subscriber *s = &subscribers[i];
+        if (!s->active || !s->has_sender) continue;
+        s->has_sender = false;
+        senders[nsenders++] = s->sender;
+    }
+    mutex_unlock(&lock);
+    for (int i = 0; i < nsenders; i++) thread_join(senders[i]);
+
+    for (int i = 0; i < EVENTS_RING_SIZE; i++) {
+        free(ring[i]);
+        ring[i] = NULL;
+    }
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include "utils.h"
+
+// WebSocket change feed at /events.
+// Every frame is a JSON array of { "entity", "op", <key fields> } notifications.
+bool events_start(struct mg_context *ctx);
+void events_stop(void);
@@ -0,0 +1,305 @@
+#include "export.h"
+#include "db.h"
+#include "trace.h"
+#include "frontend.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EXPORT_CHUNK_SIZE 16384
+
+typedef enum {
+    EXPORT_CSV,
+    EXPORT_NDJSON
+} ExportFormat;
+
+typedef struct {
+    struct mg_connection *conn;
+    ExportFormat format;
+    uint64_t rows;
+    bool failed;            // the client went away; the rest of the rows are dropped
+    bool spooling;          // chunks go to spool until the visitor returns
+    bool spool_failed;      // out of memory; the rest of the rows are dropped
+    char *spool;
+    size_t spool_len, spool_cap;
+    size_t len;
+    char buf[EXPORT_CHUNK_SIZE];
+} ExportStream;
+
+#pragma region Output
+
+static void spool_chunk(ExportStream *es) {
+    if (es->spool_failed) return;
+    if (es->spool_cap - es->spool_len < es->len) {
+        size_t cap = es->spool_cap ? es->spool_cap : EXPORT_CHUNK_SIZE * 4;
+        while (cap - es->spool_len < es->len) cap *= 2;
+        char *grown = realloc(es->spool, cap);
+        if (!grown) {
+            es->spool_failed = true;
+            return;
+        }
+        es->spool = grown;
+        es->spool_cap = cap;
+    }
+    memcpy(es->spool + es->spool_len, es->buf, es->len);
+    es->spool_len += es->len;
+}
+
+static void flush(ExportStream *es) {
+    if (es->spooling) {
+        if (es->len) spool_chunk(es);
+    } else if (es->len && !es->failed && http_send_chunk(es->conn, es->buf, (unsigned int)es->len) <= 0) {
+        es->failed = true;
+    }
+    es->len = 0;
+}
+
+// Sends what was spooled while the store was locked
+static void send_spool(ExportStream *es) {
+    for (size_t off = 0; off < es->spool_len && !es->failed; off += EXPORT_CHUNK_SIZE) {
+        size_t n = es->spool_len - off < EXPORT_CHUNK_SIZE ? es->spool_len - off : EXPORT_CHUNK_SIZE;
+        if (http_send_chunk(es->conn, es->spool + off, (unsigned int)n) <= 0) es->failed = true;
+    }
+    free(es->spool);
+    es->spool = NULL;
+    es->spool_len = es->spool_cap = 0;
+}
+
+static void put(ExportStream *es, const char *data, size_t n) {
+    while (n > 0) {
+        if (es->len == sizeof(es->buf)) flush(es);
+        size_t take = sizeof(es->buf) - es->len;
+        if (take > n) take = n;
+        memcpy(es->buf + es->len, data, take);
+        es->len += take;
+        data += take;
+        n -= take;
+    }
+}
+
+static void put_str(ExportStream *es, const char *s) {
+    put(es, s, strlen(s));
+}
+
+static void put_char(ExportStream *es, char c) {
+    if (es->len == sizeof(es->buf)) flush(es);
+    es->buf[es->len++] = c;
+}
+
+// Quoted only when needed, RFC 4180 style
+static void put_csv_text(ExportStream *es, const char *s) {
+    if (!s) return;
+    if (!s[strcspn(s, ",\"\r\n")]) {
+        put_str(es, s);
+        return;
+    }
+    put_char(es, '"');
+    for (const char *p = s; *p; p++) {
+        if (*p == '"') put_char(es, '"');
+        put_char(es, *p);
+    }
+    put_char(es, '"');
+}
+
+static void put_json_text(ExportStream *es, const char *s) {
+    put_char(es, '"');
+    for (const unsigned char *p = (const unsigned char *)(s ? s : ""); *p; p++) {
+        switch (*p) {
+        case '"': put_str(es, "\\\""); break;
+        case '\\': put_str(es, "\\\\"); break;
+        case '\n': put_str(es, "\\n"); break;
+        case '\r': put_str(es, "\\r"); break;
+        case '\t': put_str(es, "\\t"); break;
+        default:
+            if (*p < 0x20) {
+                char esc[8];
+                snprintf(esc, sizeof(esc), "\\u%04x", *p);
+                put_str(es, esc);
+            } else {
+                put_char(es, (char)*p);
+            }
+        }
+    }
+    put_char(es, '"');
+}
+
+// JSON keeps a ".0" on whole numbers, as json_real does in the JSON API
+static void put_number(ExportStream *es, double d) {
+    char num[32];
+    int n = snprintf(num, sizeof(num), "%.15g", d);
+    put(es, num, (size_t)n);
+    if (es->format == EXPORT_NDJSON && !strpbrk(num, ".eEn")) put_str(es, ".0");
+}
+
+// Field separators and record ends shared by both formats
+static void begin_field(ExportStream *es, bool first, const char *key) {
+    if (es->format == EXPORT_CSV) {
+        if (!first) put_char(es, ',');
+        return;
+    }
+    put_str(es, first ? "{\"" : ",\"");
+    put_str(es, key);
+    put_str(es, "\":");
+}
+
+static void text_field(ExportStream *es, bool first, const char *key, const char *value) {
+    begin_field(es, first, key);
+    if (es->format == EXPORT_CSV) put_csv_text(es, value);
+    else put_json_text(es, value);
+}
+
+static void number_field(ExportStream *es, bool first, const char *key, double value) {
+    begin_field(es, first, key);
+    put_number(es, value);
+}
+
+static void end_row(ExportStream *es) {
+    if (es->format == EXPORT_CSV) put_str(es, "\r\n");
+    else put_str(es, "}\n");
+    es->rows++;
+}
+
+#pragma endregion Output
+
+#pragma region Visitors
+
+static void export_course(const Course *c, void *user) {
+    ExportStream *es = user;
+    if (es->failed) return;
+    text_field(es, true, "course_id", c->course_id);
+    text_field(es, false, "name", c->name);
+    text_field(es, false, "type", c->type);
+    number_field(es, false, "credit", c->credit);
+    number_field(es, false, "total_hours", c->total_hours);
+    number_field(es, false, "lecture_hours", c->lecture_hours);
+    number_field(es, false, "lab_hours", c->lab_hours);
+    text_field(es, false, "semester", c->semester);
+    end_row(es);
+}
+
+static void export_student(const Student *s, void *user) {
+    ExportStream *es = user;
+    if (es->failed) return;
+    text_field(es, true, "student_id", s->student_id);
+    text_field(es, false, "name", s->name);
+    text_field(es, false, "email", s->email);
+    number_field(es, false, "credits", s->credits);
+    end_row(es);
+}
+
+static void export_enrollment(const Enrollment *e, void *user) {
+    ExportStream *es = user;
+    if (es->failed) return;
+    text_field(es, true, "student_id", e->student_id);
+    text_field(es, false, "course_id", e->course_id);
+    end_row(es);
+}
+
+#pragma endregion Visitors
+
+static int respond_export_error(struct mg_connection *conn, int code, const char *reason, const char *msg) {
+    char body[128];
+    snprintf(body, sizeof(body), "{ \"error\": \"%s\" }", msg);
+    http_printf(conn,
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: application/json\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Content-Length: %d\r\n\r\n%s",
+        code, reason, (int)strlen(body), body);
+    return code;
+}
+
+static bool query_flag(const char *qs, const char *name) {
+    char value[8];
+    return mg_get_var(qs, strlen(qs), name, value, sizeof(value)) > 0 && strcmp(value, "0") != 0 && strcmp(value, "false") != 0;
+}
+
+int handle_export(struct mg_connection *conn) {
+    const struct mg_request_info *ri = http_request_info(conn);
+    const char *entity = ri->local_uri + strlen("/export/");
+    const char *qs = ri->query_string ? ri->query_string : "";
+
+    if (strcmp(entity, "course") != 0 && strcmp(entity, "student") != 0 && strcmp(entity, "enrollment") != 0) {
+        return respond_export_error(conn, 404, "Not Found", "not found");
+    }
+
+    char format[16];
+    ExportFormat fmt = EXPORT_CSV;
+    // -2 means the value did not fit, so it is neither csv nor ndjson
+    if (mg_get_var(qs, strlen(qs), "format", format, sizeof(format)) != -1) {
+        if (strcmp(format, "ndjson") == 0) fmt = EXPORT_NDJSON;
+        else if (strcmp(format, "csv") != 0) return respond_export_error(conn, 400, "Bad Request", "format must be csv or ndjson");
+    }
+    bool snapshot = query_flag(qs, "snapshot");
+
+    ExportStream *es = malloc(sizeof(*es));
+    if (!es) return respond_export_error(conn, 500, "Internal Server Error", "out of memory");
+    es->conn = conn;
+    es->format = fmt;
+    es->rows = 0;
+    es->failed = false;
+    // The memory backend's visitors run under the store's read lock, which a slow
+    // client would otherwise hold against every writer
+    es->spooling = strcmp(db_backend_name(), "memory") == 0;
+    es->spool_failed = false;
+    es->spool = NULL;
+    es->spool_len = es->spool_cap = 0;
+    es->len = 0;
+
+    // A long cursor on the shared connection would pin every other request to its snapshot
+    if (!db_thread_open()) {
+        free(es);
+        return respond_export_error(conn, 500, "Internal Server Error", "db error");
+    }
+    if (snapshot && !db_read_begin()) {
+        db_thread_close();
+        free(es);
+        return respond_export_error(conn, 500, "Internal Server Error", "db error");
+    }
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Exporting %s as %s%s", entity, fmt == EXPORT_CSV ? "csv" : "ndjson", snapshot ? " (snapshot)" : "");
+    log_message(buf, LOG_INFO);
+
+    http_printf(conn,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Disposition: attachment; filename=\"%s.%s\"\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Cache-Control: no-store\r\n"
+        "%s"
+        "Transfer-Encoding: chunked\r\n\r\n",
+        fmt == EXPORT_CSV ? "text/csv; charset=utf-8" : "application/x-ndjson",
+        entity, fmt == EXPORT_CSV ? "csv" : "ndjson", trace_response_header());
+
+    bool ok;
+    if (strcmp(entity, "course") == 0) {
+        if (fmt == EXPORT_CSV) put_str(es, "course_id,name,type,credit,total_hours,lecture_hours,lab_hours,semester\r\n");
+        ok = db_course_list(NULL, export_course, es);
+    } else if (strcmp(entity, "student") == 0) {
+        if (fmt == EXPORT_CSV) put_str(es, "student_id,name,email,credits\r\n");
+        ok = db_student_list(NULL, export_student, es);
+    } else {
+        if (fmt == EXPORT_CSV) put_str(es, "student_id,course_id\r\n");
+        ok = db_enrollment_list(NULL, export_enrollment, es);
+    }
+
+    if (snapshot) db_read_end();
+    db_thread_close();
+
+    if (es->spooling) {
+        flush(es);
+        es->spooling = false;
+        send_spool(es);
+        if (es->spool_failed) ok = false;
+    }
+    if (!ok && fmt == EXPORT_NDJSON) put_str(es, "{\"error\":\"db error\"}\n");
+    flush(es);
+    if (!es->failed && http_send_chunk(conn, "", 0) < 0) es->failed = true;
+
+    snprintf(buf, sizeof(buf), "Exported %llu %s rows%s", (unsigned long long)es->rows, entity,
+             !ok ? " (db error)" : es->failed ? " (client disconnected)" : "");
+    log_message(buf, ok && !es->failed ? LOG_INFO : LOG_WARN);
+    free(es);
+    return ok ? 200 : 500;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "utils.h"
+
+/*
+ * Streaming exports for reporting:
+ *
+ *   GET /export/{course|student|enrollment}?format=csv|ndjson[&snapshot=1]
+ *
+ * Rows are walked with the db_*_list visitors and written to the socket with
+ * chunked transfer encoding through a fixed-size buffer, so memory does not
+ * grow with the table. The memory backend's visitors hold the store's read
+ * lock, so there the rows are serialized into memory first and only sent once
+ * the lock is released; a slow client then cannot hold back writers. CSV (the
+ * default) uses the utils/example_*.csv columns, so an export can be fed back
+ * to curriculum-import; NDJSON writes one object per line with the same fields
+ * as the JSON API. Each export reads through its own connection; snapshot=1
+ * additionally pins one read transaction from before the first byte is sent
+ * until the last (db_read_begin). Errors after the headers are out can only
+ * truncate the stream: NDJSON ends with an {"error":...} line, CSV simply
+ * stops. A format other than csv or ndjson, too long ones included, is a 400.
+ */
+
+int handle_export(struct mg_connection *conn);
@@ -0,0 +1,439 @@
+#include "fastjson.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FASTJSON_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define MAX_FIELDS 8
+
+typedef enum {
+    FIELD_STRING,
+    FIELD_NUMBER
+} FieldType;
+
+typedef struct {
+    const char *name;
+    FieldType type;
+    size_t offset;          // of the const char * or double in the target struct
+    bool required;
+} FieldSpec;
+
+// Where a string value sits in the body until it is decoded
+typedef struct {
+    char *start;
+    char *end;              // the closing quote
+    bool escaped;
+} StringSpan;
+
+typedef struct {
+    char *base;
+    char *p;
+    char *end;
+    char *err;
+    size_t errlen;
+} Scanner;
+
+static FastJsonStatus syntax_error(Scanner *sc, const char *what) {
+    snprintf(sc->err, sc->errlen, "invalid json at offset %d: %s", (int)(sc->p - sc->base), what);
+    return FASTJSON_ERROR;
+}
+
+static FastJsonStatus field_error(Scanner *sc, const FieldSpec *f, const char *what) {
+    snprintf(sc->err, sc->errlen, "%s %s", f->name, what);
+    return FASTJSON_ERROR;
+}
+
+#pragma region Scanning
+
+#ifdef FASTJSON_SSE2
+static int first_bit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return (int)i;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+static bool is_ws(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static void skip_ws(Scanner *sc) {
+    char *p = sc->p;
+    // Compact bodies have no whitespace at all; indented ones have long runs
+    if (p < sc->end && !is_ws(*p)) return;
+#ifdef FASTJSON_SSE2
+    const __m128i sp = _mm_set1_epi8(' '), nl = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r'), tab = _mm_set1_epi8('\t');
+    while (sc->end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, nl)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab)));
+        unsigned other = ~(unsigned)_mm_movemask_epi8(ws) & 0xFFFF;
+        if (other) {
+            sc->p = p + first_bit(other);
+            return;
+        }
+        p += 16;
+    }
+#endif
+    while (p < sc->end && is_ws(*p)) p++;
+    sc->p = p;
+}
+
+// Length of the valid UTF-8 sequence at p (lead byte >= 0x80), or 0
+static int utf8_sequence(const unsigned char *p, const unsigned char *end) {
+    unsigned char c = p[0];
+    int len;
+    unsigned char lo = 0x80, hi = 0xBF;     // allowed range of the second byte
+    if (c >= 0xC2 && c <= 0xDF) len = 2;
+    else if (c == 0xE0) { len = 3; lo = 0xA0; }
+    else if (c == 0xED) { len = 3; hi = 0x9F; }     // no surrogates
+    else if (c >= 0xE1 && c <= 0xEF) len = 3;
+    else if (c == 0xF0) { len = 4; lo = 0x90; }
+    else if (c == 0xF4) { len = 4; hi = 0x8F; }     // nothing above U+10FFFF
+    else if (c >= 0xF1 && c <= 0xF3) len = 4;
+    else return 0;
+    if (end - p < len) return 0;
+    if (p[1] < lo || p[1] > hi) return 0;
+    for (int i = 2; i < len; i++) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+    }
+    return len;
+}
+
+static int hex4(const char *p) {
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        int d = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (d < 0) return -1;
+        v = v << 4 | d;
+    }
+    return v;
+}
+
+/* Validates a string whose opening quote is at sc->p; leaves sc->p after the closing quote. */
+static FastJsonStatus scan_string(Scanner *sc, StringSpan *span, const FieldSpec *field) {
+    char *p = ++sc->p;
+    span->start = p;
+    span->escaped = false;
+    for (;;) {
+#ifdef FASTJSON_SSE2
+        // Skip 16 plain ASCII bytes at a time; signed compare flags both < 0x20 and >= 0x80
+        const __m128i quote = _mm_set1_epi8('"'), bslash = _mm_set1_epi8('\\'), ctl = _mm_set1_epi8(0x20);
+        while (sc->end - p >= 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)p);
+            __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                                           _mm_cmplt_epi8(v, ctl));
+            unsigned mask = (unsigned)_mm_movemask_epi8(special);
+            if (mask) {
+                p += first_bit(mask);
+                break;
+            }
+            p += 16;
+        }
+#endif
+        if (p >= sc->end) {
+            sc->p = p;
+            return syntax_error(sc, "unterminated string");
+        }
+        unsigned char c = (unsigned char)*p;
+        if (c == '"') break;
+        if (c == '\\') {
+            span->escaped = true;
+            char e = p[1];
+            if (e == 'u') {
+                int cp = hex4(p + 2);
+                if (cp < 0) { sc->p = p; return syntax_error(sc, "bad \\u escape"); }
+                // Would cut the string short once decoded, so jansson refuses it too
+                if (cp == 0) { sc->p = p; return syntax_error(sc, "\\u0000 is not allowed"); }
+                p += 6;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    int lo = p[0] == '\\' && p[1] == 'u' ? hex4(p + 2) : -1;
+                    if (lo < 0xDC00 || lo > 0xDFFF) { sc->p = p; return syntax_error(sc, "unpaired surrogate"); }
+                    p += 6;
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    sc->p = p - 6;
+                    return syntax_error(sc, "unpaired surrogate");
+                }
+            } else if (e && strchr("\"\\/bfnrt", e)) {
+                p += 2;
+            } else {
+                sc->p = p;
+                return syntax_error(sc, "bad escape");
+            }
+        } else if (c < 0x20) {
+            sc->p = p;
+            return syntax_error(sc, "control character in string");
+        } else if (c >= 0x80) {
+            int len = utf8_sequence((const unsigned char *)p, (const unsigned char *)sc->end);
+            if (!len) {
+                sc->p = p;
+                if (field) return field_error(sc, field, "is not valid UTF-8");
+                return syntax_error(sc, "invalid UTF-8");
+            }
+            p += len;
+        } else {
+            p++;
+        }
+    }
+    span->end = p;
+    sc->p = p + 1;
+    return FASTJSON_OK;
+}
+
+static FastJsonStatus scan_number(Scanner *sc, double *out) {
+    char *p = sc->p;
+    if (*p == '-') p++;
+    if (*p == '0') p++;
+    else if (*p >= '1' && *p <= '9') while (*p >= '0' && *p <= '9') p++;
+    else return syntax_error(sc, "bad number");
+    if (*p == '.') {
+        p++;
+        if (!(*p >= '0' && *p <= '9')) return syntax_error(sc, "bad number");
+        while (*p >= '0' && *p <= '9') p++;
+    }
+    if (*p == 'e' || *p == 'E') {
+        p++;
+        if (*p == '+' || *p == '-') p++;
+        if (!(*p >= '0' && *p <= '9')) return syntax_error(sc, "bad number");
+        while (*p >= '0' && *p <= '9') p++;
+    }
+    // The grammar is checked above, so strtod sees only a JSON number
+    double d = strtod(sc->p, NULL);
+    if (!isfinite(d)) return syntax_error(sc, "number out of range");
+    *out = d;
+    sc->p = p;
+    return FASTJSON_OK;
+}
+
+static bool scan_literal(Scanner *sc, const char *word) {
+    size_t n = strlen(word);
+    if ((size_t)(sc->end - sc->p) < n || memcmp(sc->p, word, n) != 0) return false;
+    sc->p += n;
+    return true;
+}
+
+#pragma endregion Scanning
+
+#pragma region Decoding
+
+static char *put_utf8(char *dst, unsigned cp) {
+    if (cp < 0x80) {
+        *dst++ = (char)cp;
+    } else if (cp < 0x800) {
+        *dst++ = (char)(0xC0 | cp >> 6);
+        *dst++ = (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *dst++ = (char)(0xE0 | cp >> 12);
+        *dst++ = (char)(0x80 | (cp >> 6 & 0x3F));
+        *dst++ = (char)(0x80 | (cp & 0x3F));
+    } else {
+        *dst++ = (char)(0xF0 | cp >> 18);
+        *dst++ = (char)(0x80 | (cp >> 12 & 0x3F));
+        *dst++ = (char)(0x80 | (cp >> 6 & 0x3F));
+        *dst++ = (char)(0x80 | (cp & 0x3F));
+    }
+    return dst;
+}
+
+/* Unescapes an already validated span in place; the result never outgrows the source. */
+static char *decode_string(const StringSpan *span) {
+    if (!span->escaped) {
+        *span->end = '\0';
+        return span->start;
+    }
+    char *src = span->start, *dst = span->start;
+    while (src < span->end) {
+        char *bs = memchr(src, '\\', (size_t)(span->end - src));
+        size_t run = (size_t)((bs ? bs : span->end) - src);
+        if (dst != src) memmove(dst, src, run);
+        dst += run;
+        src += run;
+        if (!bs) break;
+
+        char e = src[1];
+        src += 2;
+        switch (e) {
+            case 'b': *dst++ = '\b'; break;
+            case 'f': *dst++ = '\f'; break;
+            case 'n': *dst++ = '\n'; break;
+            case 'r': *dst++ = '\r'; break;
+            case 't': *dst++ = '\t'; break;
+            case 'u': {
+                unsigned cp = (unsigned)hex4(src);
+                src += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + ((unsigned)hex4(src + 2) - 0xDC00);
+                    src += 6;
+                }
+                dst = put_utf8(dst, cp);
+                break;
+            }
+            default: *dst++ = e; break;    // " \ /
+        }
+    }
+    *dst = '\0';
+    return span->start;
+}
+
+#pragma endregion Decoding
+
+/* Validates the whole object before writing to body, so UNSUPPORTED leaves it untouched. */
+static FastJsonStatus parse_object(char *body, const FieldSpec *spec, int nfields, void *out, char *err, size_t errlen) {
+    Scanner sc = { body, body, body + strlen(body), err, errlen };
+    StringSpan spans[MAX_FIELDS];
+    bool seen[MAX_FIELDS] = {0};
+    bool present[MAX_FIELDS] = {0};
+    FastJsonStatus st;
+
+    skip_ws(&sc);
+    if (sc.p >= sc.end || *sc.p != '{') return sc.p < sc.end && *sc.p == '[' ? FASTJSON_UNSUPPORTED : syntax_error(&sc, "expected an object");
+    sc.p++;
+    skip_ws(&sc);
+    bool first = true;
+    while (sc.p < sc.end && *sc.p != '}') {
+        if (!first) {
+            if (*sc.p != ',') return syntax_error(&sc, "expected ',' or '}'");
+            sc.p++;
+            skip_ws(&sc);
+        }
+        first = false;
+
+        if (sc.p >= sc.end || *sc.p != '"') return syntax_error(&sc, "expected a key");
+        StringSpan key;
+        if ((st = scan_string(&sc, &key, NULL)) != FASTJSON_OK) return st;
+        if (key.escaped) return FASTJSON_UNSUPPORTED;
+        size_t keylen = (size_t)(key.end - key.start);
+        int i = 0;
+        while (i < nfields && !(strlen(spec[i].name) == keylen && memcmp(spec[i].name, key.start, keylen) == 0)) i++;
+        if (i == nfields) return FASTJSON_UNSUPPORTED;
+        const FieldSpec *f = &spec[i];
+        if (seen[i]) return field_error(&sc, f, "is given twice");
+        seen[i] = true;
+
+        skip_ws(&sc);
+        if (sc.p >= sc.end || *sc.p != ':') return syntax_error(&sc, "expected ':'");
+        sc.p++;
+        skip_ws(&sc);
+        if (sc.p >= sc.end) return syntax_error(&sc, "expected a value");
+
+        char c = *sc.p;
+        if (c == '"') {
+            if (f->type != FIELD_STRING) return field_error(&sc, f, "must be a number");
+            if ((st = scan_string(&sc, &spans[i], f)) != FASTJSON_OK) return st;
+            present[i] = true;
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            if (f->type != FIELD_NUMBER) return field_error(&sc, f, "must be a string");
+            if ((st = scan_number(&sc, (double *)((char *)out + f->offset))) != FASTJSON_OK) return st;
+            present[i] = true;
+        } else if (c == '{' || c == '[') {
+            return FASTJSON_UNSUPPORTED;
+        } else if (scan_literal(&sc, "null")) {
+            // Same as leaving the field out
+        } else if (scan_literal(&sc, "true") || scan_literal(&sc, "false")) {
+            return field_error(&sc, f, f->type == FIELD_STRING ? "must be a string" : "must be a number");
+        } else {
+            return syntax_error(&sc, "expected a value");
+        }
+        skip_ws(&sc);
+    }
+    if (sc.p >= sc.end) return syntax_error(&sc, "unterminated object");
+    sc.p++;
+    skip_ws(&sc);
+    if (sc.p != sc.end) return syntax_error(&sc, "trailing characters");
+
+    for (int i = 0; i < nfields; i++) {
+        if (spec[i].required && !present[i]) return field_error(&sc, &spec[i], "is required");
+    }
+    for (int i = 0; i < nfields; i++) {
+        if (present[i] && spec[i].type == FIELD_STRING) {
+            *(const char **)((char *)out + spec[i].offset) = decode_string(&spans[i]);
+        }
+    }
+    return FASTJSON_OK;
+}
+
+static const FieldSpec course_fields[] = {
+    { "course_id", FIELD_STRING, offsetof(Course, course_id), true },
+    { "name", FIELD_STRING, offsetof(Course, name), false },
+    { "type", FIELD_STRING, offsetof(Course, type), false },
+    { "total_hours", FIELD_NUMBER, offsetof(Course, total_hours), false },
+    { "lecture_hours", FIELD_NUMBER, offsetof(Course, lecture_hours), false },
+    { "lab_hours", FIELD_NUMBER, offsetof(Course, lab_hours), false },
+    { "credit", FIELD_NUMBER, offsetof(Course, credit), true },
+    { "semester", FIELD_STRING, offsetof(Course, semester), false },
+};
+
+static const FieldSpec student_fields[] = {
+    { "student_id", FIELD_STRING, offsetof(Student, student_id), true },
+    { "name", FIELD_STRING, offsetof(Student, name), true },
+    { "email", FIELD_STRING, offsetof(Student, email), false },
+    { "credits", FIELD_NUMBER, offsetof(Student, credits), false },
+};
+
+static const FieldSpec enrollment_fields[] = {
+    { "student_id", FIELD_STRING, offsetof(Enrollment, student_id), true },
+    { "course_id", FIELD_STRING, offsetof(Enrollment, course_id), true },
+};
+
+static FastJsonStatus parse_tree(const json_t *obj, const FieldSpec *spec, int nfields, void *out, char *err, size_t errlen) {
+    if (!json_is_object(obj)) {
+        snprintf(err, errlen, "expected an object");
+        return FASTJSON_ERROR;
+    }
+    for (int i = 0; i < nfields; i++) {
+        const FieldSpec *f = &spec[i];
+        json_t *v = json_object_get(obj, f->name);
+        if (!v || json_is_null(v)) {
+            if (!f->required) continue;
+            snprintf(err, errlen, "%s is required", f->name);
+            return FASTJSON_ERROR;
+        }
+        if (f->type == FIELD_STRING ? !json_is_string(v) : !json_is_number(v)) {
+            snprintf(err, errlen, "%s must be a %s", f->name, f->type == FIELD_STRING ? "string" : "number");
+            return FASTJSON_ERROR;
+        }
+        if (f->type == FIELD_STRING) *(const char **)((char *)out + f->offset) = json_string_value(v);
+        else *(double *)((char *)out + f->offset) = json_number_value(v);
+    }
+    return FASTJSON_OK;
+}
+
+FastJsonStatus fastjson_course(char *body, Course *out, char *err, size_t errlen) {
+    memset(out, 0, sizeof(*out));
+    return parse_object(body, course_fields, (int)(sizeof(course_fields) / sizeof(course_fields[0])), out, err, errlen);
+}
+
+FastJsonStatus fastjson_student(char *body, Student *out, char *err, size_t errlen) {
+    memset(out, 0, sizeof(*out));
+    return parse_object(body, student_fields, (int)(sizeof(student_fields) / sizeof(student_fields[0])), out, err, errlen);
+}
+
+FastJsonStatus fastjson_enrollment(char *body, Enrollment *out, char *err, size_t errlen) {
+    memset(out, 0, sizeof(*out));
+    return parse_object(body, enrollment_fields, (int)(sizeof(enrollment_fields) / sizeof(enrollment_fields[0])), out, err, errlen);
+}
+
+FastJsonStatus fastjson_course_tree(const json_t *obj, Course *out, char *err, size_t errlen) {
+    memset(out, 0, sizeof(*out));
+    return parse_tree(obj, course_fields, (int)(sizeof(course_fields) / sizeof(course_fields[0])), out, err, errlen);
+}
+
+FastJsonStatus fastjson_student_tree(const json_t *obj, Student *out, char *err, size_t errlen) {
+    memset(out, 0, sizeof(*out));
+    return parse_tree(obj, student_fields, (int)(sizeof(student_fields) / sizeof(student_fields[0])), out, err, errlen);
+}
+
+FastJsonStatus fastjson_enrollment_tree(const json_t *obj, Enrollment *out, char *err, size_t errlen) {
+    memset(out, 0, sizeof(*out));
+    return parse_tree(obj, enrollment_fields, (int)(sizeof(enrollment_fields) / sizeof(enrollment_fields[0])), out, err, errlen);
+}
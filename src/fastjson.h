@@ -0,0 +1,38 @@
+#pragma once
+#include "db.h"
+
+/*
+ * Schema-specific decoders for the write endpoints' request bodies. They
+ * decode a flat JSON object straight into a Course/Student/Enrollment without
+ * building a jansson tree or allocating: the body is validated in one pass
+ * (whitespace and string contents are scanned 16 bytes at a time with SSE2
+ * where available, including UTF-8 validation), then the string fields are
+ * unescaped in place and the struct's pointers point into the body.
+ *
+ * FASTJSON_ERROR comes with a message naming the offending field or byte
+ * offset, e.g. "credit must be a number". Shapes the decoders do not handle
+ * (unknown keys, escaped keys, nested objects or arrays) return
+ * FASTJSON_UNSUPPORTED with the body untouched, so the caller can fall back
+ * to jansson.
+ *
+ * The *_tree variants take that fallback's parsed object (or a MessagePack
+ * body decoded to jansson) and apply the same field rules and messages;
+ * unknown keys are ignored there. Strings point into the tree.
+ */
+
+typedef enum {
+    FASTJSON_OK,
+    FASTJSON_ERROR,
+    FASTJSON_UNSUPPORTED
+} FastJsonStatus;
+
+// body must be NUL-terminated and stay alive while out is in use; null counts as absent
+FastJsonStatus fastjson_course(char *body, Course *out, char *err, size_t errlen);
+// credits is accepted but left to the caller
+FastJsonStatus fastjson_student(char *body, Student *out, char *err, size_t errlen);
+FastJsonStatus fastjson_enrollment(char *body, Enrollment *out, char *err, size_t errlen);
+
+// Never FASTJSON_UNSUPPORTED
+FastJsonStatus fastjson_course_tree(const json_t *obj, Course *out, char *err, size_t errlen);
+FastJsonStatus fastjson_student_tree(const json_t *obj, Student *out, char *err, size_t errlen);
+FastJsonStatus fastjson_enrollment_tree(const json_t *obj, Enrollment *out, char *err, size_t errlen);
@@ -0,0 +1,181 @@
+#include "follower.h"
+#include "db.h"
+#include "thread.h"
+#include <string.h>
+#include <sys/stat.h>
+
+static struct {
+    mutex_t lock;                   // guards the counters below
+    cond_t wake;
+    thread_t thread;
+    bool enabled;
+    bool running;
+    bool stopping;
+
+    const char *primary;            // primary database file
+    const char *primary_url;
+    int interval_ms;
+    int step_pages;
+    int pause_ms;
+
+    DbFileWatch *watch;
+    bool copied;
+    int64_t copied_version;         // primary's version when the last copy started
+
+    uint64_t synced_us;             // copy known to match the primary as of then
+    uint64_t copies;
+    uint64_t failures;
+    uint64_t restarts;
+    uint64_t last_copy_us;
+    uint64_t max_copy_us;
+    uint64_t total_copy_us;
+    int last_pages;
+} fl;
+
+static bool same_file(const char *a, const char *b) {
+    struct stat sa, sb;
+    return stat(a, &sa) == 0 && stat(b, &sb) == 0 && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+
+// One poll: copies the primary if it changed since the last copy
+static bool sync_once(void) {
+    uint64_t start = now_us();
+    int64_t version;
+    if (!db_watch_version(fl.watch, &version)) {
+        mutex_lock(&fl.lock);
+        fl.failures++;
+        mutex_unlock(&fl.lock);
+        return false;
+    }
+    if (fl.copied && version == fl.copied_version) {
+        mutex_lock(&fl.lock);
+        fl.synced_us = start;
+        mutex_unlock(&fl.lock);
+        return true;
+    }
+
+    // A commit after version was read only makes the copy newer than start
+    DbCopyStats st;
+    bool ok = db_copy_file(fl.primary, DB_FILE, fl.step_pages, fl.pause_ms, &st);
+    uint64_t elapsed = now_us() - start;
+    if (ok) {
+        db_data_replaced();
+        fl.copied = true;
+        fl.copied_version = version;
+    }
+
+    mutex_lock(&fl.lock);
+    if (ok) {
+        fl.synced_us = start;
+        fl.copies++;
+        fl.restarts += (uint64_t)st.restarts;
+        fl.last_pages = st.pages;
+        fl.last_copy_us = elapsed;
+        fl.total_copy_us += elapsed;
+        if (elapsed > fl.max_copy_us) fl.max_copy_us = elapsed;
+    } else {
+        fl.failures++;
+    }
+    mutex_unlock(&fl.lock);
+    return ok;
+}
+
+static void follower_loop(void *arg) {
+    (void)arg;
+    mutex_lock(&fl.lock);
+    while (!fl.stopping) {
+        cond_timedwait(&fl.wake, &fl.lock, fl.interval_ms);
+        if (fl.stopping) break;
+        mutex_unlock(&fl.lock);
+        sync_once();
+        mutex_lock(&fl.lock);
+    }
+    mutex_unlock(&fl.lock);
+}
+
+bool follower_enabled(void) {
+    return fl.enabled;
+}
+
+bool follower_start(void) {
+    const char *primary = env_str("CURRICULUM_FOLLOW", "");
+    if (!primary[0]) return true;
+
+    if (strcmp(db_backend_name(), "sqlite") != 0) {
+        log_message("CURRICULUM_FOLLOW needs the sqlite backend without shards", LOG_ERROR);
+        return false;
+    }
+    if (env_long("CURRICULUM_PROCESSES", 1) > 1) {
+        log_message("CURRICULUM_FOLLOW runs in a single process: unset CURRICULUM_PROCESSES", LOG_ERROR);
+        return false;
+    }
+    if (same_file(primary, DB_FILE)) {
+        log_message("CURRICULUM_FOLLOW names this server's own database; run the follower in another directory", LOG_ERROR);
+        return false;
+    }
+
+    memset(&fl, 0, sizeof(fl));
+    mutex_init(&fl.lock);
+    cond_init(&fl.wake);
+    fl.primary = primary;
+    fl.primary_url = env_str("CURRICULUM_PRIMARY_URL", "");
+    fl.interval_ms = (int)env_long("CURRICULUM_FOLLOW_INTERVAL_MS", 200);
+    fl.step_pages = (int)env_long("CURRICULUM_FOLLOW_STEP_PAGES", 256);
+    fl.pause_ms = (int)env_long("CURRICULUM_FOLLOW_PAUSE_MS", 1);
+    if (fl.interval_ms < 10) fl.interval_ms = 10;
+    // Writes are refused from here on, even if the first copy fails
+    fl.enabled = true;
+
+    fl.watch = db_watch_open(primary);
+    if (!fl.watch) return false;
+    // Serving starts from a current copy
+    if (!sync_once()) {
+        log_message("Follower: first copy of the primary failed", LOG_ERROR);
+        return false;
+    }
+
+    if (!thread_start(&fl.thread, follower_loop, NULL)) return false;
+    fl.running = true;
+
+    char buf[512];
+    snprintf(buf, sizeof(buf), "Following %s (%d pages copied in %llums, polling every %dms)", primary,
+             fl.last_pages, (unsigned long long)(fl.last_copy_us / 1000), fl.interval_ms);
+    log_message(buf, LOG_INFO);
+    return true;
+}
+
+void follower_stop(void) {
+    if (fl.running) {
+        mutex_lock(&fl.lock);
+        fl.stopping = true;
+        cond_broadcast(&fl.wake);
+        mutex_unlock(&fl.lock);
+        thread_join(fl.thread);
+        fl.running = false;
+    }
+    db_watch_close(fl.watch);
+    fl.watch = NULL;
+}
+
+const char *follower_primary_url(void) {
+    return fl.primary_url ? fl.primary_url : "";
+}
+
+json_t *follower_stats_json(void) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "enabled", json_boolean(fl.enabled));
+    if (!fl.enabled) return obj;
+    mutex_lock(&fl.lock);
+    uint64_t now = now_us();
+    json_object_set_new(obj, "primary", json_string(fl.primary));
+    json_object_set_new(obj, "lag_ms", json_integer(fl.synced_us ? (json_int_t)((now - fl.synced_us) / 1000) : -1));
+    json_object_set_new(obj, "copies", json_integer((json_int_t)fl.copies));
+    json_object_set_new(obj, "failures", json_integer((json_int_t)fl.failures));
+    json_object_set_new(obj, "restarts", json_integer((json_int_t)fl.restarts));
+    json_object_set_new(obj, "last_pages", json_integer(fl.last_pages));
+    json_object_set_new(obj, "last_copy_us", json_integer((json_int_t)fl.last_copy_us));
+    json_object_set_new(obj, "max_copy_us", json_integer((json_int_t)fl.max_copy_us));
+    json_object_set_new(obj, "avg_copy_us", json_integer(fl.copies ? (json_int_t)(fl.total_copy_us / fl.copies) : 0));
+    mutex_unlock(&fl.lock);
+    return obj;
+}
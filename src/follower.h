@@ -0,0 +1,36 @@
+#pragma once
+#include "utils.h"
+
+/*
+ * Follower mode: a second server that keeps a read-only copy of the primary's
+ * database, so reporting reads and exports never compete with registration
+ * writes. Start it in its own directory with CURRICULUM_FOLLOW pointing at the
+ * primary's database file and its own CURRICULUM_PORT; its curriculum.db is
+ * the copy.
+ *
+ * A thread polls the primary file (db_watch_version moves on every commit, by
+ * any process) and whenever it has changed copies it over the local file with
+ * db_copy_file: a few pages per step with a pause in between, so the primary's
+ * checkpointer is never held back for long. Local readers see the old copy
+ * until the new one is complete, then every data version moves so cached
+ * responses are dropped. Lag in /metrics is how long ago the copy was last
+ * known to match the primary.
+ *
+ * GET routes are served from the copy. Every other method answers 307 to the
+ * same path on CURRICULUM_PRIMARY_URL, or 405 when that is not set. Needs the
+ * sqlite backend without shards, in a single process.
+ *
+ * CURRICULUM_FOLLOW              primary database file (unset: not a follower)
+ * CURRICULUM_PRIMARY_URL         where writes are redirected, e.g. http://localhost:8080
+ * CURRICULUM_FOLLOW_INTERVAL_MS  poll interval (default 200)
+ * CURRICULUM_FOLLOW_STEP_PAGES   pages per copy step (default 256)
+ * CURRICULUM_FOLLOW_PAUSE_MS     pause between copy steps (default 1)
+ */
+
+bool follower_enabled(void);
+// Copies the primary once, then keeps following it; call after init_db
+bool follower_start(void);
+void follower_stop(void);
+// "" when writes are not redirected
+const char *follower_primary_url(void);
+json_t *follower_stats_json(void);
@@ -0,0 +1,781 @@
+#ifdef __linux__
+#define _GNU_SOURCE     // accept4
+#endif
+#include "frontend.h"
+#include "thread.h"
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MAX_HEADER_BYTES 16384
+#define MAX_BODY_BYTES (1024 * 1024)
+#define DIRECT_WRITE_BYTES (256 * 1024)
+#define READ_CHUNK 16384
+#define MAX_EVENTS 256
+
+typedef enum {
+    CONN_READING,           // armed for input, owned by the I/O thread
+    CONN_DISPATCHED,        // a worker runs the handler
+    CONN_WRITING            // armed for output, owned by the I/O thread
+} ConnState;
+
+typedef struct FeConn {
+    int fd;
+    struct FeLoop *loop;
+    ConnState state;
+    uint64_t last_active_us;
+    struct FeConn *prev, *next;     // every connection of the loop
+    struct FeConn *queue_next;      // work or completion queue
+    char remote_addr[48];
+    int remote_port;
+
+    char *in;
+    size_t in_len, in_cap;
+    size_t head_len;                // request line and headers, once complete
+    long long content_length;       // -1 when absent
+    size_t body_pos;                // http_read position
+    bool continue_sent;
+    bool keep_alive;
+    struct mg_request_info ri;
+    char *path;                     // ri.local_uri, decoded; the request line keeps the raw one
+    size_t path_cap;
+
+    char *out;
+    size_t out_len, out_cap, out_pos;
+    bool broken;                    // a write failed; output is discarded and the connection closed
+} FeConn;
+
+typedef struct FeLoop {
+    thread_t thread;
+    int epfd;
+    int wakefd;
+    mutex_t lock;                   // guards the completion queue
+    FeConn *done_head, *done_tail;
+    FeConn *conns;
+    int count;
+} FeLoop;
+
+static struct {
+    bool running;
+    bool stopping;
+    int listen_fd;
+    frontend_handler handler;
+    void (*thread_exit)(void);
+    int max_per_loop;
+    int idle_timeout_ms;
+
+    FeLoop *loops;
+    int nloops;
+    thread_t *workers;
+    int nworkers;
+
+    mutex_t lock;                   // guards the work queue
+    cond_t work;
+    FeConn *work_head, *work_tail;
+} fe;
+
+// The connection whose handler runs on this worker thread
+static _Thread_local FeConn *current;
+
+static FeConn *owned(struct mg_connection *conn) {
+    return current && (void *)current == (void *)conn ? current : NULL;
+}
+
+static bool reserve(char **buf, size_t *cap, size_t need) {
+    if (need <= *cap) return true;
+    size_t n = *cap ? *cap : 1024;
+    while (n < need) n *= 2;
+    char *tmp = realloc(*buf, n);
+    if (!tmp) return false;
+    *buf = tmp;
+    *cap = n;
+    return true;
+}
+
+static bool name_is(const char *a, const char *b) {
+    for (; *a && *b; a++, b++) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return false;
+    }
+    return *a == *b;
+}
+
+#pragma region Parsing
+
+static const char *find_crlf2(const char *p, size_t n) {
+    for (size_t i = 3; i < n; i++) {
+        if (p[i] == '\n' && p[i - 1] == '\r' && p[i - 2] == '\n' && p[i - 3] == '\r') return p + i - 3;
+    }
+    return NULL;
+}
+
+// Value of header name in the raw head, not NUL-terminated; len receives its length
+static const char *raw_header(const char *head, const char *end, const char *name, size_t *len) {
+    size_t n = strlen(name);
+    const char *line = memchr(head, '\n', (size_t)(end - head));
+    while (line && ++line < end) {
+        const char *eol = memchr(line, '\r', (size_t)(end - line));
+        if (!eol) break;
+        if ((size_t)(eol - line) > n && line[n] == ':') {
+            size_t i = 0;
+            while (i < n && tolower((unsigned char)line[i]) == name[i]) i++;
+            if (i == n) {
+                const char *v = line + n + 1;
+                while (v < eol && (*v == ' ' || *v == '\t')) v++;
+                *len = (size_t)(eol - v);
+                return v;
+            }
+        }
+        line = eol + 1;
+    }
+    return NULL;
+}
+
+/*
+ * Checks whether a whole request is buffered without modifying the buffer.
+ * Returns 1 when complete, 0 when more input is needed, or an HTTP status to reject it with.
+ */
+static int scan_request(FeConn *c) {
+    if (!c->head_len) {
+        const char *end = find_crlf2(c->in, c->in_len);
+        if (!end) return c->in_len > MAX_HEADER_BYTES ? 431 : 0;
+        if (end - c->in > MAX_HEADER_BYTES) return 431;
+        c->head_len = (size_t)(end - c->in) + 4;
+
+        size_t len;
+        const char *v;
+        c->content_length = -1;
+        if ((v = raw_header(c->in, end + 2, "transfer-encoding", &len)) && !(len == 8 && strncmp(v, "identity", 8) == 0)) return 411;
+        if ((v = raw_header(c->in, end + 2, "content-length", &len))) {
+            long long n = 0;
+            if (len == 0 || len > 10) return 400;
+            for (size_t i = 0; i < len; i++) {
+                if (v[i] < '0' || v[i] > '9') return 400;
+                n = n * 10 + (v[i] - '0');
+            }
+            if (n > MAX_BODY_BYTES) return 413;
+            c->content_length = n;
+        }
+    }
+    size_t body = c->content_length > 0 ? (size_t)c->content_length : 0;
+    if (c->in_len >= c->head_len + body) return 1;
+
+    // curl and browsers wait for this before sending larger bodies
+    size_t len;
+    const char *v = raw_header(c->in, c->in + c->head_len - 2, "expect", &len);
+    if (v && !c->continue_sent && len == 12 && strncmp(v, "100-continue", 12) == 0) {
+        static const char cont[] = "HTTP/1.1 100 Continue\r\n\r\n";
+        c->continue_sent = true;
+        if (send(c->fd, cont, sizeof(cont) - 1, MSG_NOSIGNAL) < 0) return 400;
+    }
+    return 0;
+}
+
+// False for %00, which would cut the path short
+static bool url_decode_path(char *s) {
+    char *dst = s;
+    for (char *p = s; *p; p++) {
+        if (*p == '%' && isxdigit((unsigned char)p[1]) && isxdigit((unsigned char)p[2])) {
+            char hex[3] = { p[1], p[2], 0 };
+            *dst = (char)strtol(hex, NULL, 16);
+            if (!*dst++) return false;
+            p += 2;
+        } else {
+            *dst++ = *p;
+        }
+    }
+    *dst = '\0';
+    return true;
+}
+
+/* Splits the head of a complete request in place into c->ri. Returns 0 or an HTTP status. */
+static int parse_request(FeConn *c) {
+    struct mg_request_info *ri = &c->ri;
+    memset(ri, 0, sizeof(*ri));
+    char *p = c->in;
+    char *end = c->in + c->head_len - 2;     // the final CRLF
+    end[0] = '\0';
+
+    char *eol = strstr(p, "\r\n");
+    if (!eol) return 400;
+    *eol = '\0';
+    char *method = p;
+    char *uri = strchr(method, ' ');
+    if (!uri) return 400;
+    *uri++ = '\0';
+    char *version = strchr(uri, ' ');
+    if (!version || strncmp(version + 1, "HTTP/1.", 7) != 0) return 400;
+    *version = '\0';
+    version += 6;
+    if (*uri != '/') return 400;
+
+    char *query = strchr(uri, '?');
+    if (query) *query++ = '\0';
+    // As in civetweb, handlers route on the decoded path and local_uri_raw stays as sent
+    size_t n = strlen(uri) + 1;
+    if (n > c->path_cap) {
+        char *path = realloc(c->path, n);
+        if (!path) return 503;
+        c->path = path;
+        c->path_cap = n;
+    }
+    memcpy(c->path, uri, n);
+    if (!url_decode_path(c->path)) return 400;
+
+    ri->request_method = method;
+    ri->request_uri = uri;
+    ri->local_uri = c->path;
+    ri->local_uri_raw = uri;
+    ri->http_version = version;
+    ri->query_string = query;
+    ri->content_length = c->content_length;
+    memcpy(ri->remote_addr, c->remote_addr, sizeof(ri->remote_addr));
+    ri->remote_port = c->remote_port;
+
+    bool close = strcmp(version, "1.1") != 0;
+    for (p = eol + 2; p < end; p = eol + 2) {
+        eol = strstr(p, "\r\n");
+        if (!eol) eol = end;
+        *eol = '\0';
+        char *colon = strchr(p, ':');
+        if (!colon) return 400;
+        if (ri->num_headers == (int)(sizeof(ri->http_headers) / sizeof(ri->http_headers[0]))) return 431;
+        *colon = '\0';
+        char *value = colon + 1;
+        while (*value == ' ' || *value == '\t') value++;
+        ri->http_headers[ri->num_headers].name = p;
+        ri->http_headers[ri->num_headers].value = value;
+        ri->num_headers++;
+        if (name_is(p, "connection")) {
+            for (char *v = value; *v; v++) *v = (char)tolower((unsigned char)*v);
+            if (strstr(value, "close")) close = true;
+        }
+        if (eol == end) break;
+    }
+    c->keep_alive = !close;
+    return 0;
+}
+
+#pragma endregion Parsing
+
+#pragma region Connections
+
+static void arm(FeConn *c, uint32_t events) {
+    struct epoll_event ev = { .events = events | EPOLLONESHOT | EPOLLRDHUP, .data.ptr = c };
+    epoll_ctl(c->loop->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+static void conn_close(FeConn *c) {
+    FeLoop *l = c->loop;
+    close(c->fd);
+    if (c->prev) c->prev->next = c->next;
+    else l->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    l->count--;
+    free(c->in);
+    free(c->out);
+    free(c->path);
+    free(c);
+}
+
+static bool out_append(FeConn *c, const void *data, size_t len) {
+    if (!reserve(&c->out, &c->out_cap, c->out_len + len)) return false;
+    memcpy(c->out + c->out_len, data, len);
+    c->out_len += len;
+    return true;
+}
+
+// 1 when everything is written, 0 when the socket is full, -1 on error
+static int send_pending(FeConn *c) {
+    while (c->out_pos < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_pos, c->out_len - c->out_pos, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            c->out_pos += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        } else {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+static void dispatch(FeConn *c);
+static void process_input(FeConn *c);
+
+static void reject(FeConn *c, int status) {
+    const char *reason = status == 411 ? "Length Required" : status == 413 ? "Payload Too Large"
+                       : status == 431 ? "Request Header Fields Too Large"
+                       : status == 503 ? "Service Unavailable" : "Bad Request";
+    char buf[256];
+    int n = snprintf(buf, sizeof(buf),
+        "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\nConnection: close\r\n\r\n{ \"error\": \"%s\" }",
+        status, reason, (int)strlen(reason) + 15, reason);
+    c->keep_alive = false;
+    c->in_len = 0;
+    c->state = CONN_WRITING;
+    if (!out_append(c, buf, (size_t)n) || send_pending(c) != 0) conn_close(c);
+    else arm(c, EPOLLOUT);
+}
+
+// Output is out; pick up the next pipelined request or wait for one
+static void finish_response(FeConn *c) {
+    c->out_len = c->out_pos = 0;
+    if (c->out_cap > 65536) {
+        free(c->out);
+        c->out = NULL;
+        c->out_cap = 0;
+    }
+    if (!c->keep_alive) {
+        conn_close(c);
+        return;
+    }
+    c->state = CONN_READING;
+    c->last_active_us = now_us();
+    process_input(c);
+}
+
+static void write_response(FeConn *c) {
+    int r = c->broken ? -1 : send_pending(c);
+    if (r < 0) conn_close(c);
+    else if (r == 0) arm(c, EPOLLOUT);
+    else finish_response(c);
+}
+
+static void process_input(FeConn *c) {
+    int r = scan_request(c);
+    if (r == 0) arm(c, EPOLLIN);
+    else if (r == 1) dispatch(c);
+    else reject(c, r);
+}
+
+static void on_readable(FeConn *c) {
+    for (;;) {
+        if (c->in_len >= MAX_HEADER_BYTES + MAX_BODY_BYTES + READ_CHUNK) break;
+        if (!reserve(&c->in, &c->in_cap, c->in_len + READ_CHUNK)) {
+            conn_close(c);
+            return;
+        }
+        ssize_t n = recv(c->fd, c->in + c->in_len, c->in_cap - c->in_len, MSG_DONTWAIT);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        // EOF or error; a request that was already complete is not worth answering
+        conn_close(c);
+        return;
+    }
+    c->last_active_us = now_us();
+    process_input(c);
+}
+
+static void on_accept(FeLoop *l) {
+    for (;;) {
+        struct sockaddr_storage addr;
+        socklen_t addrlen = sizeof(addr);
+        int fd = accept4(fe.listen_fd, (struct sockaddr *)&addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // Out of descriptors: the listener stays readable, so back off instead of spinning
+            if (errno == EMFILE || errno == ENFILE) sleep_ms(10);
+            return;             // EAGAIN, or another loop took it
+        }
+        if (l->count >= fe.max_per_loop) {
+            close(fd);
+            continue;
+        }
+        FeConn *c = calloc(1, sizeof(*c));
+        if (!c) {
+            close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (addr.ss_family == AF_INET) {
+            struct sockaddr_in *in = (struct sockaddr_in *)&addr;
+            inet_ntop(AF_INET, &in->sin_addr, c->remote_addr, sizeof(c->remote_addr));
+            c->remote_port = ntohs(in->sin_port);
+        } else if (addr.ss_family == AF_INET6) {
+            struct sockaddr_in6 *in6 = (struct sockaddr_in6 *)&addr;
+            inet_ntop(AF_INET6, &in6->sin6_addr, c->remote_addr, sizeof(c->remote_addr));
+            c->remote_port = ntohs(in6->sin6_port);
+        }
+        c->fd = fd;
+        c->loop = l;
+        c->state = CONN_READING;
+        c->last_active_us = now_us();
+        c->next = l->conns;
+        if (l->conns) l->conns->prev = c;
+        l->conns = c;
+        l->count++;
+
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT | EPOLLRDHUP, .data.ptr = c };
+        if (epoll_ctl(l->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) conn_close(c);
+    }
+}
+
+#pragma endregion Connections
+
+#pragma region Threads
+
+static void dispatch(FeConn *c) {
+    int status = parse_request(c);
+    if (status) {
+        reject(c, status);
+        return;
+    }
+    c->state = CONN_DISPATCHED;
+    c->body_pos = 0;
+    c->queue_next = NULL;
+    mutex_lock(&fe.lock);
+    if (fe.work_tail) fe.work_tail->queue_next = c;
+    else fe.work_head = c;
+    fe.work_tail = c;
+    cond_signal(&fe.work);
+    mutex_unlock(&fe.lock);
+}
+
+// Back on the I/O thread: drop the served request from the input and write the response
+static void complete(FeConn *c) {
+    size_t used = c->head_len + (c->content_length > 0 ? (size_t)c->content_length : 0);
+    memmove(c->in, c->in + used, c->in_len - used);
+    c->in_len -= used;
+    c->head_len = 0;
+    c->continue_sent = false;
+    c->state = CONN_WRITING;
+    write_response(c);
+}
+
+static void sweep_idle(FeLoop *l) {
+    uint64_t now = now_us();
+    uint64_t limit = (uint64_t)fe.idle_timeout_ms * 1000;
+    for (FeConn *c = l->conns, *next; c; c = next) {
+        next = c->next;
+        if (c->state != CONN_DISPATCHED && now - c->last_active_us > limit) conn_close(c);
+    }
+}
+
+static void loop_main(void *arg) {
+    FeLoop *l = arg;
+    struct epoll_event events[MAX_EVENTS];
+    uint64_t last_sweep = now_us();
+    while (!fe.stopping) {
+        int n = epoll_wait(l->epfd, events, MAX_EVENTS, 1000);
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &fe) {
+                on_accept(l);
+            } else if (ptr == l) {
+                uint64_t v;
+                if (read(l->wakefd, &v, sizeof(v)) < 0) {}
+                mutex_lock(&l->lock);
+                FeConn *c = l->done_head;
+                l->done_head = l->done_tail = NULL;
+                mutex_unlock(&l->lock);
+                while (c) {
+                    FeConn *next = c->queue_next;
+                    complete(c);
+                    c = next;
+                }
+            } else {
+                FeConn *c = ptr;
+                if (c->state == CONN_READING) on_readable(c);
+                else if (c->state == CONN_WRITING) write_response(c);
+            }
+        }
+        if (now_us() - last_sweep >= 1000000) {
+            sweep_idle(l);
+            last_sweep = now_us();
+        }
+    }
+}
+
+static void worker_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        mutex_lock(&fe.lock);
+        while (!fe.work_head && !fe.stopping) cond_wait(&fe.work, &fe.lock);
+        if (fe.stopping) {
+            mutex_unlock(&fe.lock);
+            break;
+        }
+        FeConn *c = fe.work_head;
+        fe.work_head = c->queue_next;
+        if (!fe.work_head) fe.work_tail = NULL;
+        mutex_unlock(&fe.lock);
+
+        current = c;
+        fe.handler((struct mg_connection *)c, NULL);
+        current = NULL;
+
+        FeLoop *l = c->loop;
+        c->queue_next = NULL;
+        mutex_lock(&l->lock);
+        if (l->done_tail) l->done_tail->queue_next = c;
+        else l->done_head = c;
+        l->done_tail = c;
+        mutex_unlock(&l->lock);
+        uint64_t one = 1;
+        if (write(l->wakefd, &one, sizeof(one)) < 0) {}
+    }
+    if (fe.thread_exit) fe.thread_exit();
+}
+
+#pragma endregion Threads
+
+static int open_listener(const char *port, bool reuse_port) {
+    char host[256] = "";
+    const char *colon = strrchr(port, ':');
+    if (colon) {
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - port), port);
+        port = colon + 1;
+    }
+    struct addrinfo hints = { 0 }, *res;
+    hints.ai_family = *host ? AF_UNSPEC : AF_INET;   // a bare port listens on IPv4, as civetweb does
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(*host ? host : NULL, port, &hints, &res) != 0) return -1;
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        // Several processes listen on the port and the kernel spreads connections between them
+        if (reuse_port) setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, SOMAXCONN) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+bool frontend_start(const char *port, frontend_handler handler, void (*thread_exit)(void)) {
+    fe.handler = handler;
+    fe.thread_exit = thread_exit;
+    fe.nloops = (int)env_long("CURRICULUM_IO_THREADS", 2);
+    fe.nworkers = (int)env_long("CURRICULUM_WORKERS", env_long("CURRICULUM_HTTP_THREADS", 4));
+    long max_conns = env_long("CURRICULUM_MAX_CONNECTIONS", 10000);
+    fe.idle_timeout_ms = (int)env_long("CURRICULUM_IDLE_TIMEOUT_MS", 60000);
+    if (fe.nloops < 1) fe.nloops = 1;
+    if (fe.nworkers < 1) fe.nworkers = 1;
+    fe.max_per_loop = (int)((max_conns + fe.nloops - 1) / fe.nloops);
+    fe.stopping = false;
+
+    fe.listen_fd = open_listener(port, env_long("CURRICULUM_REUSEPORT", 0) != 0);
+    if (fe.listen_fd < 0) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "frontend: cannot listen on %s", port);
+        log_message(buf, LOG_ERROR);
+        return false;
+    }
+
+    mutex_init(&fe.lock);
+    cond_init(&fe.work);
+    fe.work_head = fe.work_tail = NULL;
+    fe.loops = calloc((size_t)fe.nloops, sizeof(*fe.loops));
+    fe.workers = calloc((size_t)fe.nworkers, sizeof(*fe.workers));
+    if (!fe.loops || !fe.workers) return false;
+
+    for (int i = 0; i < fe.nloops; i++) {
+        FeLoop *l = &fe.loops[i];
+        mutex_init(&l->lock);
+        l->epfd = epoll_create1(EPOLL_CLOEXEC);
+        l->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        // Every loop accepts; EPOLLEXCLUSIVE wakes only one of them per connection
+        struct epoll_event lev = { .events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = &fe };
+        struct epoll_event wev = { .events = EPOLLIN, .data.ptr = l };
+        if (l->epfd < 0 || l->wakefd < 0 ||
+            epoll_ctl(l->epfd, EPOLL_CTL_ADD, fe.listen_fd, &lev) != 0 ||
+            epoll_ctl(l->epfd, EPOLL_CTL_ADD, l->wakefd, &wev) != 0 ||
+            !thread_start(&l->thread, loop_main, l)) {
+            log_message("frontend: cannot start I/O thread", LOG_ERROR);
+            return false;
+        }
+    }
+    for (int i = 0; i < fe.nworkers; i++) {
+        if (!thread_start(&fe.workers[i], worker_main, NULL)) {
+            log_message("frontend: cannot start worker", LOG_ERROR);
+            return false;
+        }
+    }
+    fe.running = true;
+
+    char buf[160];
+    snprintf(buf, sizeof(buf), "epoll front end listening on %s (%d I/O threads, %d workers, %ld connections)",
+             port, fe.nloops, fe.nworkers, max_conns);
+    log_message(buf, LOG_INFO);
+    return true;
+}
+
+void frontend_stop(void) {
+    if (!fe.running) return;
+    // Loops first, so no new work arrives; queued requests are dropped, running ones finish
+    fe.stopping = true;
+    for (int i = 0; i < fe.nloops; i++) {
+        uint64_t one = 1;
+        if (write(fe.loops[i].wakefd, &one, sizeof(one)) < 0) {}
+    }
+    for (int i = 0; i < fe.nloops; i++) thread_join(fe.loops[i].thread);
+    mutex_lock(&fe.lock);
+    cond_broadcast(&fe.work);
+    mutex_unlock(&fe.lock);
+    for (int i = 0; i < fe.nworkers; i++) thread_join(fe.workers[i]);
+
+    for (int i = 0; i < fe.nloops; i++) {
+        FeLoop *l = &fe.loops[i];
+        while (l->conns) conn_close(l->conns);
+        close(l->epfd);
+        close(l->wakefd);
+        mutex_destroy(&l->lock);
+    }
+    close(fe.listen_fd);
+    free(fe.loops);
+    free(fe.workers);
+    fe.loops = NULL;
+    fe.workers = NULL;
+    cond_destroy(&fe.work);
+    mutex_destroy(&fe.lock);
+    fe.running = false;
+}
+
+/* Worker side: writes straight to the socket so streamed responses stay bounded */
+static void flush_direct(FeConn *c) {
+    while (!c->broken) {
+        int r = send_pending(c);
+        if (r == 1) break;
+        struct pollfd p = { .fd = c->fd, .events = POLLOUT };
+        if (r < 0 || poll(&p, 1, fe.idle_timeout_ms) <= 0) c->broken = true;
+    }
+    c->out_len = c->out_pos = 0;
+}
+
+static int frontend_write(FeConn *c, const void *data, size_t len) {
+    if (c->broken) return -1;
+    if (!out_append(c, data, len)) {
+        c->broken = true;
+        return -1;
+    }
+    if (c->out_len - c->out_pos > DIRECT_WRITE_BYTES) flush_direct(c);
+    return c->broken ? -1 : (int)len;
+}
+
+#else
+
+typedef struct FeConn FeConn;
+
+static FeConn *owned(struct mg_connection *conn) {
+    (void)conn;
+    return NULL;
+}
+
+bool frontend_start(const char *port, frontend_handler handler, void (*thread_exit)(void)) {
+    (void)port;
+    (void)handler;
+    (void)thread_exit;
+    log_message("frontend: the epoll front end is only available on Linux", LOG_ERROR);
+    return false;
+}
+
+void frontend_stop(void) {}
+
+static int frontend_write(FeConn *c, const void *data, size_t len) {
+    (void)c;
+    (void)data;
+    (void)len;
+    return -1;
+}
+
+#endif
+
+#pragma region Handler calls
+
+const struct mg_request_info *http_request_info(struct mg_connection *conn) {
+#ifdef __linux__
+    FeConn *c = owned(conn);
+    if (c) return &c->ri;
+#endif
+    return mg_get_request_info(conn);
+}
+
+const char *http_header(struct mg_connection *conn, const char *name) {
+#ifdef __linux__
+    FeConn *c = owned(conn);
+    if (c) {
+        for (int i = 0; i < c->ri.num_headers; i++) {
+            if (name_is(c->ri.http_headers[i].name, name)) return c->ri.http_headers[i].value;
+        }
+        return NULL;
+    }
+#endif
+    return mg_get_header(conn, name);
+}
+
+int http_read(struct mg_connection *conn, void *buf, size_t len) {
+#ifdef __linux__
+    FeConn *c = owned(conn);
+    if (c) {
+        size_t body = c->content_length > 0 ? (size_t)c->content_length : 0;
+        size_t n = body - c->body_pos;
+        if (n > len) n = len;
+        memcpy(buf, c->in + c->head_len + c->body_pos, n);
+        c->body_pos += n;
+        return (int)n;
+    }
+#endif
+    return mg_read(conn, buf, len);
+}
+
+int http_write(struct mg_connection *conn, const void *buf, size_t len) {
+    FeConn *c = owned(conn);
+    if (c) return frontend_write(c, buf, len);
+    return mg_write(conn, buf, len);
+}
+
+int http_printf(struct mg_connection *conn, const char *fmt, ...) {
+    char small[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(small, sizeof(small), fmt, ap);
+    va_end(ap);
+    if (n < 0) return -1;
+    if ((size_t)n < sizeof(small)) return http_write(conn, small, (size_t)n);
+
+    char *big = malloc((size_t)n + 1);
+    if (!big) return -1;
+    va_start(ap, fmt);
+    vsnprintf(big, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    int r = http_write(conn, big, (size_t)n);
+    free(big);
+    return r;
+}
+
+int http_send_chunk(struct mg_connection *conn, const char *chunk, unsigned int len) {
+    if (!owned(conn)) return mg_send_chunk(conn, chunk, len);
+    char head[16];
+    int n = snprintf(head, sizeof(head), "%x\r\n", len);
+    if (http_write(conn, head, (size_t)n) < 0) return -1;
+    if (len && http_write(conn, chunk, len) < 0) return -1;
+    return http_write(conn, "\r\n", 2) < 0 ? -1 : (int)len;
+}
+
+#pragma endregion Handler calls
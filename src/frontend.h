@@ -0,0 +1,37 @@
+#pragma once
+#include "utils.h"
+
+/*
+ * Event-driven HTTP front end, an alternative to civetweb's thread per
+ * connection. A few I/O threads own all sockets through epoll: they accept,
+ * buffer and parse requests and write responses. Complete requests are
+ * handed to a separate worker pool that runs the usual request handler, so
+ * idle or slow keep-alive clients cost a buffer, not a thread.
+ *
+ * Handlers see a struct mg_connection either way and must use the http_*
+ * calls below instead of the mg_* ones. Responses are buffered and written by
+ * the I/O threads; only streamed responses larger than 256 KB are written
+ * from the worker directly. Request bodies must carry a Content-Length of at
+ * most 1 MB. The /events websocket is only served by civetweb.
+ *
+ * CURRICULUM_FRONTEND          civetweb (default) or epoll (Linux only)
+ * CURRICULUM_IO_THREADS        I/O threads (default 2)
+ * CURRICULUM_WORKERS           worker threads (default CURRICULUM_HTTP_THREADS, else 4)
+ * CURRICULUM_MAX_CONNECTIONS   open connections beyond this are closed on accept (default 10000)
+ * CURRICULUM_IDLE_TIMEOUT_MS   idle or incomplete connections are closed after this (default 60000)
+ * CURRICULUM_REUSEPORT         1 sets SO_REUSEPORT on the listener (default 0; see supervisor.h)
+ */
+
+typedef int (*frontend_handler)(struct mg_connection *conn, void *cbdata);
+
+// port is "8080" or "host:8080"; thread_exit (may be NULL) runs on each worker as it exits
+bool frontend_start(const char *port, frontend_handler handler, void (*thread_exit)(void));
+void frontend_stop(void);
+
+// Connection calls for handlers: forward to civetweb or the front end, whichever owns conn
+const struct mg_request_info *http_request_info(struct mg_connection *conn);
+const char *http_header(struct mg_connection *conn, const char *name);
+int http_read(struct mg_connection *conn, void *buf, size_t len);
+int http_write(struct mg_connection *conn, const void *buf, size_t len);
+int http_printf(struct mg_connection *conn, const char *fmt, ...);
+int http_send_chunk(struct mg_connection *conn, const char *chunk, unsigned int len);
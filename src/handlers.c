@@ -7,29 +7,79 @@
 static const char *status_text(int code) {
     switch (code) {
         case 200: return "OK";
+        case 202: return "Accepted";
         case 400: return "Bad Request";
         case 404: return "Not Found";
         case 405: return "Method Not Allowed";
         case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
         default: return "";
     }
 }
 
-static int respond_json_str(struct mg_connection *conn, int code, const char *body) {
+#define JSON_TYPE "application/json"
+#define MSGPACK_TYPE "application/msgpack"
+
+#define RESPONSE_HEAD \
+    "HTTP/1.1 %d %s\r\n" \
+    "Content-Type: %s\r\n" \
+    "Vary: Accept\r\n" \
+    "Access-Control-Allow-Origin: *\r\n" \
+    "Access-Control-Allow-Methods: GET, POST, DELETE, PUT, OPTIONS\r\n" \
+    "Access-Control-Allow-Headers: Content-Type\r\n" \
+    "%s" \
+    "Content-Length: %zu\r\n" \
+    "\r\n"
+
+static int respond_body(struct mg_connection *conn, int code, const char *type, const char *body, size_t len) {
     char buf[512];
     snprintf(buf, sizeof(buf), "Responding %d %s", code, status_text(code));
     log_message(buf, LOG_INFO);
-    mg_printf(conn, 
-        "HTTP/1.1 %d %s\r\n"
-        "Content-Type: application/json\r\n"
-        "Access-Control-Allow-Origin: *\r\n"
-        "Access-Control-Allow-Methods: GET, POST, DELETE, PUT, OPTIONS\r\n"
-        "Access-Control-Allow-Headers: Content-Type\r\n"
-        "\r\n%s", 
-        code, status_text(code), body ? body : "");
+    TraceSpan span;
+    bool traced = trace_span_begin(&span);
+    char head[1536];
+    int n = snprintf(head, sizeof(head), RESPONSE_HEAD, code, status_text(code), type, trace_response_header(), len);
+    if (n < 0 || (size_t)n >= sizeof(head)) n = 0;
+    if (n && (size_t)n + len <= sizeof(head)) {
+        // One write, so small responses go out in a single segment
+        if (len) memcpy(head + n, body, len);
+        http_write(conn, head, (size_t)n + len);
+    } else {
+        // Large bodies (listings, cached responses) go to the socket as they are
+        if (n) http_write(conn, head, (size_t)n);
+        else http_printf(conn, RESPONSE_HEAD, code, status_text(code), type, trace_response_header(), len);
+        if (len) http_write(conn, body, len);
+    }
+    if (traced) trace_span_end(&span, "write", NULL);
     return code;
 }
 
+static int respond_json_str(struct mg_connection *conn, int code, const char *body) {
+    return respond_body(conn, code, JSON_TYPE, body, body ? strlen(body) : 0);
+}
+
+/*
+ * Content negotiation: MessagePack when the client asks for it, JSON
+ * otherwise. Error bodies are always JSON.
+ */
+typedef enum {
+    FORMAT_JSON,
+    FORMAT_MSGPACK
+} BodyFormat;
+
+static BodyFormat media_format(const char *media) {
+    if (media && (strstr(media, MSGPACK_TYPE) || strstr(media, "application/x-msgpack"))) return FORMAT_MSGPACK;
+    return FORMAT_JSON;
+}
+
+static BodyFormat request_format(struct mg_connection *conn) {
+    return media_format(http_header(conn, "Content-Type"));
+}
+
+static BodyFormat response_format(struct mg_connection *conn) {
+    return media_format(http_header(conn, "Accept"));
+}
+
 static int respond_error(struct mg_connection *conn, int code, const char *msg) {
     char buf[256];
     if (!msg) msg = "error";
@@ -67,13 +117,13 @@ static char *url_decode(const char *s) {
     return out;
 }
 
-static char *read_body(struct mg_connection *conn) {
+static char *read_body(struct mg_connection *conn, size_t *len) {
     char buf[1024];
     int r;
     char *data = NULL;
     size_t size = 0;
 
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+    const struct mg_request_info *ri = http_request_info(conn);
     if (ri && ri->content_length > 1024 * 1024) return NULL;
     if (ri) {
         char t[128];
@@ -81,7 +131,9 @@ static char *read_body(struct mg_connection *conn) {
         log_message(t, LOG_DEBUG);
     }
 
-    while ((r = mg_read(conn, buf, sizeof(buf))) > 0) {
+    TraceSpan span;
+    bool traced = trace_span_begin(&span);
+    while ((r = http_read(conn, buf, sizeof(buf))) > 0) {
         char *tmp = realloc(data, size + r + 1);
         if (!tmp) { free(data); return NULL; }
         data = tmp;
@@ -89,9 +141,86 @@ static char *read_body(struct mg_connection *conn) {
         size += r;
     }
     if (data) data[size] = '\0';
+    *len = size;
+    if (traced) trace_span_end(&span, "read_body", NULL);
+    capture_request_body(data, size);
     return data;
 }
 
+/* jansson wrappers that record trace spans */
+static json_t *parse_json(const char *body, json_error_t *err) {
+    TraceSpan span;
+    bool traced = trace_span_begin(&span);
+    json_t *j = json_loads(body, 0, err);
+    if (traced) trace_span_end(&span, "json_parse", NULL);
+    return j;
+}
+
+static char *dump_json(const json_t *j) {
+    TraceSpan span;
+    bool traced = trace_span_begin(&span);
+    char *s = json_dumps(j, 0);
+    if (traced) trace_span_end(&span, "serialize", NULL);
+    return s;
+}
+
+/*
+ * Request body decoders: for JSON the schema-specific parser first, jansson for
+ * shapes it does not handle; MessagePack is decoded into a jansson tree. On
+ * success the strings point into body or *tree, so the caller releases both
+ * (json_decref(NULL) is a no-op) after the mutation.
+ */
+static bool decode_tree(BodyFormat fmt, const char *body, size_t len, json_t **tree, char *err, size_t errlen) {
+    if (fmt == FORMAT_MSGPACK) {
+        TraceSpan span;
+        bool traced = trace_span_begin(&span);
+        *tree = msgpack_to_json(body, len, err, errlen);
+        if (traced) trace_span_end(&span, "msgpack_parse", NULL);
+        return *tree != NULL;
+    }
+    json_error_t jerr;
+    *tree = parse_json(body, &jerr);
+    if (*tree) return true;
+    snprintf(err, errlen, "invalid json");
+    return false;
+}
+
+static bool decode_course(BodyFormat fmt, char *body, size_t len, Course *c, json_t **tree, char *err, size_t errlen) {
+    *tree = NULL;
+    if (fmt == FORMAT_JSON) {
+        TraceSpan span;
+        bool traced = trace_span_begin(&span);
+        FastJsonStatus st = fastjson_course(body, c, err, errlen);
+        if (traced) trace_span_end(&span, "json_parse", NULL);
+        if (st != FASTJSON_UNSUPPORTED) return st == FASTJSON_OK;
+    }
+    return decode_tree(fmt, body, len, tree, err, errlen) && fastjson_course_tree(*tree, c, err, errlen) == FASTJSON_OK;
+}
+
+static bool decode_student(BodyFormat fmt, char *body, size_t len, Student *s, json_t **tree, char *err, size_t errlen) {
+    *tree = NULL;
+    if (fmt == FORMAT_JSON) {
+        TraceSpan span;
+        bool traced = trace_span_begin(&span);
+        FastJsonStatus st = fastjson_student(body, s, err, errlen);
+        if (traced) trace_span_end(&span, "json_parse", NULL);
+        if (st != FASTJSON_UNSUPPORTED) return st == FASTJSON_OK;
+    }
+    return decode_tree(fmt, body, len, tree, err, errlen) && fastjson_student_tree(*tree, s, err, errlen) == FASTJSON_OK;
+}
+
+static bool decode_enrollment(BodyFormat fmt, char *body, size_t len, Enrollment *e, json_t **tree, char *err, size_t errlen) {
+    *tree = NULL;
+    if (fmt == FORMAT_JSON) {
+        TraceSpan span;
+        bool traced = trace_span_begin(&span);
+        FastJsonStatus st = fastjson_enrollment(body, e, err, errlen);
+        if (traced) trace_span_end(&span, "json_parse", NULL);
+        if (st != FASTJSON_UNSUPPORTED) return st == FASTJSON_OK;
+    }
+    return decode_tree(fmt, body, len, tree, err, errlen) && fastjson_enrollment_tree(*tree, e, err, errlen) == FASTJSON_OK;
+}
+
 static char *get_qs_param(const struct mg_request_info *ri, const char *key) {
     if (!ri || !ri->query_string || !key) return NULL;
     size_t keylen = strlen(key);
@@ -116,54 +245,100 @@ static char *get_qs_param(const struct mg_request_info *ri, const char *key) {
     return NULL;
 }
 
-static QueryOptions *parse_query_options(const struct mg_request_info *ri) {
-    static QueryOptions opt;
-    static char *last_order_by = NULL;
-    
-    // Free previous order_by if any
-    if (last_order_by) {
-        free(last_order_by);
-        last_order_by = NULL;
-    }
-    
-    opt.order_by = NULL;
-    opt.order = SORT_ASC;
-    opt.limit = -1;
-    opt.offset = 0;
+// opt->order_by is malloc'd (or NULL); the caller frees it
+static void parse_query_options(const struct mg_request_info *ri, QueryOptions *opt) {
+    opt->order_by = NULL;
+    opt->order = SORT_ASC;
+    opt->limit = -1;
+    opt->offset = 0;
 
-    if (!ri || !ri->query_string) return &opt;
+    if (!ri || !ri->query_string) return;
 
     char *limit_str = get_qs_param(ri, "limit");
     if (limit_str) {
-        opt.limit = atoi(limit_str);
+        opt->limit = atoi(limit_str);
         free(limit_str);
     }
 
     char *offset_str = get_qs_param(ri, "offset");
     if (offset_str) {
-        opt.offset = atoi(offset_str);
+        opt->offset = atoi(offset_str);
         free(offset_str);
     }
 
     char *order_str = get_qs_param(ri, "order");
     if (order_str) {
         if (strcmp(order_str, "desc") == 0) {
-            opt.order = SORT_DESC;
+            opt->order = SORT_DESC;
         }
         free(order_str);
     }
 
-    char *order_by = get_qs_param(ri, "order_by");
-    if (order_by) {
-        last_order_by = order_by;
-        opt.order_by = order_by;
+    opt->order_by = get_qs_param(ri, "order_by");
+}
+
+/*
+ * Reads are split in two: a builder computes status and body from the request
+ * alone, and respond_read answers from the response cache when the entity has
+ * not changed since the body was built, or runs the builder through
+ * singleflight so identical concurrent reads share one query and one
+ * serialized body. Rows are encoded by the visitors below as the query
+ * produces them, into a jansson array or straight into MessagePack.
+ */
+typedef struct {
+    BodyFormat format;
+    json_t *arr;                    // FORMAT_JSON
+    MpWriter mp;                    // FORMAT_MSGPACK
+    size_t mp_array;
+    uint32_t count;
+    char *body;                     // the result
+    size_t len;
+} ReadOut;
+
+static void read_begin(ReadOut *out) {
+    if (out->format == FORMAT_MSGPACK) {
+        mp_init(&out->mp);
+        out->mp_array = mp_array_begin(&out->mp);
+        out->count = 0;
+    } else {
+        out->arr = json_array();
     }
+}
+
+static void course_to_msgpack(const Course *c, MpWriter *w) {
+    mp_map(w, 8);
+    mp_str(w, "course_id"); mp_str(w, c->course_id);
+    mp_str(w, "name"); mp_str(w, c->name);
+    mp_str(w, "type"); mp_str(w, c->type);
+    mp_str(w, "total_hours"); mp_double(w, c->total_hours);
+    mp_str(w, "lecture_hours"); mp_double(w, c->lecture_hours);
+    mp_str(w, "lab_hours"); mp_double(w, c->lab_hours);
+    mp_str(w, "credit"); mp_double(w, c->credit);
+    mp_str(w, "semester"); mp_str(w, c->semester);
+}
 
-    return &opt;
+static void student_to_msgpack(const Student *s, MpWriter *w) {
+    mp_map(w, 4);
+    mp_str(w, "student_id"); mp_str(w, s->student_id);
+    mp_str(w, "name"); mp_str(w, s->name);
+    mp_str(w, "email"); mp_str(w, s->email);
+    mp_str(w, "credits"); mp_double(w, s->credits);
 }
 
-static void course_to_json(const Course *c, void *user) {
-    json_t *arr = user;
+static void enrollment_to_msgpack(const Enrollment *e, MpWriter *w) {
+    mp_map(w, 2);
+    mp_str(w, "student_id"); mp_str(w, e->student_id);
+    mp_str(w, "course_id"); mp_str(w, e->course_id);
+}
+
+static void emit_course(const Course *c, void *user) {
+    ReadOut *out = user;
+    if (out->format == FORMAT_MSGPACK) {
+        course_to_msgpack(c, &out->mp);
+        out->count++;
+        return;
+    }
+    json_t *arr = out->arr;
     json_t *obj = json_object();
     json_object_set_new(obj, "course_id", json_string(c->course_id ? c->course_id : ""));
     json_object_set_new(obj, "name", json_string(c->name ? c->name : ""));
@@ -176,8 +351,14 @@ static void course_to_json(const Course *c, void *user) {
     json_array_append_new(arr, obj);
 }
 
-static void student_to_json(const Student *s, void *user) {
-    json_t *arr = user;
+static void emit_student(const Student *s, void *user) {
+    ReadOut *out = user;
+    if (out->format == FORMAT_MSGPACK) {
+        student_to_msgpack(s, &out->mp);
+        out->count++;
+        return;
+    }
+    json_t *arr = out->arr;
     json_t *obj = json_object();
     json_object_set_new(obj, "student_id", json_string(s->student_id ? s->student_id : ""));
     json_object_set_new(obj, "name", json_string(s->name ? s->name : ""));
@@ -186,184 +367,341 @@ static void student_to_json(const Student *s, void *user) {
     json_array_append_new(arr, obj);
 }
 
-static void enrollment_to_json(const Enrollment *e, void *user) {
-    json_t *arr = user;
+static void emit_enrollment(const Enrollment *e, void *user) {
+    ReadOut *out = user;
+    if (out->format == FORMAT_MSGPACK) {
+        enrollment_to_msgpack(e, &out->mp);
+        out->count++;
+        return;
+    }
+    json_t *arr = out->arr;
     json_t *obj = json_object();
     json_object_set_new(obj, "student_id", json_string(e->student_id ? e->student_id : ""));
     json_object_set_new(obj, "course_id", json_string(e->course_id ? e->course_id : ""));
     json_array_append_new(arr, obj);
 }
 
+typedef int (*ReadBuilder)(const struct mg_request_info *ri, ReadOut *out);
+
+typedef struct {
+    const struct mg_request_info *ri;
+    ReadBuilder build;
+    BodyFormat format;
+} ReadCall;
+
+static SharedBody *run_read(void *arg) {
+    ReadCall *call = arg;
+    ReadOut out = { .format = call->format };
+    int status = call->build(call->ri, &out);
+    return shared_body_new(status, out.body, out.len);
+}
+
+// Request threads read through a connection of their own. On the shared one,
+// statements overlapping from other threads keep one read transaction open, so a
+// read could miss a write that was already acknowledged.
+static _Thread_local bool read_conn_open;
+
+void handlers_thread_exit(void) {
+    if (read_conn_open) db_thread_close();
+    read_conn_open = false;
+}
+
+static int respond_read(struct mg_connection *conn, DbEntity entity, ReadBuilder build) {
+    const struct mg_request_info *ri = http_request_info(conn);
+    if (!read_conn_open) read_conn_open = db_thread_open();
+    ReadCall call = { ri, build, response_format(conn) };
+    // Each format is coalesced and cached on its own
+    const char *prefix = call.format == FORMAT_MSGPACK ? "msgpack " : "";
+    size_t plen = strlen(prefix);
+    char key[1024];
+    memcpy(key, prefix, plen);
+    SharedBody *b;
+    if (singleflight_key(ri, key + plen, sizeof(key) - plen)) {
+        // The version is taken before the query runs, so neither a flight nor a
+        // cache entry is ever newer than its version says
+        uint64_t version = respcache_version(entity);
+        b = respcache_get(key, version);
+        if (!b) {
+            b = singleflight_do(key, version, run_read, &call);
+            if (b && b->status == 200) respcache_put(key, version, b);
+        }
+    } else {
+        b = run_read(&call);
+    }
+    if (!b) return respond_error(conn, 500, "out of memory");
+    const char *type = call.format == FORMAT_MSGPACK && b->status == 200 ? MSGPACK_TYPE : JSON_TYPE;
+    int r = respond_body(conn, b->status, type, b->data, b->len);
+    shared_body_release(b);
+    return r;
+}
+
+static int read_error(ReadOut *out, int code, const char *msg) {
+    size_t n = strlen(msg) + 16;
+    out->body = malloc(n);
+    if (out->body) out->len = (size_t)snprintf(out->body, n, "{ \"error\": \"%s\" }", msg);
+    return code;
+}
+
+static int read_result(bool ok, ReadOut *out) {
+    if (out->format == FORMAT_MSGPACK) {
+        if (!ok) {
+            mp_free(&out->mp);
+            return read_error(out, 500, "db error");
+        }
+        mp_array_end(&out->mp, out->mp_array, out->count);
+        if (out->mp.failed) {
+            mp_free(&out->mp);
+            return 500;             // no body: answered as out of memory
+        }
+        out->body = out->mp.data;
+        out->len = out->mp.len;
+        return 200;
+    }
+    if (!ok) {
+        json_decref(out->arr);
+        return read_error(out, 500, "db error");
+    }
+    out->body = dump_json(out->arr);
+    out->len = out->body ? strlen(out->body) : 0;
+    json_decref(out->arr);
+    return 200;
+}
+
 /* Ping */
 int handle_ping(struct mg_connection *conn) {
     return respond_json_str(conn, 200, "{ \"ok\": true }");
 }
 
+/* Metrics */
+int handle_metrics(struct mg_connection *conn) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "checkpoint", checkpoint_stats_json());
+    json_object_set_new(obj, "capture", capture_stats_json());
+    json_object_set_new(obj, "admission", admission_stats_json());
+    json_object_set_new(obj, "singleflight", singleflight_stats_json());
+    json_object_set_new(obj, "response_cache", respcache_stats_json());
+    json_object_set_new(obj, "follower", follower_stats_json());
+    json_object_set_new(obj, "backup", backup_stats_json());
+    char *s = dump_json(obj);
+    json_decref(obj);
+    int r = respond_json_str(conn, 200, s);
+    free(s);
+    return r;
+}
+
+/* Jobs */
+// Bulk deletes run as a background job when jobs are enabled, inline otherwise
+static int respond_remove_all(struct mg_connection *conn, DbEntity entity, MutationKind kind) {
+    if (!jobs_enabled()) {
+        Mutation m = { .kind = kind };
+        bool ok = writer_submit(&m);
+        if (!ok) return respond_error(conn, 500, "db error");
+        return respond_json_str(conn, 200, "{ \"ok\": true }");
+    }
+    uint64_t id;
+    if (!jobs_submit_remove_all(entity, &id)) return respond_error(conn, 503, "too many unfinished jobs");
+    char buf[128];
+    snprintf(buf, sizeof(buf), "{ \"ok\": true, \"job\": %llu, \"status\": \"/jobs/%llu\" }",
+             (unsigned long long)id, (unsigned long long)id);
+    return respond_json_str(conn, 202, buf);
+}
+
+int handle_jobs_list(struct mg_connection *conn) {
+    json_t *arr = jobs_list_json();
+    char *s = dump_json(arr);
+    json_decref(arr);
+    int r = respond_json_str(conn, 200, s);
+    free(s);
+    return r;
+}
+
+int handle_job_get(struct mg_connection *conn) {
+    const struct mg_request_info *ri = http_request_info(conn);
+    const char *p = ri->local_uri + strlen("/jobs/");
+    char *end;
+    unsigned long long id = strtoull(p, &end, 10);
+    if (!isdigit((unsigned char)*p) || *end) return respond_error(conn, 400, "invalid job id");
+    json_t *obj = jobs_get_json(id);
+    if (!obj) return respond_error(conn, 404, "job not found");
+    char *s = dump_json(obj);
+    json_decref(obj);
+    int r = respond_json_str(conn, 200, s);
+    free(s);
+    return r;
+}
+
+/* Backups */
+// POST starts a backup in the background; GET (and the POST reply) report on it
+int handle_backup(struct mg_connection *conn) {
+    const struct mg_request_info *ri = http_request_info(conn);
+    int code = 200;
+    if (strcmp(ri->request_method, "POST") == 0) {
+        switch (backup_request()) {
+            case BACKUP_STARTED: code = 202; break;
+            case BACKUP_BUSY: return respond_error(conn, 409, "backup already running");
+            case BACKUP_UNAVAILABLE: return respond_error(conn, 501, "backups need the sqlite backend");
+        }
+    }
+    json_t *obj = backup_stats_json();
+    char *s = dump_json(obj);
+    json_decref(obj);
+    int r = respond_json_str(conn, code, s);
+    free(s);
+    return r;
+}
+
+int handle_slow_queries(struct mg_connection *conn) {
+    const struct mg_request_info *ri = http_request_info(conn);
+    int limit = 20;
+    char *limit_str = get_qs_param(ri, "limit");
+    if (limit_str) {
+        limit = atoi(limit_str);
+        free(limit_str);
+    }
+    json_t *obj = slowlog_json(limit);
+    char *s = dump_json(obj);
+    json_decref(obj);
+    int r = respond_json_str(conn, 200, s);
+    free(s);
+    return r;
+}
+
 // Course //
 
 int handle_course_add(struct mg_connection *conn) {
-    char *body = read_body(conn);
+    size_t len;
+    char *body = read_body(conn, &len);
     if (!body) return respond_error(conn, 400, "empty body");
-    json_error_t err;
-    json_t *j = json_loads(body, 0, &err);
+    Course c;
+    json_t *tree;
+    char err[160];
+    if (!decode_course(request_format(conn), body, len, &c, &tree, err, sizeof(err))) { free(body); return respond_error(conn, 400, err); }
+
+    Mutation m = { .kind = MUT_COURSE_ADD, .course = c };
+    bool ok = writer_submit(&m);
+    json_decref(tree);
     free(body);
-    if (!j) return respond_error(conn, 400, "invalid json");
-
-    json_t *jc_id = json_object_get(j, "course_id");
-    json_t *jc_credit = json_object_get(j, "credit");
-    if (!json_is_string(jc_id) || !json_is_number(jc_credit)) { json_decref(j); return respond_error(conn, 400, "course_id and credit required"); }
-
-    Course c = {0};
-    c.course_id = json_string_value(jc_id);
-    c.credit = json_real_value(jc_credit);
-    json_t *tmp;
-    if ((tmp = json_object_get(j, "name")) && json_is_string(tmp)) c.name = json_string_value(tmp);
-    if ((tmp = json_object_get(j, "type")) && json_is_string(tmp)) c.type = json_string_value(tmp);
-    if ((tmp = json_object_get(j, "semester")) && json_is_string(tmp)) c.semester = json_string_value(tmp);
-    if ((tmp = json_object_get(j, "total_hours")) && json_is_number(tmp)) c.total_hours = json_real_value(tmp);
-    if ((tmp = json_object_get(j, "lecture_hours")) && json_is_number(tmp)) c.lecture_hours = json_real_value(tmp);
-    if ((tmp = json_object_get(j, "lab_hours")) && json_is_number(tmp)) c.lab_hours = json_real_value(tmp);
-
-    bool ok = db_course_add(&c);
-    json_decref(j);
     if (!ok) return respond_error(conn, 500, "failed to add course");
     return respond_json_str(conn, 200, "{ \"ok\": true }");
 }
 
 int handle_course_remove(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+    const struct mg_request_info *ri = http_request_info(conn);
     char *course_id = get_qs_param(ri, "course_id");
     if (!course_id) return respond_error(conn, 400, "course_id required");
-    bool ok = db_course_remove(course_id);
+    Mutation m = { .kind = MUT_COURSE_REMOVE, .id = course_id };
+    bool ok = writer_submit(&m);
     free(course_id);
     if (!ok) return respond_error(conn, 500, "failed to remove course");
     return respond_json_str(conn, 200, "{ \"ok\": true }");
 }
 
 int handle_course_remove_all(struct mg_connection *conn) {
-    bool ok = db_course_remove_all();
-    if (!ok) return respond_error(conn, 500, "db error");
-    return respond_json_str(conn, 200, "{ \"ok\": true }");
+    return respond_remove_all(conn, DB_ENTITY_COURSE, MUT_COURSE_REMOVE_ALL);
 }
 
 int handle_course_update(struct mg_connection *conn) {
-    char *body = read_body(conn);
+    size_t len;
+    char *body = read_body(conn, &len);
     if (!body) return respond_error(conn, 400, "empty body");
-    json_error_t err;
-    json_t *j = json_loads(body, 0, &err);
+    Course c;
+    json_t *tree;
+    char err[160];
+    if (!decode_course(request_format(conn), body, len, &c, &tree, err, sizeof(err))) { free(body); return respond_error(conn, 400, err); }
+
+    Mutation m = { .kind = MUT_COURSE_UPDATE, .course = c };
+    bool ok = writer_submit(&m);
+    json_decref(tree);
     free(body);
-    if (!j) return respond_error(conn, 400, "invalid json");
-
-    json_t *jc_id = json_object_get(j, "course_id");
-    json_t *jc_credit = json_object_get(j, "credit");
-    if (!json_is_string(jc_id) || !json_is_number(jc_credit)) { json_decref(j); return respond_error(conn, 400, "course_id and credit required"); }
-
-    Course c = {0};
-    c.course_id = json_string_value(jc_id);
-    c.credit = json_real_value(jc_credit);
-    json_t *tmp;
-    if ((tmp = json_object_get(j, "name")) && json_is_string(tmp)) c.name = json_string_value(tmp);
-    if ((tmp = json_object_get(j, "type")) && json_is_string(tmp)) c.type = json_string_value(tmp);
-    if ((tmp = json_object_get(j, "semester")) && json_is_string(tmp)) c.semester = json_string_value(tmp);
-    if ((tmp = json_object_get(j, "total_hours")) && json_is_number(tmp)) c.total_hours = json_real_value(tmp);
-    if ((tmp = json_object_get(j, "lecture_hours")) && json_is_number(tmp)) c.lecture_hours = json_real_value(tmp);
-    if ((tmp = json_object_get(j, "lab_hours")) && json_is_number(tmp)) c.lab_hours = json_real_value(tmp);
-
-    bool ok = db_course_update(&c);
-    json_decref(j);
     if (!ok) return respond_error(conn, 500, "failed to update course");
     return respond_json_str(conn, 200, "{ \"ok\": true }");
 }
 
+static int build_course_list(const struct mg_request_info *ri, ReadOut *out) {
+    QueryOptions opt;
+    parse_query_options(ri, &opt);
+    read_begin(out);
+    bool ok = db_course_list(&opt, emit_course, out);
+    free((char *)opt.order_by);
+    return read_result(ok, out);
+}
+
 int handle_course_list(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
-    QueryOptions *opt = parse_query_options(ri);
-    json_t *arr = json_array();
-    if (!db_course_list(opt, course_to_json, arr)) { json_decref(arr); return respond_error(conn, 500, "db error"); }
-    char *s = json_dumps(arr, 0);
-    json_decref(arr);
-    int r = respond_json_str(conn, 200, s);
-    free(s);
-    return r;
+    return respond_read(conn, DB_ENTITY_COURSE, build_course_list);
 }
 
-int handle_course_find_by_id(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+static int build_course_find_by_id(const struct mg_request_info *ri, ReadOut *out) {
     char *id = get_qs_param(ri, "id");
-    if (!id) return respond_error(conn, 400, "id required");
-    json_t *arr = json_array();
-    if (!db_course_find_by_id(id, NULL, course_to_json, arr)) { free(id); json_decref(arr); return respond_error(conn, 500, "db error"); }
+    if (!id) return read_error(out, 400, "id required");
+    read_begin(out);
+    bool ok = db_course_find_by_id(id, NULL, emit_course, out);
     free(id);
-    char *s = json_dumps(arr, 0);
-    json_decref(arr);
-    int r = respond_json_str(conn, 200, s);
-    free(s);
-    return r;
+    return read_result(ok, out);
 }
 
-int handle_course_find_by_name(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+int handle_course_find_by_id(struct mg_connection *conn) {
+    return respond_read(conn, DB_ENTITY_COURSE, build_course_find_by_id);
+}
+
+static int build_course_find_by_name(const struct mg_request_info *ri, ReadOut *out) {
     char *name = get_qs_param(ri, "name");
-    if (!name) return respond_error(conn, 400, "name required");
-    json_t *arr = json_array();
-    if (!db_course_find_by_name(name, NULL, course_to_json, arr)) { free(name); json_decref(arr); return respond_error(conn, 500, "db error"); }
+    if (!name) return read_error(out, 400, "name required");
+    read_begin(out);
+    bool ok = db_course_find_by_name(name, NULL, emit_course, out);
     free(name);
-    char *s = json_dumps(arr, 0);
-    json_decref(arr);
-    int r = respond_json_str(conn, 200, s);
-    free(s);
-    return r;
+    return read_result(ok, out);
 }
 
-int handle_course_find_by_type(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+int handle_course_find_by_name(struct mg_connection *conn) {
+    return respond_read(conn, DB_ENTITY_COURSE, build_course_find_by_name);
+}
+
+static int build_course_find_by_type(const struct mg_request_info *ri, ReadOut *out) {
     char *type = get_qs_param(ri, "type");
-    if (!type) return respond_error(conn, 400, "type required");
-    json_t *arr = json_array();
-    if (!db_course_find_by_type(type, NULL, course_to_json, arr)) { free(type); json_decref(arr); return respond_error(conn, 500, "db error"); }
+    if (!type) return read_error(out, 400, "type required");
+    read_begin(out);
+    bool ok = db_course_find_by_type(type, NULL, emit_course, out);
     free(type);
-    char *s = json_dumps(arr, 0);
-    json_decref(arr);
-    int r = respond_json_str(conn, 200, s);
-    free(s);
-    return r;
+    return read_result(ok, out);
 }
 
-int handle_course_find_by_semester(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+int handle_course_find_by_type(struct mg_connection *conn) {
+    return respond_read(conn, DB_ENTITY_COURSE, build_course_find_by_type);
+}
+
+static int build_course_find_by_semester(const struct mg_request_info *ri, ReadOut *out) {
     char *semester = get_qs_param(ri, "semester");
-    if (!semester) return respond_error(conn, 400, "semester required");
-    json_t *arr = json_array();
-    if (!db_course_find_by_semester(semester, NULL, course_to_json, arr)) { free(semester); json_decref(arr); return respond_error(conn, 500, "db error"); }
+    if (!semester) return read_error(out, 400, "semester required");
+    read_begin(out);
+    bool ok = db_course_find_by_semester(semester, NULL, emit_course, out);
     free(semester);
-    char *s = json_dumps(arr, 0);
-    json_decref(arr);
-    int r = respond_json_str(conn, 200, s);
-    free(s);
-    return r;
+    return read_result(ok, out);
+}
+
+int handle_course_find_by_semester(struct mg_connection *conn) {
+    return respond_read(conn, DB_ENTITY_COURSE, build_course_find_by_semester);
 }
 
 // Enrollment //
 
 int handle_enrollment_add(struct mg_connection *conn) {
-    char *body = read_body(conn);
+    size_t len;
+    char *body = read_body(conn, &len);
     if (!body) return respond_error(conn, 400, "empty body");
-    json_error_t err;
-    json_t *j = json_loads(body, 0, &err);
+    Enrollment e;
+    json_t *tree;
+    char err[160];
+    if (!decode_enrollment(request_format(conn), body, len, &e, &tree, err, sizeof(err))) { free(body); return respond_error(conn, 400, err); }
+    Mutation m = { .kind = MUT_ENROLLMENT_ADD, .enrollment = e };
+    bool ok = writer_submit(&m);
+    json_decref(tree);
     free(body);
-    if (!j) return respond_error(conn, 400, "invalid json");
-    json_t *js = json_object_get(j, "student_id");
-    json_t *jc = json_object_get(j, "course_id");
-    if (!json_is_string(js) || !json_is_string(jc)) { json_decref(j); return respond_error(conn, 400, "student_id and course_id required"); }
-    Enrollment e = { json_string_value(jc), json_string_value(js) };
-    bool ok = db_enrollment_add(&e);
-    json_decref(j);
     if (!ok) return respond_error(conn, 500, "db error");
     return respond_json_str(conn, 200, "{ \"ok\": true }");
 }
 
 int handle_enrollment_remove(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+    const struct mg_request_info *ri = http_request_info(conn);
     char *student_id = get_qs_param(ri, "student_id");
     char *course_id = get_qs_param(ri, "course_id");
     if (!student_id || !course_id) { 
@@ -371,152 +709,142 @@ int handle_enrollment_remove(struct mg_connection *conn) {
         if (course_id) free(course_id);
         return respond_error(conn, 400, "student_id and course_id required"); 
     }
-    bool ok = db_enrollment_remove(student_id, course_id);
+    Mutation m = { .kind = MUT_ENROLLMENT_REMOVE, .enrollment = { .course_id = course_id, .student_id = student_id } };
+    bool ok = writer_submit(&m);
     free(student_id);
     free(course_id);
     if (!ok) return respond_error(conn, 500, "db error");
     return respond_json_str(conn, 200, "{ \"ok\": true }");
 }
 
+static int build_enrollment_list(const struct mg_request_info *ri, ReadOut *out) {
+    QueryOptions opt;
+    parse_query_options(ri, &opt);
+    read_begin(out);
+    bool ok = db_enrollment_list(&opt, emit_enrollment, out);
+    free((char *)opt.order_by);
+    return read_result(ok, out);
+}
+
 int handle_enrollment_list(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
-    QueryOptions *opt = parse_query_options(ri);
-    json_t *arr = json_array();
-    if (!db_enrollment_list(opt, enrollment_to_json, arr)) { json_decref(arr); return respond_error(conn, 500, "db error"); }
-    char *s = json_dumps(arr, 0);
-    json_decref(arr);
-    int r = respond_json_str(conn, 200, s);
-    free(s);
-    return r;
+    return respond_read(conn, DB_ENTITY_ENROLLMENT, build_enrollment_list);
 }
 
-int handle_enrollment_find_by_course_id(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+static int build_enrollment_find_by_course_id(const struct mg_request_info *ri, ReadOut *out) {
     char *course_id = get_qs_param(ri, "course_id");
-    if (!course_id) return respond_error(conn, 400, "course_id required");
-    json_t *arr = json_array();
-    if (!db_enrollment_find_by_course_id(course_id, NULL, enrollment_to_json, arr)) { free(course_id); json_decref(arr); return respond_error(conn, 500, "db error"); }
+    if (!course_id) return read_error(out, 400, "course_id required");
+    read_begin(out);
+    bool ok = db_enrollment_find_by_course_id(course_id, NULL, emit_enrollment, out);
     free(course_id);
-    char *s = json_dumps(arr, 0);
-    json_decref(arr);
-    int r = respond_json_str(conn, 200, s);
-    free(s);
-    return r;
+    return read_result(ok, out);
+}
+
+int handle_enrollment_find_by_course_id(struct mg_connection *conn) {
+    return respond_read(conn, DB_ENTITY_ENROLLMENT, build_enrollment_find_by_course_id);
 }
 
 int handle_enrollment_remove_all(struct mg_connection *conn) {
-    bool ok = db_enrollment_remove_all();
-    if (!ok) return respond_error(conn, 500, "db error");
-    return respond_json_str(conn, 200, "{ \"ok\": true }");
+    return respond_remove_all(conn, DB_ENTITY_ENROLLMENT, MUT_ENROLLMENT_REMOVE_ALL);
 }
 
-int handle_enrollment_find_by_student_id(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+static int build_enrollment_find_by_student_id(const struct mg_request_info *ri, ReadOut *out) {
     char *student_id = get_qs_param(ri, "student_id");
-    if (!student_id) return respond_error(conn, 400, "student_id required");
-    json_t *arr = json_array();
-    if (!db_enrollment_find_by_student_id(student_id, NULL, enrollment_to_json, arr)) { free(student_id); json_decref(arr); return respond_error(conn, 500, "db error"); }
+    if (!student_id) return read_error(out, 400, "student_id required");
+    read_begin(out);
+    bool ok = db_enrollment_find_by_student_id(student_id, NULL, emit_enrollment, out);
     free(student_id);
-    char *s = json_dumps(arr, 0);
-    json_decref(arr);
-    int r = respond_json_str(conn, 200, s);
-    free(s);
-    return r;
+    return read_result(ok, out);
+}
+
+int handle_enrollment_find_by_student_id(struct mg_connection *conn) {
+    return respond_read(conn, DB_ENTITY_ENROLLMENT, build_enrollment_find_by_student_id);
 }
 
 // Student //
 int handle_student_add(struct mg_connection *conn) {
-    char *body = read_body(conn);
+    size_t len;
+    char *body = read_body(conn, &len);
     if (!body) return respond_error(conn, 400, "empty body");
-    json_error_t err;
-    json_t *j = json_loads(body, 0, &err);
-    free(body);
-    if (!j) return respond_error(conn, 400, "invalid json");
-    json_t *js = json_object_get(j, "student_id");
-    json_t *jn = json_object_get(j, "name");
-    json_t *je = json_object_get(j, "email");
-    if (!json_is_string(js) || !json_is_string(jn)) { json_decref(j); return respond_error(conn, 400, "student_id and name required"); }
+    Student s;
+    json_t *tree;
+    char err[160];
+    if (!decode_student(request_format(conn), body, len, &s, &tree, err, sizeof(err))) { free(body); return respond_error(conn, 400, err); }
     // Credits are always initialized to 0 and auto-calculated from enrollments
-    Student s = { json_string_value(js), json_string_value(jn), json_is_string(je) ? json_string_value(je) : NULL, 0.0 };
-    bool ok = db_student_add(&s);
-    json_decref(j);
+    s.credits = 0.0;
+    Mutation m = { .kind = MUT_STUDENT_ADD, .student = s };
+    bool ok = writer_submit(&m);
+    json_decref(tree);
+    free(body);
     if (!ok) return respond_error(conn, 500, "db error");
     return respond_json_str(conn, 200, "{ \"ok\": true }");
 }
 
 int handle_student_remove(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+    const struct mg_request_info *ri = http_request_info(conn);
     char *student_id = get_qs_param(ri, "student_id");
     if (!student_id) return respond_error(conn, 400, "student_id required");
-    bool ok = db_student_remove(student_id);
+    Mutation m = { .kind = MUT_STUDENT_REMOVE, .id = student_id };
+    bool ok = writer_submit(&m);
     free(student_id);
     if (!ok) return respond_error(conn, 500, "db error");
     return respond_json_str(conn, 200, "{ \"ok\": true }");
 }
 
 int handle_student_remove_all(struct mg_connection *conn) {
-    bool ok = db_student_remove_all();
-    if (!ok) return respond_error(conn, 500, "db error");
-    return respond_json_str(conn, 200, "{ \"ok\": true }");
+    return respond_remove_all(conn, DB_ENTITY_STUDENT, MUT_STUDENT_REMOVE_ALL);
 }
 
 int handle_student_update(struct mg_connection *conn) {
-    char *body = read_body(conn);
+    size_t len;
+    char *body = read_body(conn, &len);
     if (!body) return respond_error(conn, 400, "empty body");
-    json_error_t err;
-    json_t *j = json_loads(body, 0, &err);
+    Student s;
+    json_t *tree;
+    char err[160];
+    if (!decode_student(request_format(conn), body, len, &s, &tree, err, sizeof(err))) { free(body); return respond_error(conn, 400, err); }
+    Mutation m = { .kind = MUT_STUDENT_UPDATE, .student = s };
+    bool ok = writer_submit(&m);
+    json_decref(tree);
     free(body);
-    if (!j) return respond_error(conn, 400, "invalid json");
-    json_t *js = json_object_get(j, "student_id");
-    json_t *jn = json_object_get(j, "name");
-    json_t *je = json_object_get(j, "email");
-    json_t *jc = json_object_get(j, "credits");
-    if (!json_is_string(js) || !json_is_string(jn)) { json_decref(j); return respond_error(conn, 400, "student_id and name required"); }
-    double credits = 0.0;
-    if (jc && json_is_number(jc)) credits = json_number_value(jc);
-    Student s = { json_string_value(js), json_string_value(jn), json_is_string(je) ? json_string_value(je) : NULL, credits };
-    bool ok = db_student_update(&s);
-    json_decref(j);
     if (!ok) return respond_error(conn, 500, "db error");
     return respond_json_str(conn, 200, "{ \"ok\": true }");
 }
 
+static int build_student_list(const struct mg_request_info *ri, ReadOut *out) {
+    QueryOptions opt;
+    parse_query_options(ri, &opt);
+    read_begin(out);
+    bool ok = db_student_list(&opt, emit_student, out);
+    free((char *)opt.order_by);
+    return read_result(ok, out);
+}
+
 int handle_student_list(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
-    QueryOptions *opt = parse_query_options(ri);
-    json_t *arr = json_array();
-    if (!db_student_list(opt, student_to_json, arr)) { json_decref(arr); return respond_error(conn, 500, "db error"); }
-    char *s = json_dumps(arr, 0);
-    json_decref(arr);
-    int r = respond_json_str(conn, 200, s);
-    free(s);
-    return r;
+    return respond_read(conn, DB_ENTITY_STUDENT, build_student_list);
 }
 
-int handle_student_find_by_id(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+static int build_student_find_by_id(const struct mg_request_info *ri, ReadOut *out) {
     char *id = get_qs_param(ri, "student_id");
-    if (!id) return respond_error(conn, 400, "student_id required");
-    json_t *arr = json_array();
-    if (!db_student_find_by_id(id, NULL, student_to_json, arr)) { free(id); json_decref(arr); return respond_error(conn, 500, "db error"); }
+    if (!id) return read_error(out, 400, "student_id required");
+    read_begin(out);
+    bool ok = db_student_find_by_id(id, NULL, emit_student, out);
     free(id);
-    char *s = json_dumps(arr, 0);
-    json_decref(arr);
-    int r = respond_json_str(conn, 200, s);
-    free(s);
-    return r;
+    return read_result(ok, out);
 }
 
-int handle_student_find_by_name(struct mg_connection *conn) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+int handle_student_find_by_id(struct mg_connection *conn) {
+    return respond_read(conn, DB_ENTITY_STUDENT, build_student_find_by_id);
+}
+
+static int build_student_find_by_name(const struct mg_request_info *ri, ReadOut *out) {
     char *name = get_qs_param(ri, "name");
-    if (!name) return respond_error(conn, 400, "name required");
-    json_t *arr = json_array();
-    if (!db_student_find_by_name(name, NULL, student_to_json, arr)) { free(name); json_decref(arr); return respond_error(conn, 500, "db error"); }
+    if (!name) return read_error(out, 400, "name required");
+    read_begin(out);
+    bool ok = db_student_find_by_name(name, NULL, emit_student, out);
     free(name);
-    char *s = json_dumps(arr, 0);
-    json_decref(arr);
-    int r = respond_json_str(conn, 200, s);
-    free(s);
-    return r;
+    return read_result(ok, out);
+}
+
+int handle_student_find_by_name(struct mg_connection *conn) {
+    return respond_read(conn, DB_ENTITY_STUDENT, build_student_find_by_name);
 }
@@ -1,8 +1,31 @@
 #pragma once
 #include "utils.h"
 #include "db.h"
+#include "writer.h"
+#include "checkpoint.h"
+#include "capture.h"
+#include "export.h"
+#include "slowlog.h"
+#include "trace.h"
+#include "fastjson.h"
+#include "msgpack.h"
+#include "frontend.h"
+#include "admission.h"
+#include "singleflight.h"
+#include "respcache.h"
+#include "jobs.h"
+#include "follower.h"
+#include "backup.h"
+
+// Call on each request thread before it exits; closes the connection reads opened
+void handlers_thread_exit(void);
 
 int handle_ping(struct mg_connection *conn);
+int handle_metrics(struct mg_connection *conn);
+int handle_slow_queries(struct mg_connection *conn);
+int handle_jobs_list(struct mg_connection *conn);
+int handle_job_get(struct mg_connection *conn);
+int handle_backup(struct mg_connection *conn);
 
 int handle_course_add(struct mg_connection *conn);
 int handle_course_update(struct mg_connection *conn);
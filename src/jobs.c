@@ -0,0 +1,290 @@
+#include "jobs.h"
+#include "writer.h"
+#include "slowlog.h"
+#include "thread.h"
+#include <string.h>
+
+typedef struct {
+    uint64_t id;                    // 0 = never used
+    long owner;                     // process that runs the job
+    DbEntity entity;
+    JobState state;
+    int64_t removed;                // rows removed by the chunks
+    int batches;
+    uint64_t submitted_us;
+    uint64_t started_us;
+    uint64_t finished_us;
+} Job;
+
+// Job records, private to this process unless jobs_share placed them in shared memory
+typedef struct {
+    mutex_t lock;
+    uint64_t next_id;               // given to the next job submitted
+    Job jobs[JOBS_MAX];             // job id % JOBS_MAX
+} JobTable;
+
+static JobTable own_table;
+
+static struct {
+    mutex_t lock;                   // taken before table->lock, never after
+    cond_t wake;
+    thread_t thread;
+    bool running;
+    bool stopping;
+
+    int batch;
+    int pause_ms;
+
+    long owner;                     // this process
+    int queued;                     // jobs of this process not yet started
+    JobTable *table;
+} jb = { .table = &own_table };
+
+static const char *entity_name(DbEntity entity) {
+    switch (entity) {
+        case DB_ENTITY_COURSE: return "course";
+        case DB_ENTITY_STUDENT: return "student";
+        case DB_ENTITY_ENROLLMENT: return "enrollment";
+    }
+    return "";
+}
+
+static const char *state_name(JobState state) {
+    switch (state) {
+        case JOB_QUEUED: return "queued";
+        case JOB_RUNNING: return "running";
+        case JOB_DONE: return "done";
+        case JOB_FAILED: return "failed";
+        case JOB_CANCELLED: return "cancelled";
+    }
+    return "";
+}
+
+static MutationKind remove_all_kind(DbEntity entity) {
+    switch (entity) {
+        case DB_ENTITY_COURSE: return MUT_COURSE_REMOVE_ALL;
+        case DB_ENTITY_STUDENT: return MUT_STUDENT_REMOVE_ALL;
+        case DB_ENTITY_ENROLLMENT: break;
+    }
+    return MUT_ENROLLMENT_REMOVE_ALL;
+}
+
+// Shown as the route of the job's statements in the slow-query log
+static const char *job_route(DbEntity entity) {
+    switch (entity) {
+        case DB_ENTITY_COURSE: return "job DELETE /course/all";
+        case DB_ENTITY_STUDENT: return "job DELETE /student/all";
+        case DB_ENTITY_ENROLLMENT: break;
+    }
+    return "job DELETE /enrollment/all";
+}
+
+static JobState run_remove_all(Job *job, DbEntity entity) {
+    slowlog_set_route(job_route(entity));
+    for (;;) {
+        Mutation m = { .kind = MUT_REMOVE_BATCH, .batch = { entity, jb.batch, 0 } };
+        if (!writer_submit(&m)) return JOB_FAILED;
+        if (m.batch.removed == 0) break;
+
+        mutex_lock(&jb.table->lock);
+        job->removed += m.batch.removed;
+        job->batches++;
+        mutex_unlock(&jb.table->lock);
+
+        mutex_lock(&jb.lock);
+        // Leaves the writer to other requests for a moment; shutdown cuts it short
+        if (jb.pause_ms > 0 && !jb.stopping) cond_timedwait(&jb.wake, &jb.lock, jb.pause_ms);
+        bool stop = jb.stopping;
+        mutex_unlock(&jb.lock);
+        if (stop) return JOB_CANCELLED;
+    }
+    // Whatever is left: rows added meanwhile, or everything when the backend has no batches
+    Mutation m = { .kind = remove_all_kind(entity) };
+    return writer_submit(&m) ? JOB_DONE : JOB_FAILED;
+}
+
+// Oldest queued job of this process; caller holds table->lock
+static Job *next_own_job(void) {
+    Job *next = NULL;
+    for (int i = 0; i < JOBS_MAX; i++) {
+        Job *job = &jb.table->jobs[i];
+        if (job->id && job->owner == jb.owner && job->state == JOB_QUEUED && (!next || job->id < next->id)) next = job;
+    }
+    return next;
+}
+
+static void jobs_loop(void *arg) {
+    (void)arg;
+    for (;;) {
+        mutex_lock(&jb.lock);
+        while (!jb.stopping && jb.queued == 0) cond_wait(&jb.wake, &jb.lock);
+        bool stop = jb.stopping;
+        if (!stop) jb.queued--;
+        mutex_unlock(&jb.lock);
+        if (stop) break;
+
+        // The slot cannot be reused while the job is unfinished
+        mutex_lock(&jb.table->lock);
+        Job *job = next_own_job();
+        if (!job) {
+            mutex_unlock(&jb.table->lock);
+            continue;
+        }
+        job->state = JOB_RUNNING;
+        job->started_us = now_us();
+        DbEntity entity = job->entity;
+        uint64_t id = job->id;
+        mutex_unlock(&jb.table->lock);
+
+        char buf[96];
+        snprintf(buf, sizeof(buf), "Job %llu: removing all %s rows", (unsigned long long)id, entity_name(entity));
+        log_message(buf, LOG_INFO);
+        JobState end = run_remove_all(job, entity);
+
+        mutex_lock(&jb.table->lock);
+        job->state = end;
+        job->finished_us = now_us();
+        snprintf(buf, sizeof(buf), "Job %llu %s after %d batches (%lld rows)", (unsigned long long)id,
+                 state_name(end), job->batches, (long long)job->removed);
+        mutex_unlock(&jb.table->lock);
+        log_message(buf, end == JOB_DONE ? LOG_INFO : LOG_WARN);
+    }
+    mutex_lock(&jb.table->lock);
+    for (Job *job; (job = next_own_job()) != NULL;) {
+        job->state = JOB_CANCELLED;
+        job->finished_us = now_us();
+    }
+    mutex_unlock(&jb.table->lock);
+}
+
+bool jobs_start(void) {
+    if (!env_long("CURRICULUM_JOBS", 1)) {
+        log_message("Background jobs disabled: bulk deletes run inline", LOG_INFO);
+        return true;
+    }
+    mutex_init(&jb.lock);
+    cond_init(&jb.wake);
+    if (jb.table == &own_table) {
+        memset(&own_table, 0, sizeof(own_table));
+        mutex_init(&own_table.lock);
+        own_table.next_id = 1;
+    }
+    jb.batch = (int)env_long("CURRICULUM_JOB_BATCH", 200);
+    jb.pause_ms = (int)env_long("CURRICULUM_JOB_PAUSE_MS", 5);
+    if (jb.batch < 1) jb.batch = 1;
+    jb.owner = process_id();
+    jb.queued = 0;
+    jb.stopping = false;
+
+    if (!thread_start(&jb.thread, jobs_loop, NULL)) return false;
+    jb.running = true;
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "Job thread started (batch=%d, pause=%dms)", jb.batch, jb.pause_ms);
+    log_message(buf, LOG_INFO);
+    return true;
+}
+
+void jobs_stop(void) {
+    if (!jb.running) return;
+    mutex_lock(&jb.lock);
+    jb.stopping = true;
+    cond_broadcast(&jb.wake);
+    mutex_unlock(&jb.lock);
+    thread_join(jb.thread);
+    jb.running = false;
+    cond_destroy(&jb.wake);
+    mutex_destroy(&jb.lock);
+    if (jb.table == &own_table) mutex_destroy(&own_table.lock);
+}
+
+size_t jobs_shared_size(void) {
+    return sizeof(JobTable);
+}
+
+bool jobs_share(void *shared) {
+    JobTable *table = shared;
+    memset(table, 0, sizeof(*table));
+    if (!mutex_init_shared(&table->lock)) return false;
+    table->next_id = 1;
+    jb.table = table;
+    return true;
+}
+
+void jobs_fail_process(long owner) {
+    mutex_lock(&jb.table->lock);
+    for (int i = 0; i < JOBS_MAX; i++) {
+        Job *job = &jb.table->jobs[i];
+        if (job->id && job->owner == owner && (job->state == JOB_QUEUED || job->state == JOB_RUNNING)) {
+            job->state = JOB_FAILED;
+            job->finished_us = now_us();
+        }
+    }
+    mutex_unlock(&jb.table->lock);
+}
+
+bool jobs_enabled(void) {
+    return jb.running;
+}
+
+bool jobs_submit_remove_all(DbEntity entity, uint64_t *id) {
+    if (!jb.running) return false;
+    mutex_lock(&jb.lock);
+    mutex_lock(&jb.table->lock);
+    Job *job = &jb.table->jobs[jb.table->next_id % JOBS_MAX];
+    bool ok = !jb.stopping && !(job->id && (job->state == JOB_QUEUED || job->state == JOB_RUNNING));
+    if (ok) {
+        memset(job, 0, sizeof(*job));
+        job->id = jb.table->next_id++;
+        job->owner = jb.owner;
+        job->entity = entity;
+        job->state = JOB_QUEUED;
+        job->submitted_us = now_us();
+        *id = job->id;
+    }
+    mutex_unlock(&jb.table->lock);
+    if (ok) {
+        jb.queued++;
+        cond_broadcast(&jb.wake);
+    }
+    mutex_unlock(&jb.lock);
+    return ok;
+}
+
+static json_t *job_json(const Job *job, uint64_t now) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "id", json_integer((json_int_t)job->id));
+    json_object_set_new(obj, "operation", json_string("remove_all"));
+    json_object_set_new(obj, "entity", json_string(entity_name(job->entity)));
+    json_object_set_new(obj, "state", json_string(state_name(job->state)));
+    json_object_set_new(obj, "removed", json_integer((json_int_t)job->removed));
+    json_object_set_new(obj, "batches", json_integer(job->batches));
+    uint64_t start = job->started_us ? job->started_us : now;
+    uint64_t end = job->finished_us ? job->finished_us : now;
+    json_object_set_new(obj, "queued_ms", json_integer((json_int_t)((start - job->submitted_us) / 1000)));
+    json_object_set_new(obj, "elapsed_ms", json_integer(job->started_us ? (json_int_t)((end - start) / 1000) : 0));
+    return obj;
+}
+
+json_t *jobs_get_json(uint64_t id) {
+    if (!jb.running || id == 0) return NULL;
+    mutex_lock(&jb.table->lock);
+    const Job *job = &jb.table->jobs[id % JOBS_MAX];
+    json_t *obj = job->id == id ? job_json(job, now_us()) : NULL;
+    mutex_unlock(&jb.table->lock);
+    return obj;
+}
+
+json_t *jobs_list_json(void) {
+    json_t *arr = json_array();
+    if (!jb.running) return arr;
+    mutex_lock(&jb.table->lock);
+    uint64_t now = now_us();
+    uint64_t next_id = jb.table->next_id;
+    for (uint64_t id = next_id - 1; id > 0 && next_id - id <= JOBS_MAX; id--) {
+        const Job *job = &jb.table->jobs[id % JOBS_MAX];
+        if (job->id == id) json_array_append_new(arr, job_json(job, now));
+    }
+    mutex_unlock(&jb.table->lock);
+    return arr;
+}
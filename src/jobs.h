@@ -0,0 +1,53 @@
+#pragma once
+#include "utils.h"
+#include "db.h"
+#include <stdint.h>
+
+/*
+ * Background jobs for bulk deletes. DELETE /course/all, /student/all and
+ * /enrollment/all answer 202 with a job ID at once. A job thread then deletes
+ * in chunks of CURRICULUM_JOB_BATCH rows (see db_remove_batch), each one
+ * submitted to the writer as its own mutation, so the write lock is released
+ * after every chunk and interactive writes queued behind it go through. Once
+ * a chunk finds nothing left the job finishes with the ordinary remove_all,
+ * which also takes rows added while it ran. GET /jobs/{id} reports progress.
+ *
+ * Jobs run one at a time in submission order and are kept in memory only: a
+ * job cut short by shutdown is cancelled, and the last JOBS_MAX are
+ * remembered. Under the supervisor (see supervisor.h) the records live in
+ * memory shared by all server processes, so any of them answers /jobs; each
+ * job still runs in the process that accepted it.
+ *
+ * CURRICULUM_JOBS          0 runs bulk deletes inline as before (default 1)
+ * CURRICULUM_JOB_BATCH     rows per chunk (default 200)
+ * CURRICULUM_JOB_PAUSE_MS  pause between chunks (default 5)
+ */
+
+#define JOBS_MAX 64
+
+typedef enum {
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE,
+    JOB_FAILED,
+    JOB_CANCELLED
+} JobState;
+
+bool jobs_start(void);
+void jobs_stop(void);
+bool jobs_enabled(void);
+
+// Queues a remove_all of entity; false when too many jobs are unfinished
+bool jobs_submit_remove_all(DbEntity entity, uint64_t *id);
+
+// Moves the job records into shared memory of jobs_shared_size() bytes; call
+// before forking the server processes and before jobs_start
+size_t jobs_shared_size(void);
+bool jobs_share(void *shared);
+// Marks the unfinished jobs of a process that died as failed
+void jobs_fail_process(long owner);
+
+// NULL when id is unknown or has been forgotten
+json_t *jobs_get_json(uint64_t id);
+// Most recent first
+json_t *jobs_list_json(void);
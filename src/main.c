@@ -1,4 +1,5 @@
 #include "server.h"
+#include "supervisor.h"
 #include "utils.h"
 
 int main(void) {
@@ -11,12 +12,22 @@ int main(void) {
 
     log_message("Starting course server...", LOG_INFO);
 
-    if (!start_server("8080")) {
+    const char *port = env_str("CURRICULUM_PORT", "8080");
+    long processes = env_long("CURRICULUM_PROCESSES", 1);
+    if (processes > 1) {
+        int rc = supervisor_run(port, (int)processes);
+        log_close();
+        return rc;
+    }
+
+    if (!start_server(port)) {
         log_message("Failed to start server", LOG_ERROR);
         return 1;
     }
 
-    log_message("Server running on http://localhost:8080", LOG_INFO);
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Server running on http://localhost:%s", port);
+    log_message(buf, LOG_INFO);
     log_message("Press ENTER to quit...", LOG_INFO);
     getchar();
 
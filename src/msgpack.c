@@ -0,0 +1,243 @@
+#include "msgpack.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DEPTH 32
+
+#pragma region Encoder
+
+void mp_init(MpWriter *w) {
+    memset(w, 0, sizeof(*w));
+}
+
+void mp_free(MpWriter *w) {
+    free(w->data);
+    mp_init(w);
+}
+
+static unsigned char *reserve(MpWriter *w, size_t n) {
+    if (w->failed) return NULL;
+    if (w->len + n > w->cap) {
+        size_t cap = w->cap ? w->cap * 2 : 4096;
+        while (cap < w->len + n) cap *= 2;
+        char *data = realloc(w->data, cap);
+        if (!data) {
+            w->failed = true;
+            return NULL;
+        }
+        w->data = data;
+        w->cap = cap;
+    }
+    unsigned char *p = (unsigned char *)w->data + w->len;
+    w->len += n;
+    return p;
+}
+
+static void put_be(unsigned char *p, uint64_t v, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+        p[i] = (unsigned char)v;
+        v >>= 8;
+    }
+}
+
+size_t mp_array_begin(MpWriter *w) {
+    size_t at = w->len;
+    unsigned char *p = reserve(w, 5);
+    if (p) p[0] = 0xdd;             // array 32
+    return at;
+}
+
+void mp_array_end(MpWriter *w, size_t at, uint32_t count) {
+    if (!w->failed) put_be((unsigned char *)w->data + at + 1, count, 4);
+}
+
+void mp_map(MpWriter *w, uint32_t count) {
+    unsigned char *p;
+    if (count < 16) {
+        if ((p = reserve(w, 1))) p[0] = (unsigned char)(0x80 | count);
+    } else if (count <= 0xffff) {
+        if ((p = reserve(w, 3))) { p[0] = 0xde; put_be(p + 1, count, 2); }
+    } else {
+        if ((p = reserve(w, 5))) { p[0] = 0xdf; put_be(p + 1, count, 4); }
+    }
+}
+
+void mp_str(MpWriter *w, const char *s) {
+    size_t n = s ? strlen(s) : 0;
+    unsigned char *p;
+    if (n < 32) {
+        if (!(p = reserve(w, 1 + n))) return;
+        *p++ = (unsigned char)(0xa0 | n);
+    } else if (n <= 0xff) {
+        if (!(p = reserve(w, 2 + n))) return;
+        *p++ = 0xd9;
+        *p++ = (unsigned char)n;
+    } else if (n <= 0xffff) {
+        if (!(p = reserve(w, 3 + n))) return;
+        *p++ = 0xda;
+        put_be(p, n, 2);
+        p += 2;
+    } else {
+        if (!(p = reserve(w, 5 + n))) return;
+        *p++ = 0xdb;
+        put_be(p, n, 4);
+        p += 4;
+    }
+    if (n) memcpy(p, s, n);
+}
+
+void mp_double(MpWriter *w, double d) {
+    unsigned char *p = reserve(w, 9);
+    if (!p) return;
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    p[0] = 0xcb;                    // float 64
+    put_be(p + 1, bits, 8);
+}
+
+#pragma endregion Encoder
+
+#pragma region Decoder
+
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+    char *err;
+    size_t errlen;
+} MpReader;
+
+static json_t *fail(MpReader *r, const char *what) {
+    snprintf(r->err, r->errlen, "invalid msgpack: %s", what);
+    return NULL;
+}
+
+static bool take(MpReader *r, size_t n, const unsigned char **out) {
+    if ((size_t)(r->end - r->p) < n) return false;
+    *out = r->p;
+    r->p += n;
+    return true;
+}
+
+static bool take_be(MpReader *r, int bytes, uint64_t *v) {
+    const unsigned char *p;
+    if (!take(r, (size_t)bytes, &p)) return false;
+    *v = 0;
+    for (int i = 0; i < bytes; i++) *v = (*v << 8) | p[i];
+    return true;
+}
+
+static json_t *read_value(MpReader *r, int depth);
+
+static json_t *read_str(MpReader *r, size_t n) {
+    const unsigned char *s;
+    if (!take(r, n, &s)) return fail(r, "truncated string");
+    json_t *j = json_stringn((const char *)s, n);
+    return j ? j : fail(r, "string is not valid UTF-8");
+}
+
+static json_t *read_array(MpReader *r, uint64_t n, int depth) {
+    // Each element takes at least one byte, so a huge count cannot be honest
+    if (n > (uint64_t)(r->end - r->p)) return fail(r, "truncated array");
+    json_t *arr = json_array();
+    for (uint64_t i = 0; i < n; i++) {
+        json_t *v = read_value(r, depth + 1);
+        if (!v) {
+            json_decref(arr);
+            return NULL;
+        }
+        json_array_append_new(arr, v);
+    }
+    return arr;
+}
+
+static json_t *read_map(MpReader *r, uint64_t n, int depth) {
+    if (n > (uint64_t)(r->end - r->p) / 2) return fail(r, "truncated map");
+    json_t *obj = json_object();
+    for (uint64_t i = 0; i < n; i++) {
+        json_t *k = read_value(r, depth + 1);
+        if (!k || !json_is_string(k) || memchr(json_string_value(k), '\0', json_string_length(k))) {
+            if (k) fail(r, "map keys must be strings");
+            json_decref(k);
+            json_decref(obj);
+            return NULL;
+        }
+        json_t *v = read_value(r, depth + 1);
+        if (!v) {
+            json_decref(k);
+            json_decref(obj);
+            return NULL;
+        }
+        json_object_set_new(obj, json_string_value(k), v);
+        json_decref(k);
+    }
+    return obj;
+}
+
+static json_t *read_value(MpReader *r, int depth) {
+    if (depth > MAX_DEPTH) return fail(r, "nested too deeply");
+    const unsigned char *tp;
+    if (!take(r, 1, &tp)) return fail(r, "truncated");
+    unsigned char t = *tp;
+    uint64_t n;
+
+    if (t <= 0x7f) return json_integer(t);
+    if (t >= 0xe0) return json_integer((int8_t)t);
+    if ((t & 0xe0) == 0xa0) return read_str(r, t & 0x1f);
+    if ((t & 0xf0) == 0x90) return read_array(r, t & 0x0f, depth);
+    if ((t & 0xf0) == 0x80) return read_map(r, t & 0x0f, depth);
+
+    switch (t) {
+        case 0xc0: return json_null();
+        case 0xc2: return json_false();
+        case 0xc3: return json_true();
+        case 0xca: {
+            if (!take_be(r, 4, &n)) return fail(r, "truncated float");
+            uint32_t bits = (uint32_t)n;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            json_t *j = json_real(f);
+            return j ? j : fail(r, "number is not finite");
+        }
+        case 0xcb: {
+            if (!take_be(r, 8, &n)) return fail(r, "truncated float");
+            double d;
+            memcpy(&d, &n, sizeof(d));
+            json_t *j = json_real(d);
+            return j ? j : fail(r, "number is not finite");
+        }
+        case 0xcc: case 0xcd: case 0xce: case 0xcf: {
+            if (!take_be(r, 1 << (t - 0xcc), &n)) return fail(r, "truncated integer");
+            return n > INT64_MAX ? json_real((double)n) : json_integer((json_int_t)n);
+        }
+        case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+            int bytes = 1 << (t - 0xd0);
+            if (!take_be(r, bytes, &n)) return fail(r, "truncated integer");
+            if (bytes < 8 && (n >> (bytes * 8 - 1))) n |= ~(uint64_t)0 << (bytes * 8);  // sign-extend
+            return json_integer((json_int_t)(int64_t)n);
+        }
+        case 0xd9: case 0xda: case 0xdb:
+            if (!take_be(r, 1 << (t - 0xd9), &n)) return fail(r, "truncated string");
+            return read_str(r, (size_t)n);
+        case 0xdc: case 0xdd:
+            if (!take_be(r, t == 0xdc ? 2 : 4, &n)) return fail(r, "truncated array");
+            return read_array(r, n, depth);
+        case 0xde: case 0xdf:
+            if (!take_be(r, t == 0xde ? 2 : 4, &n)) return fail(r, "truncated map");
+            return read_map(r, n, depth);
+        default:
+            // bin and ext have no counterpart in the JSON bodies
+            return fail(r, "unsupported type");
+    }
+}
+
+json_t *msgpack_to_json(const char *data, size_t len, char *err, size_t errlen) {
+    MpReader r = { (const unsigned char *)data, (const unsigned char *)data + len, err, errlen };
+    json_t *j = read_value(&r, 0);
+    if (j && r.p != r.end) {
+        json_decref(j);
+        return fail(&r, "trailing bytes");
+    }
+    return j;
+}
+
+#pragma endregion Decoder
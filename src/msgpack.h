@@ -0,0 +1,36 @@
+#pragma once
+#include "utils.h"
+#include <stdint.h>
+
+/*
+ * MessagePack for clients that send "Accept: application/msgpack" or
+ * "Content-Type: application/msgpack". Responses carry the same records as
+ * the JSON ones, but doubles are 9 fixed bytes instead of text and keys are
+ * length-prefixed, so there is nothing to format or escape.
+ *
+ * The encoder appends to a growable buffer; list responses open an array
+ * with mp_array_begin and patch its count in mp_array_end once the visitor
+ * has seen every row. Request bodies are decoded into a jansson tree so the
+ * write endpoints check fields the same way for both formats.
+ */
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    bool failed;                    // out of memory; the buffer is incomplete
+} MpWriter;
+
+void mp_init(MpWriter *w);
+void mp_free(MpWriter *w);
+
+// Writes an array header with room for any count; returns where to patch it
+size_t mp_array_begin(MpWriter *w);
+void mp_array_end(MpWriter *w, size_t at, uint32_t count);
+void mp_map(MpWriter *w, uint32_t count);
+// NULL is written as an empty string, as the JSON responses do
+void mp_str(MpWriter *w, const char *s);
+void mp_double(MpWriter *w, double d);
+
+// NULL on malformed input, with the reason in err
+json_t *msgpack_to_json(const char *data, size_t len, char *err, size_t errlen);
@@ -0,0 +1,304 @@
+#include "respcache.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct CacheEntry {
+    struct CacheEntry *hash_next;
+    struct CacheEntry *lru_prev, *lru_next;     // most recently used first
+    uint32_t hash;
+    uint64_t version;
+    SharedBody *body;
+    size_t bytes;                               // charged against the cap
+    char key[];
+} CacheEntry;
+
+static struct {
+    mutex_t lock;
+    bool running;
+    long external_ms;                           // how often to look for outside commits, 0 never
+    size_t max_bytes;
+    size_t max_entry_bytes;
+
+    CacheEntry **buckets;
+    size_t nbuckets;                            // power of two
+    size_t entries;
+    size_t bytes;
+    CacheEntry *lru_head, *lru_tail;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stale;
+    uint64_t inserts;
+    uint64_t evictions;
+} rc;
+
+// One watcher for the whole process, so each outside commit drops the cache once
+static struct {
+    mutex_t lock;
+    bool opened;                                // opened on the first check, after init_db
+    DbFileWatch *files[DB_SHARDS_MAX];
+    int nfiles;
+    bool known;
+    int64_t version;
+    uint64_t next_check_us;
+    uint64_t invalidations;
+} watch;
+
+static uint32_t hash_key(const char *s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+bool respcache_start(void) {
+    long mb = env_long("CURRICULUM_CACHE_MB", 64);
+    long max_kb = env_long("CURRICULUM_CACHE_MAX_KB", 1024);
+    if (mb <= 0) {
+        log_message("Response cache disabled", LOG_INFO);
+        return true;
+    }
+    mutex_init(&rc.lock);
+    rc.max_bytes = (size_t)mb * 1024 * 1024;
+    rc.max_entry_bytes = max_kb > 0 ? (size_t)max_kb * 1024 : rc.max_bytes;
+    rc.external_ms = env_long("CURRICULUM_CACHE_EXTERNAL_MS", 0);
+    if (rc.external_ms > 0) {
+        mutex_init(&watch.lock);
+        watch.opened = watch.known = false;
+        watch.nfiles = 0;
+        watch.next_check_us = 0;
+        watch.invalidations = 0;
+    }
+    rc.nbuckets = 1024;
+    rc.buckets = calloc(rc.nbuckets, sizeof(*rc.buckets));
+    if (!rc.buckets) return false;
+    rc.entries = rc.bytes = 0;
+    rc.lru_head = rc.lru_tail = NULL;
+    rc.hits = rc.misses = rc.stale = rc.inserts = rc.evictions = 0;
+    rc.running = true;
+
+    char buf[160];
+    int n = snprintf(buf, sizeof(buf), "Response cache: %ld MB, entries up to %ld KB", mb, max_kb);
+    if (rc.external_ms > 0) {
+        snprintf(buf + n, sizeof(buf) - n, ", checking for external commits every %ld ms", rc.external_ms);
+    }
+    log_message(buf, LOG_INFO);
+    return true;
+}
+
+static void lru_unlink(CacheEntry *e) {
+    if (e->lru_prev) e->lru_prev->lru_next = e->lru_next;
+    else rc.lru_head = e->lru_next;
+    if (e->lru_next) e->lru_next->lru_prev = e->lru_prev;
+    else rc.lru_tail = e->lru_prev;
+}
+
+static void lru_push_front(CacheEntry *e) {
+    e->lru_prev = NULL;
+    e->lru_next = rc.lru_head;
+    if (rc.lru_head) rc.lru_head->lru_prev = e;
+    rc.lru_head = e;
+    if (!rc.lru_tail) rc.lru_tail = e;
+}
+
+// Unlinks e from both lists; the caller releases e->body outside the lock
+static SharedBody *remove_entry(CacheEntry *e) {
+    CacheEntry **p = &rc.buckets[e->hash & (rc.nbuckets - 1)];
+    while (*p != e) p = &(*p)->hash_next;
+    *p = e->hash_next;
+    lru_unlink(e);
+    rc.entries--;
+    rc.bytes -= e->bytes;
+    SharedBody *b = e->body;
+    free(e);
+    return b;
+}
+
+static void grow(void) {
+    size_t n = rc.nbuckets * 2;
+    CacheEntry **buckets = calloc(n, sizeof(*buckets));
+    if (!buckets) return;
+    for (size_t i = 0; i < rc.nbuckets; i++) {
+        for (CacheEntry *e = rc.buckets[i], *next; e; e = next) {
+            next = e->hash_next;
+            e->hash_next = buckets[e->hash & (n - 1)];
+            buckets[e->hash & (n - 1)] = e;
+        }
+    }
+    free(rc.buckets);
+    rc.buckets = buckets;
+    rc.nbuckets = n;
+}
+
+static CacheEntry *find(const char *key, uint32_t hash) {
+    for (CacheEntry *e = rc.buckets[hash & (rc.nbuckets - 1)]; e; e = e->hash_next) {
+        if (e->hash == hash && strcmp(e->key, key) == 0) return e;
+    }
+    return NULL;
+}
+
+static void open_watches(void) {
+    watch.opened = true;
+    // Only sqlite files can be written by another process
+    const char *backend = db_backend_name();
+    if (!backend || strncmp(backend, "sqlite", 6) != 0) return;
+    for (int i = 0; i < db_shard_count(); i++) {
+        char path[256];
+        db_shard_file(i, path, sizeof(path));
+        DbFileWatch *w = db_watch_open(path);
+        if (!w) {
+            log_message("Response cache: cannot watch for external commits", LOG_WARN);
+            for (int j = 0; j < watch.nfiles; j++) db_watch_close(watch.files[j]);
+            watch.nfiles = 0;
+            return;
+        }
+        watch.files[watch.nfiles++] = w;
+    }
+}
+
+// The watcher's connection never writes, so the server's own commits count as outside
+// ones too; either way the cache is dropped at most once per interval.
+static void check_external_commits(void) {
+    uint64_t now = now_us();
+    mutex_lock(&watch.lock);
+    if (now < watch.next_check_us) {
+        mutex_unlock(&watch.lock);
+        return;
+    }
+    watch.next_check_us = now + (uint64_t)rc.external_ms * 1000;
+    if (!watch.opened) open_watches();
+    int64_t total = 0;
+    bool ok = watch.nfiles > 0;
+    for (int i = 0; ok && i < watch.nfiles; i++) {
+        int64_t v = 0;
+        ok = db_watch_version(watch.files[i], &v);
+        total += v;
+    }
+    if (ok && watch.known && total != watch.version) {
+        db_data_replaced();
+        watch.invalidations++;
+    }
+    watch.known = ok;
+    watch.version = total;
+    mutex_unlock(&watch.lock);
+}
+
+uint64_t respcache_version(DbEntity entity) {
+    if (rc.running && rc.external_ms > 0) check_external_commits();
+    return db_data_version(entity);
+}
+
+SharedBody *respcache_get(const char *key, uint64_t version) {
+    if (!rc.running) return NULL;
+    uint32_t hash = hash_key(key);
+    SharedBody *hit = NULL, *dropped = NULL;
+    mutex_lock(&rc.lock);
+    CacheEntry *e = find(key, hash);
+    if (e && e->version == version) {
+        lru_unlink(e);
+        lru_push_front(e);
+        hit = e->body;
+        shared_body_retain(hit);
+        rc.hits++;
+    } else {
+        if (e) {
+            dropped = remove_entry(e);
+            rc.stale++;
+        }
+        rc.misses++;
+    }
+    mutex_unlock(&rc.lock);
+    shared_body_release(dropped);
+    return hit;
+}
+
+void respcache_put(const char *key, uint64_t version, SharedBody *b) {
+    if (!rc.running || !b) return;
+    size_t keylen = strlen(key);
+    size_t bytes = sizeof(CacheEntry) + keylen + 1 + b->len;
+    if (b->len > rc.max_entry_bytes || bytes > rc.max_bytes) return;
+
+    CacheEntry *n = malloc(sizeof(CacheEntry) + keylen + 1);
+    if (!n) return;
+    memcpy(n->key, key, keylen + 1);
+    n->hash = hash_key(key);
+    n->version = version;
+    n->body = b;
+    n->bytes = bytes;
+    shared_body_retain(b);
+
+    // Bodies are released after unlocking; at most the replaced entry plus a few evictions
+    SharedBody *released[16];
+    int nreleased = 0;
+    mutex_lock(&rc.lock);
+    CacheEntry *old = find(key, n->hash);
+    if (old) {
+        // Another request built it first; keep whichever is newer
+        if (old->version >= version) {
+            mutex_unlock(&rc.lock);
+            shared_body_release(b);
+            free(n);
+            return;
+        }
+        released[nreleased++] = remove_entry(old);
+    }
+    while (rc.bytes + bytes > rc.max_bytes && rc.lru_tail && nreleased < 16) {
+        released[nreleased++] = remove_entry(rc.lru_tail);
+        rc.evictions++;
+    }
+    if (rc.bytes + bytes > rc.max_bytes) {
+        mutex_unlock(&rc.lock);
+        shared_body_release(b);
+        free(n);
+    } else {
+        if (rc.entries >= rc.nbuckets) grow();
+        size_t slot = n->hash & (rc.nbuckets - 1);
+        n->hash_next = rc.buckets[slot];
+        rc.buckets[slot] = n;
+        lru_push_front(n);
+        rc.entries++;
+        rc.bytes += bytes;
+        rc.inserts++;
+        mutex_unlock(&rc.lock);
+    }
+    for (int i = 0; i < nreleased; i++) shared_body_release(released[i]);
+}
+
+void respcache_stop(void) {
+    if (!rc.running) return;
+    rc.running = false;
+    while (rc.lru_head) shared_body_release(remove_entry(rc.lru_head));
+    free(rc.buckets);
+    rc.buckets = NULL;
+    mutex_destroy(&rc.lock);
+    if (rc.external_ms > 0) {
+        for (int i = 0; i < watch.nfiles; i++) db_watch_close(watch.files[i]);
+        watch.nfiles = 0;
+        mutex_destroy(&watch.lock);
+    }
+}
+
+json_t *respcache_stats_json(void) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "enabled", json_boolean(rc.running));
+    if (!rc.running) return obj;
+    mutex_lock(&rc.lock);
+    json_object_set_new(obj, "entries", json_integer((json_int_t)rc.entries));
+    json_object_set_new(obj, "bytes", json_integer((json_int_t)rc.bytes));
+    json_object_set_new(obj, "max_bytes", json_integer((json_int_t)rc.max_bytes));
+    json_object_set_new(obj, "hits", json_integer((json_int_t)rc.hits));
+    json_object_set_new(obj, "misses", json_integer((json_int_t)rc.misses));
+    json_object_set_new(obj, "stale", json_integer((json_int_t)rc.stale));
+    json_object_set_new(obj, "inserts", json_integer((json_int_t)rc.inserts));
+    json_object_set_new(obj, "evictions", json_integer((json_int_t)rc.evictions));
+    mutex_unlock(&rc.lock);
+    if (rc.external_ms > 0) {
+        mutex_lock(&watch.lock);
+        json_object_set_new(obj, "external_invalidations", json_integer((json_int_t)watch.invalidations));
+        mutex_unlock(&watch.lock);
+    }
+    return obj;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "utils.h"
+#include "db.h"
+#include "singleflight.h"
+#include <stdint.h>
+
+/*
+ * Cache of fully serialized read responses. Between writes, a listing is
+ * byte-identical for every client, so a hit skips the query, the jansson tree
+ * and json_dumps and goes straight to the socket.
+ *
+ * Entries are keyed by singleflight_key and tagged with the db_data_version
+ * the body was built at. db.c bumps the version once any mutation of the
+ * entity (or one that cascades into it) commits, so a lookup with a newer
+ * version is a miss that drops the stale entry. Memory is capped; the least
+ * recently used entries are evicted first.
+ *
+ * Commits from outside the server (libcurriculum clients, curriculum-import, the
+ * sqlite3 shell) do not move db_data_version. With CURRICULUM_CACHE_EXTERNAL_MS set,
+ * respcache_version looks at the database files through one process-wide watcher
+ * (db_watch_open) at most that often and drops every entry once per change it sees.
+ * The watcher cannot tell the server's own commits apart, and outside writes may be
+ * served stale for up to the interval.
+ *
+ * CURRICULUM_CACHE_MB           memory for cached responses (default 64, 0 disables)
+ * CURRICULUM_CACHE_MAX_KB       larger responses are not cached (default 1024)
+ * CURRICULUM_CACHE_EXTERNAL_MS  check for outside commits this often (default 0, never)
+ */
+
+bool respcache_start(void);
+void respcache_stop(void);
+
+// The version to look up and cache entity's responses at; call before the query runs
+uint64_t respcache_version(DbEntity entity);
+
+// Returns a retained body, or NULL on a miss
+SharedBody *respcache_get(const char *key, uint64_t version);
+// Caches b (taking its own reference) unless it is too large
+void respcache_put(const char *key, uint64_t version, SharedBody *b);
+
+json_t *respcache_stats_json(void);
@@ -1,12 +1,16 @@
 #include "server.h"
+#include <stdlib.h>
+#include <string.h>
 
 static struct mg_context *ctx = NULL;
+static bool use_epoll = false;
 
 static int respond_405(struct mg_connection *conn, const char *allow) {
     char buf[256];
     snprintf(buf, sizeof(buf), "405 Method Not Allowed (Allow: %s)", allow);
     log_message(buf, LOG_WARN);
-    mg_printf(conn, "HTTP/1.1 405 Method Not Allowed\r\nAllow: %s\r\nContent-Type: application/json\r\n\r\n{ \"error\": \"method not allowed\" }", allow);
+    const char *body = "{ \"error\": \"method not allowed\" }";
+    http_printf(conn, "HTTP/1.1 405 Method Not Allowed\r\nAllow: %s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s", allow, (int)strlen(body), body);
     return 405;
 }
 
@@ -14,19 +18,63 @@ static int respond_400(struct mg_connection *conn, const char *msg) {
     char buf[256];
     snprintf(buf, sizeof(buf), "400 Bad Request: %s", msg);
     log_message(buf, LOG_WARN);
-    mg_printf(conn, "HTTP/1.1 400 Bad Request\r\nContent-Type: application/json\r\n\r\n{ \"error\": \"%s\" }", msg);
+    char body[256];
+    snprintf(body, sizeof(body), "{ \"error\": \"%s\" }", msg);
+    http_printf(conn, "HTTP/1.1 400 Bad Request\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s", (int)strlen(body), body);
     return 400;
 }
 
-static int request_handler(struct mg_connection *conn, void *cbdata) {
-    const struct mg_request_info *ri = mg_get_request_info(conn);
+static int respond_503(struct mg_connection *conn, const char *route) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "503 Service Unavailable: shed %s", route);
+    log_message(buf, LOG_WARN);
+    const char *body = "{ \"error\": \"server overloaded\" }";
+    http_printf(conn, "HTTP/1.1 503 Service Unavailable\r\nRetry-After: %d\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s",
+                admission_retry_after(), (int)strlen(body), body);
+    return 503;
+}
+
+static bool has_control_chars(const char *s) {
+    for (; *s; s++) {
+        if ((unsigned char)*s < 0x20 || *s == 0x7f) return true;
+    }
+    return false;
+}
+
+// A follower never writes: send the client to the primary when its URL is known
+static int respond_read_only(struct mg_connection *conn, const struct mg_request_info *ri) {
+    const char *primary = follower_primary_url();
+    if (!primary[0]) {
+        const char *body = "{ \"error\": \"read-only follower\" }";
+        http_printf(conn, "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s", (int)strlen(body), body);
+        return 405;
+    }
+    const char *uri = ri->local_uri_raw ? ri->local_uri_raw : ri->local_uri;
+    const char *qs = ri->query_string;
+    // All of it goes into the Location header, where a CR or LF would start a header of its own
+    if (has_control_chars(primary) || has_control_chars(uri) || (qs && has_control_chars(qs))) {
+        return respond_400(conn, "invalid characters in request path");
+    }
+    // The URL comes from the environment, so let jansson escape it
+    json_t *obj = json_object();
+    json_object_set_new(obj, "error", json_string("read-only follower"));
+    json_object_set_new(obj, "primary", json_string(primary));
+    char *body = json_dumps(obj, 0);
+    json_decref(obj);
+    http_printf(conn, "HTTP/1.1 307 Temporary Redirect\r\nLocation: %s%s%s%s\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n%s",
+                primary, uri, qs ? "?" : "", qs ? qs : "", body ? (int)strlen(body) : 0, body ? body : "");
+    free(body);
+    return 307;
+}
+
+static int route_request(struct mg_connection *conn, const struct mg_request_info *ri) {
     char buf[512];
     snprintf(buf, sizeof(buf), "Request %s %s?%s", ri->request_method, ri->local_uri, ri->query_string ? ri->query_string : "");
     log_message(buf, LOG_INFO);
 
     // Handle CORS preflight requests
     if (strcmp(ri->request_method, "OPTIONS") == 0) {
-        mg_printf(conn,
+        http_printf(conn,
             "HTTP/1.1 200 OK\r\n"
             "Access-Control-Allow-Origin: *\r\n"
             "Access-Control-Allow-Methods: GET, POST, DELETE, PUT, OPTIONS\r\n"
@@ -35,10 +83,44 @@ static int request_handler(struct mg_connection *conn, void *cbdata) {
         return 200;
     }
 
+    if (follower_enabled() && strcmp(ri->request_method, "GET") != 0) {
+        return respond_read_only(conn, ri);
+    }
+
     if (strcmp(ri->local_uri, "/ping") == 0) {
         return handle_ping(conn);
     }
 
+    if (strcmp(ri->local_uri, "/metrics") == 0) {
+        if (strcmp(ri->request_method, "GET") == 0) return handle_metrics(conn);
+        return respond_405(conn, "GET");
+    }
+
+    if (strcmp(ri->local_uri, "/debug/slow-queries") == 0) {
+        if (strcmp(ri->request_method, "GET") == 0) return handle_slow_queries(conn);
+        return respond_405(conn, "GET");
+    }
+
+    if (strcmp(ri->local_uri, "/jobs") == 0) {
+        if (strcmp(ri->request_method, "GET") == 0) return handle_jobs_list(conn);
+        return respond_405(conn, "GET");
+    }
+
+    if (strncmp(ri->local_uri, "/jobs/", 6) == 0) {
+        if (strcmp(ri->request_method, "GET") == 0) return handle_job_get(conn);
+        return respond_405(conn, "GET");
+    }
+
+    if (strcmp(ri->local_uri, "/backup") == 0) {
+        if (strcmp(ri->request_method, "GET") == 0 || strcmp(ri->request_method, "POST") == 0) return handle_backup(conn);
+        return respond_405(conn, "GET, POST");
+    }
+
+    if (strncmp(ri->local_uri, "/export/", 8) == 0) {
+        if (strcmp(ri->request_method, "GET") == 0) return handle_export(conn);
+        return respond_405(conn, "GET");
+    }
+
     if (strcmp(ri->local_uri, "/course") == 0) {
         if (strcmp(ri->request_method, "GET") == 0) return handle_course_list(conn);
         if (strcmp(ri->request_method, "POST") == 0) return handle_course_add(conn);
@@ -123,35 +205,136 @@ static int request_handler(struct mg_connection *conn, void *cbdata) {
         return respond_405(conn, "DELETE");
     }
 
-    mg_printf(conn,
+    http_printf(conn,
         "HTTP/1.1 404 Not Found\r\n"
-        "Content-Type: application/json\r\n\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: 24\r\n\r\n"
         "{ \"error\": \"not found\" }");
 
     return 404;
 }
 
+static void exit_thread(const struct mg_context *c, int thread_type, void *thread_pointer) {
+    handlers_thread_exit();
+}
+
+static int request_handler(struct mg_connection *conn, void *cbdata) {
+    const struct mg_request_info *ri = http_request_info(conn);
+    char route[128];
+    snprintf(route, sizeof(route), "%s %s", ri->request_method, ri->local_uri);
+    slowlog_set_route(route);
+    trace_request_begin(route, http_header(conn, "traceparent"));
+    capture_request_begin(conn);
+    int status;
+    AdmitClass cls = admission_classify(ri);
+    if (admission_enter(cls)) {
+        status = route_request(conn, ri);
+        admission_leave(cls);
+    } else {
+        status = respond_503(conn, route);
+    }
+    capture_request_end(status);
+    trace_request_end(status);
+    slowlog_set_route(NULL);
+    return status;
+}
+
 bool start_server(const char *port) {
+    // With civetweb each keep-alive connection holds a worker thread while it is
+    // open, so load tests with many clients need CURRICULUM_HTTP_THREADS raised to
+    // match; the epoll front end (see frontend.h) does not have that limit
+    use_epoll = strcmp(env_str("CURRICULUM_FRONTEND", "civetweb"), "epoll") == 0;
+    char num_threads[16];
+    snprintf(num_threads, sizeof(num_threads), "%ld", env_long("CURRICULUM_HTTP_THREADS", 4));
+    if (!capture_start()) return false;
+    if (!admission_start()) return false;
+    if (!singleflight_start()) return false;
+    if (!respcache_start()) return false;
+    if (!trace_start()) return false;
+
     const char *options[] = {
         "listening_ports", port,
-        "num_threads", "4",
+        "num_threads", num_threads,
+        "enable_keep_alive", env_long("CURRICULUM_KEEP_ALIVE", 1) ? "yes" : "no",
+        "websocket_timeout_ms", "30000",
+        "enable_websocket_ping_pong", "yes",
         NULL
     };
 
-    ctx = mg_start(NULL, NULL, options);
-    if (!ctx)
-        return false;
+    struct mg_callbacks callbacks = { 0 };
+    callbacks.exit_thread = exit_thread;
+    if (!use_epoll) {
+        ctx = mg_start(&callbacks, NULL, options);
+        if (!ctx)
+            return false;
+
+        mg_set_request_handler(ctx, "/", request_handler, NULL);
+    }
 
-    mg_set_request_handler(ctx, "/", request_handler, NULL);
+    // Must run before any connection is opened so every connection is traced
+    if (!slowlog_start()) return false;
 
     if (!init_db()) return false;
 
+    // Must run before the writer opens its connection so auto-checkpoint is off everywhere
+    if (!checkpoint_start()) {
+        log_message("Failed to start checkpoint thread", LOG_ERROR);
+        return false;
+    }
+
+    if (!writer_start()) {
+        log_message("Failed to start writer thread", LOG_ERROR);
+        return false;
+    }
+
+    if (!jobs_start()) {
+        log_message("Failed to start job thread", LOG_ERROR);
+        return false;
+    }
+
+    if (!follower_start()) {
+        log_message("Failed to start following the primary", LOG_ERROR);
+        return false;
+    }
+
+    if (!backup_start()) {
+        log_message("Failed to start backup thread", LOG_ERROR);
+        return false;
+    }
+
+    if (use_epoll) {
+        log_message("Change feed (/events) is only served by the civetweb front end", LOG_WARN);
+        return frontend_start(port, request_handler, handlers_thread_exit);
+    }
+
+    if (!events_start(ctx)) {
+        log_message("Failed to start change feed", LOG_ERROR);
+        return false;
+    }
+
     return true;
 }
 
 void stop_server(void) {
+    events_stop();
+
     if (ctx)
         mg_stop(ctx);
+    ctx = NULL;
+    frontend_stop();
 
+    // Handlers may still be waiting on the writer until mg_stop/frontend_stop return;
+    // a running job gives up after its current chunk
+    jobs_stop();
+    writer_stop();
+    follower_stop();
+    backup_stop();
+    checkpoint_stop();
     close_db();
+    slowlog_stop();
+    trace_stop();
+    respcache_stop();
+    singleflight_stop();
+    admission_stop();
+    capture_stop();
 }
@@ -2,6 +2,7 @@
 #include "utils.h"
 #include "db.h"
 #include "handlers.h"
+#include "events.h"
 
 bool start_server(const char *port);
 void stop_server(void);
\ No newline at end of file
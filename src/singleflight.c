@@ -0,0 +1,192 @@
+#include "singleflight.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PARAMS 32
+
+typedef struct Flight {
+    struct Flight *next;
+    char *key;
+    uint64_t version;
+    cond_t done_cond;
+    bool done;
+    int waiters;
+    SharedBody *result;
+} Flight;
+
+static struct {
+    mutex_t lock;                   // guards flights and stats
+    bool running;
+    bool enabled;
+    Flight *flights;                // in progress
+    uint64_t leaders;
+    uint64_t followers;
+    int max_waiters;
+} sf;
+
+SharedBody *shared_body_new(int status, char *data, size_t len) {
+    if (!data) return NULL;
+    SharedBody *b = malloc(sizeof(*b));
+    if (!b) {
+        free(data);
+        return NULL;
+    }
+    mutex_init(&b->lock);
+    b->refs = 1;
+    b->status = status;
+    b->len = len;
+    b->data = data;
+    return b;
+}
+
+void shared_body_retain(SharedBody *b) {
+    if (!b) return;
+    mutex_lock(&b->lock);
+    b->refs++;
+    mutex_unlock(&b->lock);
+}
+
+void shared_body_release(SharedBody *b) {
+    if (!b) return;
+    mutex_lock(&b->lock);
+    bool last = --b->refs == 0;
+    mutex_unlock(&b->lock);
+    if (last) {
+        mutex_destroy(&b->lock);
+        free(b->data);
+        free(b);
+    }
+}
+
+bool singleflight_start(void) {
+    mutex_init(&sf.lock);
+    sf.enabled = env_long("CURRICULUM_SINGLEFLIGHT", 1) != 0;
+    sf.flights = NULL;
+    sf.leaders = sf.followers = 0;
+    sf.max_waiters = 0;
+    sf.running = true;
+    if (!sf.enabled) log_message("Read coalescing disabled", LOG_INFO);
+    return true;
+}
+
+void singleflight_stop(void) {
+    if (!sf.running) return;
+    sf.running = false;
+    mutex_destroy(&sf.lock);
+}
+
+static int compare_params(const void *a, const void *b) {
+    const char *x = *(const char *const *)a;
+    const char *y = *(const char *const *)b;
+    // Compare up to '&' so "a=1&..." and "a=1" order the same way
+    size_t nx = strcspn(x, "&"), ny = strcspn(y, "&");
+    int c = memcmp(x, y, nx < ny ? nx : ny);
+    return c ? c : (nx > ny) - (nx < ny);
+}
+
+bool singleflight_key(const struct mg_request_info *ri, char *out, size_t outlen) {
+    int n = snprintf(out, outlen, "%s %s", ri->request_method, ri->local_uri);
+    if (n < 0 || (size_t)n >= outlen) return false;
+    const char *qs = ri->query_string;
+    if (!qs || !*qs) return true;
+
+    const char *params[MAX_PARAMS];
+    int count = 0;
+    for (const char *p = qs; *p; ) {
+        if (*p != '&') {
+            if (count == MAX_PARAMS) return false;
+            params[count++] = p;
+        }
+        const char *amp = strchr(p, '&');
+        if (!amp) break;
+        p = amp + 1;
+    }
+    qsort(params, (size_t)count, sizeof(params[0]), compare_params);
+
+    size_t len = (size_t)n;
+    for (int i = 0; i < count; i++) {
+        size_t plen = strcspn(params[i], "&");
+        if (len + plen + 2 > outlen) return false;
+        out[len++] = i ? '&' : '?';
+        memcpy(out + len, params[i], plen);
+        len += plen;
+    }
+    out[len] = '\0';
+    return true;
+}
+
+static void flight_free(Flight *f) {
+    cond_destroy(&f->done_cond);
+    free(f->key);
+    free(f);
+}
+
+SharedBody *singleflight_do(const char *key, uint64_t version, flight_fn fn, void *arg) {
+    if (!sf.running || !sf.enabled) return fn(arg);
+
+    mutex_lock(&sf.lock);
+    for (Flight *f = sf.flights; f; f = f->next) {
+        if (f->version != version || strcmp(f->key, key) != 0) continue;
+        f->waiters++;
+        if (f->waiters > sf.max_waiters) sf.max_waiters = f->waiters;
+        sf.followers++;
+        TraceSpan span;
+        bool traced = trace_span_begin(&span);
+        while (!f->done) cond_wait(&f->done_cond, &sf.lock);
+        SharedBody *b = f->result;      // the leader took a reference for us
+        bool last = --f->waiters == 0;
+        mutex_unlock(&sf.lock);
+        if (last) flight_free(f);
+        if (traced) trace_span_end(&span, "singleflight.wait", key);
+        return b;
+    }
+
+    Flight *f = calloc(1, sizeof(*f));
+    char *k = f ? malloc(strlen(key) + 1) : NULL;
+    if (!k) {
+        mutex_unlock(&sf.lock);
+        free(f);
+        return fn(arg);
+    }
+    strcpy(k, key);
+    f->key = k;
+    f->version = version;
+    cond_init(&f->done_cond);
+    f->next = sf.flights;
+    sf.flights = f;
+    sf.leaders++;
+    mutex_unlock(&sf.lock);
+
+    SharedBody *b = fn(arg);
+
+    mutex_lock(&sf.lock);
+    for (Flight **p = &sf.flights; *p; p = &(*p)->next) {
+        if (*p == f) {
+            *p = f->next;
+            break;
+        }
+    }
+    f->result = b;
+    f->done = true;
+    bool alone = f->waiters == 0;
+    // One reference per waiter, taken now since the caller may release b before they wake
+    for (int i = 0; i < f->waiters; i++) shared_body_retain(b);
+    if (!alone) cond_broadcast(&f->done_cond);
+    mutex_unlock(&sf.lock);
+    // Otherwise the last waiter frees the flight
+    if (alone) flight_free(f);
+    return b;
+}
+
+json_t *singleflight_stats_json(void) {
+    json_t *obj = json_object();
+    if (!sf.running) return obj;
+    mutex_lock(&sf.lock);
+    json_object_set_new(obj, "enabled", json_boolean(sf.enabled));
+    json_object_set_new(obj, "queries", json_integer((json_int_t)sf.leaders));
+    json_object_set_new(obj, "coalesced", json_integer((json_int_t)sf.followers));
+    json_object_set_new(obj, "max_waiters", json_integer(sf.max_waiters));
+    mutex_unlock(&sf.lock);
+    return obj;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "utils.h"
+#include "thread.h"
+#include <stdint.h>
+
+/*
+ * Request coalescing for reads. Identical GETs that arrive while one of them
+ * is still running wait for it and are answered with the same serialized
+ * body, so a burst of the same listing costs one query and one json_dumps.
+ *
+ * Requests are identical when their canonical key (method, path and the
+ * query parameters in sorted order) matches and they saw the same
+ * db_data_version for the entity they read. A read that arrives after a
+ * write has committed therefore never joins a flight that started before
+ * it, and is ordered after the write.
+ *
+ * CURRICULUM_SINGLEFLIGHT  0 turns coalescing off (default 1)
+ */
+
+// A response body shared by every request served from it. Released by each user.
+typedef struct {
+    mutex_t lock;
+    int refs;
+    int status;
+    size_t len;
+    char *data;                     // JSON text or MessagePack
+} SharedBody;
+
+// Takes ownership of data (malloc'd); returns NULL and frees data on failure
+SharedBody *shared_body_new(int status, char *data, size_t len);
+void shared_body_retain(SharedBody *b);
+void shared_body_release(SharedBody *b);
+
+typedef SharedBody *(*flight_fn)(void *arg);
+
+bool singleflight_start(void);
+void singleflight_stop(void);
+
+// Writes "METHOD path?a=1&b=2" with parameters sorted; false if it does not fit
+bool singleflight_key(const struct mg_request_info *ri, char *out, size_t outlen);
+
+// Runs fn, or waits for the running call with the same key and version and shares its result
+SharedBody *singleflight_do(const char *key, uint64_t version, flight_fn fn, void *arg);
+
+json_t *singleflight_stats_json(void);
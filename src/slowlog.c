@@ -0,0 +1,252 @@
+#include "slowlog.h"
+#include "thread.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SLOWLOG_ENTRIES 64
+#define ROUTE_MAX 128
+
+typedef struct {
+    char *sql;              // statement text as prepared, parameters unbound
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    // Details of the slowest run
+    uint64_t rows;
+    char route[ROUTE_MAX];
+    char *expanded;
+    char *plan;
+} SlowEntry;
+
+static struct {
+    mutex_t lock;
+    bool enabled;
+    uint64_t threshold_ns;
+    uint64_t slow_statements;
+    SlowEntry entries[SLOWLOG_ENTRIES];
+    int count;
+
+    // Read-only connection used for EXPLAIN QUERY PLAN
+    sqlite3 *explain_db;
+    char *explain_path;
+} sl;
+
+static _Thread_local char route[ROUTE_MAX];
+
+void slowlog_set_route(const char *r) {
+    if (r) snprintf(route, sizeof(route), "%s", r);
+    else route[0] = '\0';
+}
+
+const char *slowlog_route(void) {
+    return route[0] ? route : NULL;
+}
+
+static bool has_prefix_nocase(const char *s, const char *prefix) {
+    for (; *prefix; s++, prefix++) {
+        if (toupper((unsigned char)*s) != *prefix) return false;
+    }
+    return true;
+}
+
+// Transaction control and pragmas have no plan worth showing
+static bool explainable(const char *sql) {
+    while (isspace((unsigned char)*sql)) sql++;
+    return has_prefix_nocase(sql, "SELECT") || has_prefix_nocase(sql, "INSERT") ||
+           has_prefix_nocase(sql, "UPDATE") || has_prefix_nocase(sql, "DELETE") ||
+           has_prefix_nocase(sql, "REPLACE") || has_prefix_nocase(sql, "WITH");
+}
+
+/* Returns the plan as "detail; detail; ..." (malloc'd), or NULL. Caller holds sl.lock. */
+static char *explain(const char *path, const char *sql) {
+    if (!path || !*path || !explainable(sql)) return NULL;
+
+    if (sl.explain_db && strcmp(sl.explain_path, path) != 0) {
+        sqlite3_close(sl.explain_db);
+        sl.explain_db = NULL;
+        free(sl.explain_path);
+        sl.explain_path = NULL;
+    }
+    if (!sl.explain_db) {
+        if (sqlite3_open_v2(path, &sl.explain_db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+            sqlite3_close(sl.explain_db);
+            sl.explain_db = NULL;
+            return NULL;
+        }
+        sl.explain_path = strdup(path);
+    }
+
+    size_t len = strlen(sql) + 32;
+    char *query = malloc(len);
+    if (!query) return NULL;
+    snprintf(query, len, "EXPLAIN QUERY PLAN %s", sql);
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(sl.explain_db, query, -1, &stmt, NULL);
+    free(query);
+    if (rc != SQLITE_OK) return NULL;
+
+    char *plan = NULL;
+    size_t size = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *detail = (const char *)sqlite3_column_text(stmt, 3);
+        if (!detail) continue;
+        size_t n = strlen(detail);
+        char *tmp = realloc(plan, size + n + 3);
+        if (!tmp) break;
+        plan = tmp;
+        if (size) { memcpy(plan + size, "; ", 2); size += 2; }
+        memcpy(plan + size, detail, n + 1);
+        size += n;
+    }
+    sqlite3_finalize(stmt);
+    return plan;
+}
+
+static void replace_str(char **dst, char *src) {
+    free(*dst);
+    *dst = src;
+}
+
+/* Caller holds sl.lock. Takes ownership of expanded and plan. */
+static void aggregate(const char *sql, uint64_t ns, uint64_t rows, const char *r, char *expanded, char *plan) {
+    SlowEntry *e = NULL;
+    for (int i = 0; i < sl.count; i++) {
+        if (strcmp(sl.entries[i].sql, sql) == 0) { e = &sl.entries[i]; break; }
+    }
+    if (!e) {
+        char *copy = strdup(sql);
+        if (!copy) { free(expanded); free(plan); return; }
+        if (sl.count < SLOWLOG_ENTRIES) {
+            e = &sl.entries[sl.count++];
+        } else {
+            // Evict the entry that has cost the least so far
+            e = &sl.entries[0];
+            for (int i = 1; i < sl.count; i++) {
+                if (sl.entries[i].total_ns < e->total_ns) e = &sl.entries[i];
+            }
+            free(e->sql);
+            free(e->expanded);
+            free(e->plan);
+        }
+        memset(e, 0, sizeof(*e));
+        e->sql = copy;
+    }
+
+    e->count++;
+    e->total_ns += ns;
+    if (ns >= e->max_ns) {
+        e->max_ns = ns;
+        e->rows = rows;
+        snprintf(e->route, sizeof(e->route), "%s", r ? r : "");
+        replace_str(&e->expanded, expanded);
+        replace_str(&e->plan, plan);
+    } else {
+        free(expanded);
+        free(plan);
+    }
+}
+
+void slowlog_statement(sqlite3_stmt *stmt, uint64_t ns, uint64_t rows) {
+    if (!sl.enabled || ns < sl.threshold_ns) return;
+    const char *sql = sqlite3_sql(stmt);
+    if (!sql) return;
+    char *expanded_raw = sqlite3_expanded_sql(stmt);
+    char *expanded = strdup(expanded_raw ? expanded_raw : sql);
+    sqlite3_free(expanded_raw);
+    if (!expanded) return;
+    const char *r = slowlog_route();
+
+    mutex_lock(&sl.lock);
+    char *plan = explain(sqlite3_db_filename(sqlite3_db_handle(stmt), "main"), expanded);
+
+    char buf[2048];
+    snprintf(buf, sizeof(buf), "Slow query %.1f ms, %llu rows, %s: %s\n  plan: %s",
+             ns / 1e6, (unsigned long long)rows, r ? r : "-", expanded, plan ? plan : "-");
+    log_message(buf, LOG_WARN);
+
+    sl.slow_statements++;
+    aggregate(sql, ns, rows, r, expanded, plan);
+    mutex_unlock(&sl.lock);
+}
+
+bool slowlog_start(void) {
+    long ms = env_long("CURRICULUM_SLOW_QUERY_MS", 100);
+    if (ms < 0) return true;
+
+    mutex_init(&sl.lock);
+    sl.threshold_ns = (uint64_t)ms * 1000000;
+    sl.slow_statements = 0;
+    sl.count = 0;
+    sl.enabled = true;
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Slow-query log enabled (threshold %ldms)", ms);
+    log_message(buf, LOG_INFO);
+    return true;
+}
+
+void slowlog_stop(void) {
+    if (!sl.enabled) return;
+    mutex_lock(&sl.lock);
+    sl.enabled = false;
+    for (int i = 0; i < sl.count; i++) {
+        free(sl.entries[i].sql);
+        free(sl.entries[i].expanded);
+        free(sl.entries[i].plan);
+    }
+    sl.count = 0;
+    if (sl.explain_db) sqlite3_close(sl.explain_db);
+    sl.explain_db = NULL;
+    free(sl.explain_path);
+    sl.explain_path = NULL;
+    mutex_unlock(&sl.lock);
+    mutex_destroy(&sl.lock);
+}
+
+bool slowlog_enabled(void) {
+    return sl.enabled;
+}
+
+static int by_total_desc(const void *a, const void *b) {
+    const SlowEntry *x = *(const SlowEntry *const *)a;
+    const SlowEntry *y = *(const SlowEntry *const *)b;
+    return x->total_ns < y->total_ns ? 1 : x->total_ns > y->total_ns ? -1 : 0;
+}
+
+json_t *slowlog_json(int limit) {
+    json_t *obj = json_object();
+    json_object_set_new(obj, "enabled", json_boolean(sl.enabled));
+    json_t *arr = json_array();
+    if (!sl.enabled) {
+        json_object_set_new(obj, "queries", arr);
+        return obj;
+    }
+
+    mutex_lock(&sl.lock);
+    json_object_set_new(obj, "threshold_ms", json_real(sl.threshold_ns / 1e6));
+    json_object_set_new(obj, "slow_statements", json_integer((json_int_t)sl.slow_statements));
+
+    SlowEntry *sorted[SLOWLOG_ENTRIES];
+    for (int i = 0; i < sl.count; i++) sorted[i] = &sl.entries[i];
+    qsort(sorted, (size_t)sl.count, sizeof(sorted[0]), by_total_desc);
+    if (limit <= 0 || limit > sl.count) limit = sl.count;
+
+    for (int i = 0; i < limit; i++) {
+        const SlowEntry *e = sorted[i];
+        json_t *q = json_object();
+        json_object_set_new(q, "sql", json_string(e->sql));
+        json_object_set_new(q, "count", json_integer((json_int_t)e->count));
+        json_object_set_new(q, "total_ms", json_real(e->total_ns / 1e6));
+        json_object_set_new(q, "avg_ms", json_real(e->total_ns / 1e6 / (double)e->count));
+        json_object_set_new(q, "max_ms", json_real(e->max_ns / 1e6));
+        json_object_set_new(q, "slowest", json_string(e->expanded));
+        json_object_set_new(q, "rows", json_integer((json_int_t)e->rows));
+        json_object_set_new(q, "route", e->route[0] ? json_string(e->route) : json_null());
+        json_object_set_new(q, "plan", e->plan ? json_string(e->plan) : json_null());
+        json_array_append_new(arr, q);
+    }
+    mutex_unlock(&sl.lock);
+    json_object_set_new(obj, "queries", arr);
+    return obj;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "utils.h"
+#include <stdint.h>
+
+/*
+ * Slow-query log for the SQLite backend. Every connection opened after
+ * slowlog_start gets a sqlite3_trace_v2 hook that times each statement and
+ * counts the rows it returns (see db_sqlite.c). Statements slower than the threshold are logged
+ * as WARN with their expanded SQL, row count, the route of the request that
+ * ran them and the EXPLAIN QUERY PLAN output:
+ *
+ *   Slow query 182.4 ms, 20 rows, GET /course: SELECT ... ORDER BY name ASC LIMIT 20 OFFSET 90000
+ *     plan: SCAN course; USE TEMP B-TREE FOR ORDER BY
+ *
+ * Slow statements are also aggregated by their SQL text (with parameters
+ * unbound, so every order_by variant is its own entry); GET /debug/slow-queries
+ * lists the entries with the highest total time. Plans are explained on a
+ * separate read-only connection, so only statements that were already slow
+ * pay for it.
+ *
+ * CURRICULUM_SLOW_QUERY_MS  threshold in milliseconds (default 100, 0 = every
+ *                           statement, negative = disabled)
+ */
+
+// No-op when disabled; must run before the database is opened
+bool slowlog_start(void);
+void slowlog_stop(void);
+
+bool slowlog_enabled(void);
+// A statement that took ns nanoseconds and just finished (called by the SQLite backend)
+void slowlog_statement(sqlite3_stmt *stmt, uint64_t ns, uint64_t rows);
+
+// Route recorded for statements run by this thread, e.g. "GET /course"; NULL clears it
+void slowlog_set_route(const char *route);
+const char *slowlog_route(void);
+
+// Top entries by total time, at most limit of them
+json_t *slowlog_json(int limit);
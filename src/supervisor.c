@@ -0,0 +1,230 @@
+#include "supervisor.h"
+#include "server.h"
+#include "db.h"
+#include "jobs.h"
+#include "backup.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+int supervisor_run(const char *port, int processes) {
+    (void)port;
+    (void)processes;
+    log_message("CURRICULUM_PROCESSES needs fork(), which Windows does not have", LOG_ERROR);
+    return 1;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+typedef struct {
+    pid_t pid;                      // 0 = not running
+    uint64_t started_us;
+    uint64_t restart_at_us;         // when a stopped process is started again
+} Worker;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+// Child side: serves until SIGTERM or SIGINT, then shuts down as main does on ENTER
+static void run_worker(const char *port, int index) {
+    // ENTER is for the supervisor
+    int devnull = open("/dev/null", O_RDONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDIN_FILENO);
+        close(devnull);
+    }
+
+    // Blocked before any thread exists, so every thread inherits the mask and only sigwait sees them
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGTERM);
+    sigaddset(&stop, SIGINT);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    pthread_sigmask(SIG_BLOCK, &stop, NULL);
+
+    if (index > 0) {
+        setenv("CURRICULUM_CHECKPOINTER", "0", 1);
+        setenv("CURRICULUM_BACKUPS", "0", 1);
+    }
+
+    char buf[96];
+    if (!start_server(port)) {
+        snprintf(buf, sizeof(buf), "Process %d (pid %ld) failed to start", index, process_id());
+        log_message(buf, LOG_ERROR);
+        log_close();
+        _exit(1);
+    }
+    snprintf(buf, sizeof(buf), "Process %d (pid %ld) serving", index, process_id());
+    log_message(buf, LOG_INFO);
+
+    int sig;
+    sigwait(&stop, &sig);
+    stop_server();
+    snprintf(buf, sizeof(buf), "Process %d (pid %ld) stopped", index, process_id());
+    log_message(buf, LOG_INFO);
+    log_close();
+    _exit(0);
+}
+
+static void spawn(Worker *w, const char *port, int index) {
+    // Buffered output would otherwise be written by both sides
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) run_worker(port, index);
+
+    char buf[96];
+    if (pid < 0) {
+        snprintf(buf, sizeof(buf), "fork failed for process %d: %s", index, strerror(errno));
+        log_message(buf, LOG_ERROR);
+        w->restart_at_us = now_us() + 1000000;
+        return;
+    }
+    w->pid = pid;
+    w->started_us = now_us();
+}
+
+static void reap(Worker *workers, int count, pid_t pid, int status) {
+    for (int i = 0; i < count; i++) {
+        Worker *w = &workers[i];
+        if (w->pid != pid) continue;
+
+        char buf[128];
+        if (WIFSIGNALED(status)) {
+            snprintf(buf, sizeof(buf), "Process %d (pid %ld) killed by signal %d", i, (long)pid, WTERMSIG(status));
+        } else {
+            snprintf(buf, sizeof(buf), "Process %d (pid %ld) exited with status %d", i, (long)pid, WEXITSTATUS(status));
+        }
+        log_message(buf, stop_requested ? LOG_INFO : LOG_WARN);
+        jobs_fail_process((long)pid);
+
+        // One that dies right away (bad config, port taken) is not restarted in a tight loop
+        uint64_t now = now_us();
+        w->pid = 0;
+        w->restart_at_us = now - w->started_us < 1000000 ? now + 1000000 : now;
+        return;
+    }
+}
+
+static void stop_workers(Worker *workers, int count) {
+    int alive = 0;
+    for (int i = 0; i < count; i++) {
+        if (workers[i].pid > 0 && kill(workers[i].pid, SIGTERM) == 0) alive++;
+    }
+    uint64_t deadline = now_us() + (uint64_t)env_long("CURRICULUM_SHUTDOWN_TIMEOUT_MS", 10000) * 1000;
+    while (alive > 0) {
+        int status;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid > 0) {
+            reap(workers, count, pid, status);
+            alive--;
+            continue;
+        }
+        if (pid < 0 && errno != EINTR) break;
+        if (now_us() >= deadline) {
+            log_message("Shutdown grace period over, killing remaining processes", LOG_WARN);
+            for (int i = 0; i < count; i++) {
+                if (workers[i].pid > 0) kill(workers[i].pid, SIGKILL);
+            }
+            deadline = UINT64_MAX;
+        }
+        sleep_ms(20);
+    }
+}
+
+int supervisor_run(const char *port, int processes) {
+    if (strcmp(env_str("CURRICULUM_BACKEND", "sqlite"), "memory") == 0) {
+        log_message("CURRICULUM_PROCESSES needs the sqlite backend: the memory backend cannot be shared", LOG_ERROR);
+        return 1;
+    }
+    if (strcmp(env_str("CURRICULUM_FRONTEND", "epoll"), "epoll") != 0) {
+        log_message("CURRICULUM_FRONTEND ignored: processes share the port through the epoll front end", LOG_WARN);
+    }
+    setenv("CURRICULUM_FRONTEND", "epoll", 1);
+    setenv("CURRICULUM_REUSEPORT", "1", 1);
+
+    // Zeroed by mmap; inherited by every process forked below
+    size_t versions_size = (DB_ENTITY_ENROLLMENT + 1) * sizeof(uint64_t);
+    size_t shared_size = versions_size + jobs_shared_size() + backup_shared_size();
+    void *shared = mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        log_message("Cannot map memory shared between processes", LOG_ERROR);
+        return 1;
+    }
+    db_share_data_versions(shared);
+    if (!jobs_share((char *)shared + versions_size) ||
+        !backup_share((char *)shared + versions_size + jobs_shared_size())) {
+        log_message("Cannot create a process-shared lock for jobs and backups", LOG_ERROR);
+        munmap(shared, shared_size);
+        return 1;
+    }
+
+    // Schema creation and migrations run once here instead of racing in every process
+    if (!init_db()) {
+        log_message("Failed to open database", LOG_ERROR);
+        munmap(shared, shared_size);
+        return 1;
+    }
+    close_db();
+
+    struct sigaction sa = { 0 };
+    sa.sa_handler = on_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+
+    Worker *workers = calloc((size_t)processes, sizeof(Worker));
+    if (!workers) {
+        munmap(shared, shared_size);
+        return 1;
+    }
+    for (int i = 0; i < processes; i++) spawn(&workers[i], port, i);
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Supervising %d server processes on port %s", processes, port);
+    log_message(buf, LOG_INFO);
+    log_message("Press ENTER to quit...", LOG_INFO);
+
+    while (!stop_requested) {
+        // Any input or end of input quits, as getchar() does in single-process mode
+        struct pollfd in = { .fd = STDIN_FILENO, .events = POLLIN };
+        if (poll(&in, 1, 200) > 0) break;
+
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) reap(workers, processes, pid, status);
+
+        uint64_t now = now_us();
+        for (int i = 0; i < processes; i++) {
+            if (workers[i].pid == 0 && now >= workers[i].restart_at_us && !stop_requested) {
+                snprintf(buf, sizeof(buf), "Restarting process %d", i);
+                log_message(buf, LOG_WARN);
+                spawn(&workers[i], port, i);
+            }
+        }
+    }
+
+    stop_requested = 1;
+    log_message("Stopping server processes", LOG_INFO);
+    stop_workers(workers, processes);
+    free(workers);
+    munmap(shared, shared_size);
+    log_message("Server stopped, cleaning up logs", LOG_INFO);
+    return 0;
+}
+
+#endif
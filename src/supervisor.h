@@ -0,0 +1,30 @@
+#pragma once
+#include "utils.h"
+
+/*
+ * Multi-process mode. With CURRICULUM_PROCESSES > 1, main hands over to a
+ * supervisor that forks that many server processes. They all listen on the
+ * same port with SO_REUSEPORT (so the epoll front end is used) and the kernel
+ * spreads connections between them. Every process opens the same WAL
+ * database; SQLite serialises their writers and each reader gets its own
+ * snapshot.
+ *
+ * State that must agree between processes lives in one shared mapping made
+ * before fork: the data versions (db_share_data_versions), so a commit in any
+ * process invalidates the read cache and coalesced reads of all of them, and
+ * the job records (jobs_share) and the backup state (backup_share). Only the
+ * first process runs the WAL checkpointer and writes backups. Everything else (admission limits, caches, slow-query log,
+ * metrics) is per process, and /events is not served.
+ *
+ * The supervisor restarts a process that exits, after a one second pause if
+ * it died within a second of starting. ENTER, SIGINT or SIGTERM stops every
+ * process with SIGTERM, which shuts it down like ENTER does in single-process
+ * mode, and kills any still running after CURRICULUM_SHUTDOWN_TIMEOUT_MS.
+ * POSIX only; needs the sqlite backend.
+ *
+ * CURRICULUM_PROCESSES             server processes (default 1: no supervisor)
+ * CURRICULUM_SHUTDOWN_TIMEOUT_MS   grace period on shutdown (default 10000)
+ */
+
+// Runs until shutdown; returns the exit code for main
+int supervisor_run(const char *port, int processes);
@@ -0,0 +1,158 @@
+#include "thread.h"
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+typedef struct {
+    thread_fn fn;
+    void *arg;
+} ThreadStart;
+
+#ifdef _WIN32
+
+static DWORD WINAPI thread_trampoline(LPVOID p) {
+    ThreadStart ts = *(ThreadStart *)p;
+    free(p);
+    ts.fn(ts.arg);
+    return 0;
+}
+
+bool thread_start(thread_t *t, thread_fn fn, void *arg) {
+    ThreadStart *ts = malloc(sizeof(*ts));
+    if (!ts) return false;
+    ts->fn = fn;
+    ts->arg = arg;
+    *t = CreateThread(NULL, 0, thread_trampoline, ts, 0, NULL);
+    if (!*t) { free(ts); return false; }
+    return true;
+}
+
+void thread_join(thread_t t) {
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+
+void mutex_init(mutex_t *m) { InitializeSRWLock(m); }
+void mutex_destroy(mutex_t *m) { (void)m; }
+void mutex_lock(mutex_t *m) { AcquireSRWLockExclusive(m); }
+void mutex_unlock(mutex_t *m) { ReleaseSRWLockExclusive(m); }
+bool mutex_init_shared(mutex_t *m) { (void)m; return false; }
+
+void rwlock_init(rwlock_t *l) { InitializeSRWLock(l); }
+void rwlock_destroy(rwlock_t *l) { (void)l; }
+void rwlock_rdlock(rwlock_t *l) { AcquireSRWLockShared(l); }
+void rwlock_rdunlock(rwlock_t *l) { ReleaseSRWLockShared(l); }
+void rwlock_wrlock(rwlock_t *l) { AcquireSRWLockExclusive(l); }
+void rwlock_wrunlock(rwlock_t *l) { ReleaseSRWLockExclusive(l); }
+
+void cond_init(cond_t *c) { InitializeConditionVariable(c); }
+void cond_destroy(cond_t *c) { (void)c; }
+void cond_wait(cond_t *c, mutex_t *m) { SleepConditionVariableSRW(c, m, INFINITE, 0); }
+bool cond_timedwait(cond_t *c, mutex_t *m, int timeout_ms) {
+    return SleepConditionVariableSRW(c, m, timeout_ms < 0 ? 0 : (DWORD)timeout_ms, 0) != 0;
+}
+void cond_signal(cond_t *c) { WakeConditionVariable(c); }
+void cond_broadcast(cond_t *c) { WakeAllConditionVariable(c); }
+
+uint64_t atomic_load_u64(const volatile uint64_t *p) {
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)p, 0, 0);
+}
+void atomic_inc_u64(volatile uint64_t *p) { InterlockedIncrement64((volatile LONG64 *)p); }
+long process_id(void) { return (long)GetCurrentProcessId(); }
+
+uint64_t now_us(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000ull
+         + (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000ull / (uint64_t)freq.QuadPart;
+}
+
+void sleep_ms(int ms) { Sleep(ms < 0 ? 0 : (DWORD)ms); }
+
+#else
+
+static void *thread_trampoline(void *p) {
+    ThreadStart ts = *(ThreadStart *)p;
+    free(p);
+    ts.fn(ts.arg);
+    return NULL;
+}
+
+bool thread_start(thread_t *t, thread_fn fn, void *arg) {
+    ThreadStart *ts = malloc(sizeof(*ts));
+    if (!ts) return false;
+    ts->fn = fn;
+    ts->arg = arg;
+    if (pthread_create(t, NULL, thread_trampoline, ts) != 0) { free(ts); return false; }
+    return true;
+}
+
+void thread_join(thread_t t) { pthread_join(t, NULL); }
+
+void mutex_init(mutex_t *m) { pthread_mutex_init(m, NULL); }
+void mutex_destroy(mutex_t *m) { pthread_mutex_destroy(m); }
+void mutex_lock(mutex_t *m) {
+    // Only shared mutexes are robust; what the dead owner guarded is left as it was
+    if (pthread_mutex_lock(m) == EOWNERDEAD) pthread_mutex_consistent(m);
+}
+void mutex_unlock(mutex_t *m) { pthread_mutex_unlock(m); }
+
+bool mutex_init_shared(mutex_t *m) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    bool ok = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) == 0
+           && pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST) == 0
+           && pthread_mutex_init(m, &attr) == 0;
+    pthread_mutexattr_destroy(&attr);
+    return ok;
+}
+
+void rwlock_init(rwlock_t *l) { pthread_rwlock_init(l, NULL); }
+void rwlock_destroy(rwlock_t *l) { pthread_rwlock_destroy(l); }
+void rwlock_rdlock(rwlock_t *l) { pthread_rwlock_rdlock(l); }
+void rwlock_rdunlock(rwlock_t *l) { pthread_rwlock_unlock(l); }
+void rwlock_wrlock(rwlock_t *l) { pthread_rwlock_wrlock(l); }
+void rwlock_wrunlock(rwlock_t *l) { pthread_rwlock_unlock(l); }
+
+void cond_init(cond_t *c) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(c, &attr);
+    pthread_condattr_destroy(&attr);
+}
+void cond_destroy(cond_t *c) { pthread_cond_destroy(c); }
+void cond_wait(cond_t *c, mutex_t *m) { pthread_cond_wait(c, m); }
+bool cond_timedwait(cond_t *c, mutex_t *m, int timeout_ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    if (timeout_ms < 0) timeout_ms = 0;
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+    return pthread_cond_timedwait(c, m, &ts) != ETIMEDOUT;
+}
+void cond_signal(cond_t *c) { pthread_cond_signal(c); }
+void cond_broadcast(cond_t *c) { pthread_cond_broadcast(c); }
+
+uint64_t atomic_load_u64(const volatile uint64_t *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+void atomic_inc_u64(volatile uint64_t *p) { __atomic_add_fetch(p, 1, __ATOMIC_RELEASE); }
+long process_id(void) { return (long)getpid(); }
+
+uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000ull;
+}
+
+void sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {}
+}
+
+#endif
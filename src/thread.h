@@ -0,0 +1,56 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+typedef SRWLOCK mutex_t;
+typedef SRWLOCK rwlock_t;
+typedef CONDITION_VARIABLE cond_t;
+typedef HANDLE thread_t;
+#else
+#include <pthread.h>
+typedef pthread_mutex_t mutex_t;
+typedef pthread_rwlock_t rwlock_t;
+typedef pthread_cond_t cond_t;
+typedef pthread_t thread_t;
+#endif
+
+// Minimal portable threading layer (Win32 / pthreads)
+
+typedef void (*thread_fn)(void *arg);
+
+bool thread_start(thread_t *t, thread_fn fn, void *arg);
+void thread_join(thread_t t);
+
+void mutex_init(mutex_t *m);
+void mutex_destroy(mutex_t *m);
+void mutex_lock(mutex_t *m);
+void mutex_unlock(mutex_t *m);
+
+void rwlock_init(rwlock_t *l);
+void rwlock_destroy(rwlock_t *l);
+void rwlock_rdlock(rwlock_t *l);
+void rwlock_rdunlock(rwlock_t *l);
+void rwlock_wrlock(rwlock_t *l);
+void rwlock_wrunlock(rwlock_t *l);
+
+void cond_init(cond_t *c);
+void cond_destroy(cond_t *c);
+void cond_wait(cond_t *c, mutex_t *m);
+bool cond_timedwait(cond_t *c, mutex_t *m, int timeout_ms);  // false on timeout
+void cond_signal(cond_t *c);
+void cond_broadcast(cond_t *c);
+
+// For state in memory shared between processes (mmap MAP_SHARED). A shared mutex
+// whose owner died is handed to the next locker as is; false where unsupported.
+bool mutex_init_shared(mutex_t *m);
+uint64_t atomic_load_u64(const volatile uint64_t *p);
+void atomic_inc_u64(volatile uint64_t *p);
+long process_id(void);
+
+uint64_t now_us(void);     // monotonic clock, microseconds
+void sleep_ms(int ms);
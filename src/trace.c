@@ -0,0 +1,309 @@
+#include "trace.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SPAN_BUFFER 1024
+#define SPAN_DETAIL 160
+#define FLUSH_INTERVAL_US 1000000
+
+typedef struct {
+    const char *name;
+    uint64_t trace_hi;
+    uint64_t trace_lo;
+    uint64_t span_id;
+    uint64_t parent_id;
+    uint64_t start_us;
+    uint64_t dur_us;
+    char detail[SPAN_DETAIL];
+} SpanRecord;
+
+// Written only by the owning thread; read by others only after it has stopped
+typedef struct TraceBuffer {
+    SpanRecord spans[SPAN_BUFFER];
+    int count;
+    int tid;
+    uint64_t last_flush_us;
+    struct TraceBuffer *next;
+} TraceBuffer;
+
+static struct {
+    mutex_t lock;           // guards fp and the buffer list
+    bool enabled;
+    bool otlp;
+    double rate;
+    FILE *fp;
+    int64_t wall_offset_us; // wall clock minus now_us
+    TraceBuffer *buffers;
+    int next_tid;
+} tr;
+
+static _Thread_local struct {
+    TraceBuffer *buf;
+    TraceContext ctx;
+    TraceSpan root;
+    bool root_active;
+    char root_name[128];
+    char header[80];
+    uint64_t rng;
+} cur;
+
+static uint64_t random_u64(void) {
+    if (!cur.rng) cur.rng = (now_us() ^ (uint64_t)(uintptr_t)&cur) | 1;
+    // xorshift64*
+    cur.rng ^= cur.rng >> 12;
+    cur.rng ^= cur.rng << 25;
+    cur.rng ^= cur.rng >> 27;
+    return cur.rng * 0x2545F4914F6CDD1DULL;
+}
+
+static uint64_t random_id(void) {
+    uint64_t id;
+    while ((id = random_u64()) == 0) {}
+    return id;
+}
+
+#pragma region Output
+
+static void write_escaped(FILE *fp, const char *s) {
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(fp, "\\%c", c);
+        else if (c < 0x20) fprintf(fp, "\\u%04x", c);
+        else fputc(c, fp);
+    }
+}
+
+static void write_chrome(FILE *fp, const TraceBuffer *b) {
+    for (int i = 0; i < b->count; i++) {
+        const SpanRecord *r = &b->spans[i];
+        fprintf(fp, "{\"name\":\"%s\",\"cat\":\"curriculum\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%llu,\"pid\":1,\"tid\":%d,"
+                    "\"args\":{\"trace_id\":\"%016llx%016llx\",\"span_id\":\"%016llx\",\"parent_id\":\"%016llx\",\"detail\":\"",
+                r->name, (long long)r->start_us + tr.wall_offset_us, (unsigned long long)r->dur_us, b->tid,
+                (unsigned long long)r->trace_hi, (unsigned long long)r->trace_lo,
+                (unsigned long long)r->span_id, (unsigned long long)r->parent_id);
+        write_escaped(fp, r->detail);
+        fputs("\"}},\n", fp);
+    }
+}
+
+static void write_otlp(FILE *fp, const TraceBuffer *b) {
+    fputs("{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":\"service.name\",\"value\":{\"stringValue\":\"curriculum\"}}]},"
+          "\"scopeSpans\":[{\"scope\":{\"name\":\"curriculum\"},\"spans\":[", fp);
+    for (int i = 0; i < b->count; i++) {
+        const SpanRecord *r = &b->spans[i];
+        bool root = strcmp(r->name, "request") == 0;
+        long long start = (long long)r->start_us + tr.wall_offset_us;
+        fprintf(fp, "%s{\"traceId\":\"%016llx%016llx\",\"spanId\":\"%016llx\",", i ? "," : "",
+                (unsigned long long)r->trace_hi, (unsigned long long)r->trace_lo, (unsigned long long)r->span_id);
+        if (r->parent_id) fprintf(fp, "\"parentSpanId\":\"%016llx\",", (unsigned long long)r->parent_id);
+        // kind 2 = SERVER, 1 = INTERNAL
+        fprintf(fp, "\"name\":\"%s\",\"kind\":%d,\"startTimeUnixNano\":\"%lld000\",\"endTimeUnixNano\":\"%lld000\","
+                    "\"attributes\":[{\"key\":\"%s\",\"value\":{\"stringValue\":\"",
+                r->name, root ? 2 : 1, start, start + (long long)r->dur_us,
+                strcmp(r->name, "sql") == 0 ? "db.statement" : "detail");
+        write_escaped(fp, r->detail);
+        fputs("\"}}]}", fp);
+    }
+    fputs("]}]}]}\n", fp);
+}
+
+static void flush_buffer(TraceBuffer *b) {
+    mutex_lock(&tr.lock);
+    if (tr.fp && b->count) {
+        if (tr.otlp) write_otlp(tr.fp, b);
+        else write_chrome(tr.fp, b);
+        fflush(tr.fp);
+    }
+    mutex_unlock(&tr.lock);
+    b->count = 0;
+    b->last_flush_us = now_us();
+}
+
+#pragma endregion Output
+
+static TraceBuffer *thread_buffer(void) {
+    if (cur.buf) return cur.buf;
+    TraceBuffer *b = calloc(1, sizeof(*b));
+    if (!b) return NULL;
+    b->last_flush_us = now_us();
+    mutex_lock(&tr.lock);
+    b->tid = ++tr.next_tid;
+    b->next = tr.buffers;
+    tr.buffers = b;
+    mutex_unlock(&tr.lock);
+    cur.buf = b;
+    return b;
+}
+
+// Copies at most SPAN_DETAIL - 1 bytes without splitting a UTF-8 sequence
+static void copy_detail(char *dst, const char *src) {
+    size_t len = src ? strlen(src) : 0;
+    if (len >= SPAN_DETAIL) {
+        len = SPAN_DETAIL - 1;
+        while (len > 0 && ((unsigned char)src[len] & 0xC0) == 0x80) len--;
+    }
+    if (len) memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static void record(const char *name, uint64_t span_id, uint64_t parent_id, uint64_t start_us, uint64_t dur_us, const char *detail) {
+    TraceBuffer *b = thread_buffer();
+    if (!b) return;
+    if (b->count == SPAN_BUFFER) flush_buffer(b);
+
+    SpanRecord *r = &b->spans[b->count++];
+    r->name = name;
+    r->trace_hi = cur.ctx.trace_hi;
+    r->trace_lo = cur.ctx.trace_lo;
+    r->span_id = span_id;
+    r->parent_id = parent_id;
+    r->start_us = start_us;
+    r->dur_us = dur_us;
+    copy_detail(r->detail, detail);
+
+    if (now_us() - b->last_flush_us >= FLUSH_INTERVAL_US) flush_buffer(b);
+}
+
+bool trace_start(void) {
+    const char *path = env_str("CURRICULUM_TRACE", NULL);
+    if (!path) return true;
+
+    mutex_init(&tr.lock);
+    tr.otlp = strcmp(env_str("CURRICULUM_TRACE_FORMAT", "chrome"), "otlp") == 0;
+    tr.rate = strtod(env_str("CURRICULUM_TRACE_RATE", "1"), NULL);
+    tr.fp = fopen(path, "ab");
+    if (!tr.fp) {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "trace: cannot open %s", path);
+        log_message(buf, LOG_ERROR);
+        mutex_destroy(&tr.lock);
+        return false;
+    }
+    // The closing ] of the trace-event array is optional, so appending to an earlier trace stays valid
+    fseek(tr.fp, 0, SEEK_END);
+    if (!tr.otlp && ftell(tr.fp) == 0) fputs("[\n", tr.fp);
+
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    tr.wall_offset_us = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000 - (int64_t)now_us();
+    tr.buffers = NULL;
+    tr.next_tid = 0;
+    tr.enabled = true;
+
+    char buf[320];
+    snprintf(buf, sizeof(buf), "Tracing %.0f%% of requests to %s (%s)", tr.rate * 100, path, tr.otlp ? "otlp" : "chrome");
+    log_message(buf, LOG_INFO);
+    return true;
+}
+
+void trace_stop(void) {
+    if (!tr.enabled) return;
+    tr.enabled = false;
+    TraceBuffer *b = tr.buffers;
+    while (b) {
+        TraceBuffer *next = b->next;
+        flush_buffer(b);
+        free(b);
+        b = next;
+    }
+    tr.buffers = NULL;
+    cur.buf = NULL;
+    fclose(tr.fp);
+    tr.fp = NULL;
+    mutex_destroy(&tr.lock);
+}
+
+bool trace_enabled(void) {
+    return tr.enabled;
+}
+
+static bool parse_hex(const char *s, int n, uint64_t *out) {
+    uint64_t v = 0;
+    for (int i = 0; i < n; i++) {
+        char c = s[i];
+        int d = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (d < 0) return false;
+        v = v << 4 | (uint64_t)d;
+    }
+    *out = v;
+    return true;
+}
+
+// version-traceid-parentid-flags, e.g. 00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01
+static bool parse_traceparent(const char *tp, TraceContext *ctx) {
+    uint64_t flags;
+    if (!tp || strlen(tp) < 55 || tp[2] != '-' || tp[35] != '-' || tp[52] != '-') return false;
+    if (!parse_hex(tp + 3, 16, &ctx->trace_hi) || !parse_hex(tp + 19, 16, &ctx->trace_lo) ||
+        !parse_hex(tp + 36, 16, &ctx->span_id) || !parse_hex(tp + 53, 2, &flags)) return false;
+    if ((ctx->trace_hi | ctx->trace_lo) == 0 || ctx->span_id == 0) return false;
+    ctx->sampled = flags & 1;
+    return true;
+}
+
+void trace_request_begin(const char *name, const char *traceparent) {
+    if (!tr.enabled) return;
+    TraceContext ctx = {0};
+    if (!parse_traceparent(traceparent, &ctx)) {
+        ctx.trace_hi = random_id();
+        ctx.trace_lo = random_id();
+        ctx.span_id = 0;
+        ctx.sampled = false;
+    }
+    if (!ctx.sampled) ctx.sampled = (double)(random_u64() >> 11) / 9007199254740992.0 < tr.rate;
+    ctx.valid = true;
+    cur.ctx = ctx;
+
+    cur.root_active = trace_span_begin(&cur.root);
+    uint64_t own_id = cur.root_active ? cur.root.span_id : random_id();
+    snprintf(cur.root_name, sizeof(cur.root_name), "%s", name);
+    snprintf(cur.header, sizeof(cur.header), "traceparent: 00-%016llx%016llx-%016llx-%02x\r\n",
+             (unsigned long long)ctx.trace_hi, (unsigned long long)ctx.trace_lo,
+             (unsigned long long)own_id, ctx.sampled ? 1 : 0);
+}
+
+void trace_request_end(int status) {
+    if (!cur.ctx.valid) return;
+    if (cur.root_active) {
+        char detail[SPAN_DETAIL];
+        snprintf(detail, sizeof(detail), "%s -> %d", cur.root_name, status);
+        trace_span_end(&cur.root, "request", detail);
+        cur.root_active = false;
+    }
+    cur.ctx.valid = false;
+    cur.header[0] = '\0';
+}
+
+const char *trace_response_header(void) {
+    return cur.ctx.valid ? cur.header : "";
+}
+
+void trace_current(TraceContext *out) {
+    *out = cur.ctx;
+}
+
+void trace_adopt(const TraceContext *ctx) {
+    if (ctx && ctx->valid && tr.enabled) cur.ctx = *ctx;
+    else cur.ctx.valid = false;
+}
+
+bool trace_span_begin(TraceSpan *span) {
+    if (!tr.enabled || !cur.ctx.valid || !cur.ctx.sampled) return false;
+    span->start_us = now_us();
+    span->span_id = random_id();
+    span->parent_id = cur.ctx.span_id;
+    cur.ctx.span_id = span->span_id;
+    return true;
+}
+
+void trace_span_end(TraceSpan *span, const char *name, const char *detail) {
+    record(name, span->span_id, span->parent_id, span->start_us, now_us() - span->start_us, detail);
+    cur.ctx.span_id = span->parent_id;
+}
+
+void trace_statement(const char *sql, uint64_t ns) {
+    if (!tr.enabled || !cur.ctx.valid || !cur.ctx.sampled) return;
+    uint64_t end = now_us();
+    uint64_t dur = ns / 1000;
+    record("sql", random_id(), cur.ctx.span_id, end - dur, dur, sql);
+}
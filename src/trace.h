@@ -0,0 +1,63 @@
+#pragma once
+#include "utils.h"
+#include <stdint.h>
+
+/*
+ * Per-request span tracing. With CURRICULUM_TRACE=<path> every request gets a
+ * trace ID, taken from an incoming W3C `traceparent` header or generated, and
+ * echoed back in the response's `traceparent` header. Sampled requests record
+ * spans for the request as a whole, body read, JSON parse, every SQLite
+ * statement (also those the writer thread runs on the request's behalf),
+ * serialization and the socket write.
+ *
+ * Spans go into a buffer owned by the recording thread, so recording takes no
+ * lock; a thread appends its buffer to the file when it fills up, at least
+ * once a second while it keeps recording, and on shutdown.
+ *
+ * CURRICULUM_TRACE         output file
+ * CURRICULUM_TRACE_FORMAT  chrome (default): Chrome trace-event JSON array, opens in
+ *                          chrome://tracing or Perfetto; otlp: one OTLP/JSON
+ *                          ExportTraceServiceRequest per line, as written by the
+ *                          OpenTelemetry collector's file exporter
+ * CURRICULUM_TRACE_RATE    fraction of requests to sample (default 1.0); requests
+ *                          whose traceparent has the sampled flag are always traced
+ */
+
+typedef struct {
+    uint64_t trace_hi;
+    uint64_t trace_lo;
+    uint64_t span_id;       // span that new spans hang off
+    bool sampled;
+    bool valid;
+} TraceContext;
+
+typedef struct {
+    uint64_t start_us;
+    uint64_t span_id;
+    uint64_t parent_id;
+} TraceSpan;
+
+// No-op unless CURRICULUM_TRACE is set; must run before the server accepts requests
+bool trace_start(void);
+// Flushes every thread's buffer; the recording threads must have stopped
+void trace_stop(void);
+bool trace_enabled(void);
+
+// Bracket a request on its thread; traceparent may be NULL
+void trace_request_begin(const char *name, const char *traceparent);
+void trace_request_end(int status);
+// "traceparent: ...\r\n" for the current request, or "" when tracing is off
+const char *trace_response_header(void);
+
+// Hand the current context to another thread (e.g. with a queued mutation)
+void trace_current(TraceContext *out);
+// Record the calling thread's spans under ctx until trace_adopt(NULL)
+void trace_adopt(const TraceContext *ctx);
+
+// begin returns false when the thread is not sampling; end only then needs calling.
+// name must be a string literal; detail (may be NULL) is copied, truncated if long
+bool trace_span_begin(TraceSpan *span);
+void trace_span_end(TraceSpan *span, const char *name, const char *detail);
+
+// A statement that took ns nanoseconds and just finished (called by the SQLite backend)
+void trace_statement(const char *sql, uint64_t ns);
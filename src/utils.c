@@ -1,4 +1,5 @@
 #include "utils.h"
+#include <stdlib.h>
 
 static FILE *log_fp = NULL;
 
@@ -55,4 +56,17 @@ void log_message(const char *message, enum log_level level) {
         fprintf(log_fp, "%s [%s] %s\n", tbuf, lvl, message);
         fflush(log_fp);
     }
+}
+
+const char *env_str(const char *name, const char *def) {
+    const char *v = getenv(name);
+    return (v && *v) ? v : def;
+}
+
+long env_long(const char *name, long def) {
+    const char *v = getenv(name);
+    if (!v || !*v) return def;
+    char *end = NULL;
+    long n = strtol(v, &end, 10);
+    return (end && *end == '\0') ? n : def;
 }
\ No newline at end of file
@@ -17,4 +17,8 @@ enum log_level {
 
 void log_message(const char *message, enum log_level level);
 bool log_init(const char *path);
-void log_close(void);
\ No newline at end of file
+void log_close(void);
+
+// Runtime tuning knobs come from environment variables
+const char *env_str(const char *name, const char *def);
+long env_long(const char *name, long def);
\ No newline at end of file
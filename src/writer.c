@@ -0,0 +1,239 @@
+#include "writer.h"
+#include "thread.h"
+#include "slowlog.h"
+
+// One per shard (see db_shard_count), each with its own thread and connection
+typedef struct {
+    mutex_t lock;
+    cond_t not_empty;
+    cond_t not_full;
+    cond_t completed;
+
+    Mutation *head;
+    Mutation *tail;
+    int count;
+
+    thread_t thread;
+    bool started;           // the thread has tried to open its connection
+    bool opened;            // ...and got one
+    bool stopping;
+} WriterQueue;
+
+static struct {
+    int batch_max;
+    int window_us;
+    int queue_max;
+
+    WriterQueue queues[DB_SHARDS_MAX];
+    int nqueues;
+    bool running;
+} w;
+
+// Per-student writes go to the writer of the student's shard; the rest span shards
+static int mutation_shard(const Mutation *m) {
+    switch (m->kind) {
+        case MUT_STUDENT_ADD:
+        case MUT_STUDENT_UPDATE: return db_shard_of(m->student.student_id);
+        case MUT_STUDENT_REMOVE: return db_shard_of(m->id);
+        case MUT_ENROLLMENT_ADD:
+        case MUT_ENROLLMENT_REMOVE: return db_shard_of(m->enrollment.student_id);
+        default: return 0;
+    }
+}
+
+static bool apply_mutation(Mutation *m) {
+    switch (m->kind) {
+        case MUT_COURSE_ADD: return db_course_add(&m->course);
+        case MUT_COURSE_UPDATE: return db_course_update(&m->course);
+        case MUT_COURSE_REMOVE: return db_course_remove(m->id);
+        case MUT_COURSE_REMOVE_ALL: return db_course_remove_all();
+        case MUT_STUDENT_ADD: return db_student_add(&m->student);
+        case MUT_STUDENT_UPDATE: return db_student_update(&m->student);
+        case MUT_STUDENT_REMOVE: return db_student_remove(m->id);
+        case MUT_STUDENT_REMOVE_ALL: return db_student_remove_all();
+        case MUT_ENROLLMENT_ADD: return db_enrollment_add(&m->enrollment);
+        case MUT_ENROLLMENT_REMOVE: return db_enrollment_remove(m->enrollment.student_id, m->enrollment.course_id);
+        case MUT_ENROLLMENT_REMOVE_ALL: return db_enrollment_remove_all();
+        case MUT_REMOVE_BATCH: return db_remove_batch(m->batch.entity, m->batch.limit, &m->batch.removed);
+    }
+    return false;
+}
+
+/* Apply a batch in one transaction. Sets ok on every mutation. */
+static void apply_batch(Mutation *batch) {
+    slowlog_set_route("writer");
+    if (!db_begin()) {
+        for (Mutation *m = batch; m; m = m->next) m->ok = false;
+        return;
+    }
+
+    for (Mutation *m = batch; m; m = m->next) {
+        slowlog_set_route(m->route);
+        trace_adopt(&m->trace);
+        TraceSpan span;
+        bool traced = trace_span_begin(&span);
+        if (db_savepoint()) {
+            m->ok = apply_mutation(m);
+            if (m->ok) db_release_savepoint();
+            else db_rollback_savepoint();
+        } else {
+            m->ok = false;
+        }
+        if (traced) trace_span_end(&span, "writer.apply", NULL);
+        trace_adopt(NULL);
+    }
+    slowlog_set_route("writer");
+
+    if (!db_commit()) {
+        log_message("writer: batch commit failed", LOG_ERROR);
+        db_rollback();
+        for (Mutation *m = batch; m; m = m->next) m->ok = false;
+    }
+}
+
+static void writer_loop(void *arg) {
+    WriterQueue *q = arg;
+    bool opened = db_thread_open();
+    if (!opened) log_message("writer: failed to open connection", LOG_ERROR);
+
+    mutex_lock(&q->lock);
+    q->started = true;
+    q->opened = opened;
+    cond_broadcast(&q->completed);
+    // Without a connection of its own the writer would share the request threads' one
+    if (!opened) {
+        mutex_unlock(&q->lock);
+        return;
+    }
+    for (;;) {
+        while (!q->head && !q->stopping) cond_wait(&q->not_empty, &q->lock);
+        if (!q->head && q->stopping) break;
+
+        // Optionally give concurrent submitters a moment to join this batch
+        if (w.window_us > 0 && q->count < w.batch_max && !q->stopping) {
+            uint64_t deadline = now_us() + (uint64_t)w.window_us;
+            while (q->count < w.batch_max && !q->stopping) {
+                uint64_t now = now_us();
+                if (now >= deadline) break;
+                int wait_ms = (int)((deadline - now + 999) / 1000);
+                cond_timedwait(&q->not_empty, &q->lock, wait_ms);
+            }
+        }
+
+        Mutation *batch = q->head;
+        Mutation *last = batch;
+        int n = 1;
+        while (last->next && n < w.batch_max) { last = last->next; n++; }
+        q->head = last->next;
+        if (!q->head) q->tail = NULL;
+        last->next = NULL;
+        q->count -= n;
+        cond_broadcast(&q->not_full);
+        mutex_unlock(&q->lock);
+
+        apply_batch(batch);
+
+        mutex_lock(&q->lock);
+        for (Mutation *m = batch; m; ) {
+            Mutation *next = m->next;
+            m->done = true;     // submitter owns m again after this
+            m = next;
+        }
+        cond_broadcast(&q->completed);
+    }
+    mutex_unlock(&q->lock);
+
+    db_thread_close();
+}
+
+bool writer_start(void) {
+    w.batch_max = (int)env_long("CURRICULUM_WRITER_BATCH", 64);
+    w.window_us = (int)env_long("CURRICULUM_WRITER_WINDOW_US", 0);
+    w.queue_max = (int)env_long("CURRICULUM_WRITER_QUEUE", 1024);
+    if (w.batch_max < 1) w.batch_max = 1;
+    if (w.queue_max < w.batch_max) w.queue_max = w.batch_max;
+
+    w.nqueues = 0;
+    for (int i = 0; i < db_shard_count(); i++) {
+        WriterQueue *q = &w.queues[i];
+        mutex_init(&q->lock);
+        cond_init(&q->not_empty);
+        cond_init(&q->not_full);
+        cond_init(&q->completed);
+        q->head = q->tail = NULL;
+        q->count = 0;
+        q->started = q->opened = false;
+        q->stopping = false;
+        if (!thread_start(&q->thread, writer_loop, q)) {
+            writer_stop();
+            return false;
+        }
+        w.nqueues++;
+        w.running = true;
+
+        mutex_lock(&q->lock);
+        while (!q->started) cond_wait(&q->completed, &q->lock);
+        bool opened = q->opened;
+        mutex_unlock(&q->lock);
+        if (!opened) {
+            writer_stop();
+            return false;
+        }
+    }
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Writer started (batch=%d, window=%dus, queue=%d, threads=%d)",
+             w.batch_max, w.window_us, w.queue_max, w.nqueues);
+    log_message(buf, LOG_INFO);
+    return true;
+}
+
+void writer_stop(void) {
+    if (!w.running) return;
+    for (int i = 0; i < w.nqueues; i++) {
+        WriterQueue *q = &w.queues[i];
+        mutex_lock(&q->lock);
+        q->stopping = true;
+        cond_broadcast(&q->not_empty);
+        mutex_unlock(&q->lock);
+    }
+    for (int i = 0; i < w.nqueues; i++) thread_join(w.queues[i].thread);
+    w.running = false;
+}
+
+bool writer_submit(Mutation *m) {
+    m->ok = false;
+    m->done = false;
+    m->next = NULL;
+    m->route = slowlog_route();
+
+    if (!w.running) {
+        m->ok = apply_mutation(m);
+        m->done = true;
+        return m->ok;
+    }
+
+    // The span covers queueing and the batch commit; the writer's spans hang off it
+    TraceSpan span;
+    bool traced = trace_span_begin(&span);
+    trace_current(&m->trace);
+
+    WriterQueue *q = &w.queues[mutation_shard(m)];
+    mutex_lock(&q->lock);
+    while (q->count >= w.queue_max && !q->stopping) cond_wait(&q->not_full, &q->lock);
+    if (q->stopping) {
+        mutex_unlock(&q->lock);
+        if (traced) trace_span_end(&span, "writer.wait", NULL);
+        return false;
+    }
+    if (q->tail) q->tail->next = m;
+    else q->head = m;
+    q->tail = m;
+    q->count++;
+    cond_signal(&q->not_empty);
+
+    while (!m->done) cond_wait(&q->completed, &q->lock);
+    mutex_unlock(&q->lock);
+    if (traced) trace_span_end(&span, "writer.wait", NULL);
+    return m->ok;
+}
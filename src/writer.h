@@ -0,0 +1,65 @@
+#pragma once
+#include "db.h"
+#include "trace.h"
+
+/*
+ * Group-commit writer: handlers submit mutations to a bounded queue and block
+ * until a dedicated writer thread has applied them. The writer applies each
+ * batch in one transaction with a savepoint per mutation, so one failing
+ * mutation does not affect the others.
+ *
+ * With shards (CURRICULUM_SHARDS) there is one writer per shard, each with its
+ * own queue and connections. Student and enrollment writes go to the writer of
+ * the student's shard; course writes and bulk deletes touch every shard and go
+ * to the first writer.
+ *
+ * CURRICULUM_WRITER_BATCH      max mutations per transaction (default 64)
+ * CURRICULUM_WRITER_WINDOW_US  extra time to wait for a batch to fill (default 0)
+ * CURRICULUM_WRITER_QUEUE      max queued mutations before submitters block (default 1024)
+ */
+
+typedef enum {
+    MUT_COURSE_ADD,
+    MUT_COURSE_UPDATE,
+    MUT_COURSE_REMOVE,
+    MUT_COURSE_REMOVE_ALL,
+    MUT_STUDENT_ADD,
+    MUT_STUDENT_UPDATE,
+    MUT_STUDENT_REMOVE,
+    MUT_STUDENT_REMOVE_ALL,
+    MUT_ENROLLMENT_ADD,
+    MUT_ENROLLMENT_REMOVE,
+    MUT_ENROLLMENT_REMOVE_ALL,
+    MUT_REMOVE_BATCH
+} MutationKind;
+
+typedef struct Mutation {
+    MutationKind kind;
+    union {
+        Course course;           // MUT_COURSE_ADD / UPDATE
+        Student student;         // MUT_STUDENT_ADD / UPDATE
+        Enrollment enrollment;   // MUT_ENROLLMENT_ADD / REMOVE
+        const char *id;          // MUT_COURSE_REMOVE / MUT_STUDENT_REMOVE
+        struct {                 // MUT_REMOVE_BATCH, see db_remove_batch
+            DbEntity entity;
+            int limit;
+            int removed;         // set by the writer
+        } batch;
+    };
+
+    // Filled in by writer_submit: the submitting request, for the slow-query log and traces
+    const char *route;
+    TraceContext trace;
+
+    // Filled in by the writer
+    bool ok;
+    bool done;
+    struct Mutation *next;
+} Mutation;
+
+bool writer_start(void);
+void writer_stop(void);
+
+// Blocks until the mutation is committed or rejected. Falls back to applying
+// the mutation inline when the writer thread is not running.
+bool writer_submit(Mutation *m);
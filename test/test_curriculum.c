@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/curriculum.h"
+
+#define CHECK(expr, msg) do { if (!(expr)) { fprintf(stderr, "%s\n", msg); cur_close(db); return 1; } } while (0)
+
+/* Visitor used to sum the credits of all listed courses */
+static void credit_visitor(const CurCourse *c, void *user) {
+    double *sum = user;
+    *sum += c->credit;
+}
+
+int main(void) {
+    /* CURRICULUM_BACKEND picks the backend, as it does for the server */
+    const char *backend = getenv("CURRICULUM_BACKEND");
+    const char *path = backend && strcmp(backend, "memory") == 0 ? "test_curriculum.mem" : "test_curriculum.db";
+    CurDb *db = NULL;
+    if (cur_open(backend, path, &db) != CUR_OK) {
+        fprintf(stderr, "cur_open failed\n");
+        return 1;
+    }
+    cur_enrollment_remove_all(db);
+    cur_student_remove_all(db);
+    cur_course_remove_all(db);
+
+    /* Writes and status codes */
+    CurCourse c1 = { "c1", "Intro", "required", 32, 32, 0, 2.0, "fall" };
+    CurCourse c2 = { "c2", "Lab", "elective", 16, 0, 16, 1.5, "spring" };
+    CHECK(cur_course_add(db, &c1) == CUR_OK, "cur_course_add failed");
+    CHECK(cur_course_add(db, &c2) == CUR_OK, "cur_course_add failed");
+    CHECK(cur_course_add(db, &c1) == CUR_EXISTS, "duplicate course not reported");
+    CHECK(cur_course_add(db, &(CurCourse){ .name = "no id" }) == CUR_INVALID, "course without ID accepted");
+
+    CurStudent s1 = { "s1", "Alice", "alice@example.com", 0 };
+    CHECK(cur_student_add(db, &s1) == CUR_OK, "cur_student_add failed");
+    CHECK(cur_student_update(db, &(CurStudent){ "nobody", "Nobody", NULL, 0 }) == CUR_NOT_FOUND, "update of missing student not reported");
+
+    /* Enrollments inside a transaction keep credits in step */
+    CHECK(cur_begin(db) == CUR_OK, "cur_begin failed");
+    CHECK(cur_enrollment_add(db, &(CurEnrollment){ "s1", "c1" }) == CUR_OK, "cur_enrollment_add failed");
+    CHECK(cur_enrollment_add(db, &(CurEnrollment){ "s1", "c2" }) == CUR_OK, "cur_enrollment_add failed");
+    CHECK(cur_enrollment_add(db, &(CurEnrollment){ "s1", "c1" }) == CUR_EXISTS, "duplicate enrollment not reported");
+    CHECK(cur_enrollment_add(db, &(CurEnrollment){ "s1", "c9" }) == CUR_NOT_FOUND, "enrollment in missing course not reported");
+    CHECK(cur_commit(db) == CUR_OK, "cur_commit failed");
+    CHECK(cur_commit(db) == CUR_INVALID, "commit outside a transaction accepted");
+
+    /* Cursor reads */
+    CurCursor *it;
+    CurStudent s;
+    CHECK(cur_student_query(db, &(CurQuery){ .field = CUR_BY_STUDENT_ID, .value = "s1" }, &it) == CUR_OK, "cur_student_query failed");
+    CHECK(cur_student_next(it, &s) == CUR_ROW && s.credits == 3.5, "credits not updated by enrollments");
+    CHECK(cur_student_next(it, &s) == CUR_DONE, "cursor returned too many rows");
+    cur_cursor_close(it);
+
+    CurEnrollment e;
+    int rows = 0;
+    CHECK(cur_enrollment_query(db, &(CurQuery){ .field = CUR_BY_STUDENT_ID, .value = "s1", .order_by = "course_id", .descending = true }, &it) == CUR_OK, "cur_enrollment_query failed");
+    while (cur_enrollment_next(it, &e) == CUR_ROW) {
+        if (rows++ == 0 && strcmp(e.course_id, "c2") != 0) { cur_cursor_close(it); CHECK(0, "enrollment cursor ignored order"); }
+    }
+    cur_cursor_close(it);
+    CHECK(rows == 2, "enrollment cursor returned wrong row count");
+
+    CHECK(cur_course_query(db, &(CurQuery){ .order_by = "no_such_column" }, &it) == CUR_INVALID, "bad order_by accepted");
+
+    /* Visitor reads */
+    double sum = 0;
+    CHECK(cur_course_visit(db, NULL, credit_visitor, &sum) == CUR_OK && sum == 3.5, "cur_course_visit failed");
+
+    /* Removals of missing rows are reported */
+    CHECK(cur_course_remove(db, "c2") == CUR_OK, "cur_course_remove failed");
+    CHECK(cur_course_remove(db, "c2") == CUR_NOT_FOUND, "removal of missing course not reported");
+    CHECK(cur_enrollment_remove(db, "s1", "c1") == CUR_OK, "cur_enrollment_remove failed");
+    CHECK(cur_enrollment_remove(db, "s1", "c1") == CUR_NOT_FOUND, "removal of missing enrollment not reported");
+
+    cur_close(db);
+
+    /* Remove files created by the test for hygiene */
+    remove(path);
+    char log_path[64];
+    snprintf(log_path, sizeof(log_path), "%s.log", path);
+    remove(log_path);
+    printf("All tests passed\n");
+    return 0;
+}
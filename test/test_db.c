@@ -30,6 +30,28 @@ static void enrollment_visitor(const Enrollment *e, void *user) {
     }
 }
 
+static void count_courses(const Course *c, void *user) {
+    (void)c;
+    (*(int *)user)++;
+}
+
+static void count_enrollments(const Enrollment *e, void *user) {
+    (void)e;
+    (*(int *)user)++;
+}
+
+/* Visitor used by the paging test to collect student names in order */
+typedef struct {
+    char names[4][16];
+    int n;
+} NameList;
+
+static void name_visitor(const Student *s, void *user) {
+    NameList *list = user;
+    if (!s || list->n >= 4) return;
+    strncpy(list->names[list->n++], s->name ? s->name : "", 15);
+}
+
 /* Visitor used by ordering tests to capture course name */
 static void order_visitor(const Course *c, void *user) {
     char *out = user;
@@ -38,6 +60,10 @@ static void order_visitor(const Course *c, void *user) {
 }
 
 int main(void) {
+    /* Versions kept where other processes could see them (as the supervisor does) */
+    uint64_t shared_versions[DB_ENTITY_ENROLLMENT + 1] = { 0 };
+    db_share_data_versions(shared_versions);
+
     /* Initialize DB (creates `curriculum.db` in working directory) */
     if (!init_db()) {
         fprintf(stderr, "init_db failed\n");
@@ -87,14 +113,144 @@ int main(void) {
     if (!db_enrollment_find_by_student_id("s1", NULL, enrollment_visitor, &cnt)) { fprintf(stderr, "db_enrollment_find_by_student_id failed\n"); close_db(); return 1; }
     if (!cnt) { fprintf(stderr, "enrollment not found or incorrect\n"); close_db(); return 1; }
 
+    /* Data versions: enrollments recompute credits, so they move the student version too */
+    uint64_t course_v = db_data_version(DB_ENTITY_COURSE);
+    uint64_t student_v = db_data_version(DB_ENTITY_STUDENT);
+    uint64_t enrollment_v = db_data_version(DB_ENTITY_ENROLLMENT);
+    if (!db_enrollment_remove("s1", "c1")) { fprintf(stderr, "db_enrollment_remove failed\n"); close_db(); return 1; }
+    if (db_data_version(DB_ENTITY_ENROLLMENT) == enrollment_v || db_data_version(DB_ENTITY_STUDENT) == student_v
+        || db_data_version(DB_ENTITY_COURSE) != course_v) {
+        fprintf(stderr, "data versions not bumped as expected\n"); close_db(); return 1;
+    }
+    /* Changes inside a transaction only count once committed */
+    enrollment_v = db_data_version(DB_ENTITY_ENROLLMENT);
+    if (!db_begin() || !db_enrollment_add(&e)) { fprintf(stderr, "db_begin/db_enrollment_add failed\n"); close_db(); return 1; }
+    if (db_data_version(DB_ENTITY_ENROLLMENT) != enrollment_v) { fprintf(stderr, "data version moved before commit\n"); close_db(); return 1; }
+    if (!db_commit() || db_data_version(DB_ENTITY_ENROLLMENT) == enrollment_v) { fprintf(stderr, "data version not bumped on commit\n"); close_db(); return 1; }
+    if (shared_versions[DB_ENTITY_ENROLLMENT] != db_data_version(DB_ENTITY_ENROLLMENT) || shared_versions[DB_ENTITY_COURSE] == 0) {
+        fprintf(stderr, "data versions not kept in shared memory\n"); close_db(); return 1;
+    }
+
+    /* Removal in chunks, as background jobs do it; an empty table reports 0 removed.
+       The memory backend has no chunks (jobs fall back to remove_all there). */
+    int removed = 0;
+    if (strncmp(db_backend_name(), "sqlite", 6) == 0) {
+        enrollment_v = db_data_version(DB_ENTITY_ENROLLMENT);
+        if (!db_remove_batch(DB_ENTITY_ENROLLMENT, 10, &removed) || removed != 1) { fprintf(stderr, "db_remove_batch (enrollment) failed\n"); close_db(); return 1; }
+        if (db_data_version(DB_ENTITY_ENROLLMENT) == enrollment_v) { fprintf(stderr, "data version not bumped by db_remove_batch\n"); close_db(); return 1; }
+        cnt = 0;
+        if (!db_enrollment_find_by_student_id("s1", NULL, enrollment_visitor, &cnt) || cnt) { fprintf(stderr, "enrollment left after db_remove_batch\n"); close_db(); return 1; }
+        if (!db_remove_batch(DB_ENTITY_ENROLLMENT, 10, &removed) || removed != 0) { fprintf(stderr, "db_remove_batch on empty table failed\n"); close_db(); return 1; }
+        int batches = 0;
+        do {
+            if (!db_remove_batch(DB_ENTITY_COURSE, 1, &removed) || removed > 1) { fprintf(stderr, "db_remove_batch (course) failed\n"); close_db(); return 1; }
+            batches++;
+        } while (removed);
+        cnt = 0;
+        if (!db_course_list(NULL, count_courses, &cnt) || cnt || batches < 3) { fprintf(stderr, "courses left after db_remove_batch\n"); close_db(); return 1; }
+
+        /* Every enrollment counts, and a course once however many shards hold it */
+        const char *batch_ids[] = { "b1", "b2", "b3", "b4" };
+        Course bc1 = { "bc1", "Batch 1", NULL, 0, 0, 0, 1.0, NULL };
+        Course bc2 = { "bc2", "Batch 2", NULL, 0, 0, 0, 1.0, NULL };
+        db_course_add(&bc1);
+        db_course_add(&bc2);
+        for (int i = 0; i < 4; i++) {
+            Student bs = { batch_ids[i], "Batch", NULL, 0.0 };
+            Enrollment be1 = { .course_id = "bc1", .student_id = batch_ids[i] };
+            Enrollment be2 = { .course_id = "bc2", .student_id = batch_ids[i] };
+            db_student_add(&bs);
+            db_enrollment_add(&be1);
+            db_enrollment_add(&be2);
+        }
+        int total = 0;
+        do {
+            if (!db_remove_batch(DB_ENTITY_COURSE, 100, &removed)) { fprintf(stderr, "db_remove_batch (course) failed\n"); close_db(); return 1; }
+            total += removed;
+        } while (removed);
+        if (total != 10) { fprintf(stderr, "db_remove_batch (course) reported %d rows, expected 10\n", total); close_db(); return 1; }
+        for (int i = 0; i < 4; i++) db_student_remove(batch_ids[i]);
+    } else if (!db_remove_batch(DB_ENTITY_COURSE, 1, &removed) || removed != 0) {
+        fprintf(stderr, "db_remove_batch without backend support failed\n"); close_db(); return 1;
+    }
+
     /* Cleanup */
     db_enrollment_remove("s1", "c1");
     db_student_remove("s1");
     db_course_remove("c1");
+
+    /* Lists that span shards: order, offset and limit apply to all rows together */
+    Course cm = { "cm", "Merge", "Core", 1.0, 0.0, 0.0, 1.0, "Fall" };
+    const char *merge_names[] = { "Eve", "Bob", "Dan", "Amy", "Cal" };
+    char merge_ids[5][8];
+    if (!db_course_add(&cm)) { fprintf(stderr, "db_course_add (merge) failed\n"); close_db(); return 1; }
+    for (int i = 0; i < 5; i++) {
+        snprintf(merge_ids[i], sizeof(merge_ids[i]), "m%d", i);
+        Student ms = { merge_ids[i], merge_names[i], NULL, 0.0 };
+        Enrollment me = { "cm", merge_ids[i] };
+        if (!db_student_add(&ms) || !db_enrollment_add(&me)) { fprintf(stderr, "merge test setup failed\n"); close_db(); return 1; }
+    }
+    NameList page = { .n = 0 };
+    QueryOptions by_name = { .order_by = "name", .order = SORT_DESC, .limit = 2, .offset = 1 };
+    if (!db_student_list(&by_name, name_visitor, &page) || page.n != 2
+        || strcmp(page.names[0], "Dan") != 0 || strcmp(page.names[1], "Cal") != 0) {
+        fprintf(stderr, "ordered page across shards wrong\n"); close_db(); return 1;
+    }
+    cnt = 0;
+    QueryOptions tail = { .order_by = "student_id", .limit = 10, .offset = 3 };
+    if (!db_enrollment_find_by_course_id("cm", &tail, count_enrollments, &cnt) || cnt != 2) {
+        fprintf(stderr, "enrollment page across shards wrong (%d rows)\n", cnt); close_db(); return 1;
+    }
+    cnt = 0;
+    QueryOptions unordered = { .limit = 4 };
+    if (!db_enrollment_find_by_course_id("cm", &unordered, count_enrollments, &cnt) || cnt != 4) {
+        fprintf(stderr, "unordered limit across shards wrong (%d rows)\n", cnt); close_db(); return 1;
+    }
+    db_course_remove("cm");
+    for (int i = 0; i < 5; i++) db_student_remove(merge_ids[i]);
+
+    /* Online copy a page per step, and a watcher that notices a commit by another connection */
+    if (strncmp(db_backend_name(), "sqlite", 6) == 0) {
+        char path[64];
+        db_shard_file(0, path, sizeof(path));
+        DbCopyStats cs;
+        if (!db_copy_file(path, "curriculum-copy.db", 1, 0, &cs) || cs.pages < 2 || cs.steps < cs.pages) {
+            fprintf(stderr, "db_copy_file failed\n"); close_db(); return 1;
+        }
+        remove("curriculum-copy.db");
+
+        /* An export nested in a request thread's reads leaves their connection open:
+           the read after a write sees it, and a snapshot still needs that connection */
+        db_thread_open();
+        db_thread_open();
+        db_thread_close();
+        Course cn = { "cn", "Nested", NULL, 0, 0, 0, 1.0, NULL };
+        cnt = 0;
+        if (!db_course_add(&cn) || !db_read_begin() || !db_course_find_by_id("cn", NULL, count_courses, &cnt) || cnt != 1) {
+            fprintf(stderr, "nested db_thread_close closed the thread's connection\n"); close_db(); return 1;
+        }
+        db_read_end();
+        db_thread_close();
+        db_course_remove("cn");
+        DbFileWatch *watch = db_watch_open(path);
+        int64_t before = 0, after = 0;
+        Course cw = { "cw", "Watched", NULL, 0, 0, 0, 1.0, NULL };
+        if (!watch || !db_watch_version(watch, &before) || !db_course_add(&cw) || !db_watch_version(watch, &after) || after == before) {
+            fprintf(stderr, "db_watch_version missed a commit\n"); db_watch_close(watch); close_db(); return 1;
+        }
+        db_watch_close(watch);
+        db_course_remove("cw");
+    }
+
+    int shards = db_shard_count();
     close_db();
 
-    /* Remove DB file created by test for hygiene */
-    remove("curriculum.db");
+    /* Remove DB files created by test for hygiene */
+    for (int i = 0; i < shards; i++) {
+        char path[64];
+        db_shard_file(i, path, sizeof(path));
+        remove(path);
+    }
     printf("All tests passed\n");
     return 0;
 }
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/fastjson.h"
+
+#define CHECK(expr, msg) do { if (!(expr)) { fprintf(stderr, "%s\n", msg); return 1; } } while (0)
+
+int main(void) {
+    char err[160];
+
+    /* Compact and indented bodies decode straight into the struct */
+    char course[] = "{\"course_id\":\"c1\",\"name\":\"Intro\",\"credit\":3,\"total_hours\":48.5,\"semester\":null}";
+    Course c;
+    CHECK(fastjson_course(course, &c, err, sizeof(err)) == FASTJSON_OK, "compact course rejected");
+    CHECK(strcmp(c.course_id, "c1") == 0 && strcmp(c.name, "Intro") == 0, "course strings wrong");
+    CHECK(c.credit == 3.0 && c.total_hours == 48.5 && !c.semester && !c.type, "course numbers or absent fields wrong");
+
+    char student[] = "{\n    \"student_id\" : \"s1\",\n    \"name\" : \"\xE5\xBC\xA0\xE4\xB8\x89 \\\"Zhang\\\" \\u00e9\\ud83d\\ude00\",\n    \"email\" : \"a\\/b@example.com\"\n}\n";
+    Student s;
+    CHECK(fastjson_student(student, &s, err, sizeof(err)) == FASTJSON_OK, "indented student rejected");
+    CHECK(strcmp(s.name, "\xE5\xBC\xA0\xE4\xB8\x89 \"Zhang\" \xC3\xA9\xF0\x9F\x98\x80") == 0, "escapes not decoded");
+    CHECK(strcmp(s.email, "a/b@example.com") == 0, "escaped slash not decoded");
+
+    /* Long values cross the 16-byte scanning blocks */
+    char enrollment[] = "{\"student_id\":\"s-0123456789abcdefghijklmnopqrstuvwxyz\",\"course_id\":\"c-0123456789abcdef\\n0123456789abcdef\"}";
+    Enrollment e;
+    CHECK(fastjson_enrollment(enrollment, &e, err, sizeof(err)) == FASTJSON_OK, "long enrollment rejected");
+    CHECK(strcmp(e.student_id, "s-0123456789abcdefghijklmnopqrstuvwxyz") == 0, "long string wrong");
+    CHECK(strcmp(e.course_id, "c-0123456789abcdef\n0123456789abcdef") == 0, "long escaped string wrong");
+
+    /* Field-level errors */
+    char bad_type[] = "{\"course_id\":\"c1\",\"credit\":\"3\"}";
+    CHECK(fastjson_course(bad_type, &c, err, sizeof(err)) == FASTJSON_ERROR && strcmp(err, "credit must be a number") == 0, "type error not reported");
+    char missing[] = "{\"student_id\":\"s1\",\"name\":null}";
+    CHECK(fastjson_student(missing, &s, err, sizeof(err)) == FASTJSON_ERROR && strcmp(err, "name is required") == 0, "missing field not reported");
+    char bad_utf8[] = "{\"student_id\":\"s1\",\"name\":\"\xED\xA0\x80\"}";
+    CHECK(fastjson_student(bad_utf8, &s, err, sizeof(err)) == FASTJSON_ERROR && strcmp(err, "name is not valid UTF-8") == 0, "surrogate bytes accepted");
+    char twice[] = "{\"student_id\":\"s1\",\"student_id\":\"s2\",\"course_id\":\"c1\"}";
+    CHECK(fastjson_enrollment(twice, &e, err, sizeof(err)) == FASTJSON_ERROR, "duplicate field accepted");
+
+    /* Syntax errors carry the offset */
+    char trailing[] = "{\"student_id\":\"s1\",\"course_id\":\"c1\"} x";
+    CHECK(fastjson_enrollment(trailing, &e, err, sizeof(err)) == FASTJSON_ERROR && strstr(err, "offset 37"), "trailing garbage accepted");
+    char bad_number[] = "{\"course_id\":\"c1\",\"credit\":01}";
+    CHECK(fastjson_course(bad_number, &c, err, sizeof(err)) == FASTJSON_ERROR, "leading zero accepted");
+    char lone[] = "{\"student_id\":\"\\udc00\",\"name\":\"x\"}";
+    CHECK(fastjson_student(lone, &s, err, sizeof(err)) == FASTJSON_ERROR, "lone low surrogate accepted");
+
+    /* Unknown shapes are left untouched for jansson */
+    char unknown[] = "{\"student_id\":\"s1\",\"name\":\"A\\tB\",\"nickname\":\"x\"}";
+    CHECK(fastjson_student(unknown, &s, err, sizeof(err)) == FASTJSON_UNSUPPORTED, "unknown key not passed on");
+    CHECK(strcmp(unknown, "{\"student_id\":\"s1\",\"name\":\"A\\tB\",\"nickname\":\"x\"}") == 0, "body modified before fallback");
+    char nested[] = "{\"course_id\":\"c1\",\"credit\":1,\"name\":{\"zh\":\"x\"}}";
+    CHECK(fastjson_course(nested, &c, err, sizeof(err)) == FASTJSON_UNSUPPORTED, "nested object not passed on");
+
+    /* The jansson fallback applies the same rules, ignoring only unknown keys */
+    json_t *tree = json_loads("{\"course_id\":\"x\",\"credit\":3,\"name\":5,\"extra\":1}", 0, NULL);
+    CHECK(fastjson_course_tree(tree, &c, err, sizeof(err)) == FASTJSON_ERROR && strcmp(err, "name must be a string") == 0, "tree type error not reported");
+    json_decref(tree);
+    tree = json_loads("{\"student_id\":\"s1\",\"name\":\"A\",\"email\":null,\"credits\":\"2\",\"nickname\":\"x\"}", 0, NULL);
+    CHECK(fastjson_student_tree(tree, &s, err, sizeof(err)) == FASTJSON_ERROR && strcmp(err, "credits must be a number") == 0, "tree number error not reported");
+    json_decref(tree);
+    tree = json_loads("{\"student_id\":\"s1\",\"course_id\":null,\"extra\":[1]}", 0, NULL);
+    CHECK(fastjson_enrollment_tree(tree, &e, err, sizeof(err)) == FASTJSON_ERROR && strcmp(err, "course_id is required") == 0, "tree missing field not reported");
+    json_decref(tree);
+    tree = json_loads("{\"course_id\":\"c2\",\"credit\":2.5,\"semester\":null,\"extra\":{}}", 0, NULL);
+    CHECK(fastjson_course_tree(tree, &c, err, sizeof(err)) == FASTJSON_OK && strcmp(c.course_id, "c2") == 0 && c.credit == 2.5 && !c.semester && !c.name,
+          "valid tree rejected");
+    json_decref(tree);
+    tree = json_loads("[1]", 0, NULL);
+    CHECK(fastjson_course_tree(tree, &c, err, sizeof(err)) == FASTJSON_ERROR && strcmp(err, "expected an object") == 0, "tree array accepted");
+    json_decref(tree);
+
+    printf("All tests passed\n");
+    return 0;
+}
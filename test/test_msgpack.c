@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/msgpack.h"
+
+#define CHECK(expr, msg) do { if (!(expr)) { fprintf(stderr, "%s\n", msg); return 1; } } while (0)
+
+int main(void) {
+    char err[160];
+
+    /* A list as the read endpoints write it decodes back to the same records */
+    MpWriter w;
+    mp_init(&w);
+    size_t at = mp_array_begin(&w);
+    mp_map(&w, 3);
+    mp_str(&w, "course_id"); mp_str(&w, "c1");
+    mp_str(&w, "name"); mp_str(&w, NULL);
+    mp_str(&w, "credit"); mp_double(&w, 3.5);
+    char long_name[300];
+    memset(long_name, 'x', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    mp_map(&w, 1);
+    mp_str(&w, "name"); mp_str(&w, long_name);
+    mp_array_end(&w, at, 2);
+    CHECK(!w.failed && (unsigned char)w.data[0] == 0xdd, "array header missing");
+
+    json_t *arr = msgpack_to_json(w.data, w.len, err, sizeof(err));
+    CHECK(arr && json_array_size(arr) == 2, "encoded list not decoded");
+    json_t *first = json_array_get(arr, 0);
+    CHECK(strcmp(json_string_value(json_object_get(first, "course_id")), "c1") == 0, "string field wrong");
+    CHECK(strcmp(json_string_value(json_object_get(first, "name")), "") == 0, "NULL not written as empty string");
+    CHECK(json_real_value(json_object_get(first, "credit")) == 3.5, "double field wrong");
+    CHECK(strcmp(json_string_value(json_object_get(json_array_get(arr, 1), "name")), long_name) == 0, "str16 wrong");
+    json_decref(arr);
+
+    /* Truncated input is rejected at every length */
+    for (size_t n = 0; n < w.len; n++) {
+        CHECK(!msgpack_to_json(w.data, n, err, sizeof(err)), "truncated body accepted");
+    }
+    mp_free(&w);
+
+    /* Write bodies from other encoders: fixint, negative int, float 32, uint 16 */
+    const char body[] = "\x84\xa9" "course_id" "\xa2" "c2" "\xa6" "credit" "\x03"
+                        "\xa9" "lab_hours" "\xca\x40\x20\x00\x00" "\xa5" "total" "\xcd\x01\x00";
+    json_t *obj = msgpack_to_json(body, sizeof(body) - 1, err, sizeof(err));
+    CHECK(obj && json_integer_value(json_object_get(obj, "credit")) == 3, "fixint wrong");
+    CHECK(json_real_value(json_object_get(obj, "lab_hours")) == 2.5, "float 32 wrong");
+    CHECK(json_integer_value(json_object_get(obj, "total")) == 256, "uint 16 wrong");
+    json_decref(obj);
+    obj = msgpack_to_json("\xd0\xfe", 2, err, sizeof(err));
+    CHECK(obj && json_integer_value(obj) == -2, "int 8 not sign-extended");
+    json_decref(obj);
+
+    /* Malformed bodies */
+    CHECK(!msgpack_to_json("\x81\x01\x02", 3, err, sizeof(err)) && strstr(err, "keys"), "integer key accepted");
+    CHECK(!msgpack_to_json("\xa1\xff", 2, err, sizeof(err)) && strstr(err, "UTF-8"), "invalid UTF-8 accepted");
+    CHECK(!msgpack_to_json("\xc0\xc0", 2, err, sizeof(err)) && strstr(err, "trailing"), "trailing bytes accepted");
+    CHECK(!msgpack_to_json("\xc4\x01\x00", 3, err, sizeof(err)), "bin accepted");
+    CHECK(!msgpack_to_json("\xdd\xff\xff\xff\xff", 5, err, sizeof(err)), "oversized array count accepted");
+    char deep[40];
+    memset(deep, 0x91, sizeof(deep) - 1);
+    deep[sizeof(deep) - 1] = (char)0xc0;
+    CHECK(!msgpack_to_json(deep, sizeof(deep), err, sizeof(err)) && strstr(err, "deeply"), "deep nesting accepted");
+
+    printf("All tests passed\n");
+    return 0;
+}
@@ -0,0 +1,729 @@
+/*
+ * curriculum-gen: seeded synthetic dataset generator for capacity testing.
+ *
+ *   curriculum-gen --students 2000000 --courses 5000 --out data/          CSV
+ *   curriculum-gen --students 2000000 --format sqlite --out curriculum.db
+ *
+ * The data follows utils/example_*.csv: courses have the same type, semester
+ * and credit mix (total hours = 16 x credit), students get Chinese names and
+ * school e-mail addresses, and each student takes --min-enroll..--max-enroll
+ * courses drawn from a Zipf distribution (--skew) so a few courses are far
+ * more popular than the rest.
+ *
+ * Output is a pure function of the options and --seed: every student draws
+ * from its own RNG stream, so --threads only changes the speed. Worker
+ * threads generate blocks of students; the main thread writes them in order.
+ *
+ * CSV output writes courses.csv, students.csv and enrollments.csv with the
+ * example headers into the --out directory; credits are 0, as in the
+ * examples, because loading enrollments through the API adds them. SQLite
+ * output creates a fresh database with the server's schema, fills it with
+ * batched prepared inserts and stores each student's summed credits.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <sqlite3.h>
+#include "db_backend.h"
+#include "thread.h"
+
+#pragma region Configuration
+
+typedef enum { FORMAT_CSV, FORMAT_SQLITE } OutputFormat;
+
+static struct {
+    int students;
+    int courses;
+    int min_enroll;
+    int max_enroll;
+    double skew;            // Zipf exponent for course popularity; 0 = uniform
+    uint64_t seed;
+    int threads;
+    OutputFormat format;
+    const char *out;
+    bool force;
+} cfg = {
+    .students = 100000,
+    .courses = 1000,
+    .min_enroll = 1,
+    .max_enroll = 12,
+    .skew = 1.0,
+    .seed = 42,
+    .threads = 4,
+    .format = FORMAT_CSV,
+};
+
+// Student IDs continue the numbering used by utils/example_students.csv
+#define STUDENT_ID_BASE 10000
+// Students per unit of work handed to a thread
+#define BLOCK_STUDENTS 8192
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: curriculum-gen [options]\n"
+        "  --students N        students to generate (default 100000)\n"
+        "  --courses N         courses to generate (default 1000)\n"
+        "  --min-enroll N      fewest courses per student (default 1)\n"
+        "  --max-enroll N      most courses per student (default 12)\n"
+        "  --skew S            Zipf exponent of course popularity, 0 = uniform (default 1.0)\n"
+        "  --seed N            RNG seed (default 42)\n"
+        "  --threads N         generator threads (default 4)\n"
+        "  --format csv|sqlite output format (default csv)\n"
+        "  --out PATH          directory for CSV (default .), database file for sqlite (default " DB_FILE ")\n"
+        "  --force             overwrite an existing database\n");
+}
+
+static bool parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        bool takes_value = true;
+        if (strcmp(a, "--force") == 0) { cfg.force = true; takes_value = false; }
+        else if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0) return false;
+        else if (!v) { fprintf(stderr, "%s needs a value\n", a); return false; }
+        else if (strcmp(a, "--students") == 0) cfg.students = atoi(v);
+        else if (strcmp(a, "--courses") == 0) cfg.courses = atoi(v);
+        else if (strcmp(a, "--min-enroll") == 0) cfg.min_enroll = atoi(v);
+        else if (strcmp(a, "--max-enroll") == 0) cfg.max_enroll = atoi(v);
+        else if (strcmp(a, "--skew") == 0) cfg.skew = atof(v);
+        else if (strcmp(a, "--seed") == 0) cfg.seed = strtoull(v, NULL, 10);
+        else if (strcmp(a, "--threads") == 0) cfg.threads = atoi(v);
+        else if (strcmp(a, "--out") == 0) cfg.out = v;
+        else if (strcmp(a, "--format") == 0) {
+            if (strcmp(v, "csv") == 0) cfg.format = FORMAT_CSV;
+            else if (strcmp(v, "sqlite") == 0) cfg.format = FORMAT_SQLITE;
+            else { fprintf(stderr, "unknown format '%s'\n", v); return false; }
+        } else {
+            fprintf(stderr, "unknown option %s\n", a);
+            return false;
+        }
+        if (takes_value) i++;
+    }
+    if (cfg.students < 0 || cfg.courses < 1 || cfg.min_enroll < 0 || cfg.max_enroll < cfg.min_enroll
+        || cfg.skew < 0 || cfg.threads < 1) {
+        fprintf(stderr, "invalid option value\n");
+        return false;
+    }
+    if (cfg.max_enroll > cfg.courses) cfg.max_enroll = cfg.courses;
+    if (cfg.min_enroll > cfg.max_enroll) cfg.min_enroll = cfg.max_enroll;
+    if (!cfg.out) cfg.out = cfg.format == FORMAT_CSV ? "." : DB_FILE;
+    return true;
+}
+
+#pragma endregion Configuration
+
+#pragma region Random numbers
+
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Independent stream per (purpose, index) so results do not depend on scheduling
+static uint64_t stream_seed(uint64_t purpose, uint64_t index) {
+    uint64_t s = splitmix64(cfg.seed ^ splitmix64(purpose * 0x100000001B3ull ^ index));
+    return s ? s : 1;
+}
+
+static uint64_t next_rand(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static double rand_unit(uint64_t *state) { return (double)(next_rand(state) >> 11) * (1.0 / 9007199254740992.0); }
+static int rand_below(uint64_t *state, int n) { return (int)(next_rand(state) % (uint64_t)n); }
+
+// Pick an index from cumulative weights
+static int pick_weighted(uint64_t *state, const double *cumulative, int n) {
+    double u = rand_unit(state) * cumulative[n - 1];
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cumulative[mid] > u) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+#pragma endregion Random numbers
+
+#pragma region Vocabulary
+
+typedef struct {
+    const char *text;
+    double weight;
+} Weighted;
+
+// Shares as in utils/example_courses.csv
+static const Weighted course_types[] = { { "required", 282 }, { "general", 270 }, { "elective", 263 } };
+static const Weighted semesters[] = { { "summer", 285 }, { "spring", 276 }, { "fall", 254 } };
+static const Weighted credits[] = { { "2", 196 }, { "3", 204 }, { "4", 219 }, { "5", 196 } };
+
+static const char *disciplines[] = {
+    "哲学", "逻辑学", "伦理学", "经济学", "财政学", "金融学", "保险学", "投资学", "国际贸易", "法学",
+    "政治学", "社会学", "人类学", "教育学", "心理学", "体育学", "汉语言文学", "新闻学", "历史学", "考古学",
+    "数学", "统计学", "物理学", "化学", "天文学", "地理学", "大气科学", "海洋科学", "地质学", "生物学",
+    "力学", "机械工程", "材料科学", "能源工程", "电气工程", "电子信息", "自动化", "计算机科学", "软件工程", "网络安全",
+    "土木工程", "水利工程", "测绘工程", "化学工程", "环境工程", "生物医学工程", "建筑学", "临床医学", "药学", "管理学",
+};
+static const char *course_suffixes[] = { "导论", "基础", "概论", "实践", "前沿专题", "实验" };
+
+// Most common Chinese surnames, weighted roughly by frequency
+static const Weighted surnames[] = {
+    { "王", 7.1 }, { "李", 7.0 }, { "张", 6.7 }, { "刘", 5.4 }, { "陈", 4.5 }, { "杨", 3.1 }, { "黄", 2.2 },
+    { "赵", 2.0 }, { "吴", 1.9 }, { "周", 1.9 }, { "徐", 1.5 }, { "孙", 1.4 }, { "马", 1.2 }, { "朱", 1.2 },
+    { "胡", 1.1 }, { "郭", 1.1 }, { "何", 1.0 }, { "林", 1.0 }, { "高", 1.0 }, { "罗", 0.9 }, { "郑", 0.9 },
+    { "梁", 0.8 }, { "谢", 0.7 }, { "宋", 0.6 }, { "唐", 0.6 }, { "许", 0.5 }, { "韩", 0.5 }, { "冯", 0.5 },
+    { "邓", 0.5 }, { "曹", 0.5 }, { "彭", 0.5 }, { "曾", 0.5 }, { "肖", 0.4 }, { "田", 0.4 }, { "董", 0.4 },
+    { "潘", 0.4 }, { "袁", 0.4 }, { "蔡", 0.3 }, { "蒋", 0.3 }, { "余", 0.3 }, { "欧阳", 0.05 }, { "司马", 0.02 },
+};
+
+static const char *given_chars[] = {
+    "伟", "芳", "娜", "敏", "静", "丽", "强", "磊", "军", "洋", "勇", "艳", "杰", "娟", "涛", "明", "超", "秀",
+    "霞", "平", "刚", "桂", "英", "华", "玉", "萍", "红", "鹏", "建", "文", "辉", "宇", "浩", "然", "子", "轩",
+    "欣", "怡", "梓", "涵", "晨", "雨", "思", "博", "嘉", "琪", "佳", "俊", "晴", "悦", "彤", "瑶", "睿", "泽",
+    "一", "诺", "安", "可", "心", "航", "天", "佑", "若", "曦", "梦", "洁", "婷", "雪", "春", "晓", "鑫", "亮",
+};
+
+// School domains in the proportions of utils/example_students.csv
+static const Weighted schools[] = {
+    { "trinity", 24 }, { "millennium", 22 }, { "gehenna", 21 }, { "hyakkiyako", 15 }, { "redwinter", 8 },
+    { "abydos", 7 }, { "shanhaijing", 5 }, { "srt", 4 }, { "arius", 4 }, { "valkyrie", 3 },
+};
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+static double *cumulative_weights(const Weighted *items, size_t n) {
+    double *c = malloc(n * sizeof(*c));
+    if (!c) return NULL;
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) c[i] = sum += items[i].weight;
+    return c;
+}
+
+static struct {
+    double *types;
+    double *semesters;
+    double *credits;
+    double *surnames;
+    double *schools;
+} cdf;
+
+static bool build_vocabulary(void) {
+    cdf.types = cumulative_weights(course_types, COUNT_OF(course_types));
+    cdf.semesters = cumulative_weights(semesters, COUNT_OF(semesters));
+    cdf.credits = cumulative_weights(credits, COUNT_OF(credits));
+    cdf.surnames = cumulative_weights(surnames, COUNT_OF(surnames));
+    cdf.schools = cumulative_weights(schools, COUNT_OF(schools));
+    return cdf.types && cdf.semesters && cdf.credits && cdf.surnames && cdf.schools;
+}
+
+#pragma endregion Vocabulary
+
+#pragma region Courses
+
+typedef struct {
+    char course_id[24];
+    char name[96];
+    const char *type;
+    const char *semester;
+    int credit;
+    int total_hours;
+    int lecture_hours;
+    int lab_hours;
+} GenCourse;
+
+static GenCourse *courses;
+static double *popularity;      // cumulative Zipf weights by popularity rank
+static int *rank_course;        // popularity rank -> course index
+
+static bool generate_courses(void) {
+    courses = calloc((size_t)cfg.courses, sizeof(*courses));
+    popularity = malloc((size_t)cfg.courses * sizeof(*popularity));
+    rank_course = malloc((size_t)cfg.courses * sizeof(*rank_course));
+    if (!courses || !popularity || !rank_course) return false;
+
+    int width = 4;
+    for (int n = cfg.courses; n >= 10000; n /= 10) width++;
+
+    size_t names = COUNT_OF(disciplines) * COUNT_OF(course_suffixes);
+    for (int i = 0; i < cfg.courses; i++) {
+        GenCourse *c = &courses[i];
+        uint64_t rng = stream_seed(1, (uint64_t)i);
+        char num[12];
+        int digits = snprintf(num, sizeof(num), "%d", i + 1);
+        snprintf(c->course_id, sizeof(c->course_id), "C%.*s%s", digits < width ? width - digits : 0, "000000", num);
+
+        // Shuffle name order per index so consecutive IDs are not the same discipline
+        size_t n = (size_t)i % names, round = (size_t)i / names;
+        size_t d = (n * 7) % COUNT_OF(disciplines), s = n / COUNT_OF(disciplines);
+        if (round) snprintf(c->name, sizeof(c->name), "%s%s（%zu）", disciplines[d], course_suffixes[s], round + 1);
+        else snprintf(c->name, sizeof(c->name), "%s%s", disciplines[d], course_suffixes[s]);
+
+        c->type = course_types[pick_weighted(&rng, cdf.types, COUNT_OF(course_types))].text;
+        c->semester = semesters[pick_weighted(&rng, cdf.semesters, COUNT_OF(semesters))].text;
+        c->credit = atoi(credits[pick_weighted(&rng, cdf.credits, COUNT_OF(credits))].text);
+        c->total_hours = c->credit * 16;
+        // Lab share between 0 and 30%, skewed towards little lab time as in the examples
+        double u = rand_unit(&rng);
+        c->lab_hours = (int)(c->total_hours * 0.3 * u * u);
+        c->lecture_hours = c->total_hours - c->lab_hours;
+    }
+
+    // Popularity ranks are a seeded permutation so C0001 is not automatically the busiest course
+    uint64_t rng = stream_seed(2, 0);
+    for (int i = 0; i < cfg.courses; i++) rank_course[i] = i;
+    for (int i = cfg.courses - 1; i > 0; i--) {
+        int j = rand_below(&rng, i + 1);
+        int t = rank_course[i];
+        rank_course[i] = rank_course[j];
+        rank_course[j] = t;
+    }
+    double sum = 0;
+    for (int r = 0; r < cfg.courses; r++) popularity[r] = sum += 1.0 / pow((double)(r + 1), cfg.skew);
+    return true;
+}
+
+#pragma endregion Courses
+
+#pragma region Students
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+static bool buf_reserve(Buffer *b, size_t extra) {
+    if (b->len + extra <= b->cap) return true;
+    size_t cap = b->cap ? b->cap : 1 << 16;
+    while (cap < b->len + extra) cap *= 2;
+    char *data = realloc(b->data, cap);
+    if (!data) return false;
+    b->data = data;
+    b->cap = cap;
+    return true;
+}
+
+typedef struct {
+    char name[16];
+    char email[48];
+    int credits;
+    int first_enrollment;       // index into Block.enrollments
+    int enrollment_count;
+} GenStudent;
+
+typedef struct {
+    int index;
+    int first;                  // first student index in the block
+    int count;
+    GenStudent *students;
+    int *enrollments;           // course indices, ascending per student
+    int enrollment_count;
+    Buffer student_csv;
+    Buffer enrollment_csv;
+    bool failed;
+} Block;
+
+static void free_block(Block *b) {
+    free(b->students);
+    free(b->enrollments);
+    free(b->student_csv.data);
+    free(b->enrollment_csv.data);
+    free(b);
+}
+
+static int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static void generate_student(GenStudent *s, int index, int *picked) {
+    uint64_t rng = stream_seed(3, (uint64_t)index);
+
+    const char *surname = surnames[pick_weighted(&rng, cdf.surnames, COUNT_OF(surnames))].text;
+    const char *g1 = given_chars[rand_below(&rng, COUNT_OF(given_chars))];
+    // Two-character given names are the more common
+    const char *g2 = rand_unit(&rng) < 0.7 ? given_chars[rand_below(&rng, COUNT_OF(given_chars))] : "";
+    snprintf(s->name, sizeof(s->name), "%s%s%s", surname, g1, g2);
+    const char *school = schools[pick_weighted(&rng, cdf.schools, COUNT_OF(schools))].text;
+    snprintf(s->email, sizeof(s->email), "s%d@%s.edu", STUDENT_ID_BASE + index, school);
+
+    int n = cfg.min_enroll + rand_below(&rng, cfg.max_enroll - cfg.min_enroll + 1);
+    int count = 0;
+    // Redraw duplicates; n is tiny next to the course count, so this terminates quickly
+    while (count < n) {
+        int course = rank_course[pick_weighted(&rng, popularity, cfg.courses)];
+        bool dup = false;
+        for (int k = 0; k < count && !dup; k++) dup = picked[k] == course;
+        if (!dup) picked[count++] = course;
+    }
+    qsort(picked, (size_t)count, sizeof(int), compare_int);
+    s->enrollment_count = count;
+    s->credits = 0;
+    for (int k = 0; k < count; k++) s->credits += courses[picked[k]].credit;
+}
+
+static bool format_csv(Block *b) {
+    for (int i = 0; i < b->count; i++) {
+        const GenStudent *s = &b->students[i];
+        int id = STUDENT_ID_BASE + b->first + i;
+        if (!buf_reserve(&b->student_csv, 128)) return false;
+        b->student_csv.len += (size_t)sprintf(b->student_csv.data + b->student_csv.len, "%d,%s,%s,0\n", id, s->name, s->email);
+        for (int k = 0; k < s->enrollment_count; k++) {
+            if (!buf_reserve(&b->enrollment_csv, 48)) return false;
+            const GenCourse *c = &courses[b->enrollments[s->first_enrollment + k]];
+            b->enrollment_csv.len += (size_t)sprintf(b->enrollment_csv.data + b->enrollment_csv.len, "%d,%s\n", id, c->course_id);
+        }
+    }
+    return true;
+}
+
+static Block *generate_block(int index) {
+    Block *b = calloc(1, sizeof(*b));
+    if (!b) return NULL;
+    b->index = index;
+    b->first = index * BLOCK_STUDENTS;
+    b->count = cfg.students - b->first < BLOCK_STUDENTS ? cfg.students - b->first : BLOCK_STUDENTS;
+    b->students = calloc((size_t)b->count, sizeof(*b->students));
+    b->enrollments = malloc((size_t)b->count * (size_t)(cfg.max_enroll ? cfg.max_enroll : 1) * sizeof(int));
+    if (!b->students || !b->enrollments) {
+        b->failed = true;
+        return b;
+    }
+    for (int i = 0; i < b->count; i++) {
+        GenStudent *s = &b->students[i];
+        s->first_enrollment = b->enrollment_count;
+        generate_student(s, b->first + i, b->enrollments + b->enrollment_count);
+        b->enrollment_count += s->enrollment_count;
+    }
+    if (cfg.format == FORMAT_CSV && !format_csv(b)) b->failed = true;
+    return b;
+}
+
+#pragma endregion Students
+
+#pragma region Pipeline
+
+// Workers generate blocks in any order; the writer consumes them in index order
+static struct {
+    mutex_t lock;
+    cond_t filled;
+    cond_t space;
+    Block **slots;
+    int slot_count;
+    int next_block;             // next block for a worker to claim
+    int written;                // blocks consumed by the writer
+    int block_count;
+    bool abort;
+} pipe_state;
+
+static void generator_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        mutex_lock(&pipe_state.lock);
+        int index = pipe_state.abort ? pipe_state.block_count : pipe_state.next_block++;
+        mutex_unlock(&pipe_state.lock);
+        if (index >= pipe_state.block_count) return;
+
+        Block *b = generate_block(index);
+
+        mutex_lock(&pipe_state.lock);
+        if (!b) {
+            // Out of memory: the writer sees the abort instead of waiting for this block
+            pipe_state.abort = true;
+            cond_broadcast(&pipe_state.filled);
+            cond_broadcast(&pipe_state.space);
+        }
+        while (index >= pipe_state.written + pipe_state.slot_count && !pipe_state.abort) {
+            cond_wait(&pipe_state.space, &pipe_state.lock);
+        }
+        if (pipe_state.abort) {
+            mutex_unlock(&pipe_state.lock);
+            if (b) free_block(b);
+            return;
+        }
+        pipe_state.slots[index % pipe_state.slot_count] = b;
+        cond_broadcast(&pipe_state.filled);
+        mutex_unlock(&pipe_state.lock);
+    }
+}
+
+// NULL if a generator failed
+static Block *next_block(int index) {
+    mutex_lock(&pipe_state.lock);
+    Block **slot = &pipe_state.slots[index % pipe_state.slot_count];
+    while ((!*slot || (*slot)->index != index) && !pipe_state.abort) cond_wait(&pipe_state.filled, &pipe_state.lock);
+    if (pipe_state.abort) {
+        mutex_unlock(&pipe_state.lock);
+        return NULL;
+    }
+    Block *b = *slot;
+    *slot = NULL;
+    pipe_state.written = index + 1;
+    cond_broadcast(&pipe_state.space);
+    mutex_unlock(&pipe_state.lock);
+    return b;
+}
+
+static void abort_pipeline(void) {
+    mutex_lock(&pipe_state.lock);
+    pipe_state.abort = true;
+    cond_broadcast(&pipe_state.space);
+    mutex_unlock(&pipe_state.lock);
+}
+
+#pragma endregion Pipeline
+
+#pragma region CSV output
+
+static FILE *open_csv(const char *name, const char *header) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", cfg.out, name);
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return NULL;
+    }
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+    fputs(header, f);
+    return f;
+}
+
+static bool write_csv(uint64_t *enrollments) {
+    FILE *cf = open_csv("courses.csv", "course_id,name,type,credit,total_hours,lecture_hours,lab_hours,semester\n");
+    FILE *sf = open_csv("students.csv", "student_id,name,email,credits\n");
+    FILE *ef = open_csv("enrollments.csv", "student_id,course_id\n");
+    bool ok = cf && sf && ef;
+
+    for (int i = 0; ok && i < cfg.courses; i++) {
+        const GenCourse *c = &courses[i];
+        fprintf(cf, "%s,%s,%s,%d,%d,%d,%d,%s\n", c->course_id, c->name, c->type, c->credit,
+                c->total_hours, c->lecture_hours, c->lab_hours, c->semester);
+    }
+
+    for (int i = 0; ok && i < pipe_state.block_count; i++) {
+        Block *b = next_block(i);
+        if (!b || b->failed) {
+            fprintf(stderr, "out of memory generating block %d\n", i);
+            ok = false;
+        } else {
+            ok = fwrite(b->student_csv.data, 1, b->student_csv.len, sf) == b->student_csv.len
+              && fwrite(b->enrollment_csv.data, 1, b->enrollment_csv.len, ef) == b->enrollment_csv.len;
+            *enrollments += (uint64_t)b->enrollment_count;
+        }
+        if (b) free_block(b);
+    }
+
+    if (cf && fclose(cf) != 0) ok = false;
+    if (sf && fclose(sf) != 0) ok = false;
+    if (ef && fclose(ef) != 0) ok = false;
+    return ok;
+}
+
+#pragma endregion CSV output
+
+#pragma region SQLite output
+
+static bool exec_sql(sqlite3 *db, const char *sql) {
+    char *err = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &err) == SQLITE_OK) return true;
+    fprintf(stderr, "sqlite: %s\n", err ? err : sqlite3_errmsg(db));
+    sqlite3_free(err);
+    return false;
+}
+
+static bool step_reset(sqlite3 *db, sqlite3_stmt *stmt) {
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    if (rc == SQLITE_DONE) return true;
+    fprintf(stderr, "sqlite: %s\n", sqlite3_errmsg(db));
+    return false;
+}
+
+static bool insert_courses(sqlite3 *db) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db,
+            "INSERT INTO course (id, course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);", -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "sqlite: %s\n", sqlite3_errmsg(db));
+        return false;
+    }
+    bool ok = true;
+    for (int i = 0; ok && i < cfg.courses; i++) {
+        const GenCourse *c = &courses[i];
+        sqlite3_bind_int(stmt, 1, i + 1);
+        sqlite3_bind_text(stmt, 2, c->course_id, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, c->name, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, c->type, -1, SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 5, c->total_hours);
+        sqlite3_bind_double(stmt, 6, c->lecture_hours);
+        sqlite3_bind_double(stmt, 7, c->lab_hours);
+        sqlite3_bind_double(stmt, 8, c->credit);
+        sqlite3_bind_text(stmt, 9, c->semester, -1, SQLITE_STATIC);
+        ok = step_reset(db, stmt);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+// Surrogate keys are assigned directly: student i is id i + 1, course i is id i + 1
+static bool insert_block(sqlite3 *db, sqlite3_stmt *student, sqlite3_stmt *enrollment, const Block *b) {
+    char id[16];
+    for (int i = 0; i < b->count; i++) {
+        const GenStudent *s = &b->students[i];
+        int row = b->first + i + 1;
+        snprintf(id, sizeof(id), "%d", STUDENT_ID_BASE + b->first + i);
+        sqlite3_bind_int(student, 1, row);
+        sqlite3_bind_text(student, 2, id, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(student, 3, s->name, -1, SQLITE_STATIC);
+        sqlite3_bind_text(student, 4, s->email, -1, SQLITE_STATIC);
+        sqlite3_bind_double(student, 5, s->credits);
+        if (!step_reset(db, student)) return false;
+        for (int k = 0; k < s->enrollment_count; k++) {
+            sqlite3_bind_int(enrollment, 1, row);
+            sqlite3_bind_int(enrollment, 2, b->enrollments[s->first_enrollment + k] + 1);
+            if (!step_reset(db, enrollment)) return false;
+        }
+    }
+    return true;
+}
+
+static bool write_sqlite(uint64_t *enrollments) {
+    struct stat st;
+    if (stat(cfg.out, &st) == 0) {
+        if (!cfg.force) {
+            fprintf(stderr, "%s exists; use --force to replace it\n", cfg.out);
+            return false;
+        }
+        const char *suffixes[] = { "", "-wal", "-shm" };
+        char path[1024];
+        for (size_t i = 0; i < COUNT_OF(suffixes); i++) {
+            snprintf(path, sizeof(path), "%s%s", cfg.out, suffixes[i]);
+            remove(path);
+        }
+    }
+
+    // Let the server's own code create the schema so the file is exactly what it expects
+    DbStore *store = db_sqlite_open(cfg.out);
+    if (!store) return false;
+    store->ops->close(store);
+
+    sqlite3 *db;
+    if (sqlite3_open(cfg.out, &db) != SQLITE_OK) {
+        fprintf(stderr, "sqlite: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return false;
+    }
+    // A fresh file that is discarded on failure, so durability can wait until the end;
+    // the secondary index is built once at the end instead of row by row
+    bool ok = exec_sql(db, "PRAGMA synchronous=OFF; PRAGMA cache_size=-262144;")
+           && exec_sql(db, db_sqlite_drop_indexes_sql)
+           && exec_sql(db, "BEGIN;")
+           && insert_courses(db);
+
+    sqlite3_stmt *student = NULL, *enrollment = NULL;
+    if (ok && (sqlite3_prepare_v2(db, "INSERT INTO student (id, student_id, name, email, credits) VALUES (?, ?, ?, ?, ?);",
+                                  -1, &student, NULL) != SQLITE_OK
+            || sqlite3_prepare_v2(db, "INSERT INTO enrollment (student, course) VALUES (?, ?);",
+                                  -1, &enrollment, NULL) != SQLITE_OK)) {
+        fprintf(stderr, "sqlite: %s\n", sqlite3_errmsg(db));
+        ok = false;
+    }
+
+    for (int i = 0; ok && i < pipe_state.block_count; i++) {
+        Block *b = next_block(i);
+        if (!b || b->failed) {
+            fprintf(stderr, "out of memory generating block %d\n", i);
+            ok = false;
+        } else {
+            ok = insert_block(db, student, enrollment, b);
+            *enrollments += (uint64_t)b->enrollment_count;
+            // Bounded transactions keep the WAL from growing with the whole dataset
+            if (ok && i % 16 == 15) ok = exec_sql(db, "COMMIT; BEGIN;");
+        }
+        if (b) free_block(b);
+    }
+    sqlite3_finalize(student);
+    sqlite3_finalize(enrollment);
+
+    if (ok) {
+        fprintf(stderr, "building indexes...\n");
+        ok = exec_sql(db, "COMMIT;")
+          && exec_sql(db, db_sqlite_create_indexes_sql)
+          && exec_sql(db, "PRAGMA wal_checkpoint(TRUNCATE); ANALYZE;");
+    }
+    if (!ok) exec_sql(db, "ROLLBACK;");
+    sqlite3_close(db);
+    return ok;
+}
+
+#pragma endregion SQLite output
+
+int main(int argc, char **argv) {
+    if (!parse_args(argc, argv)) {
+        usage();
+        return 2;
+    }
+    if (!build_vocabulary() || !generate_courses()) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    pipe_state.block_count = (cfg.students + BLOCK_STUDENTS - 1) / BLOCK_STUDENTS;
+    pipe_state.slot_count = cfg.threads * 2;
+    pipe_state.slots = calloc((size_t)pipe_state.slot_count, sizeof(*pipe_state.slots));
+    if (!pipe_state.slots) return 1;
+    mutex_init(&pipe_state.lock);
+    cond_init(&pipe_state.filled);
+    cond_init(&pipe_state.space);
+
+    fprintf(stderr, "generating %d courses and %d students (%d-%d enrollments each) with %d threads\n",
+            cfg.courses, cfg.students, cfg.min_enroll, cfg.max_enroll, cfg.threads);
+    uint64_t start = now_us();
+    thread_t *threads = calloc((size_t)cfg.threads, sizeof(*threads));
+    if (!threads) return 1;
+    int started = 0;
+    for (; started < cfg.threads; started++) {
+        if (!thread_start(&threads[started], generator_main, NULL)) break;
+    }
+    if (started == 0) {
+        fprintf(stderr, "failed to start generator threads\n");
+        return 1;
+    }
+
+    uint64_t enrollments = 0;
+    bool ok = cfg.format == FORMAT_CSV ? write_csv(&enrollments) : write_sqlite(&enrollments);
+    if (!ok) abort_pipeline();
+    for (int t = 0; t < started; t++) thread_join(threads[t]);
+
+    // Blocks finished after an abort are still parked in the ring
+    for (int i = 0; i < pipe_state.slot_count; i++) {
+        if (pipe_state.slots[i]) free_block(pipe_state.slots[i]);
+    }
+
+    double seconds = (double)(now_us() - start) / 1e6;
+    if (ok) {
+        fprintf(stderr, "wrote %d courses, %d students, %llu enrollments to %s in %.2fs (%.0f rows/s)\n",
+                cfg.courses, cfg.students, (unsigned long long)enrollments, cfg.out, seconds,
+                seconds > 0 ? (double)(cfg.courses + cfg.students + enrollments) / seconds : 0.0);
+    }
+
+    free(threads);
+    free(pipe_state.slots);
+    cond_destroy(&pipe_state.filled);
+    cond_destroy(&pipe_state.space);
+    mutex_destroy(&pipe_state.lock);
+    free(courses);
+    free(popularity);
+    free(rank_course);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,656 @@
+/*
+ * curriculum-import: offline bulk loader from CSV straight into the SQLite
+ * database, for use while the server is stopped.
+ *
+ *   curriculum-import --courses courses.csv --students students.csv \
+ *                     --enrollments enrollments.csv --db curriculum.db
+ *
+ * Files use the utils/example_*.csv layout (columns are matched by header
+ * name, so order does not matter). The schema is created or migrated by
+ * db_sqlite.c exactly as the server would, then:
+ *
+ *   - files are memory-mapped and parsed in place (RFC 4180 quoting, CRLF,
+ *     UTF-8 BOM); copy-on-write mappings let quoted fields unescape in place
+ *   - rows go through prepared statements, committing every --batch rows
+ *   - courses and students are upserted by their text ID; enrollments are
+ *     resolved to surrogate keys through in-memory hash maps and inserted
+ *     with enrollment_by_course dropped, which is rebuilt once at the end
+ *   - the students' credits column from the CSV is ignored; every student's
+ *     credits are recomputed from their enrollments by one aggregate UPDATE
+ *
+ * Invalid rows and enrollments naming unknown students or courses are
+ * reported (first few by line) and skipped.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sqlite3.h>
+#include "db_backend.h"
+#include "thread.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#pragma region Configuration
+
+static struct {
+    const char *courses;
+    const char *students;
+    const char *enrollments;
+    const char *db;
+    long batch;                 // rows per transaction
+    int max_errors;             // row errors printed per file
+} cfg = {
+    .db = DB_FILE,
+    .batch = 100000,
+    .max_errors = 10,
+};
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: curriculum-import [options]\n"
+        "  --courses FILE      course CSV (course_id,name,type,credit,total_hours,lecture_hours,lab_hours,semester)\n"
+        "  --students FILE     student CSV (student_id,name,email[,credits])\n"
+        "  --enrollments FILE  enrollment CSV (student_id,course_id)\n"
+        "  --db FILE           database to load into (default " DB_FILE ")\n"
+        "  --batch N           rows per transaction (default 100000)\n"
+        "  --max-errors N      row errors to print per file (default 10)\n"
+        "Run it while the server is stopped.\n");
+}
+
+static bool parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0) return false;
+        if (!v) { fprintf(stderr, "%s needs a value\n", a); return false; }
+        if (strcmp(a, "--courses") == 0) cfg.courses = v;
+        else if (strcmp(a, "--students") == 0) cfg.students = v;
+        else if (strcmp(a, "--enrollments") == 0) cfg.enrollments = v;
+        else if (strcmp(a, "--db") == 0) cfg.db = v;
+        else if (strcmp(a, "--batch") == 0) cfg.batch = atol(v);
+        else if (strcmp(a, "--max-errors") == 0) cfg.max_errors = atoi(v);
+        else {
+            fprintf(stderr, "unknown option %s\n", a);
+            return false;
+        }
+        i++;
+    }
+    if (!cfg.courses && !cfg.students && !cfg.enrollments) {
+        fprintf(stderr, "nothing to import\n");
+        return false;
+    }
+    if (cfg.batch < 1 || cfg.max_errors < 0) {
+        fprintf(stderr, "invalid option value\n");
+        return false;
+    }
+    return true;
+}
+
+#pragma endregion Configuration
+
+#pragma region Memory-mapped files
+
+typedef struct {
+    char *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} MappedFile;
+
+// Private copy-on-write mapping: the parser may write to it, the file never changes
+static bool map_file(const char *path, MappedFile *m) {
+    memset(m, 0, sizeof(*m));
+#ifdef _WIN32
+    m->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m->file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m->file, &size)) { CloseHandle(m->file); return false; }
+    m->size = (size_t)size.QuadPart;
+    if (m->size == 0) return true;
+    m->mapping = CreateFileMappingA(m->file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (!m->mapping) { CloseHandle(m->file); return false; }
+    m->data = MapViewOfFile(m->mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (!m->data) { CloseHandle(m->mapping); CloseHandle(m->file); return false; }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) { close(fd); return false; }
+    m->size = (size_t)st.st_size;
+    if (m->size > 0) {
+        void *p = mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) { close(fd); return false; }
+        madvise(p, m->size, MADV_SEQUENTIAL);
+        m->data = p;
+    }
+    close(fd);
+#endif
+    return true;
+}
+
+static void unmap_file(MappedFile *m) {
+#ifdef _WIN32
+    if (m->data) UnmapViewOfFile(m->data);
+    if (m->mapping) CloseHandle(m->mapping);
+    if (m->file && m->file != INVALID_HANDLE_VALUE) CloseHandle(m->file);
+#else
+    if (m->data) munmap(m->data, m->size);
+#endif
+    memset(m, 0, sizeof(*m));
+}
+
+#pragma endregion Memory-mapped files
+
+#pragma region CSV parsing
+
+typedef struct {
+    const char *ptr;
+    size_t len;
+} Field;
+
+typedef struct {
+    char *p;
+    char *end;
+    size_t line;                // line number of the record just read
+    size_t next_line;
+} CsvReader;
+
+#define MAX_FIELDS 16
+
+static void csv_init(CsvReader *r, MappedFile *m) {
+    r->p = m->data;
+    r->end = m->data + m->size;
+    if (m->size >= 3 && memcmp(r->p, "\xEF\xBB\xBF", 3) == 0) r->p += 3;
+    r->line = 0;
+    r->next_line = 1;
+}
+
+// Parses one record; returns the field count, 0 at end of input, -1 on a malformed quote
+static int csv_next(CsvReader *r, Field *fields) {
+    // Skip blank lines
+    while (r->p < r->end && (*r->p == '\n' || *r->p == '\r')) {
+        if (*r->p == '\n') r->next_line++;
+        r->p++;
+    }
+    if (r->p >= r->end) return 0;
+    r->line = r->next_line;
+
+    int n = 0;
+    for (;;) {
+        Field f;
+        if (r->p < r->end && *r->p == '"') {
+            // Quoted: unescape "" in place
+            char *src = ++r->p, *dst = src;
+            f.ptr = src;
+            for (;;) {
+                if (src >= r->end) return -1;
+                if (*src == '"') {
+                    if (src + 1 < r->end && src[1] == '"') {
+                        *dst++ = '"';
+                        src += 2;
+                        continue;
+                    }
+                    src++;
+                    break;
+                }
+                if (*src == '\n') r->next_line++;
+                *dst++ = *src++;
+            }
+            f.len = (size_t)(dst - f.ptr);
+            r->p = src;
+            if (r->p < r->end && *r->p != ',' && *r->p != '\n' && *r->p != '\r') return -1;
+        } else {
+            char *start = r->p;
+            while (r->p < r->end && *r->p != ',' && *r->p != '\n' && *r->p != '\r') r->p++;
+            f.ptr = start;
+            f.len = (size_t)(r->p - start);
+        }
+        if (n < MAX_FIELDS) fields[n] = f;
+        n++;
+
+        if (r->p < r->end && *r->p == ',') {
+            r->p++;
+            continue;
+        }
+        // End of record
+        if (r->p < r->end && *r->p == '\r') r->p++;
+        if (r->p < r->end && *r->p == '\n') {
+            r->p++;
+            r->next_line++;
+        }
+        return n < MAX_FIELDS ? n : MAX_FIELDS;
+    }
+}
+
+static bool field_is(const Field *f, const char *name) {
+    size_t n = strlen(name);
+    return f->len == n && memcmp(f->ptr, name, n) == 0;
+}
+
+// Column positions from the header row; -1 when absent
+static bool map_columns(CsvReader *r, const char *const *names, int count, int *columns, const char *path) {
+    Field header[MAX_FIELDS];
+    int n = csv_next(r, header);
+    if (n <= 0) {
+        fprintf(stderr, "%s: missing header row\n", path);
+        return false;
+    }
+    for (int c = 0; c < count; c++) {
+        columns[c] = -1;
+        for (int i = 0; i < n; i++) {
+            if (field_is(&header[i], names[c])) columns[c] = i;
+        }
+    }
+    return true;
+}
+
+static const Field *column(const Field *fields, int n, int index) {
+    return index >= 0 && index < n && fields[index].len > 0 ? &fields[index] : NULL;
+}
+
+static bool parse_number(const Field *f, double *out) {
+    char buf[64];
+    if (!f || f->len >= sizeof(buf)) return false;
+    memcpy(buf, f->ptr, f->len);
+    buf[f->len] = '\0';
+    char *end;
+    *out = strtod(buf, &end);
+    return end != buf && *end == '\0';
+}
+
+#pragma endregion CSV parsing
+
+#pragma region ID maps
+
+// text ID -> surrogate key, open addressing over an append-only key arena
+typedef struct {
+    struct { uint64_t hash; size_t offset; uint32_t len; int64_t id; } *slots;
+    size_t cap;
+    size_t count;
+    char *arena;
+    size_t arena_len;
+    size_t arena_cap;
+} IdMap;
+
+static uint64_t hash_bytes(const char *p, size_t n) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 1099511628211ull;
+    }
+    return h ? h : 1;
+}
+
+static bool idmap_grow(IdMap *m) {
+    size_t cap = m->cap ? m->cap * 2 : 1024;
+    void *slots = calloc(cap, sizeof(*m->slots));
+    if (!slots) return false;
+    IdMap grown = *m;
+    grown.slots = slots;
+    grown.cap = cap;
+    for (size_t i = 0; i < m->cap; i++) {
+        if (!m->slots[i].hash) continue;
+        size_t j = m->slots[i].hash & (cap - 1);
+        while (grown.slots[j].hash) j = (j + 1) & (cap - 1);
+        grown.slots[j] = m->slots[i];
+    }
+    free(m->slots);
+    *m = grown;
+    return true;
+}
+
+static bool idmap_put(IdMap *m, const char *key, size_t len, int64_t id) {
+    if ((m->count + 1) * 4 > m->cap * 3 && !idmap_grow(m)) return false;
+    if (m->arena_len + len > m->arena_cap) {
+        size_t cap = m->arena_cap ? m->arena_cap : 1 << 20;
+        while (cap < m->arena_len + len) cap *= 2;
+        char *arena = realloc(m->arena, cap);
+        if (!arena) return false;
+        m->arena = arena;
+        m->arena_cap = cap;
+    }
+    uint64_t h = hash_bytes(key, len);
+    size_t j = h & (m->cap - 1);
+    while (m->slots[j].hash) j = (j + 1) & (m->cap - 1);
+    memcpy(m->arena + m->arena_len, key, len);
+    m->slots[j].hash = h;
+    m->slots[j].offset = m->arena_len;
+    m->slots[j].len = (uint32_t)len;
+    m->slots[j].id = id;
+    m->arena_len += len;
+    m->count++;
+    return true;
+}
+
+static int64_t idmap_get(const IdMap *m, const char *key, size_t len) {
+    if (!m->cap) return 0;
+    uint64_t h = hash_bytes(key, len);
+    for (size_t j = h & (m->cap - 1); m->slots[j].hash; j = (j + 1) & (m->cap - 1)) {
+        if (m->slots[j].hash == h && m->slots[j].len == len && memcmp(m->arena + m->slots[j].offset, key, len) == 0) {
+            return m->slots[j].id;
+        }
+    }
+    return 0;
+}
+
+static void idmap_free(IdMap *m) {
+    free(m->slots);
+    free(m->arena);
+    memset(m, 0, sizeof(*m));
+}
+
+#pragma endregion ID maps
+
+#pragma region Loading
+
+typedef struct {
+    const char *path;
+    uint64_t rows;
+    uint64_t loaded;
+    uint64_t rejected;
+    uint64_t duplicates;
+} LoadStats;
+
+static sqlite3 *db;
+static uint64_t batch_rows;
+
+static bool exec_sql(const char *sql) {
+    char *err = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &err) == SQLITE_OK) return true;
+    fprintf(stderr, "sqlite: %s\n", err ? err : sqlite3_errmsg(db));
+    sqlite3_free(err);
+    return false;
+}
+
+static bool batch_step(void) {
+    if (++batch_rows % (uint64_t)cfg.batch) return true;
+    return exec_sql("COMMIT; BEGIN;");
+}
+
+static void reject(LoadStats *s, size_t line, const char *why) {
+    if (s->rejected++ < (uint64_t)cfg.max_errors) fprintf(stderr, "%s:%zu: %s\n", s->path, line, why);
+}
+
+static void bind_field(sqlite3_stmt *stmt, int index, const Field *f) {
+    if (f) sqlite3_bind_text(stmt, index, f->ptr, (int)f->len, SQLITE_STATIC);
+    else sqlite3_bind_null(stmt, index);
+}
+
+static bool prepare(const char *sql, sqlite3_stmt **stmt) {
+    if (sqlite3_prepare_v2(db, sql, -1, stmt, NULL) == SQLITE_OK) return true;
+    fprintf(stderr, "sqlite: %s\n", sqlite3_errmsg(db));
+    return false;
+}
+
+static bool open_csv(const char *path, MappedFile *m, CsvReader *r) {
+    if (!map_file(path, m)) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    csv_init(r, m);
+    return true;
+}
+
+// Steps an insert; a constraint failure rejects the row, anything else is fatal
+static bool step_row(sqlite3_stmt *stmt, LoadStats *s, size_t line, bool *fatal) {
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    if (rc == SQLITE_DONE) return true;
+    if ((rc & 0xff) == SQLITE_CONSTRAINT) {
+        reject(s, line, sqlite3_errmsg(db));
+        return false;
+    }
+    fprintf(stderr, "%s:%zu: sqlite: %s\n", s->path, line, sqlite3_errmsg(db));
+    *fatal = true;
+    return false;
+}
+
+static bool load_courses(LoadStats *s) {
+    static const char *const names[] = { "course_id", "name", "type", "credit", "total_hours", "lecture_hours", "lab_hours", "semester" };
+    enum { COURSE_ID, NAME, TYPE, CREDIT, TOTAL, LECTURE, LAB, SEMESTER, COLUMN_COUNT };
+    MappedFile m;
+    CsvReader r;
+    int col[COLUMN_COUNT];
+    if (!open_csv(s->path, &m, &r)) return false;
+    if (!map_columns(&r, names, COLUMN_COUNT, col, s->path) || col[COURSE_ID] < 0 || col[CREDIT] < 0) {
+        if (col[COURSE_ID] < 0 || col[CREDIT] < 0) fprintf(stderr, "%s: needs course_id and credit columns\n", s->path);
+        unmap_file(&m);
+        return false;
+    }
+
+    sqlite3_stmt *stmt;
+    if (!prepare("INSERT INTO course (course_id, name, type, total_hours, lecture_hours, lab_hours, credit, semester) "
+                 "VALUES (?, ?, ?, ?, ?, ?, ?, ?) ON CONFLICT(course_id) DO UPDATE SET "
+                 "name = excluded.name, type = excluded.type, total_hours = excluded.total_hours, "
+                 "lecture_hours = excluded.lecture_hours, lab_hours = excluded.lab_hours, "
+                 "credit = excluded.credit, semester = excluded.semester;", &stmt)) {
+        unmap_file(&m);
+        return false;
+    }
+
+    bool fatal = false;
+    Field f[MAX_FIELDS];
+    int n;
+    while (!fatal && (n = csv_next(&r, f)) != 0) {
+        s->rows++;
+        if (n < 0) { reject(s, r.line, "unterminated quoted field"); break; }
+        const Field *id = column(f, n, col[COURSE_ID]);
+        double credit, hours;
+        if (!id || !parse_number(column(f, n, col[CREDIT]), &credit)) {
+            reject(s, r.line, "course_id and a numeric credit are required");
+            continue;
+        }
+        sqlite3_bind_text(stmt, 1, id->ptr, (int)id->len, SQLITE_STATIC);
+        bind_field(stmt, 2, column(f, n, col[NAME]));
+        bind_field(stmt, 3, column(f, n, col[TYPE]));
+        const int hour_cols[] = { TOTAL, LECTURE, LAB };
+        for (int k = 0; k < 3; k++) {
+            // Missing hours load as 0, as the HTTP API does
+            if (!parse_number(column(f, n, col[hour_cols[k]]), &hours)) hours = 0;
+            sqlite3_bind_double(stmt, 4 + k, hours);
+        }
+        sqlite3_bind_double(stmt, 7, credit);
+        bind_field(stmt, 8, column(f, n, col[SEMESTER]));
+        if (step_row(stmt, s, r.line, &fatal)) s->loaded++;
+        if (!fatal && !batch_step()) fatal = true;
+    }
+    sqlite3_finalize(stmt);
+    unmap_file(&m);
+    return !fatal;
+}
+
+static bool load_students(LoadStats *s) {
+    static const char *const names[] = { "student_id", "name", "email" };
+    enum { STUDENT_ID, NAME, EMAIL, COLUMN_COUNT };
+    MappedFile m;
+    CsvReader r;
+    int col[COLUMN_COUNT];
+    if (!open_csv(s->path, &m, &r)) return false;
+    if (!map_columns(&r, names, COLUMN_COUNT, col, s->path) || col[STUDENT_ID] < 0 || col[NAME] < 0) {
+        if (col[STUDENT_ID] < 0 || col[NAME] < 0) fprintf(stderr, "%s: needs student_id and name columns\n", s->path);
+        unmap_file(&m);
+        return false;
+    }
+
+    // credits are recomputed from enrollments at the end
+    sqlite3_stmt *stmt;
+    if (!prepare("INSERT INTO student (student_id, name, email) VALUES (?, ?, ?) "
+                 "ON CONFLICT(student_id) DO UPDATE SET name = excluded.name, email = excluded.email;", &stmt)) {
+        unmap_file(&m);
+        return false;
+    }
+
+    bool fatal = false;
+    Field f[MAX_FIELDS];
+    int n;
+    while (!fatal && (n = csv_next(&r, f)) != 0) {
+        s->rows++;
+        if (n < 0) { reject(s, r.line, "unterminated quoted field"); break; }
+        const Field *id = column(f, n, col[STUDENT_ID]);
+        const Field *name = column(f, n, col[NAME]);
+        if (!id || !name) {
+            reject(s, r.line, "student_id and name are required");
+            continue;
+        }
+        sqlite3_bind_text(stmt, 1, id->ptr, (int)id->len, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, name->ptr, (int)name->len, SQLITE_STATIC);
+        bind_field(stmt, 3, column(f, n, col[EMAIL]));
+        if (step_row(stmt, s, r.line, &fatal)) s->loaded++;
+        if (!fatal && !batch_step()) fatal = true;
+    }
+    sqlite3_finalize(stmt);
+    unmap_file(&m);
+    return !fatal;
+}
+
+static bool load_id_map(const char *sql, IdMap *map) {
+    sqlite3_stmt *stmt;
+    if (!prepare(sql, &stmt)) return false;
+    bool ok = true;
+    while (ok && sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *key = (const char *)sqlite3_column_text(stmt, 1);
+        ok = idmap_put(map, key, (size_t)sqlite3_column_bytes(stmt, 1), sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    if (!ok) fprintf(stderr, "out of memory\n");
+    return ok;
+}
+
+static bool load_enrollments(LoadStats *s) {
+    static const char *const names[] = { "student_id", "course_id" };
+    enum { STUDENT_ID, COURSE_ID, COLUMN_COUNT };
+    MappedFile m;
+    CsvReader r;
+    int col[COLUMN_COUNT];
+    if (!open_csv(s->path, &m, &r)) return false;
+    if (!map_columns(&r, names, COLUMN_COUNT, col, s->path) || col[STUDENT_ID] < 0 || col[COURSE_ID] < 0) {
+        if (col[STUDENT_ID] < 0 || col[COURSE_ID] < 0) fprintf(stderr, "%s: needs student_id and course_id columns\n", s->path);
+        unmap_file(&m);
+        return false;
+    }
+
+    IdMap students = { 0 }, courses = { 0 };
+    sqlite3_stmt *stmt = NULL;
+    bool fatal = !load_id_map("SELECT id, student_id FROM student;", &students)
+              || !load_id_map("SELECT id, course_id FROM course;", &courses)
+              || !prepare("INSERT OR IGNORE INTO enrollment (student, course) VALUES (?, ?);", &stmt);
+
+    Field f[MAX_FIELDS];
+    int n;
+    while (!fatal && (n = csv_next(&r, f)) != 0) {
+        s->rows++;
+        if (n < 0) { reject(s, r.line, "unterminated quoted field"); break; }
+        const Field *sid = column(f, n, col[STUDENT_ID]);
+        const Field *cid = column(f, n, col[COURSE_ID]);
+        int64_t student = sid ? idmap_get(&students, sid->ptr, sid->len) : 0;
+        int64_t course = cid ? idmap_get(&courses, cid->ptr, cid->len) : 0;
+        if (!student || !course) {
+            reject(s, r.line, !student ? "unknown student_id" : "unknown course_id");
+            continue;
+        }
+        sqlite3_bind_int64(stmt, 1, student);
+        sqlite3_bind_int64(stmt, 2, course);
+        if (step_row(stmt, s, r.line, &fatal)) {
+            if (sqlite3_changes(db)) s->loaded++;
+            else s->duplicates++;
+        }
+        if (!fatal && !batch_step()) fatal = true;
+    }
+    sqlite3_finalize(stmt);
+    idmap_free(&students);
+    idmap_free(&courses);
+    unmap_file(&m);
+    return !fatal;
+}
+
+#pragma endregion Loading
+
+static void report(const LoadStats *s, const char *what, double seconds) {
+    if (!s->path) return;
+    fprintf(stderr, "%-12s %10llu rows  %10llu loaded  %8llu rejected", what, (unsigned long long)s->rows,
+            (unsigned long long)s->loaded, (unsigned long long)s->rejected);
+    if (s->duplicates) fprintf(stderr, "  %llu already present", (unsigned long long)s->duplicates);
+    fprintf(stderr, "  %.2fs\n", seconds);
+}
+
+int main(int argc, char **argv) {
+    if (!parse_args(argc, argv)) {
+        usage();
+        return 2;
+    }
+
+    // Create or migrate the schema with the server's own code
+    DbStore *store = db_sqlite_open(cfg.db);
+    if (!store) return 1;
+    store->ops->close(store);
+
+    if (sqlite3_open(cfg.db, &db) != SQLITE_OK) {
+        fprintf(stderr, "sqlite: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return 1;
+    }
+
+    // Nothing else has the database open, so trade crash safety during the load for speed;
+    // the final checkpoint makes the result durable
+    LoadStats courses = { .path = cfg.courses }, students = { .path = cfg.students }, enrollments = { .path = cfg.enrollments };
+    double t_courses = 0, t_students = 0, t_enrollments = 0, t_index = 0, t_credits = 0;
+    uint64_t start = now_us(), t;
+    bool ok = exec_sql("PRAGMA synchronous=OFF; PRAGMA cache_size=-262144; PRAGMA temp_store=MEMORY; BEGIN;");
+
+    if (ok && cfg.courses) {
+        t = now_us();
+        ok = load_courses(&courses);
+        t_courses = (double)(now_us() - t) / 1e6;
+    }
+    if (ok && cfg.students) {
+        t = now_us();
+        ok = load_students(&students);
+        t_students = (double)(now_us() - t) / 1e6;
+    }
+    if (ok && cfg.enrollments) {
+        t = now_us();
+        ok = exec_sql(db_sqlite_drop_indexes_sql) && load_enrollments(&enrollments);
+        t_enrollments = (double)(now_us() - t) / 1e6;
+        if (ok) {
+            t = now_us();
+            ok = exec_sql(db_sqlite_create_indexes_sql);
+            t_index = (double)(now_us() - t) / 1e6;
+        }
+    }
+    if (ok) {
+        t = now_us();
+        ok = exec_sql("UPDATE student SET credits = COALESCE(("
+                      "SELECT SUM(course.credit) FROM enrollment JOIN course ON course.id = enrollment.course "
+                      "WHERE enrollment.student = student.id), 0.0);");
+        t_credits = (double)(now_us() - t) / 1e6;
+    }
+    ok = ok && exec_sql("COMMIT;");
+    if (!ok) {
+        exec_sql("ROLLBACK;");
+        fprintf(stderr, "import failed; batches committed before the error remain\n");
+    } else {
+        ok = exec_sql("PRAGMA synchronous=FULL; PRAGMA optimize; PRAGMA wal_checkpoint(TRUNCATE);");
+    }
+    sqlite3_close(db);
+
+    report(&courses, "courses", t_courses);
+    report(&students, "students", t_students);
+    report(&enrollments, "enrollments", t_enrollments);
+    if (ok) {
+        if (cfg.enrollments) fprintf(stderr, "%-12s %.2fs\n", "index", t_index);
+        fprintf(stderr, "%-12s %.2fs\n", "credits", t_credits);
+        fprintf(stderr, "%-12s %.2fs\n", "total", (double)(now_us() - start) / 1e6);
+    }
+    return ok ? 0 : 1;
+}
@@ -76,6 +76,10 @@ const api = {
         });
     },
 
+    async findCourseById(courseId) {
+        return await this.request(`/course/find?id=${encodeURIComponent(courseId)}`);
+    },
+
     async findStudentById(studentId) {
         return await this.request(`/student/find?student_id=${encodeURIComponent(studentId)}`);
     },
@@ -179,9 +183,173 @@ const api = {
     },
     async deleteAllEnrollments() {
         return await this.request('/enrollment/all', { method: 'DELETE' });
+    },
+    async getJob(id) {
+        return await this.request(`/jobs/${encodeURIComponent(id)}`);
     }
 };
 
+// Live updates: the server pushes { entity, op, key } notifications over /events
+// and state is patched in place instead of refetching whole tables.
+const liveFeed = {
+    connected: false,
+    resyncOnOpen: false,
+    retryMs: 1000
+};
+
+function connectLiveFeed() {
+    const socket = new WebSocket(`${API_BASE.replace(/^http/, 'ws')}/events`);
+
+    socket.onopen = () => {
+        liveFeed.connected = true;
+        liveFeed.retryMs = 1000;
+        // Notifications sent while we were disconnected are lost
+        if (liveFeed.resyncOnOpen) reloadCurrentView();
+    };
+
+    socket.onmessage = (message) => {
+        let changes;
+        try {
+            changes = JSON.parse(message.data);
+        } catch (error) {
+            console.error('Live feed parse error:', error);
+            return;
+        }
+        if (Array.isArray(changes)) applyChanges(changes);
+    };
+
+    socket.onclose = () => {
+        liveFeed.connected = false;
+        liveFeed.resyncOnOpen = true;
+        setTimeout(connectLiveFeed, liveFeed.retryMs);
+        liveFeed.retryMs = Math.min(liveFeed.retryMs * 2, 30000);
+    };
+}
+
+function reloadCurrentView() {
+    if (state.currentView === 'students') loadStudents();
+    else if (state.currentView === 'courses') loadCourses();
+    else if (state.currentView === 'enrollments') loadEnrollments();
+}
+
+// Refetch after our own writes only when the live feed cannot deliver the change
+function reloadIfOffline(...loaders) {
+    if (liveFeed.connected) return;
+    loaders.forEach(load => load());
+}
+
+function upsertBy(list, key, item) {
+    const idx = list.findIndex(x => x[key] === item[key]);
+    if (idx >= 0) list[idx] = item;
+    else list.push(item);
+}
+
+async function refreshStudent(studentId) {
+    const rows = await api.findStudentById(studentId);
+    const student = Array.isArray(rows) && rows.length > 0 ? rows[0] : null;
+    if (student) upsertBy(state.students, 'student_id', student);
+    else state.students = state.students.filter(s => s.student_id !== studentId);
+    state.enrollments.forEach(e => {
+        if (e.student_id === studentId) e.student_name = student?.name;
+    });
+}
+
+async function refreshCourse(courseId) {
+    const rows = await api.findCourseById(courseId);
+    const course = Array.isArray(rows) && rows.length > 0 ? rows[0] : null;
+    if (course) upsertBy(state.courses, 'course_id', course);
+    else state.courses = state.courses.filter(c => c.course_id !== courseId);
+    state.enrollments.forEach(e => {
+        if (e.course_id === courseId) e.course_name = course?.name;
+    });
+}
+
+// A bulk-delete job sends one remove_batch per chunk, without IDs, and a remove_all
+// when it finishes; reload once the chunks stop in case the job ended early
+let batchReloadTimer = null;
+function scheduleBatchReload() {
+    clearTimeout(batchReloadTimer);
+    batchReloadTimer = setTimeout(() => {
+        batchReloadTimer = null;
+        reloadCurrentView();
+    }, 2000);
+}
+
+async function applyChanges(changes) {
+    const staleStudents = new Set();
+    const staleCourses = new Set();
+
+    for (const change of changes) {
+        if (change.op === 'remove_batch') {
+            scheduleBatchReload();
+            continue;
+        }
+        if (change.entity === 'course') {
+            if (change.op === 'remove_all') {
+                state.courses = [];
+                state.enrollments = [];
+                staleCourses.clear();
+            } else if (change.op === 'remove') {
+                state.courses = state.courses.filter(c => c.course_id !== change.course_id);
+                state.enrollments = state.enrollments.filter(e => e.course_id !== change.course_id);
+                staleCourses.delete(change.course_id);
+            } else {
+                staleCourses.add(change.course_id);
+            }
+        } else if (change.entity === 'student') {
+            if (change.op === 'remove_all') {
+                state.students = [];
+                state.enrollments = [];
+                staleStudents.clear();
+            } else if (change.op === 'remove') {
+                state.students = state.students.filter(s => s.student_id !== change.student_id);
+                state.enrollments = state.enrollments.filter(e => e.student_id !== change.student_id);
+                staleStudents.delete(change.student_id);
+            } else {
+                staleStudents.add(change.student_id);
+            }
+        } else if (change.entity === 'enrollment') {
+            if (change.op === 'remove_all') {
+                state.enrollments = [];
+                state.students.forEach(s => { s.credits = 0; });
+            } else if (change.op === 'remove') {
+                state.enrollments = state.enrollments.filter(e =>
+                    !(e.student_id === change.student_id && e.course_id === change.course_id));
+                staleStudents.add(change.student_id);
+            } else if (change.op === 'add') {
+                const exists = state.enrollments.some(e =>
+                    e.student_id === change.student_id && e.course_id === change.course_id);
+                if (!exists) {
+                    state.enrollments.push({
+                        student_id: change.student_id,
+                        course_id: change.course_id,
+                        student_name: state.students.find(s => s.student_id === change.student_id)?.name,
+                        course_name: state.courses.find(c => c.course_id === change.course_id)?.name
+                    });
+                }
+                // Credits are recomputed server-side
+                staleStudents.add(change.student_id);
+            }
+        }
+    }
+
+    try {
+        await Promise.all([
+            ...[...staleStudents].map(refreshStudent),
+            ...[...staleCourses].map(refreshCourse)
+        ]);
+    } catch (error) {
+        console.error('Live feed refresh error:', error);
+    }
+
+    if (state.currentView === 'students') renderStudents();
+    else if (state.currentView === 'courses') renderCourses();
+    else if (state.currentView === 'enrollments') {
+        renderEnrollments();
+        updateDataLists();
+    }
+}
+
 // UI Functions
 function showStatus(message, type = 'success') {
     const statusEl = document.createElement('div');
@@ -300,7 +468,7 @@ async function addStudent(event) {
         await api.addStudent(student);
         showStatus('学生添加成功');
         closeModal('add-student-modal');
-        loadStudents();
+        reloadIfOffline(loadStudents);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
@@ -312,19 +480,32 @@ async function deleteStudent(studentId) {
     try {
         await api.removeStudent(studentId);
         showStatus('学生删除成功');
-        loadStudents();
+        reloadIfOffline(loadStudents);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
 }
 
+// Bulk deletes answer 202 with a job ID; report success only once the job is done
+async function waitForJob(result) {
+    if (!result || !result.job) return;
+    showStatus(`删除任务 #${result.job} 已提交，正在执行...`);
+    for (;;) {
+        await new Promise(resolve => setTimeout(resolve, 500));
+        const job = await api.getJob(result.job);
+        if (job.state === 'done') return;
+        if (job.state === 'failed' || job.state === 'cancelled') {
+            throw new Error(`删除任务 #${result.job} ${job.state === 'failed' ? '失败' : '已取消'}（已删除 ${job.removed} 行）`);
+        }
+    }
+}
+
 async function deleteAllStudents() {
     if (!confirm('确定删除所有学生和其相关选课记录吗？此操作不可逆。')) return;
     try {
-        await api.deleteAllStudents();
+        await waitForJob(await api.deleteAllStudents());
         showStatus('已删除所有学生');
-        loadStudents();
-        loadEnrollments();
+        reloadIfOffline(loadStudents, loadEnrollments);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
@@ -352,7 +533,7 @@ async function editStudent(event) {
         await api.updateStudent(student);
         showStatus('学生修改成功');
         closeModal('edit-student-modal');
-        loadStudents();
+        reloadIfOffline(loadStudents);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
@@ -361,9 +542,9 @@ async function editStudent(event) {
 async function deleteAllEnrollments() {
     if (!confirm('确定删除所有选课记录吗？此操作不可逆。')) return;
     try {
-        await api.deleteAllEnrollments();
+        await waitForJob(await api.deleteAllEnrollments());
         showStatus('已删除所有选课记录');
-        loadEnrollments();
+        reloadIfOffline(loadEnrollments);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
@@ -372,10 +553,9 @@ async function deleteAllEnrollments() {
 async function deleteAllCourses() {
     if (!confirm('确定删除所有课程和其相关选课记录吗？此操作不可逆。')) return;
     try {
-        await api.deleteAllCourses();
+        await waitForJob(await api.deleteAllCourses());
         showStatus('已删除所有课程');
-        loadCourses();
-        loadEnrollments();
+        reloadIfOffline(loadCourses, loadEnrollments);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
@@ -499,7 +679,7 @@ async function addCourse(event) {
         await api.addCourse(course);
         showStatus('课程添加成功');
         closeModal('add-course-modal');
-        loadCourses();
+        reloadIfOffline(loadCourses);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
@@ -511,7 +691,7 @@ async function deleteCourse(courseId) {
     try {
         await api.removeCourse(courseId);
         showStatus('课程删除成功');
-        loadCourses();
+        reloadIfOffline(loadCourses);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
@@ -548,7 +728,7 @@ async function editCourse(event) {
         await api.updateCourse(course);
         showStatus('课程修改成功');
         closeModal('edit-course-modal');
-        loadCourses();
+        reloadIfOffline(loadCourses);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
@@ -673,7 +853,7 @@ async function addEnrollment(event) {
         await api.addEnrollment(enrollment);
         showStatus('选课添加成功');
         closeModal('add-enrollment-modal');
-        loadEnrollments();
+        reloadIfOffline(loadEnrollments);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
@@ -685,7 +865,7 @@ async function deleteEnrollment(studentId, courseId) {
     try {
         await api.removeEnrollment(studentId, courseId);
         showStatus('选课记录删除成功');
-        loadEnrollments();
+        reloadIfOffline(loadEnrollments);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
@@ -717,7 +897,7 @@ async function editEnrollment(event) {
         });
         showStatus('选课记录修改成功');
         closeModal('edit-enrollment-modal');
-        loadEnrollments();
+        reloadIfOffline(loadEnrollments);
     } catch (error) {
         showStatus(`错误: ${error.message}`, 'error');
     }
@@ -947,10 +1127,10 @@ async function importCSV() {
         showStatus(`导入完成: ${successCount} 成功, ${errorCount} 失败`);
         closeModal('import-csv-modal');
         
-        // Reload data
-        if (state.importType === 'students') loadStudents();
-        else if (state.importType === 'courses') loadCourses();
-        else if (state.importType === 'enrollments') loadEnrollments();
+        // Reload data (the live feed already patched state if connected)
+        if (state.importType === 'students') reloadIfOffline(loadStudents);
+        else if (state.importType === 'courses') reloadIfOffline(loadCourses);
+        else if (state.importType === 'enrollments') reloadIfOffline(loadEnrollments);
         
     } catch (error) {
         showStatus(`导入错误: ${error.message}`, 'error');
@@ -1000,4 +1180,5 @@ function updatePageInfo(view, data) {
 // Initialize
 window.addEventListener('DOMContentLoaded', () => {
     loadStudents();
+    connectLiveFeed();
 });